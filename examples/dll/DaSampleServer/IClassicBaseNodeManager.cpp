@@ -43,6 +43,7 @@ namespace IClassicBaseNodeManager
 // GLOBALS (DON'T CHANGE)
 //-----------------------------------------------------------------------------
 AddItemPtr								addItemCallback;
+AddItemsPtr								addItemsCallback = NULL;    // Optional, only set by servers supporting it
 RemoveItemPtr							removeItemCallback;
 AddPropertyPtr							addPropertyCallback;
 SetItemValuePtr							setItemValueCallback;
@@ -62,6 +63,7 @@ AddExistingSourcePtr					addExistingSourceCallback;
 AddConditionPtr							addConditionCallback;
 ProcessSimpleEventPtr					processSimpleEventCallback;
 ProcessTrackingEventPtr					processTrackingEventCallback;
+ProcessEventsPtr						processEventsCallback = NULL;    // Optional, only set by servers supporting it
 ProcessConditionStateChangesPtr		    processConditionStateChangesCallback;
 AckConditionPtr							ackConditionCallback;
 
@@ -92,6 +94,31 @@ HRESULT AddAnalogItem(LPWSTR itemID, DaAccessRights accessRights, LPVARIANT init
 	return addItemCallback(itemID, accessRights, initValue, true, Analog, minValue, maxValue, deviceItemHandle);
 }
 
+HRESULT AddItems(int numItems, DaItemDefinition* items, void** deviceItemHandles, HRESULT* errors)
+{
+	if (addItemsCallback != NULL) {
+		return addItemsCallback(numItems, items, deviceItemHandles, errors);
+	}
+
+	// The server does not support bulk creation of items
+	HRESULT hrRet = S_OK;
+	for (int i = 0; i < numItems; i++) {
+		void* deviceItemHandle = NULL;
+		HRESULT hres = addItemCallback(items[i].ItemId, items[i].AccessRights, &items[i].InitValue, items[i].Active,
+										items[i].EuType, items[i].MinValue, items[i].MaxValue, &deviceItemHandle);
+		if (deviceItemHandles != NULL) {
+			deviceItemHandles[i] = SUCCEEDED(hres) ? deviceItemHandle : NULL;
+		}
+		if (errors != NULL) {
+			errors[i] = hres;
+		}
+		if (FAILED(hres)) {
+			hrRet = S_FALSE;
+		}
+	}
+	return hrRet;
+}
+
 HRESULT RemoveItem(void* deviceItemHandle)
 {
 	return removeItemCallback(deviceItemHandle);
@@ -170,6 +197,14 @@ DLLEXP HRESULT DLLCALL OnDefineDaCallbacks(
 }
 
 
+DLLEXP HRESULT DLLCALL OnDefineDaBulkCallbacks(
+						AddItemsPtr			addItems )
+{
+	addItemsCallback = addItems;
+	return S_OK;
+}
+
+
 DLLEXP HRESULT DLLCALL OnDefineAeCallbacks( 
 						AddSimpleEventCategoryPtr				addSimpleEventCat, 
 						AddTrackingEventCategoryPtr				addTrackingEventCat,
@@ -206,6 +241,14 @@ DLLEXP HRESULT DLLCALL OnDefineAeCallbacks(
     return S_OK;
 }
 
+
+DLLEXP HRESULT DLLCALL OnDefineAeBulkCallbacks(
+						ProcessEventsPtr	processEvents )
+{
+	processEventsCallback = processEvents;
+	return S_OK;
+}
+
 HRESULT AddSimpleEventCategory( int categoryID, LPWSTR categoryDescription)
 {
     return addSimpleEventCategoryCallback(categoryID, categoryDescription);
@@ -271,6 +314,34 @@ HRESULT ProcessTrackingEvent( int categoryId, int sourceId, LPWSTR message, int
 	return processTrackingEventCallback( categoryId, sourceId, message, severity, actorId, attributeCount, attributeValues, timeStamp );
 }
 
+HRESULT ProcessEvents(int count, AeEventDefinition* events, HRESULT* errors)
+{
+	if (processEventsCallback != NULL) {
+		return processEventsCallback(count, events, errors);
+	}
+
+	// The server does not support batched events
+	HRESULT hrRet = S_OK;
+	for (int i = 0; i < count; i++) {
+		HRESULT hres;
+		if (events[i].ActorId == NULL) {
+			hres = processSimpleEventCallback(events[i].CategoryId, events[i].SourceId, events[i].Message, events[i].Severity,
+											  events[i].AttributeCount, events[i].AttributeValues, events[i].TimeStamp);
+		}
+		else {
+			hres = processTrackingEventCallback(events[i].CategoryId, events[i].SourceId, events[i].Message, events[i].Severity,
+												events[i].ActorId, events[i].AttributeCount, events[i].AttributeValues, events[i].TimeStamp);
+		}
+		if (errors != NULL) {
+			errors[i] = hres;
+		}
+		if (FAILED(hres)) {
+			hrRet = S_FALSE;
+		}
+	}
+	return hrRet;
+}
+
 HRESULT ProcessConditionStateChanges(int count, AeConditionState* AeConditionStateChanges)
 {
     return processConditionStateChangesCallback(count, AeConditionStateChanges);
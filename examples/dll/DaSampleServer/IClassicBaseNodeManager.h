@@ -526,6 +526,122 @@ public:
     void*   DeviceItemHandle;
 };
 
+/**
+ * @class   DaItemDefinition
+ *
+ * @brief   The definition of an item added with AddItems().
+ */
+
+class DaItemDefinition
+{
+    // Attributes
+public:
+    /**
+     * @brief   Fully qualified item name.
+     */
+
+    LPWSTR  ItemId;
+
+    /**
+     * @brief   Access rights of the item.
+     */
+
+    DaAccessRights  AccessRights;
+
+    /**
+     * @brief   Initial value and canonical data type of the item. The value is cleared by
+     *          AddItems().
+     */
+
+    VARIANT InitValue;
+
+    /**
+     * @brief   true to set the item in active state.
+     */
+
+    bool    Active;
+
+    /**
+     * @brief   Type of the Engineering Unit.
+     */
+
+    DaEuType    EuType;
+
+    /**
+     * @brief   Analog engineering unit, corresponding to the LOW EU range.
+     */
+
+    double  MinValue;
+
+    /**
+     * @brief   Analog engineering unit, corresponding to the HIGH EU range.
+     */
+
+    double  MaxValue;
+};
+
+/**
+ * @class   AeEventDefinition
+ *
+ * @brief   The definition of a Simple or Tracking Event generated with ProcessEvents().
+ */
+
+class AeEventDefinition
+{
+    // Attributes
+public:
+    /**
+     * @brief   Identifier of an existing Event Category.
+     */
+
+    int     CategoryId;
+
+    /**
+     * @brief   Identifier of an existing Event Source.
+     */
+
+    int     SourceId;
+
+    /**
+     * @brief   Message text string which describes the Event.
+     */
+
+    LPWSTR  Message;
+
+    /**
+     * @brief   The urgency of the Event in the range of 1 ... 1000.
+     */
+
+    int     Severity;
+
+    /**
+     * @brief   Text string which identifies the OPC Client which initiated the action resulting
+     *          the tracking\-related Event. A Simple Event is generated if this member is a NULL
+     *          pointer.
+     */
+
+    LPWSTR  ActorId;
+
+    /**
+     * @brief   Number of attribute values specified in AttributeValues.
+     */
+
+    int     AttributeCount;
+
+    /**
+     * @brief   Array of attribute values. The order and the types must be identical with the
+     *          attributes of the specified Event Category.
+     */
+
+    LPVARIANT   AttributeValues;
+
+    /**
+     * @brief   Occurrence time of the event. If NULL pointer then the current time is used.
+     */
+
+    LPFILETIME  TimeStamp;
+};
+
 /**
  * @}
  */
@@ -675,6 +791,33 @@ HRESULT AddItem(LPWSTR itemId, DaAccessRights accessRights, LPVARIANT initValue,
 
 HRESULT AddAnalogItem(LPWSTR itemId, DaAccessRights accessRights, LPVARIANT initValue, double minValue, double maxValue, void** deviceItemHandle = nullptr);
 
+/**
+ * @fn  HRESULT AddItems(int numItems, DaItemDefinition* items, void** deviceItemHandles, HRESULT* errors);
+ *
+ * @brief   This function is called by the customization plugin and adds several items to the
+ *          generic server cache with one call.
+ *          
+ *          The items are created and the browse hierarchy is built outside of the lock
+ *          protecting the server cache; the built hierarchy is then published with a single
+ *          locked operation. Use this method instead of calling AddItem for each item if a
+ *          large number of items is added, e.g. during the execution of
+ *          <see cref="OnCreateServerItems" text="OnCreateServerItems" />.
+ *
+ * @param           numItems            Number of items to add.
+ * @param [in,out]  items               The item definitions. The InitValue of each item is
+ *                                      cleared.
+ * @param [out]     deviceItemHandles   If non\-null, the function returns the created device
+ *                                      items. The handle is null for items which could not be
+ *                                      added.
+ * @param [out]     errors              If non\-null, the function returns the result for each
+ *                                      item. E_INVALIDARG if the item ID already exists.
+ *
+ * @return  A HRESULT code with the result of the operation. Returns S_OK if all items were
+ *          successfully added to the cache; S_FALSE if one or more items could not be added.
+ */
+
+HRESULT AddItems(int numItems, DaItemDefinition* items, void** deviceItemHandles = nullptr, HRESULT* errors = nullptr);
+
 /**
  * @brief    This function is called by the customization plugin and removes an item from the
  *             generic server cache. If
@@ -1160,6 +1303,26 @@ HRESULT ProcessSimpleEvent(int categoryId, int sourceId, LPWSTR message, int sev
 
 HRESULT ProcessTrackingEvent(int categoryId, int sourceId, LPWSTR message, int severity, LPWSTR actorId, int attributeCount, LPVARIANT attributeValues, LPFILETIME timeStamp);
 
+/**
+ * @fn  HRESULT ProcessEvents(int count, AeEventDefinition* events, HRESULT* errors);
+ *
+ * @brief   Generates several Simple and Tracking Events with one call.
+ *          
+ *          All events are validated and created with a single pass over the Event Sources and
+ *          Event Categories and are then forwarded with one notification to the subscriptions
+ *          of each connected client. Use this function instead of ProcessSimpleEvent() or
+ *          ProcessTrackingEvent() if events are generated in bursts.
+ *
+ * @param           count   Number of events in events.
+ * @param [in]      events  The event definitions.
+ * @param [out]     errors  If non\-null, the function returns the result for each event.
+ *
+ * @return  A HRESULT code with the result of the operation. Returns S_OK if all events were
+ *          successfully generated; S_FALSE if one or more events could not be generated.
+ */
+
+HRESULT ProcessEvents(int count, AeEventDefinition* events, HRESULT* errors = nullptr);
+
 /**
  * @fn  HRESULT ProcessConditionStateChanges(int count, AeConditionState* conditionStateChanges);
  *
@@ -1748,6 +1911,58 @@ DLLEXP void DLLCALL OnGetLogPath(char * logPath);
 
 DLLEXP HRESULT DLLCALL OnRequestItems(int numItems, LPWSTR *fullItemIds, VARTYPE *dataTypes);
 
+/**
+ * @fn  HRESULT DLLCALL OnBrowseChildren(LPCWSTR branchId, int * noBranches, LPWSTR ** branchNames, int * noLeafs, LPWSTR ** leafNames, VARTYPE ** leafDataTypes, DaAccessRights ** leafAccessRights);
+ *
+ * @brief   This method is called when a client browses a branch of the server's address space
+ *          the first time.
+ *          
+ *          It returns the names of the branches and leaves of the specified branch. The generic
+ *          server keeps the names of recently browsed branches in a cache of limited size and
+ *          calls this function again if a branch is browsed which is no longer in the cache. This
+ *          allows large or dynamic address spaces without adding all items at startup. Items
+ *          used by a client are requested with OnRequestItems.
+ *          
+ *          This method is optional and only used with the generic browse mode. All arrays and
+ *          strings must be allocated with CoTaskMemAlloc and are released by the generic server.
+ *
+ * @param   branchId                    Fully qualified name of the branch. An empty string is
+ *                                      the root.
+ * @param [out]     noBranches          Number of returned branch names.
+ * @param [out]     branchNames         Names of the branches of the branch.
+ * @param [out]     noLeafs             Number of returned leaf names.
+ * @param [out]     leafNames           Names of the leaves of the branch.
+ * @param [out]     leafDataTypes       Data types of the leaves. Can be set to NULL if unknown.
+ * @param [out]     leafAccessRights    Access rights of the leaves. Can be set to NULL; the
+ *                                      leaves are then readable and writable.
+ *
+ * @return  A HRESULT code with the result of the operation. E_INVALIDARG if the branch doesn't
+ *          exist.
+ */
+
+DLLEXP HRESULT DLLCALL OnBrowseChildren(LPCWSTR branchId, int * noBranches, LPWSTR ** branchNames, int * noLeafs, LPWSTR ** leafNames, VARTYPE ** leafDataTypes, DaAccessRights ** leafAccessRights);
+
+/**
+ * @fn  HRESULT DLLCALL OnGetDaAddressSpaceParameters(bool * useCompactAddressSpace);
+ *
+ * @brief   This method is called from the generic server at startup, after
+ *          OnGetDaOptimizationParameters.
+ *          
+ *          It defines how the generic server stores the server's address space. The compact
+ *          address space keeps the item names in a trie instead of one object per branch and
+ *          leaf. It needs much less memory and is recommended for servers with a very large
+ *          number of items.
+ *          
+ *          This method is optional. If it is not exported the compact address space is not used.
+ *
+ * @param [in,out]  useCompactAddressSpace  Specify whether the compact address space is used;
+ *                                          default is false.
+ *
+ * @return  A HRESULT code with the result of the operation.
+ */
+
+DLLEXP HRESULT DLLCALL OnGetDaAddressSpaceParameters(bool * useCompactAddressSpace);
+
 /**
  * @}
  */
@@ -1756,6 +1971,7 @@ DLLEXP HRESULT DLLCALL OnRequestItems(int numItems, LPWSTR *fullItemIds, VARTYPE
 // Type Definitions
 //----------------------------------------------------------------------------
 typedef HRESULT(DLLCALL * AddItemPtr)(LPWSTR, DaAccessRights, LPVARIANT, bool, DaEuType, double, double, void**);
+typedef HRESULT(DLLCALL * AddItemsPtr)(int, DaItemDefinition*, void**, HRESULT*);
 typedef HRESULT(DLLCALL * RemoveItemPtr)(void*);
 typedef HRESULT(DLLCALL * AddPropertyPtr)(int, LPWSTR, LPVARIANT);
 typedef HRESULT(DLLCALL * SetItemValuePtr)(void*, LPVARIANT, short, FILETIME);
@@ -1781,6 +1997,7 @@ typedef HRESULT(DLLCALL * AddConditionPtr)(int, int, int);
 typedef HRESULT(DLLCALL * ProcessSimpleEventPtr)(int, int, LPWSTR, int, int, LPVARIANT pvAttrValues, LPFILETIME);
 typedef HRESULT(DLLCALL * ProcessTrackingEventPtr)(int, int, LPWSTR, int, LPWSTR, int, LPVARIANT, LPFILETIME);
 typedef HRESULT(DLLCALL * ProcessConditionStateChangesPtr)(int, IClassicBaseNodeManager::AeConditionState*);
+typedef HRESULT(DLLCALL * ProcessEventsPtr)(int, IClassicBaseNodeManager::AeEventDefinition*, HRESULT*);
 typedef HRESULT(DLLCALL * AckConditionPtr)(int, LPWSTR);
 
 typedef void (DLLCALL * FireShutdownRequestPtr)(LPCWSTR reason);
@@ -0,0 +1,133 @@
+/*
+ * Copyright (c) 2020 Technosoftware GmbH. All rights reserved
+ * Web: https://technosoftware.com 
+ * 
+ * The source code in this file is covered under a dual-license scenario:
+ *   - Owner of a purchased license: SCLA 1.0
+ *   - GPL V3: everybody else
+ *
+ * SCLA license terms accompanied with this source code.
+ * See https://technosoftware.com/license/Source_Code_License_Agreement.pdf
+ *
+ * GNU General Public License as published by the Free Software Foundation;
+ * version 3 of the License are accompanied with this source code.
+ * See https://technosoftware.com/license/GPLv3License.txt
+ *
+ * This source code is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+
+#ifdef   _OPC_SRV_AE                            // Alarms & Events Server
+
+//DOM-IGNORE-BEGIN
+//-------------------------------------------------------------------------
+// INLCUDE
+//-------------------------------------------------------------------------
+#include "stdafx.h"
+#include <stdlib.h>
+#include "AeAreaSet.h"
+
+#ifdef _DEBUG
+#define new DEBUG_NEW
+#endif
+
+//-------------------------------------------------------------------------
+// CODE
+//-------------------------------------------------------------------------
+
+static int __cdecl CompareAreaIndex( const void* p1, const void* p2 )
+{
+   DWORD dw1 = *static_cast<const DWORD*>(p1);
+   DWORD dw2 = *static_cast<const DWORD*>(p2);
+   return (dw1 < dw2) ? -1 : ((dw1 > dw2) ? 1 : 0);
+}
+
+
+
+//=========================================================================
+// Construction
+//=========================================================================
+AeAreaSet::AeAreaSet()
+{
+   count_   = 0;
+   indices_ = NULL;
+}
+
+
+
+//=========================================================================
+// Destructor
+//=========================================================================
+AeAreaSet::~AeAreaSet()
+{
+   if (indices_) {
+      delete [] indices_;
+   }
+}
+
+
+
+//=========================================================================
+// Create
+// ------
+//    Creates a new set with a sorted copy of the specified indices.
+//    The returned instance is already referenced by the caller.
+//=========================================================================
+HRESULT AeAreaSet::Create( const DWORD* indices, DWORD count, AeAreaSet** areaSet )
+{
+   *areaSet = NULL;
+
+   AeAreaSet* pSet = new AeAreaSet;
+   if (!pSet) return E_OUTOFMEMORY;
+
+   if (count) {
+      pSet->indices_ = new DWORD [count];
+      if (!pSet->indices_) {
+         delete pSet;
+         return E_OUTOFMEMORY;
+      }
+      memcpy( pSet->indices_, indices, count * sizeof (DWORD) );
+      qsort( pSet->indices_, count, sizeof (DWORD), CompareAreaIndex );
+
+      DWORD n = 1;                              // Remove duplicates
+      for (DWORD i = 1; i < count; i++) {
+         if (pSet->indices_[i] != pSet->indices_[n - 1]) {
+            pSet->indices_[n++] = pSet->indices_[i];
+         }
+      }
+      pSet->count_ = n;
+   }
+
+   pSet->AddRef();
+   *areaSet = pSet;
+   return S_OK;
+}
+
+
+
+//=========================================================================
+// Intersects
+// ----------
+//    Both index lists are sorted, so a single merge pass is sufficient.
+//=========================================================================
+BOOL AeAreaSet::Intersects( const AeAreaSet* other ) const
+{
+   DWORD i = 0, j = 0;
+
+   while (i < count_ && j < other->count_) {
+      if (indices_[i] == other->indices_[j]) {
+         return TRUE;
+      }
+      if (indices_[i] < other->indices_[j]) {
+         i++;
+      }
+      else {
+         j++;
+      }
+   }
+   return FALSE;
+}
+//DOM-IGNORE-END
+#endif
@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2020 Technosoftware GmbH. All rights reserved
+ * Web: https://technosoftware.com 
+ * 
+ * The source code in this file is covered under a dual-license scenario:
+ *   - Owner of a purchased license: SCLA 1.0
+ *   - GPL V3: everybody else
+ *
+ * SCLA license terms accompanied with this source code.
+ * See https://technosoftware.com/license/Source_Code_License_Agreement.pdf
+ *
+ * GNU General Public License as published by the Free Software Foundation;
+ * version 3 of the License are accompanied with this source code.
+ * See https://technosoftware.com/license/GPLv3License.txt
+ *
+ * This source code is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+
+#ifndef __AeAreaSet_H
+#define __AeAreaSet_H
+
+//DOM-IGNORE-BEGIN
+
+#if _MSC_VER >= 1000
+#pragma once
+#endif // _MSC_VER >= 1000
+
+#include "UtilityDefs.h"                        // for CRefClass
+
+/**
+ * @class	AeAreaSet
+ *
+ * @brief	Immutable reference counted set of Area indices.
+ * 			Each Area of the Process Area Space has a dense index assigned at creation. A
+ * 			source keeps the set of the Areas it belongs to and all events generated for the
+ * 			source reference this set. The area filter of a subscription is resolved to such
+ * 			a set too, so filtering an event is an intersection of two sorted index lists
+ * 			instead of a comparison of area names.
+ */
+
+class AeAreaSet : public CRefClass
+{
+public:
+
+   /**
+    * @fn	static HRESULT AeAreaSet::Create( const DWORD* indices, DWORD count, AeAreaSet** areaSet );
+    *
+    * @brief	Creates a new set with the specified Area indices.
+    *
+    * @param 		 	indices	The Area indices in any order. Duplicates are removed.
+    * @param 		 	count  	Number of indices.
+    * @param [out]	areaSet	The created set with a reference count of 1.
+    *
+    * @return	S_OK if succeeded; otherwise E_OUTOFMEMORY.
+    */
+
+   static HRESULT Create( const DWORD* indices, DWORD count, AeAreaSet** areaSet );
+
+   /**
+    * @fn	BOOL AeAreaSet::Intersects( const AeAreaSet* other ) const;
+    *
+    * @brief	Checks if this set and the specified set have at least one Area in common.
+    *
+    * @param	other	The other set.
+    *
+    * @return	TRUE if at least one Area is member of both sets; otherwise FALSE.
+    */
+
+   BOOL Intersects( const AeAreaSet* other ) const;
+
+   inline DWORD         Count()   const { return count_; }
+   inline const DWORD*  Indices() const { return indices_; }
+
+protected:
+   AeAreaSet();
+   ~AeAreaSet();                                // Destructor only called by Release()
+
+   /** @brief	Number of indices. */
+   DWORD    count_;
+
+   /** @brief	The Area indices in ascending order. */
+   DWORD*   indices_;
+};
+//DOM-IGNORE-END
+
+#endif // __AeAreaSet_H
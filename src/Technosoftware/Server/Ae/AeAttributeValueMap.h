@@ -28,6 +28,7 @@
 #endif // _MSC_VER >= 1000
 
 #include <comdef.h>                             // for _variant_t
+#include "UtilityDefs.h"                        // for CRefClass
 
 /**
  * @class	AttributeValueMap
@@ -120,6 +121,30 @@ protected:
    /** @brief	The size. */
    DWORD          size_;
 };
+
+/**
+ * @class	SharedAttributeValueMap
+ *
+ * @brief	Reference counted Attribute Value Map which is not changed after initialization.
+ * 			A snapshot of the attribute values of a condition is shared by all event instances
+ * 			generated while the attribute values are unchanged.
+ */
+
+class SharedAttributeValueMap : public AttributeValueMap, public CRefClass
+{
+public:
+
+   /**
+    * @fn	SharedAttributeValueMap::SharedAttributeValueMap()
+    *
+    * @brief	Default constructor. The new instance is referenced by the creator.
+    */
+
+   SharedAttributeValueMap() { AddRef(); }
+
+protected:
+   ~SharedAttributeValueMap() {}                // Destructor only called by Release()
+};
 //DOM-IGNORE-END
 
 #endif // __AttributeValueMap_H
@@ -33,6 +33,12 @@
 #include "AeEvent.h"
 #include "MatchPattern.h"
 
+//-------------------------------------------------------------------------
+// DEFINES
+//-------------------------------------------------------------------------
+// Max. number of saved replay positions of removed subscriptions
+#define  MAX_REPLAY_POSITIONS  256
+
 //-------------------------------------------------------------------------
 // CODE AeConditionChangeStates
 //-------------------------------------------------------------------------
@@ -88,6 +94,7 @@ AeConditionChangeStates::AeConditionChangeStates(
 //=========================================================================
 AeBaseServer::AeBaseServer()
 {
+    m_fCoalesceConditions = FALSE;
 }
 
 
@@ -120,6 +127,7 @@ AeBaseServer::~AeBaseServer()
             if (pCond) delete pCond;
         }
         m_mapConditions.RemoveAll();
+        m_mapCondCookies.RemoveAll();
         m_csCondMap.Unlock();
     }
     // Cleanup Condition Definition Map
@@ -543,6 +551,7 @@ HRESULT AeBaseServer::AddExistingSource(DWORD dwAreaID, DWORD dwSrcID)
     HRESULT  hres = S_OK;
 
     m_csSrcMap.Lock();
+    m_csCondMap.Lock();
     try {
         EventArea*    pArea = NULL;
         AeSource*  pSrc = NULL;
@@ -554,10 +563,14 @@ HRESULT AeBaseServer::AddExistingSource(DWORD dwAreaID, DWORD dwSrcID)
         if (!pSrc) throw E_INVALID_HANDLE;       // There is no source with the specified ID
 
         hres = pSrc->AddToAdditionalArea(pArea);
-    }
+        if (FAILED(hres)) throw hres;
+                                                 // The conditions of the source must know
+        hres = pSrc->UpdateConditionAreas();     // the new area for area filters and
+    }                                            // EnableConditionByArea().
     catch (HRESULT hresEx) {
         hres = hresEx;
     }
+    m_csCondMap.Unlock();
     m_csSrcMap.Unlock();
 
     return hres;
@@ -601,7 +614,7 @@ HRESULT AeBaseServer::AddCondition(DWORD dwSrcID, DWORD dwCondDefID, DWORD dwCon
         pCond = new AeCondition;              // Create a new instance.
         if (!pCond) throw E_OUTOFMEMORY;
         // Initialize new instance
-        hres = pCond->Create(dwCondID, pCondDef, pSrc);
+        hres = pCond->Create(dwCondID, pCondDef, pSrc, &m_RefreshSet);
         if (FAILED(hres)) throw hres;
 
         hres = pSrc->AttachCondition(pCond);    // Attach the condition the specified source
@@ -611,6 +624,13 @@ HRESULT AeBaseServer::AddCondition(DWORD dwSrcID, DWORD dwCondDefID, DWORD dwCon
             pSrc->DetachCondition(pCond);        // Detach the condition  from the source
             throw E_OUTOFMEMORY;
         }
+        // Add the condition to the cookie index used by AckCondition()
+        _ASSERTE(m_mapCondCookies.Lookup(pCond->Cookie()) == NULL);
+        if (!m_mapCondCookies.SetAt(pCond->Cookie(), pCond)) {
+            m_mapConditions.Remove(dwCondID);
+            pSrc->DetachCondition(pCond);        // Detach the condition  from the source
+            throw E_OUTOFMEMORY;
+        }
     }
     catch (HRESULT hresEx) {
         if (pCond)
@@ -716,6 +736,121 @@ HRESULT AeBaseServer::ProcessEvent(DWORD dwCatID, DWORD dwSrcID, LPCWSTR szMessa
 
 
 
+//=========================================================================
+// ProcessEvents
+// -------------
+//    Creates several simple or tracking events and process them.
+//    All events are created with one lock of the source and category
+//    maps and are processed with one call for each connected client.
+//
+// Parameters:
+//    IN
+//       dwCount              The number of events.
+//       pEvents              Array with the event data. The members
+//                            have the same meaning as the parameters
+//                            of ProcessEvent(). A tracking event is
+//                            generated if m_szActorID is not NULL.
+//    OUT
+//       errors               Array of HRESULTs indicating the success of
+//                            the individial events.
+//                            This parameter is optional. 
+//
+// Return Code:
+//    S_OK                    All succeeded
+//    S_FALSE                 The operation succeeded but not for all
+//                            specified events. Refer to individual
+//                            error returns for more information.
+//    E_XXX                   Error occured.
+//=========================================================================
+HRESULT AeBaseServer::ProcessEvents(DWORD dwCount, EVENTDATA* pEvents, HRESULT* errors /* = NULL */)
+{
+    HRESULT        hres, hresRet = S_OK;
+    AeEvent*      pEvent;
+    AeEventArray  arEvents;
+    AeSource*     pSrc = NULL;
+    AeCategory*   pCat = NULL;
+    DWORD          dwSrcID = 0;
+    DWORD          dwCatID = 0;
+    DWORD          i;
+    int            nServers;
+
+    m_csServers.Lock();
+    nServers = m_arServers.GetSize();
+    m_csServers.Unlock();
+    if (!nServers) {                             // There are no clients connected
+        if (errors) {
+            for (i = 0; i < dwCount; i++) {
+                errors[i] = S_OK;
+            }
+        }
+        return S_OK;
+    }
+
+    hres = arEvents.Create(dwCount);
+    if (FAILED(hres)) return hres;
+
+    m_csSrcMap.Lock();
+    m_csCatMap.Lock();
+    for (i = 0; i < dwCount; i++) {
+        EVENTDATA* pED = &pEvents[i];
+        pEvent = NULL;
+        try {
+            if (!pED->m_szMessage) throw E_INVALIDARG;
+            if (pED->m_dwSeverity < MIN_LOW_SEVERITY || pED->m_dwSeverity > 1000)
+                throw E_INVALIDARG;
+
+            // Consecutive events are usually generated by the same
+            // source with the same category.
+            if (!pSrc || dwSrcID != pED->m_dwSrcID) {
+                dwSrcID = pED->m_dwSrcID;
+                pSrc = m_mapSources.Lookup(dwSrcID);
+            }
+            if (!pSrc) throw E_INVALID_HANDLE;    // There is no source with the specified ID
+
+            if (!pCat || dwCatID != pED->m_dwCatID) {
+                dwCatID = pED->m_dwCatID;
+                pCat = m_mapCategories.Lookup(dwCatID);
+            }
+            if (!pCat) throw E_INVALID_HANDLE;    // There is no category with the specified ID
+
+                                                  // Invalid number of attributes specified
+            if (pED->m_dwAttrCount != (pCat->NumOfAttrs() - pCat->NumOfInternalAttrs()))
+                throw E_INVALIDARG;
+
+            pEvent = new AeEvent;                // Create an event instance
+            if (!pEvent) throw E_OUTOFMEMORY;
+            // Initialize event instance as simple or tracking event
+            hres = pEvent->Create(pCat, pSrc, pED->m_szMessage, pED->m_dwSeverity, pED->m_szActorID,
+                pED->m_pvAttrValues, pED->m_pftTimeStamp);
+            if (FAILED(hres)) throw hres;
+
+            hres = arEvents.Add(pEvent);         // The array releases the event
+            if (FAILED(hres)) throw hres;        // Not added, released by the catch block
+        }
+        catch (HRESULT hresEx) {
+            if (pEvent) {
+                pEvent->Release();
+            }
+            hres = hresEx;
+        }
+        if (errors) {
+            errors[i] = hres;
+        }
+        if (FAILED(hres)) {
+            hresRet = S_FALSE;
+        }
+    }
+    m_csCatMap.Unlock();
+    m_csSrcMap.Unlock();
+
+    if (arEvents.NumOfEvents()) {
+        FireEvents(arEvents);                   // Notify all subscribed clients
+    }
+    return hresRet;
+}
+
+
+
 //=========================================================================
 // ProcessConditionStateChanges
 // ----------------------------
@@ -1125,10 +1260,10 @@ HRESULT AeBaseServer::AckCondition(
         for (DWORD i = 0; i < dwCount; i++) {       // Acknowledge all specified conditions
 
             if (pdwCookie[i]) {                    // There is cookie specified. The cookie specifies the condition
-                AeCondition* pCond = (AeCondition*)(pdwCookie[i]);
+                AeCondition* pCond = NULL;
                 m_csCondMap.Lock();
                 // Test if the specific condition is still available
-                if (m_mapConditions.FindVal(pCond) != -1) {
+                if (m_mapCondCookies.Lookup(pdwCookie[i], pCond)) {
                     if (!pCond->IsAttachedTo(pszSource[i], pszConditionName[i])) {
                         aErr[i] = E_INVALIDARG;       // Invalid Condition or Source Name
                     }
@@ -1232,7 +1367,9 @@ HRESULT AeBaseServer::EnableConditions(
         m_csSrcMap.Unlock();
     }
     else {                                       // Change Condition State by Area
-        EventArea* pArea;
+        EventArea*           pArea;
+        CSimpleArray<DWORD>  arAreaIndices;      // Areas already handled
+        AeAreaSet*           pDone = NULL;
 
         for (i = 0; i < dwCount; i++) {
 
@@ -1243,16 +1380,31 @@ HRESULT AeBaseServer::EnableConditions(
 
             hres = m_RootArea.PositionTo(pszNames[i], &pArea);
             if (SUCCEEDED(hres)) {
+                // Only the sources of the area are visited. Sources which
+                // also belong to an area specified before are skipped.
                 CSimpleValArray<AeEventArray*> arparEvents;
-                hres = pArea->EnableConditions(fEnable, arparEvents);
+                hres = pArea->EnableConditions(fEnable, pDone, arparEvents);
                 if (FAILED(hres)) {
                     hresRet = hres;
                 }
+                else if (hres == S_FALSE && hresRet == S_OK) {
+                    hresRet = S_FALSE;              // Not succeeded for all conditions
+                }
                 for (int z = 0; z < arparEvents.GetSize(); z++) {
                     FireEvents(*(arparEvents[z])); // Notify all subscribed clients
                     delete arparEvents[z];
                 }
                 arparEvents.RemoveAll();
+
+                if (arAreaIndices.Add(pArea->Index())) {
+                    AeAreaSet* pNext;
+                    if (SUCCEEDED(AeAreaSet::Create(arAreaIndices.GetData(), arAreaIndices.GetSize(), &pNext))) {
+                        if (pDone) {
+                            pDone->Release();
+                        }
+                        pDone = pNext;
+                    }
+                }
             }
             else if (hres == OPC_E_INVALIDBRANCHNAME) {
                 hresRet = E_INVALIDARG;             // E_INVALIDARG if invalid Area is specified
@@ -1261,6 +1413,9 @@ HRESULT AeBaseServer::EnableConditions(
                 hresRet = hres;                     // other error
             }
         }
+        if (pDone) {
+            pDone->Release();
+        }
     }
     m_csCondMap.Unlock();                        // The source/area functions uses the condition array
 
@@ -1355,8 +1510,13 @@ HRESULT AeBaseServer::TranslateToItemIDs(
 //=========================================================================
 // GetEventsForRefresh
 // -------------------
-//    Creates and returns the events appropriate to the active and
-//    inactive, unacknowledged conidtions in the event sever.
+//    Returns the events appropriate to the active and inactive,
+//    unacknowledged conidtions in the event sever.
+//    The events are taken from the refresh set which is maintained by
+//    the conditions. Only the events of conditions whose event could
+//    not be created during the last state change are created here.
+//    Therefore the condition map is only locked if there are such
+//    conditions.
 //    Checks the 'cancel refresh' flag of the event subscription 
 //    if in progress.
 //    This function is called from the EventRefreshThread.
@@ -1374,25 +1534,33 @@ HRESULT AeBaseServer::GetEventsForRefresh(
     AeCondition*  pCond;
     AeEvent*         pEvent;
     int               i;
+    CSimpleArray<AeCondition*> arStaleConds;
 
-    m_csCondMap.Lock();
     try {
-        for (i = 0; i < m_mapConditions.GetSize(); i++) {
-            // Terminate function if refresh canceled
-            if (pSubscr->IsCancelRefreshActive()) throw S_OK;
+        hres = m_RefreshSet.GetEvents(arEventPtrs, arStaleConds);
+        if (FAILED(hres)) throw hres;
 
-            pCond = m_mapConditions.GetValueAt(i);
+        if (arStaleConds.GetSize()) {
+            m_csCondMap.Lock();
+            for (i = 0; i < arStaleConds.GetSize(); i++) {
+                // Terminate function if refresh canceled
+                if (pSubscr->IsCancelRefreshActive()) break;
 
-            if (pCond->IsEnabled() &&
-                (pCond->IsActive() || !pCond->IsAcked())) {
-                // Enabled condition which is active
-                // or inactive, unacknowledged
-                // Create an event instance
-                hres = pCond->CreateEventInstance(&pEvent);
-                if (FAILED(hres)) throw hres;
+                pCond = arStaleConds[i];
+                if (pCond->IsRefreshRequired()) {
+                    // State may be changed after the snapshot
+                    hres = pCond->CreateEventInstance(&pEvent);
+                    if (FAILED(hres)) break;
 
-                if (!arEventPtrs.Add(pEvent)) throw E_OUTOFMEMORY;
+                    if (!arEventPtrs.Add(pEvent)) {
+                        pEvent->Release();
+                        hres = E_OUTOFMEMORY;
+                        break;
+                    }
+                }
             }
+            m_csCondMap.Unlock();
+            if (FAILED(hres)) throw hres;
         }
     }
     catch (HRESULT hresEx) {
@@ -1402,7 +1570,6 @@ HRESULT AeBaseServer::GetEventsForRefresh(
         arEventPtrs.RemoveAll();
         hres = hresEx;
     }
-    m_csCondMap.Unlock();
 
     return hres;
 }
@@ -1497,6 +1664,33 @@ BOOL AeBaseServer::ExistArea(LPCWSTR szName)
 
 
 
+//=========================================================================
+// GetAreaSet
+// ----------
+//    Creates a set with the indices of all areas with the specified
+//    fully qualified names. Names without a matching area are ignored.
+//    The returned set must be released by the caller.
+//
+// Parameters:
+//    dwNumAreas              Number of area names.
+//    pszNames                The fully qualified area names. Wildcards
+//                            are not supported.
+//    ppAreaSet               The created set.
+//=========================================================================
+HRESULT AeBaseServer::GetAreaSet(DWORD dwNumAreas, LPCWSTR* pszNames, AeAreaSet** ppAreaSet)
+{
+    CSimpleArray<DWORD> arIndices;
+
+    *ppAreaSet = NULL;
+    for (DWORD i = 0; i < dwNumAreas; i++) {
+        HRESULT hres = m_RootArea.LookupAreaIndices(pszNames[i], arIndices);
+        if (FAILED(hres)) return hres;
+    }
+    return AeAreaSet::Create(arIndices.GetData(), arIndices.GetSize(), ppAreaSet);
+}
+
+
+
 //=========================================================================
 // FireEvent
 // ---------
@@ -1505,6 +1699,7 @@ BOOL AeBaseServer::ExistArea(LPCWSTR szName)
 HRESULT AeBaseServer::FireEvent(AeEvent* pEvent)
 {
     m_csServers.Lock();
+    m_EventHistory.Add(1, &pEvent);             // Number the event and keep it for replays
     for (long i = 0; i < m_arServers.GetSize(); i++) {
         m_arServers[i]->ProcessEvents(1, &pEvent);// Process the event for this client
     }
@@ -1522,6 +1717,7 @@ HRESULT AeBaseServer::FireEvent(AeEvent* pEvent)
 HRESULT AeBaseServer::FireEvents(AeEventArray& Events)
 {
     m_csServers.Lock();
+    m_EventHistory.Add(Events.NumOfEvents(), Events.EventPtrArray());
     for (long i = 0; i < m_arServers.GetSize(); i++) {
         m_arServers[i]->ProcessEvents(
             Events.NumOfEvents(), Events.EventPtrArray()
@@ -1533,6 +1729,106 @@ HRESULT AeBaseServer::FireEvents(AeEventArray& Events)
 
 
 
+//=========================================================================
+// SetEventHistorySize
+// -------------------
+//    Sets the number of recently fired events kept for the replay
+//    to subscriptions of reconnected clients.
+//=========================================================================
+HRESULT AeBaseServer::SetEventHistorySize(DWORD dwMaxEvents)
+{
+    return m_EventHistory.SetCapacity(dwMaxEvents);
+}
+
+
+
+//=========================================================================
+// GetNextEventSequence
+// --------------------
+//    Gets the sequence number of the next fired event. All events with
+//    a lower sequence number are already processed for all connected
+//    clients because the history is filled while m_csServers is locked.
+//=========================================================================
+ULONGLONG AeBaseServer::GetNextEventSequence()
+{
+    m_csServers.Lock();
+    ULONGLONG ullNext = m_EventHistory.NextSequence();
+    m_csServers.Unlock();
+    return ullNext;
+}
+
+
+
+//=========================================================================
+// SaveReplayPosition
+// ------------------
+//    Keeps the sequence number of the first event not yet sent to a
+//    subscription which is removed. Only subscriptions of clients with
+//    a name are kept because the client is identified by its name.
+//    The oldest position is removed if there are too many positions.
+//=========================================================================
+void AeBaseServer::SaveReplayPosition(LPCWSTR szClientName, OPCHANDLE hClientSubscription, ULONGLONG ullNextSequence)
+{
+    if (m_EventHistory.Capacity() == 0 || szClientName == NULL || *szClientName == L'\0') {
+        return;
+    }
+
+    REPLAYPOSITION rp;
+    rp.wsClientName = szClientName;
+    rp.hClientSubscription = hClientSubscription;
+    rp.ullNextSequence = ullNextSequence;
+
+    m_csReplayPositions.Lock();
+    for (int i = 0; i < m_arReplayPositions.GetSize(); i++) {
+        if (m_arReplayPositions[i].hClientSubscription == hClientSubscription &&
+            m_arReplayPositions[i].wsClientName == szClientName) {
+            m_arReplayPositions.RemoveAt(i);     // Replaced by the new position
+            break;
+        }
+    }
+    if (m_arReplayPositions.GetSize() >= MAX_REPLAY_POSITIONS) {
+        m_arReplayPositions.RemoveAt(0);
+    }
+    m_arReplayPositions.Add(rp);
+    m_csReplayPositions.Unlock();
+}
+
+
+
+//=========================================================================
+// TakeReplayPosition
+// ------------------
+//    Returns and removes the position saved by SaveReplayPosition() for
+//    the specified client and client subscription handle.
+//
+// returns:
+//    TRUE     there is a saved position
+//    FALSE    there is no position for this client subscription
+//=========================================================================
+BOOL AeBaseServer::TakeReplayPosition(LPCWSTR szClientName, OPCHANDLE hClientSubscription, ULONGLONG* pullNextSequence)
+{
+    BOOL fFound = FALSE;
+
+    if (szClientName == NULL || *szClientName == L'\0') {
+        return FALSE;
+    }
+
+    m_csReplayPositions.Lock();
+    for (int i = 0; i < m_arReplayPositions.GetSize(); i++) {
+        if (m_arReplayPositions[i].hClientSubscription == hClientSubscription &&
+            m_arReplayPositions[i].wsClientName == szClientName) {
+            *pullNextSequence = m_arReplayPositions[i].ullNextSequence;
+            m_arReplayPositions.RemoveAt(i);
+            fFound = TRUE;
+            break;
+        }
+    }
+    m_csReplayPositions.Unlock();
+    return fFound;
+}
+
+
+
 //=========================================================================
 // LookupSource
 // ------------
@@ -26,9 +26,32 @@
 #pragma once
 #endif // _MSC_VER >= 1000
 
+#include <atlcoll.h>
 #include "AeEventArea.h"
 #include "AeComBaseServer.h"
 #include "AeCondition.h"
+#include "AeEventHistory.h"
+
+
+//-----------------------------------------------------------------------
+// TYPEDEF EVENTDATA
+//-----------------------------------------------------------------------
+// A simple or tracking event generated with AeBaseServer::ProcessEvents().
+// A tracking event is generated if m_szActorID is not NULL.
+
+typedef struct tagEVENTDATA {
+
+   DWORD       m_dwCatID;
+   DWORD       m_dwSrcID;
+   LPCWSTR     m_szMessage;
+   DWORD       m_dwSeverity;
+   LPCWSTR     m_szActorID;
+   DWORD       m_dwAttrCount;
+   LPVARIANT   m_pvAttrValues;
+   LPFILETIME  m_pftTimeStamp;
+
+} EVENTDATA;
+
 
 
 //-----------------------------------------------------------------------
@@ -101,12 +124,24 @@ public:
 
    HRESULT  ProcessSimpleEvent( DWORD dwCatID, DWORD dwSrcID, LPCWSTR szMessage, DWORD dwSeverity, DWORD dwAttrCount = 0, LPVARIANT pvAttrValues = NULL, LPFILETIME pft = NULL );
    HRESULT  ProcessTrackingEvent( DWORD dwCatID, DWORD dwSrcID, LPCWSTR szMessage, DWORD dwSeverity, LPCWSTR szActorID, DWORD dwAttrCount = 0, LPVARIANT pvAttrValues = NULL, LPFILETIME pft = NULL  );
+   HRESULT  ProcessEvents( DWORD dwCount, EVENTDATA* pEvents, HRESULT* errors = NULL );
    HRESULT  ProcessConditionStateChanges( DWORD dwCount, AeConditionChangeStates* pCondStateChanges, BOOL useCurrentTime = TRUE, HRESULT* errors = NULL  );
    HRESULT  AckCondition( DWORD dwCondID, LPCWSTR szComment = NULL );
 
       // Fires a 'Shutdown Request' to all subscribed clients
    void FireShutdownRequest( LPCWSTR szReason = NULL );
 
+      // Sets the number of recently fired events kept for the replay
+      // to subscriptions of reconnected clients. 0 disables the history.
+   HRESULT SetEventHistorySize( DWORD dwMaxEvents );
+   inline DWORD EventHistorySize() const { return m_EventHistory.Capacity(); }
+
+      // Enables the coalescing of condition events for new subscriptions.
+      // Within the buffer time of a subscription only the latest event
+      // of a condition is sent. Acknowledgement related events are kept.
+   inline void SetConditionCoalescing( BOOL fEnable ) { m_fCoalesceConditions = fEnable; }
+   inline BOOL IsConditionCoalescingEnabled() const { return m_fCoalesceConditions; }
+
 // Implementation
 protected:
    ////////////////////////////////////////////////////
@@ -213,6 +248,11 @@ protected:
    BOOL     ExistEventCategory( DWORD dwEventCategory );
    BOOL     ExistSource( LPCWSTR szName );
    BOOL     ExistArea( LPCWSTR szName );
+   HRESULT  GetAreaSet( DWORD dwNumAreas, LPCWSTR* pszNames, AeAreaSet** ppAreaSet );
+   inline LONG AreaSpaceRevision() const { return m_RootArea.Revision(); }
+   ULONGLONG GetNextEventSequence();
+   void     SaveReplayPosition( LPCWSTR szClientName, OPCHANDLE hClientSubscription, ULONGLONG ullNextSequence );
+   BOOL     TakeReplayPosition( LPCWSTR szClientName, OPCHANDLE hClientSubscription, ULONGLONG* pullNextSequence );
 
 
    ////////////////////////////////////////////////////
@@ -229,6 +269,8 @@ protected:
    CSimpleMap<DWORD, AeSource*>       m_mapSources;
    CSimpleMap<DWORD, AeConditionDefiniton*> m_mapConditionDefs;
    CSimpleMap<DWORD, AeCondition*>    m_mapConditions;
+   CAtlMap<DWORD, AeCondition*>       m_mapCondCookies;  // Index of m_mapConditions by cookie
+   AeConditionRefreshSet              m_RefreshSet;   // Conditions sent by a Refresh
 
    AeSource* LookupSource( LPCWSTR szName );
    AeConditionDefiniton* LookupConditionDef( LPCWSTR szName );
@@ -236,10 +278,25 @@ protected:
    CComAutoCriticalSection m_csCatMap;          // lock/unlock m_mapCategories
    CComAutoCriticalSection m_csSrcMap;          // lock/unlock m_mapSources
    CComAutoCriticalSection m_csCondDefMap;      // lock/unlock m_mapConditionDefs
-   CComAutoCriticalSection m_csCondMap;         // lock/unlock m_mapConditions
+   CComAutoCriticalSection m_csCondMap;         // lock/unlock m_mapConditions and m_mapCondCookies
 
    EventArea              m_RootArea;
 
+   AeEventHistory         m_EventHistory;      // Recently fired events, filled by FireEvent(s)
+
+      // Position in the event history of removed subscriptions,
+      // identified by the client name and the client subscription
+      // handle. Used by the first Refresh of a reconnected client.
+   typedef struct tagREPLAYPOSITION {
+      COpcString  wsClientName;
+      OPCHANDLE   hClientSubscription;
+      ULONGLONG   ullNextSequence;
+   } REPLAYPOSITION;
+
+   CSimpleArray<REPLAYPOSITION>  m_arReplayPositions;
+   CComAutoCriticalSection m_csReplayPositions; // lock/unlock m_arReplayPositions
+   BOOL                   m_fCoalesceConditions; // Default of new subscriptions
+
    ////////////////////////////////////////////////////
    // List of the connected clients
    ////////////////////////////////////////////////////
@@ -173,6 +173,11 @@ public:
       // Pure virtual function, must be implemented by derived classes
    virtual void FireShutdownRequest( LPCWSTR szReason ) = 0;
 
+      // Pure virtual function, must be implemented by derived classes.
+      // Returns a copy of the name set by the client, allocated with
+      // CoTaskMemAlloc().
+   virtual HRESULT QueryClientName( LPWSTR* pszName ) = 0;
+
 // Impmementation
 protected:
       // The time this server instance was started.
@@ -78,6 +78,11 @@ public:
 
 // Operations
 public:
+   inline HRESULT QueryClientName( LPWSTR* pszName )
+   {
+      return OpcCommon::GetClientName( pszName );
+   }
+
    inline void FireShutdownRequest( LPCWSTR szReason )
    {
       IOPCShutdownConnectionPointImpl<AeComServer>::FireShutdownRequest( szReason );
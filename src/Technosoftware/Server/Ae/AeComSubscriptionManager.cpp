@@ -33,6 +33,7 @@
 #include "AeCategory.h"
 #include "AeComSubscription.h"
 #include "AeEvent.h"
+#include "AeAreaSet.h"
 #include "AeComSubscriptionManager.h"
 #include "AeAttribute.h"
 #include "MatchPattern.h"
@@ -64,12 +65,17 @@ AeComSubscriptionManager::AeComSubscriptionManager()
 	m_dwEventType = OPC_ALL_EVENTS;
 	m_dwLowSeverity = MIN_LOW_SEVERITY;
 	m_dwHighSeverity = 1000;
+	m_pAreaFilter = NULL;
+	m_lAreaFilterRevision = 0;
 
 	// Set Default State
 	m_fActive = FALSE;
 	m_dwBufferTime = 0;
 	m_dwMaxSize = 0;
 	m_hClientSubscription = NULL;
+	m_fCoalesceConditions = FALSE;
+	m_ullNextSequence = 0;
+	m_ullFirstLiveSequence = 0;
 }
 
 
@@ -120,6 +126,8 @@ HRESULT AeComSubscriptionManager::Create(
 
 	m_csStatesAndEventBuffer.Lock();
 	HRESULT hres = m_EventBuffer.PreAllocate(DEFAULT_SIZE_EVENT_BUFFER);
+	m_fCoalesceConditions = m_pServerHandler->IsConditionCoalescingEnabled();
+	m_ullNextSequence = m_pServerHandler->GetNextEventSequence();
 	m_csStatesAndEventBuffer.Unlock();
 
 	if (SUCCEEDED(hres)) {
@@ -197,6 +205,17 @@ void AeComSubscriptionManager::CleanupSubscription()
 
 	// Remove current subscription
 	if (m_pServer) {
+		// Keep the position of the last sent event so that the
+		// client can resume after a reconnect.
+		LPWSTR szClientName;
+		if (m_pServerHandler->EventHistorySize() &&
+			SUCCEEDED(m_pServer->QueryClientName(&szClientName))) {
+			m_csStatesAndEventBuffer.Lock();
+			ULONGLONG ullNextSequence = m_ullNextSequence;
+			m_csStatesAndEventBuffer.Unlock();
+			m_pServerHandler->SaveReplayPosition(szClientName, m_hClientSubscription, ullNextSequence);
+			CoTaskMemFree(szClientName);
+		}
 		if (SUCCEEDED(m_pServer->RemoveSubscriptionFromList(this))) {
 			fReleaseServerRef = TRUE;              // Permits deletion of the server but execute
 		}                                         // it as the last action of the cleanup function.
@@ -230,10 +249,7 @@ void AeComSubscriptionManager::CleanupSubscription()
 
 	// Release non-fired events
 	m_csStatesAndEventBuffer.Lock();
-	for (DWORD z = 0; z < m_EventBuffer.GetSize(); z++) {
-		m_EventBuffer[z]->Release();
-	}
-	m_EventBuffer.RemoveAll();
+	RemoveBufferedEvents();
 	m_csStatesAndEventBuffer.Unlock();
 
 	// Cleanup map of Attribute ID arrays
@@ -243,6 +259,11 @@ void AeComSubscriptionManager::CleanupSubscription()
 		if (parAttrIDs) delete parAttrIDs;
 	}
 
+	if (m_pAreaFilter) {
+		m_pAreaFilter->Release();
+		m_pAreaFilter = NULL;
+	}
+
 	if (fReleaseServerRef) {
 		m_pServer->Release();                     // Permits deletion of the server
 	}
@@ -338,6 +359,10 @@ STDMETHODIMP AeComSubscriptionManager::SetFilter(
 		}
 
 		m_arAreas.RemoveAll();
+		if (m_pAreaFilter) {                     // Resolved with the first filtered event
+			m_pAreaFilter->Release();
+			m_pAreaFilter = NULL;
+		}
 		for (i = 0; i < dwNumAreas; i++) {
 			pwsz = new COpcString(pszAreaList[i]);
 			if (!pwsz) throw E_OUTOFMEMORY;
@@ -543,6 +568,9 @@ STDMETHODIMP AeComSubscriptionManager::Refresh(
 
 		hres = m_hRefreshThread ? S_OK : HRESULT_FROM_WIN32(GetLastError());
 	}
+	if (SUCCEEDED(hres)) {
+		ResumeEvents();                           // Events missed by a reconnected client
+	}
 	return hres;
 }
 
@@ -627,10 +655,7 @@ STDMETHODIMP AeComSubscriptionManager::SetState(
 	if (pbActive && (m_fActive != *pbActive)) {
 		m_fActive = *pbActive;
 		if (!m_fActive) {                         // Remove all buffered events if the new state is inactive
-			for (DWORD i = 0; i < m_EventBuffer.GetSize(); i++) {
-				m_EventBuffer[i]->Release();
-			}
-			m_EventBuffer.RemoveAll();
+			RemoveBufferedEvents();
 		}
 		fNotifyEventThread = TRUE;
 	}
@@ -684,6 +709,10 @@ HRESULT AeComSubscriptionManager::ProcessEvents(DWORD dwNumOfEvents, AeEvent** p
 
 	m_csStatesAndEventBuffer.Lock();
 
+	if (m_ullFirstLiveSequence == 0 && dwNumOfEvents) {
+		m_ullFirstLiveSequence = ppEvents[0]->Sequence();   // End of a replay
+	}
+
 	if (m_fActive) {                             // Subscription must be active
 
 		for (i = 0; i < dwNumOfEvents; i++) {       // Handle all new events
@@ -692,6 +721,11 @@ HRESULT AeComSubscriptionManager::ProcessEvents(DWORD dwNumOfEvents, AeEvent** p
 			if (!IsEventPassingFilters(pEvent))
 				continue;
 
+			if (m_fCoalesceConditions && pEvent->dwEventType == OPC_CONDITION_EVENT) {
+				if (CoalesceEvent(pEvent))
+					continue;                      // Replaces the buffered event of the condition
+			}
+
 			pEvent->AddRef();                      // Event passed all filters. Is
 												   // used once more
 
@@ -713,10 +747,189 @@ HRESULT AeComSubscriptionManager::ProcessEvents(DWORD dwNumOfEvents, AeEvent** p
 
 
 
+//=========================================================================
+// SetConditionCoalescing                                          PUBLIC
+// ----------------------
+//    Enables or disables the coalescing of condition events. If enabled
+//    only the latest event of a condition is kept in the event buffer
+//    until the buffered events are sent.
+//=========================================================================
+void AeComSubscriptionManager::SetConditionCoalescing(BOOL fEnable)
+{
+	m_csStatesAndEventBuffer.Lock();
+	m_fCoalesceConditions = fEnable;
+	m_csStatesAndEventBuffer.Unlock();
+}
+
+
+
+//=========================================================================
+// ReplayEvents                                                    PUBLIC
+// ------------
+//    Handles the events of the event history of the server which are
+//    fired from sequence number ullFromSequence up to, but excluding,
+//    ullToSequence. The events pass the filters of this subscription
+//    like new events.
+//
+//    The events are copied from the history in small portions, so new
+//    events are not blocked by the replay.
+//
+// returns:
+//    S_OK     all events since ullFromSequence are replayed
+//    S_FALSE  older events are no longer in the history, only the
+//             remaining events are replayed (a Refresh is recommended)
+//    E_XXX    error occured
+//=========================================================================
+HRESULT AeComSubscriptionManager::ReplayEvents(ULONGLONG ullFromSequence, ULONGLONG ullToSequence, ULONGLONG* pullNextSequence)
+{
+	const DWORD REPLAY_PORTION = 256;
+
+	AeEvent*    apEvents[REPLAY_PORTION];
+	DWORD       dwCount, i;
+	HRESULT     hres, hresRet = S_OK;
+
+	do {
+		hres = m_pServerHandler->m_EventHistory.GetEvents(ullFromSequence, ullToSequence, REPLAY_PORTION,
+			apEvents, &dwCount, &ullFromSequence);
+		if (hres == S_FALSE) {
+			hresRet = S_FALSE;
+		}
+		if (dwCount) {
+			hres = ProcessEvents(dwCount, apEvents);
+			for (i = 0; i < dwCount; i++) {
+				apEvents[i]->Release();
+			}
+			if (FAILED(hres)) {
+				hresRet = hres;
+				break;
+			}
+		}
+	} while (dwCount);
+
+	if (pullNextSequence) {
+		*pullNextSequence = ullFromSequence;
+	}
+	return hresRet;
+}
+
+
+
+//=========================================================================
+// ResumeEvents                                                    PUBLIC
+// ------------
+//    Replays the events fired since the last event sent to a removed
+//    subscription of a client with the same name and the same client
+//    subscription handle. Called by the Refresh of the reconnected
+//    client; the position is used only once.
+//
+//    Events are fired in the order of their sequence numbers. Events
+//    from the first one handled by ProcessEvents() on are already
+//    processed for this subscription and are not replayed. If there
+//    was none yet, all events fired so far are replayed.
+//=========================================================================
+void AeComSubscriptionManager::ResumeEvents()
+{
+	LPWSTR      szClientName;
+	ULONGLONG   ullFromSequence, ullToSequence;
+
+	if (m_pServer == NULL || m_pServerHandler->EventHistorySize() == 0) {
+		return;                                   // There is no history to replay
+	}
+	if (FAILED(m_pServer->QueryClientName(&szClientName))) {
+		return;
+	}
+	if (m_pServerHandler->TakeReplayPosition(szClientName, m_hClientSubscription, &ullFromSequence)) {
+		// Read before the lock, the server fires events while it is locked.
+		ullToSequence = m_pServerHandler->GetNextEventSequence();
+		m_csStatesAndEventBuffer.Lock();
+		if (m_ullFirstLiveSequence) {
+			ullToSequence = m_ullFirstLiveSequence;
+		}
+		m_csStatesAndEventBuffer.Unlock();
+		if (ullFromSequence < ullToSequence) {
+			ReplayEvents(ullFromSequence, ullToSequence, NULL);    // S_FALSE if older events are lost
+		}
+	}
+	CoTaskMemFree(szClientName);
+}
+
+
+
 //-------------------------------------------------------------------------
 // IMPLEMENTATTION
 //-------------------------------------------------------------------------
 
+//=========================================================================
+// CoalesceEvent                                                   INTERNAL
+// -------------
+//    Replaces the buffered event of the same condition with the new
+//    condition event. Events reporting an acknowledgement and events
+//    of another activation which must be acknowledged are never
+//    replaced.
+//    m_csStatesAndEventBuffer must be locked by the caller.
+//
+// returns:
+//    TRUE     the event has replaced a buffered event
+//    FALSE    the event must be added to the event buffer
+//=========================================================================
+BOOL AeComSubscriptionManager::CoalesceEvent(AeEvent* pEvent)
+{
+	CAtlMap<DWORD, COALESCEDEVENT>::CPair* pPair = m_mapCoalesced.Lookup(pEvent->dwCookie);
+	if (pPair) {
+		DWORD dwIndex = pPair->m_value.dwIndex;
+		if (dwIndex < m_EventBuffer.GetSize() &&
+			m_EventBuffer[dwIndex]->dwCookie == pEvent->dwCookie) {
+
+			AeEvent* pOld = m_EventBuffer[dwIndex];
+			BOOL fReplace = TRUE;
+			if (pOld->wChangeMask & OPC_CHANGE_ACK_STATE) {
+				fReplace = FALSE;                  // Acknowledgement must be reported
+			}
+			else if (pOld->bAckRequired &&
+				CompareFileTime(&pOld->ftActiveTime, &pEvent->ftActiveTime) != 0) {
+				fReplace = FALSE;                  // Other activation to be acknowledged
+			}
+			if (fReplace) {
+				pPair->m_value.wChangeMask |= pOld->wChangeMask;
+				if (pPair->m_value.wCount < 0xFFFF) {
+					pPair->m_value.wCount++;
+				}
+				pEvent->AddRef();
+				m_EventBuffer[dwIndex] = pEvent;
+				pOld->Release();
+				return TRUE;
+			}
+		}
+	}
+
+	// Following events of the condition are coalesced with this event
+	COALESCEDEVENT ce;
+	ce.dwIndex = m_EventBuffer.GetSize();
+	ce.wChangeMask = 0;
+	ce.wCount = 0;
+	m_mapCoalesced.SetAt(pEvent->dwCookie, ce);
+	return FALSE;
+}
+
+
+
+//=========================================================================
+// RemoveBufferedEvents                                            INTERNAL
+// --------------------
+//    Releases all events of the event buffer.
+//    m_csStatesAndEventBuffer must be locked by the caller.
+//=========================================================================
+void AeComSubscriptionManager::RemoveBufferedEvents()
+{
+	for (DWORD i = 0; i < m_EventBuffer.GetSize(); i++) {
+		m_EventBuffer[i]->Release();
+	}
+	m_EventBuffer.RemoveAll();
+	m_mapCoalesced.RemoveAll();
+}
+
+
+
 //=========================================================================
 // IsEventPassingFilters                                           INTERNAL
 // ---------------------
@@ -757,33 +970,14 @@ BOOL AeComSubscriptionManager::IsEventPassingFilters(AeEvent* pOnEvent)
 		//
 		// Area Filter
 		//
-		if (dwSize = m_arAreas.GetSize()) {
-			BOOL fAreaOK = FALSE;
-			LPVARIANT pAreas = pOnEvent->LookupAttributeValue(ATTRID_AREAS);
-			if (pAreas) {
-				// Must be an array of BSTRs
-				_ASSERTE(V_VT(pAreas) == (VT_ARRAY | VT_BSTR));
-
-				HRESULT     hres;
-				BSTR HUGEP* pbstr;
-				// Get a pointer to the elements of the array.
-				if (SUCCEEDED(SafeArrayAccessData(V_ARRAY(pAreas), (void HUGEP**)&pbstr))) {
-
-					do {
-						dwSize--;
-						for (DWORD i = 0; i < V_ARRAY(pAreas)->rgsabound->cElements; i++) {
-							if (wcscmp((LPCWSTR)*m_arAreas[dwSize], pbstr[i]) == 0) {
-								fAreaOK = TRUE;
-								break;
-							}
-						}
-					} while (dwSize && !fAreaOK);
-
-					hres = SafeArrayUnaccessData(V_ARRAY(pAreas));
-					_ASSERTE(SUCCEEDED(hres));
-				}
-			}
-			if (!fAreaOK) throw FALSE;
+		// The event passes if at least one of its areas (attribute
+		// ATTRID_AREAS) is specified by the filter. Both are compared
+		// as sorted lists of area indices.
+		if (m_arAreas.GetSize()) {
+			AeAreaSet* pAreas = pOnEvent->AreaSet();
+			if (!pAreas) throw FALSE;
+			if (FAILED(ResolveAreaFilter())) throw FALSE;
+			if (!m_pAreaFilter->Intersects(pAreas)) throw FALSE;
 		}
 		//
 		// Source Filter
@@ -810,18 +1004,61 @@ BOOL AeComSubscriptionManager::IsEventPassingFilters(AeEvent* pOnEvent)
 
 
 
+//=========================================================================
+// ResolveAreaFilter                                               INTERNAL
+// -----------------
+//    Resolves the area names of the filter to the indices of the areas.
+//    The names are resolved again if areas have been added to the
+//    process area space since the last call.
+//    m_csFilters must be locked by the caller.
+//=========================================================================
+HRESULT AeComSubscriptionManager::ResolveAreaFilter()
+{
+	LONG lRevision = m_pServerHandler->AreaSpaceRevision();
+	if (m_pAreaFilter && m_lAreaFilterRevision == lRevision) {
+		return S_OK;                             // Still up to date
+	}
+
+	DWORD dwNumAreas = m_arAreas.GetSize();
+	LPCWSTR* pszAreas = new LPCWSTR[dwNumAreas];
+	if (!pszAreas) return E_OUTOFMEMORY;
+
+	for (DWORD i = 0; i < dwNumAreas; i++) {
+		pszAreas[i] = (LPCWSTR)*m_arAreas[i];
+	}
+
+	AeAreaSet* pAreaFilter;
+	HRESULT hres = m_pServerHandler->GetAreaSet(dwNumAreas, pszAreas, &pAreaFilter);
+	delete[] pszAreas;
+
+	if (SUCCEEDED(hres)) {
+		if (m_pAreaFilter) {
+			m_pAreaFilter->Release();
+		}
+		m_pAreaFilter = pAreaFilter;
+		m_lAreaFilterRevision = lRevision;       // Revision read before the names are resolved
+	}
+	return hres;
+}
+
+
+
 //=========================================================================
 // SendBufferedEvents                                              INTERNAL
 // ------------------
 //    Send events from the event buffer to the client.
 //    If no MaxSize is defined then all events from the buffer are
 //    sent; otherwise the maximum number of events limited by MaxSize.
+//    The selected attributes of all sent events are stored in a
+//    single buffer.
 //=========================================================================
 HRESULT AeComSubscriptionManager::SendBufferedEvents()
 {
-	DWORD             dwNumOfEvents, i;
+	DWORD             dwNumOfEvents, dwNumOfAttrs, i;
 	AeEvent*         pEvent;
 	AeSubscribedEvent* pSubscrEvents;
+	LPVARIANT         pvAttrBuffer = NULL;
+	LPVARIANT         pvAttrs;
 	AttrIDArray*      parAttrIDs;
 
 	m_csStatesAndEventBuffer.Lock();
@@ -843,28 +1080,76 @@ HRESULT AeComSubscriptionManager::SendBufferedEvents()
 	}
 
 	m_csStatesAndEventBuffer.Lock();
+	dwNumOfAttrs = 0;                            // Number of selected attributes of all events
+	for (i = 0; i < dwNumOfEvents; i++) {
+		parAttrIDs = m_mapSelectedAttrIDs.Lookup(m_EventBuffer[i]->dwEventCategory);
+		if (parAttrIDs) {
+			dwNumOfAttrs += parAttrIDs->GetSize();
+		}
+	}
+	if (dwNumOfAttrs) {
+		pvAttrBuffer = new VARIANT[dwNumOfAttrs];
+		if (!pvAttrBuffer) {
+			m_csStatesAndEventBuffer.Unlock();
+			delete[] pSubscrEvents;
+			return E_OUTOFMEMORY;
+		}
+	}
+
+	pvAttrs = pvAttrBuffer;
 	for (i = 0; i < dwNumOfEvents; i++) {
 
 		pEvent = m_EventBuffer[i];
 
 		parAttrIDs = m_mapSelectedAttrIDs.Lookup(pEvent->dwEventCategory);
 
-		if (parAttrIDs)                        // Create the events with the selected attributes
-			pSubscrEvents[i].Create(pEvent, parAttrIDs->GetSize(), parAttrIDs->m_aT);
+		if (parAttrIDs) {                      // Create the events with the selected attributes
+			pSubscrEvents[i].Create(pEvent, parAttrIDs->GetSize(), parAttrIDs->m_aT, pvAttrs);
+			pvAttrs += parAttrIDs->GetSize();
+		}
 		else
-			pSubscrEvents[i].Create(pEvent, 0, NULL);
+			pSubscrEvents[i].Create(pEvent, 0, NULL, NULL);
+
+		if (pEvent->dwEventType == OPC_CONDITION_EVENT && !m_mapCoalesced.IsEmpty()) {
+			COALESCEDEVENT ce;
+			if (m_mapCoalesced.Lookup(pEvent->dwCookie, ce) && ce.dwIndex == i) {
+				// Report the changes of the replaced events
+				pSubscrEvents[i].wChangeMask |= ce.wChangeMask;
+				pSubscrEvents[i].wReserved = ce.wCount;
+				m_mapCoalesced.RemoveKey(pEvent->dwCookie);
+			}
+		}
 	}
 	m_csStatesAndEventBuffer.Unlock();
 
-	FireOnEvent(dwNumOfEvents, pSubscrEvents);
+	HRESULT hresFire = FireOnEvent(dwNumOfEvents, pSubscrEvents);
 
 	delete[] pSubscrEvents;
+	if (pvAttrBuffer) {
+		delete[] pvAttrBuffer;
+	}
 
 	m_csStatesAndEventBuffer.Lock();
 	for (i = 0; i < dwNumOfEvents; i++) {
+		if (SUCCEEDED(hresFire) && m_EventBuffer[i]->Sequence() >= m_ullNextSequence) {
+			m_ullNextSequence = m_EventBuffer[i]->Sequence() + 1;   // Resume position
+		}
 		m_EventBuffer[i]->Release();
 	}
 	m_EventBuffer.RemoveFirstN(dwNumOfEvents);
+
+	// Adjust the positions of the remaining coalesced events
+	POSITION pos = m_mapCoalesced.GetStartPosition();
+	while (pos) {
+		POSITION posCurrent = pos;
+		CAtlMap<DWORD, COALESCEDEVENT>::CPair* pPair = m_mapCoalesced.GetNext(pos);
+		if (pPair->m_value.dwIndex < dwNumOfEvents) {
+			m_mapCoalesced.RemoveAtPos(posCurrent);
+		}
+		else {
+			pPair->m_value.dwIndex -= dwNumOfEvents;
+		}
+	}
 	m_csStatesAndEventBuffer.Unlock();
 
 	return S_OK;
@@ -893,7 +1178,10 @@ unsigned __stdcall EventRefreshThreadHandler(void* pCreator)
 	int                     i;
 	HRESULT                 hres;
 	DWORD                   dwNumOfEvents = 0;   // Number of events to send
+	DWORD                   dwNumOfAttrs = 0;    // Number of selected attributes of the events to send
 	AeSubscribedEvent*       pSubscrEvents = NULL;
+	AeEvent**              ppPassedEvents = NULL;
+	LPVARIANT               pvAttrBuffer = NULL;
 	CSimpleArray<AeEvent*> arEventPtrs;
 	AeSubscribedEvent        dummyevent;          // Note : Ptr for events must not be NULL
 
@@ -901,12 +1189,9 @@ unsigned __stdcall EventRefreshThreadHandler(void* pCreator)
 												 // This function checks the 'cancel refresh' flag
 	hres = pSubscr->m_pServerHandler->GetEventsForRefresh(pSubscr, arEventPtrs);
 	pSubscrEvents = new AeSubscribedEvent[arEventPtrs.GetSize()];
+	ppPassedEvents = new AeEvent*[arEventPtrs.GetSize()];
 
-	if (FAILED(hres) || !pSubscrEvents) {
-		// send one final callback
-		pSubscr->FireOnEvent(0, &dummyevent, TRUE, TRUE);
-	}
-	else {
+	if (SUCCEEDED(hres) && pSubscrEvents && ppPassedEvents) {
 		// Filter the events
 		for (i = 0; i < arEventPtrs.GetSize(); i++) {
 
@@ -916,15 +1201,35 @@ unsigned __stdcall EventRefreshThreadHandler(void* pCreator)
 			if (pSubscr->IsEventPassingFilters(arEventPtrs[i])) {
 
 				AeComSubscriptionManager::AttrIDArray* parAttrIDs = pSubscr->m_mapSelectedAttrIDs.Lookup(arEventPtrs[i]->dwEventCategory);
+				if (parAttrIDs) {
+					dwNumOfAttrs += parAttrIDs->GetSize();
+				}
+				ppPassedEvents[dwNumOfEvents++] = arEventPtrs[i];
+			}
 
-				if (parAttrIDs)                     // Create the events with the selected attributes
-					pSubscrEvents[dwNumOfEvents].Create(arEventPtrs[i], parAttrIDs->GetSize(), parAttrIDs->m_aT);
-				else
-					pSubscrEvents[dwNumOfEvents].Create(arEventPtrs[i], 0, NULL);
+		}
+		if (dwNumOfAttrs) {                      // One buffer for the selected attributes of all events
+			pvAttrBuffer = new VARIANT[dwNumOfAttrs];
+			if (!pvAttrBuffer) hres = E_OUTOFMEMORY;
+		}
+	}
 
-				dwNumOfEvents++;
-			}
+	if (FAILED(hres) || !pSubscrEvents || !ppPassedEvents) {
+		// send one final callback
+		pSubscr->FireOnEvent(0, &dummyevent, TRUE, TRUE);
+	}
+	else {
+		LPVARIANT pvAttrs = pvAttrBuffer;
+		for (DWORD n = 0; n < dwNumOfEvents; n++) {
+
+			AeComSubscriptionManager::AttrIDArray* parAttrIDs = pSubscr->m_mapSelectedAttrIDs.Lookup(ppPassedEvents[n]->dwEventCategory);
 
+			if (parAttrIDs) {                     // Create the events with the selected attributes
+				pSubscrEvents[n].Create(ppPassedEvents[n], parAttrIDs->GetSize(), parAttrIDs->m_aT, pvAttrs);
+				pvAttrs += parAttrIDs->GetSize();
+			}
+			else
+				pSubscrEvents[n].Create(ppPassedEvents[n], 0, NULL, NULL);
 		}
 		if (!pSubscr->m_fCancelRefresh) {
 			// Send the events to the client
@@ -956,6 +1261,12 @@ unsigned __stdcall EventRefreshThreadHandler(void* pCreator)
 	if (pSubscrEvents) {
 		delete[] pSubscrEvents;
 	}
+	if (ppPassedEvents) {
+		delete[] ppPassedEvents;
+	}
+	if (pvAttrBuffer) {
+		delete[] pvAttrBuffer;
+	}
 
 	CloseHandle(pSubscr->m_hRefreshThread);    // Thread handle must be closed explicitly
 	pSubscr->m_fCancelRefresh = FALSE;
@@ -1059,7 +1370,7 @@ HRESULT AeComSubscription::FireOnEvent(DWORD dwNumOfEvents, ONEVENTSTRUCT* pEven
 	HRESULT hres = GetEventSinkInterface(&pSink);
 	if (SUCCEEDED(hres)) {
 
-		hres = pSink->OnEvent(
+		HRESULT hresCallback = pSink->OnEvent(
 			m_hClientSubscription,
 			fRefresh,
 			fLastRefresh,
@@ -1067,6 +1378,9 @@ HRESULT AeComSubscription::FireOnEvent(DWORD dwNumOfEvents, ONEVENTSTRUCT* pEven
 			pEvent);
 		// Refresh the last update time even
 		hres = RefreshLastUpdateTime();        // if OnEvent() failed.
+		if (FAILED(hresCallback)) {
+			hres = hresCallback;                // Events not delivered
+		}
 		pSink->Release();
 	}
 	return hres;
@@ -27,6 +27,7 @@
 #pragma once
 #endif // _MSC_VER >= 1000
 
+#include <atlcoll.h>
 #include "UtilityDefs.h"
 #include "OpcString.h"
 
@@ -34,6 +35,7 @@ class AeBaseServer;
 class AeComBaseServer;
 class AeSource;
 class AeEvent;
+class AeAreaSet;
 //class COpcString;
 
 
@@ -144,6 +146,16 @@ public:
 	   // Handles new events for this subscription
 	HRESULT ProcessEvents(DWORD dwNumOfEvents, AeEvent** ppEvents);
 
+	   // Handles the events of the server event history fired in the
+	   // specified sequence number range, used by reconnected clients
+	HRESULT ReplayEvents(ULONGLONG ullFromSequence, ULONGLONG ullToSequence, ULONGLONG* pullNextSequence);
+
+	   // Replays the events missed by a reconnected client
+	void ResumeEvents();
+
+	   // Enables or disables the coalescing of buffered condition events
+	void SetConditionCoalescing(BOOL fEnable);
+
 	// Impmementation
 protected:
 	// States
@@ -159,6 +171,8 @@ protected:
 	DWORD							m_dwHighSeverity;
 	CSimpleArray<DWORD>				m_arCatIDs;
 	CSimplePtrArray<COpcString*>	m_arAreas;
+	AeAreaSet*						m_pAreaFilter;	// m_arAreas resolved to area indices,
+	LONG							m_lAreaFilterRevision;	// valid for this area space revision
 	CSimplePtrArray<COpcString*>	m_arSources;
 	CComAutoCriticalSection			m_csFilters;   // lock/unlock all filters
 
@@ -167,6 +181,27 @@ protected:
 	CComAutoCriticalSection			m_csStatesAndEventBuffer;
 	// lock/unlock the event buffer
 	// and all states
+
+	// Coalescing of condition events
+	// If enabled a buffered event of a condition is replaced by a newer
+	// event of the same condition. The replaced changes are reported by
+	// the change mask and wReserved of the sent event.
+	typedef struct tagCOALESCEDEVENT {
+		DWORD		dwIndex;					// Position in m_EventBuffer
+		WORD		wChangeMask;				// Change masks of the replaced events
+		WORD		wCount;						// Number of replaced events
+	} COALESCEDEVENT;
+
+	ULONGLONG						m_ullNextSequence;	// Sequence number following the last event sent
+												// to the client, locked by m_csStatesAndEventBuffer
+	ULONGLONG						m_ullFirstLiveSequence;	// Sequence number of the first event handled
+												// by ProcessEvents(), 0 if none yet,
+												// locked by m_csStatesAndEventBuffer
+	BOOL							m_fCoalesceConditions;
+	CAtlMap<DWORD, COALESCEDEVENT>	m_mapCoalesced;	// Latest buffered event by condition cookie,
+												// locked by m_csStatesAndEventBuffer
+	BOOL     CoalesceEvent(AeEvent* pEvent);
+	void     RemoveBufferedEvents();
 // Selected Attributes
 	typedef CSimpleArray<DWORD> AttrIDArray, *LPATTRIDARRAY;
 	CSimpleMap<DWORD, LPATTRIDARRAY> m_mapSelectedAttrIDs;
@@ -188,6 +223,7 @@ protected:
 		BOOL fRefresh = FALSE, BOOL fLastRefresh = FALSE) = 0;
 
 	BOOL     IsEventPassingFilters(AeEvent* pOnEvent);
+	HRESULT  ResolveAreaFilter();
 	inline   HRESULT RefreshLastUpdateTime();
 
 private:
@@ -34,6 +34,12 @@
 #include "AeAttributeValueMap.h"
 #include "CoreMain.h"
 
+//-------------------------------------------------------------------------
+// STATIC MEMBERS
+//-------------------------------------------------------------------------
+LONG AeCondition::m_lLastCookie = 0;
+
+
 //-------------------------------------------------------------------------
 // CODE AeCondition
 //-------------------------------------------------------------------------
@@ -48,6 +54,20 @@ AeCondition::AeCondition()
     m_wNewState = OPC_CONDITION_ENABLED | OPC_CONDITION_ACKED;
     m_dwNumOfAttrs = 0;
     m_pavAttrValues = NULL;
+    m_pAreaSet = NULL;
+    m_pSharedMessage = NULL;
+    m_pSharedAcknowledgerID = NULL;
+    m_pAttrSnapshot = NULL;
+    m_pRefreshSet = NULL;
+    m_fInRefreshSet = FALSE;
+    m_pRefreshPrev = NULL;
+    m_pRefreshNext = NULL;
+    m_pRefreshEvent = NULL;
+
+    // Each condition gets a new cookie. 0 means 'no cookie'.
+    do {
+        m_dwCookie = (DWORD)InterlockedIncrement(&m_lLastCookie);
+    } while (m_dwCookie == 0);
 
     memset(&m_ftLastAckTime, 0, sizeof(m_ftLastAckTime));
     memset(&m_ftSubCondLastActive, 0, sizeof(m_ftSubCondLastActive));
@@ -64,9 +84,13 @@ AeCondition::AeCondition()
 //    Must be called after construction.
 //    Also the internal default attributes 'ACK COMMENT' and
 //    'AREAS' are initalized.
+//    If pRefreshSet is specified then the condition is added to this
+//    set as long as it must be sent by a Refresh.
 //=========================================================================
-HRESULT AeCondition::Create(DWORD dwCondID, AeConditionDefiniton* pCondDef, AeSource* pSource)
+HRESULT AeCondition::Create(DWORD dwCondID, AeConditionDefiniton* pCondDef, AeSource* pSource,
+    AeConditionRefreshSet* pRefreshSet /* = NULL */)
 {
+    m_pRefreshSet = pRefreshSet;
     m_dwCondID = dwCondID;
     m_pCondDef = pCondDef;
     m_pSource = pSource;
@@ -88,6 +112,7 @@ HRESULT AeCondition::Create(DWORD dwCondID, AeConditionDefiniton* pCondDef, AeSo
         m_pavAttrValues[ATTRNDX_ACKCOMMENT] = (LPCWSTR)m_wsAckComment;
         HRESULT hres = m_pSource->GetAreaNames(&m_pavAttrValues[ATTRNDX_AREAS]);
         if (FAILED(hres)) return hres;
+        m_pAreaSet = m_pSource->GetAreaSet();
     }
     catch (_com_error &e) {                      // catch _variant_t operation errors
         return e.Error();
@@ -102,9 +127,19 @@ HRESULT AeCondition::Create(DWORD dwCondID, AeConditionDefiniton* pCondDef, AeSo
 //=========================================================================
 AeCondition::~AeCondition()
 {
+    if (m_pRefreshSet) {
+        m_pRefreshSet->Remove(this);
+    }
+    ReleaseSharedMessage();
+    ReleaseSharedAcknowledgerID();
+    ReleaseAttrSnapshot();
+
     if (m_pavAttrValues) {
         delete[] m_pavAttrValues;
     }
+    if (m_pAreaSet) {
+        m_pAreaSet->Release();
+    }
 }
 
 
@@ -160,7 +195,10 @@ HRESULT AeCondition::Enable(BOOL fEnable, AeEvent** ppEvent)
         }
         if (!IsAcked()) {
             hres = AcknowledgeByServer(L"Acknowledged by Server when Enabled", ppEvent);
-            if (FAILED(hres)) return hres;
+            if (FAILED(hres)) {
+                UpdateRefreshSet(NULL);
+                return hres;
+            }
             if (hres == S_OK) {
                 (*ppEvent)->Release();           // Release the event instance because no
                 *ppEvent = NULL;                 // event must be generated.
@@ -181,6 +219,9 @@ HRESULT AeCondition::Enable(BOOL fEnable, AeEvent** ppEvent)
         // Create an event instance for client notification
         hres = CreateEventInstance(ppEvent);
     }
+    else {
+        UpdateRefreshSet(NULL);                // No longer sent by a Refresh
+    }
     return hres;
 }
 
@@ -246,7 +287,10 @@ HRESULT AeCondition::Acknowledge(LPCWSTR szAcknowledgerID, LPCWSTR szComment, FI
     }
     m_ftLastAckTime = m_ftTime;                 // Time of acknowledge
 
-    m_wsAcknowledgerID = COpcString(szAcknowledgerID);
+    if (wcscmp(m_wsAcknowledgerID, szAcknowledgerID)) {
+        m_wsAcknowledgerID = COpcString(szAcknowledgerID);
+        ReleaseSharedAcknowledgerID();
+    }
 
     m_wChangeMask = 0;                          // Reset the change mask
 
@@ -256,10 +300,12 @@ HRESULT AeCondition::Acknowledge(LPCWSTR szAcknowledgerID, LPCWSTR szComment, FI
         try {
             if (V_BSTR(&m_pavAttrValues[ATTRNDX_ACKCOMMENT]) != NULL && wcscmp(V_BSTR(&m_pavAttrValues[ATTRNDX_ACKCOMMENT]), szComment) != 0) {
                 m_pavAttrValues[ATTRNDX_ACKCOMMENT] = szComment;
+                ReleaseAttrSnapshot();
                 m_wChangeMask |= OPC_CHANGE_ATTRIBUTE;
             }
         }
         catch (_com_error &e) {                 // Catch _variant_t operation errors
+            UpdateRefreshSet(NULL);
             return e.Error();
         }
     }
@@ -273,10 +319,13 @@ HRESULT AeCondition::Acknowledge(LPCWSTR szAcknowledgerID, LPCWSTR szComment, FI
 
     DWORD dwSubCondID;
     hres = m_pCondDef->GetSubCondDefID(m_pActiveSubCond, &dwSubCondID);
-    if (FAILED(hres)) return hres;
-
-    hres = pServerHandler->OnAcknowledgeNotification(m_dwCondID, dwSubCondID);
-    if (FAILED(hres)) return hres;
+    if (SUCCEEDED(hres)) {
+        hres = pServerHandler->OnAcknowledgeNotification(m_dwCondID, dwSubCondID);
+    }
+    if (FAILED(hres)) {
+        UpdateRefreshSet(NULL);                 // State is changed but no event is created
+        return hres;
+    }
 
     return CreateEventInstance(ppEvent);       // Create an event instance for client notification
 }
@@ -535,11 +584,13 @@ HRESULT AeCondition::ChangeState(AeConditionChangeStates& cs, AeEvent** ppEvent,
             for (DWORD i = m_pCondDef->Category()->NumOfInternalAttrs(), z = 0; i < m_dwNumOfAttrs; i++, z++) {
                 if (m_pavAttrValues[i] != cs.AttrValuesPtr()[z]) {
                     m_pavAttrValues[i] = cs.AttrValuesPtr()[z];
+                    ReleaseAttrSnapshot();
                     m_wChangeMask |= OPC_CHANGE_ATTRIBUTE;
                 }
             }
         }
         catch (_com_error &e) {                   // Catch _variant_t operation errors
+            UpdateRefreshSet(NULL);
             return e.Error();
         }
     }
@@ -552,6 +603,7 @@ HRESULT AeCondition::ChangeState(AeConditionChangeStates& cs, AeEvent** ppEvent,
     LPCWSTR szNewMessage = cs.Message() ? cs.Message() : m_pActiveSubCond->Description();
     if (wcscmp(m_wsMessage, szNewMessage)) {
         m_wsMessage = COpcString(szNewMessage);
+        ReleaseSharedMessage();
         m_wChangeMask |= OPC_CHANGE_MESSAGE;
     }
 
@@ -559,7 +611,10 @@ HRESULT AeCondition::ChangeState(AeConditionChangeStates& cs, AeEvent** ppEvent,
     // Severity
     //
     DWORD dwNewSeverity = cs.SeverityPtr() ? *cs.SeverityPtr() : m_pActiveSubCond->Severity();
-    if (dwNewSeverity < 1 || dwNewSeverity > 1000) return E_INVALIDARG;
+    if (dwNewSeverity < 1 || dwNewSeverity > 1000) {
+        UpdateRefreshSet(NULL);                   // Other states may be changed already
+        return E_INVALIDARG;
+    }
     if (m_dwSeverity != dwNewSeverity) {
         m_wChangeMask |= OPC_CHANGE_SEVERITY;
         m_dwSeverity = dwNewSeverity;
@@ -580,7 +635,10 @@ HRESULT AeCondition::ChangeState(AeConditionChangeStates& cs, AeEvent** ppEvent,
                                                    // Note: AcknowledgeByServer resets the change mask.
 
             hres = AcknowledgeByServer(L"Acknowledge No Longer Required", ppEvent, useCurrentTime);
-            if (FAILED(hres)) return hres;
+            if (FAILED(hres)) {
+                UpdateRefreshSet(NULL);
+                return hres;
+            }
             // Restore change mask
             m_wChangeMask = (*ppEvent)->wChangeMask | wCM;
             (*ppEvent)->Release();
@@ -610,6 +668,11 @@ HRESULT AeCondition::ChangeState(AeConditionChangeStates& cs, AeEvent** ppEvent,
 // -------------------
 //    Creates an event instance with the current values of the
 //    condition.
+//    The strings and attribute values are not copied. The event
+//    references the names of the source, condition and sub condition
+//    and the current message, acknowledger ID and attribute values
+//    which are shared with all other events created by this condition
+//    while these values are unchanged.
 //
 // Parameters:
 //    OUT
@@ -620,51 +683,70 @@ HRESULT AeCondition::CreateEventInstance(AeEvent** ppEvent)
     HRESULT     hres = S_OK;
     AeEvent*   pE = NULL;
     DWORD*      pdwAttrIDs = NULL;
+    SharedAttributeValueMap* pSnapshot = NULL;
 
     *ppEvent = NULL;
 
     try {
+        if (!m_pSharedMessage) {
+            hres = AeSharedString::Create(m_wsMessage, &m_pSharedMessage);
+            if (FAILED(hres)) throw hres;
+        }
+        if (!m_pSharedAcknowledgerID) {
+            hres = AeSharedString::Create(m_wsAcknowledgerID, &m_pSharedAcknowledgerID);
+            if (FAILED(hres)) throw hres;
+        }
+
+        if (!m_pAttrSnapshot) {
+            // Add all attribute IDs and values 
+            // The IDs are from the specified category and the current values from the user.
+            // The values must be in the same order and have the same types as specified by
+            // the category.
+
+            DWORD dwCount;
+
+            hres = m_pCondDef->Category()->GetAttributeIDs(&dwCount, &pdwAttrIDs);
+            if (FAILED(hres)) throw hres;
+
+            pSnapshot = new SharedAttributeValueMap;
+            if (!pSnapshot) throw E_OUTOFMEMORY;
+
+            hres = pSnapshot->Create(dwCount);
+            if (FAILED(hres)) throw hres;
+
+            for (DWORD i = 0; i < dwCount; i++) {
+                hres = pSnapshot->SetAtIndex(i, pdwAttrIDs[i], &m_pavAttrValues[i]);
+                if (FAILED(hres)) throw hres;
+            }
+            m_pAttrSnapshot = pSnapshot;         // Used until the attribute values are changed
+            pSnapshot = NULL;
+        }
+
         pE = new AeEvent;                        // Create an event instance
         if (!pE) throw E_OUTOFMEMORY;
 
         pE->wChangeMask = m_wChangeMask;
         pE->wNewState = m_wNewState;
-        pE->szSource = m_pSource->Name().Copy();
         pE->ftTime = m_ftTime;
-        pE->szMessage = m_wsMessage.Copy();
         pE->dwEventType = OPC_CONDITION_EVENT;
         pE->dwEventCategory = m_pCondDef->Category()->CatID();
         pE->dwSeverity = m_dwSeverity;
-        pE->szConditionName = m_pCondDef->Name().Copy();
-        pE->szSubconditionName = m_pActiveSubCond->Name().Copy();
         pE->wQuality = m_wQuality;
         pE->bAckRequired = IsAcked() ? FALSE : TRUE;
         pE->ftActiveTime = m_ftCondLastActive;
-        pE->dwCookie = (DWORD)this;    // Cookie must be unique
-        pE->szActorID = m_wsAcknowledgerID.Copy();
+        pE->dwCookie = Cookie();       // Cookie must be unique
         pE->wReserved = 0;
 
-        if (!pE->szConditionName || !pE->szSubconditionName ||
-            !pE->szActorID || !pE->szSource || !pE->szMessage) {
-            throw E_OUTOFMEMORY;
-        }
-
-        // Add all attribute IDs and values 
-        // The IDs are from the specified category and the current values from the user.
-        // The values must be in the same order and have the same types as specified by
-        // the category.
+        pE->SetSharedStrings(m_pSource->SharedName(), m_pSharedMessage,
+            m_pCondDef->SharedName(), m_pActiveSubCond->SharedName(),
+            m_pSharedAcknowledgerID);
 
-        DWORD dwCount;
-
-        hres = m_pCondDef->Category()->GetAttributeIDs(&dwCount, &pdwAttrIDs);
-        if (FAILED(hres)) throw hres;
-
-        hres = pE->m_mapAttrValues.Create(dwCount);
-        if (FAILED(hres)) throw hres;
+        m_pAttrSnapshot->AddRef();
+        pE->m_pAttrValues = m_pAttrSnapshot;
 
-        for (DWORD i = 0; i < dwCount; i++) {
-            hres = pE->m_mapAttrValues.SetAtIndex(i, pdwAttrIDs[i], &m_pavAttrValues[i]);
-            if (FAILED(hres)) throw hres;
+        if (m_pAreaSet) {
+            m_pAreaSet->AddRef();
+            pE->m_pAreaSet = m_pAreaSet;
         }
     }
     catch (HRESULT hresEx) {
@@ -678,11 +760,17 @@ HRESULT AeCondition::CreateEventInstance(AeEvent** ppEvent)
         if (pE) {
             pE->Release();
         }
+        UpdateRefreshSet(NULL);
     }
     else {
         *ppEvent = pE;
+        UpdateRefreshSet(pE);                    // The event with the current state is also
+                                                 // sent by the next Refresh.
     }
 
+    if (pSnapshot) {                             // Not completely initialized
+        pSnapshot->Release();
+    }
     if (pdwAttrIDs)                              // Delete the temporary array of Attributes IDs.
         delete[] pdwAttrIDs;
 
@@ -691,6 +779,38 @@ HRESULT AeCondition::CreateEventInstance(AeEvent** ppEvent)
 
 
 
+//=========================================================================
+// UpdateAreas
+// -----------
+//    Takes the current areas of the source for the internal attribute
+//    'AREAS' and the area set. Must be called if the source is added
+//    to an additional area. Events which already reference the
+//    previous values are not affected.
+//=========================================================================
+HRESULT AeCondition::UpdateAreas()
+{
+    _variant_t vAreas;
+
+    HRESULT hres = m_pSource->GetAreaNames(&vAreas);
+    if (FAILED(hres)) return hres;
+
+    try {
+        m_pavAttrValues[ATTRNDX_AREAS] = vAreas;
+    }
+    catch (_com_error &e) {                      // catch _variant_t operation errors
+        return e.Error();
+    }
+    ReleaseAttrSnapshot();                       // The next event has the new areas
+
+    if (m_pAreaSet) {
+        m_pAreaSet->Release();
+    }
+    m_pAreaSet = m_pSource->GetAreaSet();
+    return S_OK;
+}
+
+
+
 //=========================================================================
 // IsAttachedTo
 // ------------
@@ -750,5 +870,219 @@ BOOL AeCondition::IsAttachedTo(LPCWSTR szSource, LPCWSTR szConditionName)
     if (wcscmp(m_pCondDef->Name(), szConditionName))    return FALSE;
     return TRUE;
 }
+
+
+//-------------------------------------------------------------------------
+// IMPLEMENTATION
+//-------------------------------------------------------------------------
+
+//=========================================================================
+// ReleaseSharedMessage
+// --------------------
+//    Must be called if the message is changed. Events already created
+//    keep their own reference to the previous message.
+//=========================================================================
+void AeCondition::ReleaseSharedMessage()
+{
+    if (m_pSharedMessage) {
+        m_pSharedMessage->Release();
+        m_pSharedMessage = NULL;
+    }
+}
+
+
+
+//=========================================================================
+// ReleaseSharedAcknowledgerID
+// ---------------------------
+//    Must be called if the acknowledger ID is changed.
+//=========================================================================
+void AeCondition::ReleaseSharedAcknowledgerID()
+{
+    if (m_pSharedAcknowledgerID) {
+        m_pSharedAcknowledgerID->Release();
+        m_pSharedAcknowledgerID = NULL;
+    }
+}
+
+
+
+//=========================================================================
+// ReleaseAttrSnapshot
+// -------------------
+//    Must be called if an attribute value is changed. The next event
+//    instance creates a new snapshot of the attribute values.
+//=========================================================================
+void AeCondition::ReleaseAttrSnapshot()
+{
+    if (m_pAttrSnapshot) {
+        m_pAttrSnapshot->Release();
+        m_pAttrSnapshot = NULL;
+    }
+}
+
+
+
+//=========================================================================
+// UpdateRefreshSet
+// ----------------
+//    Updates the membership of this condition in the refresh set.
+//    Must be called after each state change. pEvent is the event
+//    instance with the current state or NULL if no such event is
+//    available; in this case the event is created by the next Refresh.
+//=========================================================================
+void AeCondition::UpdateRefreshSet(AeEvent* pEvent)
+{
+    if (m_pRefreshSet) {
+        m_pRefreshSet->Update(this, pEvent);
+    }
+}
+
+
+
+//-------------------------------------------------------------------------
+// CODE AeConditionRefreshSet
+//-------------------------------------------------------------------------
+
+//=========================================================================
+// Construction
+//=========================================================================
+AeConditionRefreshSet::AeConditionRefreshSet()
+{
+    m_pHead = NULL;
+    m_pTail = NULL;
+    m_dwCount = 0;
+}
+
+
+
+//=========================================================================
+// Destructor
+//=========================================================================
+AeConditionRefreshSet::~AeConditionRefreshSet()
+{
+    while (m_pHead) {                            // Normally all conditions are already removed
+        Remove(m_pHead);
+    }
+}
+
+
+
+//=========================================================================
+// Update
+// ------
+//    Adds the condition to the set if it must be sent by a Refresh;
+//    otherwise it's removed from the set.
+//    The specified event instance is referenced as event for the next
+//    Refresh. If pEvent is NULL then the event instance is created
+//    by the next Refresh.
+//=========================================================================
+void AeConditionRefreshSet::Update(AeCondition* pCond, AeEvent* pEvent)
+{
+    if (!pCond->IsRefreshRequired()) {
+        Remove(pCond);
+        return;
+    }
+
+    if (pEvent) {
+        pEvent->AddRef();
+    }
+
+    m_csSet.Lock();
+    AeEvent* pOldEvent = pCond->m_pRefreshEvent;
+    pCond->m_pRefreshEvent = pEvent;
+
+    if (!pCond->m_fInRefreshSet) {               // Append new member
+        pCond->m_pRefreshPrev = m_pTail;
+        pCond->m_pRefreshNext = NULL;
+        if (m_pTail) {
+            m_pTail->m_pRefreshNext = pCond;
+        }
+        else {
+            m_pHead = pCond;
+        }
+        m_pTail = pCond;
+        pCond->m_fInRefreshSet = TRUE;
+        m_dwCount++;
+    }
+    m_csSet.Unlock();
+
+    if (pOldEvent) {                             // Event with the previous state
+        pOldEvent->Release();
+    }
+}
+
+
+
+//=========================================================================
+// Remove
+// ------
+//    Removes the condition from the set if it's a member.
+//=========================================================================
+void AeConditionRefreshSet::Remove(AeCondition* pCond)
+{
+    m_csSet.Lock();
+    AeEvent* pOldEvent = pCond->m_pRefreshEvent;
+    pCond->m_pRefreshEvent = NULL;
+
+    if (pCond->m_fInRefreshSet) {
+        if (pCond->m_pRefreshPrev) {
+            pCond->m_pRefreshPrev->m_pRefreshNext = pCond->m_pRefreshNext;
+        }
+        else {
+            m_pHead = pCond->m_pRefreshNext;
+        }
+        if (pCond->m_pRefreshNext) {
+            pCond->m_pRefreshNext->m_pRefreshPrev = pCond->m_pRefreshPrev;
+        }
+        else {
+            m_pTail = pCond->m_pRefreshPrev;
+        }
+        pCond->m_pRefreshPrev = NULL;
+        pCond->m_pRefreshNext = NULL;
+        pCond->m_fInRefreshSet = FALSE;
+        m_dwCount--;
+    }
+    m_csSet.Unlock();
+
+    if (pOldEvent) {
+        pOldEvent->Release();
+    }
+}
+
+
+
+//=========================================================================
+// GetEvents
+// ---------
+//    Returns a snapshot of the set. The event instances of all members
+//    are added to arEventPtrs and must be released by the caller.
+//    Members without event instance are added to arStaleConds; the
+//    caller must create the event instances of these conditions.
+//    Only the critical section of the set is locked.
+//=========================================================================
+HRESULT AeConditionRefreshSet::GetEvents(CSimpleArray<AeEvent*>& arEventPtrs,
+    CSimpleArray<AeCondition*>& arStaleConds)
+{
+    HRESULT hres = S_OK;
+
+    m_csSet.Lock();
+    for (AeCondition* pCond = m_pHead; pCond; pCond = pCond->m_pRefreshNext) {
+        if (pCond->m_pRefreshEvent) {
+            if (!arEventPtrs.Add(pCond->m_pRefreshEvent)) {
+                hres = E_OUTOFMEMORY;
+                break;
+            }
+            pCond->m_pRefreshEvent->AddRef();
+        }
+        else if (!arStaleConds.Add(pCond)) {
+            hres = E_OUTOFMEMORY;
+            break;
+        }
+    }
+    m_csSet.Unlock();
+
+    return hres;
+}
 //DOM-IGNORE-END
 #endif
\ No newline at end of file
@@ -29,11 +29,14 @@
 
 #include "OpcString.h"
 #include "AeConditionDefinition.h"
+#include "AeAreaSet.h"
 
 class AeSource;
 class AeEvent;
 class AttributeValueMap;
+class SharedAttributeValueMap;
 class AeConditionChangeStates;
+class AeConditionRefreshSet;
 class _variant_t;
 
 
@@ -41,11 +44,15 @@ class _variant_t;
 // CLASS AeCondition
 //-----------------------------------------------------------------------
 class AeCondition {
+                                                // Maintains the refresh set members
+   friend class AeConditionRefreshSet;
+
 // Construction
 public:
    AeCondition();                           // Default Constructor
                                                 // Initializer
-   HRESULT Create( DWORD dwCondID, AeConditionDefiniton* pCondDef, AeSource* pSource );
+   HRESULT Create( DWORD dwCondID, AeConditionDefiniton* pCondDef, AeSource* pSource,
+                   AeConditionRefreshSet* pRefreshSet = NULL );
 
 // Destruction
 public:
@@ -57,6 +64,10 @@ public:
    inline BOOL IsActive() const { return (m_wNewState & OPC_CONDITION_ACTIVE) ? TRUE : FALSE; }
    inline BOOL IsEnabled() const { return (m_wNewState & OPC_CONDITION_ENABLED) ? TRUE : FALSE; }
    inline BOOL IsAcked() const { return (m_wNewState & OPC_CONDITION_ACKED) ? TRUE : FALSE; }
+                                                // Condition must be sent by a Refresh
+   inline BOOL IsRefreshRequired() const { return IsEnabled() && (IsActive() || !IsAcked()); }
+                                                // Cookie of the condition events, must be unique
+   inline DWORD Cookie() const { return m_dwCookie; }
 
 // Operations
 public:
@@ -65,6 +76,7 @@ public:
    HRESULT  Acknowledge( LPCWSTR AcknowledgerID, LPCWSTR szComment, FILETIME ftActiveTime, AeEvent** ppEvent, BOOL useCurrentTime = TRUE);
    HRESULT  GetState( DWORD dwNumEventAttrs, DWORD* pdwAttributeIDs, OPCCONDITIONSTATE** pState );
    HRESULT  CreateEventInstance( AeEvent** ppEvent );
+   HRESULT  UpdateAreas();
    HRESULT  ChangeState( AeConditionChangeStates& cs, AeEvent** ppEvent, BOOL useCurrentTime = TRUE);
    BOOL     IsAttachedTo( LPCWSTR szSource, LPCWSTR szConditionName );
    BOOL     IsAttachedTo( LPCWSTR szSource, DWORD dwEventCategory,
@@ -93,13 +105,79 @@ protected:
    COpcString m_wsMessage;               // Current Message
 
    DWORD                   m_dwCondID;
+   DWORD                   m_dwCookie;       // Unique, never 0
    AeSource*           m_pSource;
    AeConditionDefiniton*     m_pCondDef;
 
    DWORD                   m_dwNumOfAttrs;
    _variant_t*             m_pavAttrValues;
+   AeAreaSet*              m_pAreaSet;       // Indices of the areas in m_pavAttrValues[ATTRNDX_AREAS]
 
    AeSubConditionDefiniton*  m_pActiveSubCond;
+
+   // Event payload shared by all event instances created while
+   // the values are unchanged. Created on demand by
+   // CreateEventInstance() and released if the values change.
+   AeSharedString*         m_pSharedMessage;
+   AeSharedString*         m_pSharedAcknowledgerID;
+   SharedAttributeValueMap* m_pAttrSnapshot;
+
+   void     ReleaseSharedMessage();
+   void     ReleaseSharedAcknowledgerID();
+   void     ReleaseAttrSnapshot();
+
+   // Refresh Set membership. These members are protected by the
+   // critical section of the refresh set.
+   AeConditionRefreshSet*  m_pRefreshSet;
+   BOOL                    m_fInRefreshSet;
+   AeCondition*            m_pRefreshPrev;
+   AeCondition*            m_pRefreshNext;
+   AeEvent*                m_pRefreshEvent;  // Event with the current state or
+                                             // NULL if it must be created again.
+
+   void     UpdateRefreshSet( AeEvent* pEvent );
+
+   static LONG             m_lLastCookie;    // Last cookie assigned to a condition
+};
+
+
+
+//-----------------------------------------------------------------------
+// CLASS AeConditionRefreshSet
+//-----------------------------------------------------------------------
+// Intrusive list of all conditions which must be sent by a Refresh,
+// i.e. conditions which are enabled and active or enabled and
+// unacknowledged. The conditions update their membership if their state
+// changes. Each member holds the event instance of its current state so
+// that a Refresh needs only to reference these events.
+//-----------------------------------------------------------------------
+class AeConditionRefreshSet {
+// Construction
+public:
+   AeConditionRefreshSet();
+
+// Destruction
+public:
+   ~AeConditionRefreshSet();
+
+// Attributes
+public:
+   inline DWORD Count() const { return m_dwCount; }
+
+// Operations
+public:
+   void     Update( AeCondition* pCond, AeEvent* pEvent );
+   void     Remove( AeCondition* pCond );
+   HRESULT  GetEvents( CSimpleArray<AeEvent*>& arEventPtrs,
+                       CSimpleArray<AeCondition*>& arStaleConds );
+
+// Implementation
+protected:
+   CComAutoCriticalSection m_csSet;             // lock/unlock the list and the
+                                                // refresh members of the conditions
+   AeCondition*            m_pHead;
+   AeCondition*            m_pTail;
+   DWORD                   m_dwCount;
 };
 //DOM-IGNORE-END
 
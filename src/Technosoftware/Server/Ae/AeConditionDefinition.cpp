@@ -40,6 +40,7 @@ AeSubConditionDefiniton::AeSubConditionDefiniton()
 {
    m_dwSeverity = 0;
    m_fAckRequired = FALSE;
+   m_pSharedName = NULL;
 }
 
 
@@ -64,6 +65,8 @@ HRESULT AeSubConditionDefiniton::Create( LPCWSTR szName, LPCWSTR szDef,
       m_wsDescr = COpcString( szDescr );
 
       m_wsDef = COpcString( szDef );
+
+      hres = AeSharedString::Create( szName, &m_pSharedName );
    }
    catch(HRESULT hresEx) {
       hres = hresEx;
@@ -78,6 +81,9 @@ HRESULT AeSubConditionDefiniton::Create( LPCWSTR szName, LPCWSTR szDef,
 //=========================================================================
 AeSubConditionDefiniton::~AeSubConditionDefiniton()
 {
+   if (m_pSharedName) {
+      m_pSharedName->Release();
+   }
 }
 
 
@@ -93,6 +99,7 @@ AeConditionDefiniton::AeConditionDefiniton()
 {
    m_pCategory = NULL;
    m_dwCondDefID  = 0;
+   m_pSharedName = NULL;
 }
 
 
@@ -136,6 +143,12 @@ HRESULT AeConditionDefiniton::Create( AeCategory* pCategory, DWORD dwCondDefID,
 
    m_wsName = COpcString( szName );
 
+   if (m_pSharedName) {
+      m_pSharedName->Release();
+      m_pSharedName = NULL;
+   }
+   hres = AeSharedString::CreateUnique( szName, &m_pSharedName );
+
    m_csMem.Unlock();
    return hres;
 }
@@ -194,6 +207,10 @@ AeConditionDefiniton::~AeConditionDefiniton()
       if (pSubCond) delete pSubCond;
    }
    m_csMem.Unlock();
+
+   if (m_pSharedName) {
+      m_pSharedName->Release();
+   }
 }
 
 
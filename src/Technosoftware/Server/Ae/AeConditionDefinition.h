@@ -28,6 +28,7 @@
 #endif // _MSC_VER >= 1000
 
 #include "OpcString.h"
+#include "AeSharedString.h"
 
 class AeCategory;
 
@@ -50,6 +51,7 @@ public:
 // Attributes
 public:
    inline COpcString&  Name()               { return m_wsName;      }
+   inline AeSharedString* SharedName()      { return m_pSharedName; }
    inline COpcString&  Definition()         { return m_wsDef;       }
    inline DWORD         Severity() const     { return m_dwSeverity;  }
    inline COpcString&  Description()        { return m_wsDescr;     }
@@ -58,6 +60,7 @@ public:
 // Implementation
 protected:
 	COpcString    m_wsName;
+	AeSharedString* m_pSharedName;            // Name referenced by the events
 	COpcString    m_wsDef;
 	DWORD          m_dwSeverity;
 	COpcString    m_wsDescr;
@@ -92,6 +95,7 @@ public:
 public:
    inline DWORD CondDefID() const { return m_dwCondDefID; }
    inline COpcString& Name() { return m_wsName; }
+   inline AeSharedString* SharedName() { return m_pSharedName; }
    inline AeCategory* Category() { return m_pCategory; }
    inline AeSubConditionDefiniton* DefaultSubCondition() { return m_mapSubCond.m_aVal[0]; }
    inline AeSubConditionDefiniton* SubCondition( DWORD dwSubCondDefID ) { return m_mapSubCond.Lookup( dwSubCondDefID ); }
@@ -124,6 +128,7 @@ protected:
    DWORD                   m_dwCondDefID;
    AeCategory*         m_pCategory;
    COpcString             m_wsName;
+   AeSharedString*     m_pSharedName;       // Name referenced by the events
 
    CSimpleMap<DWORD, AeSubConditionDefiniton*> m_mapSubCond;
 };
@@ -55,6 +55,15 @@ AeEvent::AeEvent()
    szMessage            = NULL;
    dwNumEventAttrs      = 0;
    pEventAttributes     = NULL;
+
+   m_pSharedSource            = NULL;
+   m_pSharedMessage           = NULL;
+   m_pSharedConditionName     = NULL;
+   m_pSharedSubconditionName  = NULL;
+   m_pSharedActorID           = NULL;
+   m_pAttrValues              = NULL;
+   m_pAreaSet                 = NULL;
+   m_ullSequence              = 0;
 }
 
 
@@ -96,18 +105,24 @@ HRESULT AeEvent::Create( AeCategory* pCat, AeSource *pSource,
    _ASSERTE( pSource );
    _ASSERTE( szParMessage );
 
-   HRESULT  hres = S_OK;
-   DWORD*   pdwAttrIDs = NULL;
+   HRESULT           hres = S_OK;
+   DWORD*            pdwAttrIDs = NULL;
+   AeSharedString*   pMessage = NULL;
+   AeSharedString*   pActorID = NULL;
+   AeSharedString*   pEmpty = AeSharedString::Empty();
 
    try {
+      if (!pEmpty) throw E_OUTOFMEMORY;
 
       // initialize members which are different between simple and tracking events
       if (szParActorID) {
-         szActorID = WSTRClone( szParActorID );
+         hres = AeSharedString::Create( szParActorID, &pActorID );
+         if (FAILED( hres )) throw hres;
          dwEventType = OPC_TRACKING_EVENT;
       }
       else {
-         szActorID = WSTRClone( L"" );
+         pActorID = pEmpty;
+         pActorID->AddRef();
          dwEventType = OPC_SIMPLE_EVENT;
       }
       if (dwEventType != pCat->EventType())
@@ -117,8 +132,6 @@ HRESULT AeEvent::Create( AeCategory* pCat, AeSource *pSource,
       // initialize members which are not required for simple and tracking events
       wChangeMask          = 0;
       wNewState            = 0;
-      szConditionName      = WSTRClone( L"" );
-      szSubconditionName   = WSTRClone( L"" );
       wQuality             = 0;
       wReserved            = 0;
       bAckRequired         = 0;
@@ -133,15 +146,16 @@ HRESULT AeEvent::Create( AeCategory* pCat, AeSource *pSource,
          hres = CoFileTimeNow( &ftTime );
          if (FAILED( hres )) throw hres;
       }
-      szSource             = pSource->Name().Copy();
-      szMessage            = WSTRClone( szParMessage );
       dwEventCategory      = pCat->CatID();
       dwSeverity           = dwParSeverity;
 
-      if ((szConditionName == NULL) || (szSubconditionName == NULL) ||
-          (szActorID == NULL) || (szSource == NULL) || (szMessage == NULL)) {
-         throw E_OUTOFMEMORY;
-      }
+      hres = AeSharedString::Create( szParMessage, &pMessage );
+      if (FAILED( hres )) throw hres;
+
+      _ASSERTE( pSource->SharedName() );
+      // simple and tracking events have no condition and sub condition names
+      SetSharedStrings( pSource->SharedName(), pMessage, pEmpty, pEmpty, pActorID );
+      m_pAreaSet = pSource->GetAreaSet();
 
       // Add all attribute IDs and values
       // The IDs are from the specified category and the current values from the user.
@@ -153,7 +167,10 @@ HRESULT AeEvent::Create( AeCategory* pCat, AeSource *pSource,
       hres = pCat->GetAttributeIDs( &dwCount, &pdwAttrIDs );
       if (FAILED( hres )) throw hres;
 
-      hres = m_mapAttrValues.Create( dwCount );
+      m_pAttrValues = new SharedAttributeValueMap;
+      if (!m_pAttrValues) throw E_OUTOFMEMORY;
+
+      hres = m_pAttrValues->Create( dwCount );
       if (FAILED( hres )) throw hres;
 
       // Initialize the vendor specific attributes
@@ -173,13 +190,13 @@ HRESULT AeEvent::Create( AeCategory* pCat, AeSource *pSource,
                //
                {
                   _variant_t vTmp( "" );
-                  hres = m_mapAttrValues.SetAtIndex( i, pdwAttrIDs[i], &vTmp );
+                  hres = m_pAttrValues->SetAtIndex( i, pdwAttrIDs[i], &vTmp );
                }
             #else
                //
                // Not Sun Solaris.
                //
-               hres = m_mapAttrValues.SetAtIndex( i, pdwAttrIDs[i], &_variant_t( "" ) );
+               hres = m_pAttrValues->SetAtIndex( i, pdwAttrIDs[i], &_variant_t( "" ) );
             #endif
                if (FAILED( hres )) throw hres;
                break;
@@ -190,14 +207,14 @@ HRESULT AeEvent::Create( AeCategory* pCat, AeSource *pSource,
                   hres = pSource->GetAreaNames( &vAreas );
                   if (FAILED( hres )) throw hres;
 
-                  hres = m_mapAttrValues.SetAtIndex( i, pdwAttrIDs[i], &vAreas );
+                  hres = m_pAttrValues->SetAtIndex( i, pdwAttrIDs[i], &vAreas );
                   VariantClear( &vAreas );
                   if (FAILED( hres )) throw hres;
                }
                break;
 
             default:
-               hres = m_mapAttrValues.SetAtIndex( i, pdwAttrIDs[i], &pvAttrValues[i - pCat->NumOfInternalAttrs()] );
+               hres = m_pAttrValues->SetAtIndex( i, pdwAttrIDs[i], &pvAttrValues[i - pCat->NumOfInternalAttrs()] );
                if (FAILED( hres )) throw hres;
                break;
          }
@@ -214,6 +231,10 @@ HRESULT AeEvent::Create( AeCategory* pCat, AeSource *pSource,
 
    if (pdwAttrIDs)
       delete [] pdwAttrIDs;
+                                                // the event holds its own references
+   if (pMessage) pMessage->Release();
+   if (pActorID) pActorID->Release();
+   if (pEmpty)   pEmpty->Release();
 
    return hres;
 }
@@ -224,6 +245,40 @@ HRESULT AeEvent::Create( AeCategory* pCat, AeSource *pSource,
 // IMPLEMENTATION
 //-------------------------------------------------------------------------
 
+//=========================================================================
+// SetSharedStrings
+// ----------------
+//    Initializes the string members with the text of the specified
+//    shared strings. The strings are referenced by this instance.
+//    All strings must be specified.
+//=========================================================================
+void AeEvent::SetSharedStrings( AeSharedString* pSource, AeSharedString* pMessage,
+                                 AeSharedString* pConditionName, AeSharedString* pSubconditionName,
+                                 AeSharedString* pActorID )
+{
+   _ASSERTE( pSource && pMessage && pConditionName && pSubconditionName && pActorID );
+
+   pSource->AddRef();
+   pMessage->AddRef();
+   pConditionName->AddRef();
+   pSubconditionName->AddRef();
+   pActorID->AddRef();
+
+   m_pSharedSource            = pSource;
+   m_pSharedMessage           = pMessage;
+   m_pSharedConditionName     = pConditionName;
+   m_pSharedSubconditionName  = pSubconditionName;
+   m_pSharedActorID           = pActorID;
+
+   szSource                   = pSource->Text();
+   szMessage                  = pMessage->Text();
+   szConditionName            = pConditionName->Text();
+   szSubconditionName         = pSubconditionName->Text();
+   szActorID                  = pActorID->Text();
+}
+
+
+
 //=========================================================================
 // Cleanup
 // -------
@@ -233,27 +288,40 @@ HRESULT AeEvent::Create( AeCategory* pCat, AeSource *pSource,
 //=========================================================================
 void AeEvent::Cleanup()
 {
-   if (szConditionName) {
-      delete szConditionName;
-      szConditionName = NULL;
+   szConditionName      = NULL;
+   szSubconditionName   = NULL;
+   szActorID            = NULL;
+   szSource             = NULL;
+   szMessage            = NULL;
+
+   if (m_pSharedSource) {
+      m_pSharedSource->Release();
+      m_pSharedSource = NULL;
+   }
+   if (m_pSharedMessage) {
+      m_pSharedMessage->Release();
+      m_pSharedMessage = NULL;
    }
-   if (szSubconditionName) {
-      delete szSubconditionName;
-      szSubconditionName = NULL;
+   if (m_pSharedConditionName) {
+      m_pSharedConditionName->Release();
+      m_pSharedConditionName = NULL;
    }
-   if (szActorID) {
-      delete szActorID;
-      szActorID = NULL;
+   if (m_pSharedSubconditionName) {
+      m_pSharedSubconditionName->Release();
+      m_pSharedSubconditionName = NULL;
    }
-   if (szSource) {
-      delete szSource;
-      szSource = NULL;
+   if (m_pSharedActorID) {
+      m_pSharedActorID->Release();
+      m_pSharedActorID = NULL;
    }
-   if (szMessage) {
-      delete szMessage;
-      szMessage = NULL;
+   if (m_pAttrValues) {                         // release the attribute values
+      m_pAttrValues->Release();
+      m_pAttrValues = NULL;
+   }
+   if (m_pAreaSet) {
+      m_pAreaSet->Release();
+      m_pAreaSet = NULL;
    }
-   m_mapAttrValues.~AttributeValueMap();            // remove all added values
 }
 
 
@@ -348,20 +416,21 @@ AeSubscribedEvent::AeSubscribedEvent()
 // -----------
 //    Must be called after construction.
 //    Creates a shallow copy of the specified AeEvent instance.
-//    The event attributes are shallow copies of the attribute 
-//    values associated with the specified IDs.
+//    The event attributes are shallow copies of the attribute
+//    values associated with the specified IDs. They are stored in
+//    the specified buffer which must have room for dwNumOfAttrIDs
+//    values and must be valid as long as this instance is used.
 //=========================================================================
-HRESULT AeSubscribedEvent::Create( AeEvent* pOnEvent, DWORD dwNumOfAttrIDs, DWORD dwAttrIDs[] )
+HRESULT AeSubscribedEvent::Create( AeEvent* pOnEvent, DWORD dwNumOfAttrIDs, DWORD dwAttrIDs[],
+                                    LPVARIANT pvAttrBuffer )
 {
    DWORD       i;
    LPVARIANT   pv;
 
    *(ONEVENTSTRUCT *)this = *pOnEvent;       // shallow copy 
 
-                                             // shallow copy of selected attributes
-   pEventAttributes = new VARIANT [dwNumOfAttrIDs];
-   if (!pEventAttributes) return E_OUTOFMEMORY;
-
+   _ASSERTE( pvAttrBuffer || (dwNumOfAttrIDs == 0) );
+   pEventAttributes = pvAttrBuffer;          // shallow copy of selected attributes
    dwNumEventAttrs = dwNumOfAttrIDs;
 
    for (i=0; i < dwNumEventAttrs; i++) {
@@ -371,17 +440,5 @@ HRESULT AeSubscribedEvent::Create( AeEvent* pOnEvent, DWORD dwNumOfAttrIDs, DWOR
    }
    return S_OK;
 }
-
-
-
-//=========================================================================
-// Destructor
-//=========================================================================
-AeSubscribedEvent::~AeSubscribedEvent()
-{
-   if (pEventAttributes) {
-      delete [] pEventAttributes;
-   }
-}
 //DOM-IGNORE-END
 #endif
\ No newline at end of file
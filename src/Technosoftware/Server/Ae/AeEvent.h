@@ -28,6 +28,8 @@
 #endif // _MSC_VER >= 1000
 
 #include "AeAttributeValueMap.h"
+#include "AeSharedString.h"
+#include "AeAreaSet.h"
 #include "AeCondition.h"
 #include "UtilityDefs.h"                        // for CRefClass
 
@@ -42,6 +44,8 @@ class AeEvent : public ONEVENTSTRUCT, public CRefClass
 {                                      
                                                 // For initialization of the attribute value map
    friend HRESULT AeCondition::CreateEventInstance( AeEvent** ppEvent );
+                                                // For numbering of the fired events
+   friend class AeEventHistory;
 
 // Construction
 public:
@@ -63,11 +67,29 @@ private:
 // Operations
 public:
    inline LPVARIANT LookupAttributeValue( DWORD dwAttrID )
-         { return m_mapAttrValues.Lookup( dwAttrID );}
+         { return m_pAttrValues ? m_pAttrValues->Lookup( dwAttrID ) : NULL; }
+                                                // Indices of the areas in attribute ATTRID_AREAS
+   inline AeAreaSet* AreaSet() const { return m_pAreaSet; }
+                                                // Sequence number assigned when fired, 0 if not fired
+   inline ULONGLONG Sequence() const { return m_ullSequence; }
 
 // Implementation
 protected:
-   AttributeValueMap m_mapAttrValues;               // Copy of all current attribute values
+                                                // The string members of ONEVENTSTRUCT point
+                                                // to the text of these shared strings.
+   AeSharedString*         m_pSharedSource;
+   AeSharedString*         m_pSharedMessage;
+   AeSharedString*         m_pSharedConditionName;
+   AeSharedString*         m_pSharedSubconditionName;
+   AeSharedString*         m_pSharedActorID;
+   SharedAttributeValueMap* m_pAttrValues;      // Snapshot of all attribute values,
+                                                // maybe shared with other events.
+   AeAreaSet*              m_pAreaSet;          // Areas of the source, shared with the source.
+   ULONGLONG               m_ullSequence;       // Sequence number of the event history.
+
+   void SetSharedStrings( AeSharedString* pSource, AeSharedString* pMessage,
+                          AeSharedString* pConditionName, AeSharedString* pSubconditionName,
+                          AeSharedString* pActorID );
    void Cleanup();
 };
 
@@ -113,11 +135,13 @@ class AeSubscribedEvent : public ONEVENTSTRUCT
 // Construction
 public:
    AeSubscribedEvent();
-   HRESULT Create( AeEvent* pOnEvent, DWORD dwNumOfAttrIDs, DWORD dwAttrIDs[] );
+   HRESULT Create( AeEvent* pOnEvent, DWORD dwNumOfAttrIDs, DWORD dwAttrIDs[],
+                   LPVARIANT pvAttrBuffer );
 
-// Destruction
-public:
-   ~AeSubscribedEvent();
+   // Note:
+   //    There is no destructor. The attribute values are stored in the
+   //    buffer provided by the caller which is usually shared by all
+   //    events of a callback.
 };
 //DOM-IGNORE-END
 
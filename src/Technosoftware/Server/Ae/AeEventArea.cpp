@@ -48,6 +48,9 @@ WCHAR EventArea::delimiter_[2] = L".";
 EventArea::EventArea()
 {
    areaId_			= AREAID_UNSPECIFIED;
+   areaIndex_		= 0;
+   nextIndex_		= 0;
+   revision_		= 0;
    parent_			= NULL;
    root_			= NULL;
    partialName_		= NULL;
@@ -68,6 +71,8 @@ HRESULT EventArea::Create( EventArea* parent, DWORD areaId, LPCWSTR areaName )
 
    areaId_  = areaId;							// The ID must not be set before
                                                 // call of function GetArea().
+                                                // Assign the dense index, the root has index 0
+   areaIndex_ = static_cast<DWORD>(InterlockedIncrement( &root_->nextIndex_ ) - 1);
                                                 // Set the fully qualified area name
    if (parent_ && !parent_->IsRoot()) {			// It's a sub-area
       LPWSTR szQualifiedName = new WCHAR [wcslen( parent_->Name() ) + wcslen( areaName ) + 2 ];
@@ -95,6 +100,9 @@ HRESULT EventArea::Create( EventArea* parent, DWORD areaId, LPCWSTR areaName )
          parent_->subAreasLock_.Lock();
          hres = parent_->subAreas_.Add( static_cast<EventArea*>(this) ) ? S_OK : E_OUTOFMEMORY;
          parent_->subAreasLock_.Unlock();
+         if (SUCCEEDED( hres )) {				// Resolved area filters must be updated
+            InterlockedIncrement( &root_->revision_ );
+         }
       }
    }
 
@@ -316,7 +324,7 @@ HRESULT EventArea::DetachSource( AeSource* source)
 }
 
 
-HRESULT EventArea::EnableConditions( BOOL enable, CSimpleValArray<AeEventArray*>& events)
+HRESULT EventArea::EnableConditions( BOOL enable, const AeAreaSet* skipAreas, CSimpleValArray<AeEventArray*>& events)
 {
    AeEventArray* parEvents;
    HRESULT        hres;
@@ -326,6 +334,17 @@ HRESULT EventArea::EnableConditions( BOOL enable, CSimpleValArray<AeEventArray*>
 
    for (int i=0; i < sources_.GetSize(); i++) {
 
+      if (skipAreas) {                           // Skip sources of areas which are already handled
+         AeAreaSet* pAreaSet = sources_[i]->GetAreaSet();
+         BOOL fSkip = (pAreaSet && pAreaSet->Intersects( skipAreas ));
+         if (pAreaSet) {
+            pAreaSet->Release();
+         }
+         if (fSkip) {
+            continue;
+         }
+      }
+
       parEvents = new AeEventArray;
       if (!parEvents) {
          hresRet = E_OUTOFMEMORY;
@@ -334,6 +353,7 @@ HRESULT EventArea::EnableConditions( BOOL enable, CSimpleValArray<AeEventArray*>
 
       hres = sources_[i]->EnableConditions(enable, parEvents );
       if (FAILED( hres )) {
+         delete parEvents;
          hresRet = hres;
          break;
       }
@@ -342,8 +362,8 @@ HRESULT EventArea::EnableConditions( BOOL enable, CSimpleValArray<AeEventArray*>
       }
 
       if (parEvents->NumOfEvents()) {			// Add it only to the array if at least one state has changed.
-         hres = events.Add( parEvents );
-         if (FAILED( hres )) {
+         if (!events.Add( parEvents )) {
+            delete parEvents;
             hresRet = S_FALSE;					// Not succeeded for all conditions.
          }
       }
@@ -377,6 +397,37 @@ BOOL EventArea::ExistArea( LPCWSTR areaName)
 
 
 
+HRESULT EventArea::LookupAreaIndices( LPCWSTR areaName, CSimpleArray<DWORD>& indices )
+{
+   HRESULT hres = S_OK;
+
+   subAreasLock_.Lock();
+   for (int i=0; i < subAreas_.GetSize(); i++) {
+
+      EventArea* eventArea = subAreas_[i];
+      size_t len = wcslen( eventArea->name_ );
+      if (wcsncmp( eventArea->name_, areaName, len ) != 0) {
+         continue;                              // Not in this branch
+      }
+      if (areaName[len] == L'\0') {				// This sub-area has the specified name
+         if (!indices.Add( eventArea->areaIndex_ )) {
+            hres = E_OUTOFMEMORY;
+            break;
+         }
+      }
+      else if (areaName[len] == delimiter_[0]) {	// The area is located in this branch
+         hres = eventArea->LookupAreaIndices( areaName, indices );
+         if (FAILED( hres )) {
+            break;
+         }
+      }
+   }
+   subAreasLock_.Unlock();
+   return hres;
+}
+
+
+
 //-------------------------------------------------------------------------
 // IMPLEMENTATION
 //-------------------------------------------------------------------------
@@ -88,6 +88,8 @@ public:
    inline WideString&   Name()            { return name_; }
    inline LPCWSTR       PartialName()     { return partialName_; }
    inline LPCWSTR       Delimiter() const { return delimiter_; }
+   inline DWORD         Index() const     { return areaIndex_; }
+   inline LONG          Revision() const  { return root_->revision_; }
 
 // Operations
 public:
@@ -210,11 +212,13 @@ public:
    HRESULT  DetachSource( AeSource* source );
 
    /**
-    * @fn	HRESULT EventArea::EnableConditions( BOOL enable, CSimpleValArray<AeEventArray*>& events );
+    * @fn	HRESULT EventArea::EnableConditions( BOOL enable, const AeAreaSet* skipAreas, CSimpleValArray<AeEventArray*>& events );
     *
     * @brief	Enables or disables all conditions for all sources within this area.
     *
     * @param	enable		  	true to enable, false to disable.
+    * @param	skipAreas	  	Sources which also belong to one of these areas are skipped
+    * 							because they are already handled. Can be NULL.
     * @param [in,out]	events	[in,out] Array of pointers to arrays with created event instances 
     * 							for each condition with changed enable state.
     *
@@ -223,7 +227,7 @@ public:
     * 							E_XXX                   Error occured.    
     */
 
-   HRESULT  EnableConditions( BOOL enable, CSimpleValArray<AeEventArray*>& events );
+   HRESULT  EnableConditions( BOOL enable, const AeAreaSet* skipAreas, CSimpleValArray<AeEventArray*>& events );
 
    /**
     * @fn	BOOL EventArea::ExistArea( LPCWSTR areaName );
@@ -239,6 +243,22 @@ public:
 
    BOOL     ExistArea( LPCWSTR areaName );
 
+   /**
+    * @fn	HRESULT EventArea::LookupAreaIndices( LPCWSTR areaName, CSimpleArray<DWORD>& indices );
+    *
+    * @brief	Adds the index of all sub-areas with the specified fully qualified name to the
+    * 			array. Only the sub-areas whose name is a prefix of the specified name are
+    * 			searched. Usually called for the root area.
+    *
+    * @param	areaName	  	The fully qualified name of the area. Wildcards are not
+    * 							supported.
+    * @param [in,out]	indices	The indices of the found areas are added to this array.
+    *
+    * @return	S_OK if succeeded (also if no area is found); otherwise E_OUTOFMEMORY.
+    */
+
+   HRESULT  LookupAreaIndices( LPCWSTR areaName, CSimpleArray<DWORD>& indices );
+
    /**
     * @fn	BOOL EventArea::FilterName( LPCWSTR name, LPCWSTR filterCriteria );
     *
@@ -275,6 +295,9 @@ protected:
 
    static WCHAR					delimiter_[2];
    DWORD						areaId_;
+   DWORD						areaIndex_;		// Dense index, unique within the Area Space
+   LONG						nextIndex_;		// Root only: the index of the next new area
+   LONG						revision_;		// Root only: incremented if an area is added
    EventArea*					parent_;
    EventArea*					root_;
    WideString					name_;			// The fully qualified name of the area
@@ -0,0 +1,195 @@
+/*
+ * Copyright (c) 2020 Technosoftware GmbH. All rights reserved
+ * Web: https://technosoftware.com 
+ * 
+ * The source code in this file is covered under a dual-license scenario:
+ *   - Owner of a purchased license: SCLA 1.0
+ *   - GPL V3: everybody else
+ *
+ * SCLA license terms accompanied with this source code.
+ * See https://technosoftware.com/license/Source_Code_License_Agreement.pdf
+ *
+ * GNU General Public License as published by the Free Software Foundation;
+ * version 3 of the License are accompanied with this source code.
+ * See https://technosoftware.com/license/GPLv3License.txt
+ *
+ * This source code is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+
+
+#ifdef   _OPC_SRV_AE                            // Alarms & Events Server
+
+//DOM-IGNORE-BEGIN
+//-------------------------------------------------------------------------
+// INLCUDE
+//-------------------------------------------------------------------------
+#include "stdafx.h"
+#include "AeEventHistory.h"
+#include "AeEvent.h"
+
+#ifdef _DEBUG
+#define new DEBUG_NEW
+#endif
+
+//-------------------------------------------------------------------------
+// CODE
+//-------------------------------------------------------------------------
+
+//=========================================================================
+// Construction
+//=========================================================================
+AeEventHistory::AeEventHistory()
+{
+   events_        = NULL;
+   capacity_      = 0;
+   nextSequence_  = 1;
+   firstSequence_ = 1;
+}
+
+
+
+//=========================================================================
+// Destructor
+//=========================================================================
+AeEventHistory::~AeEventHistory()
+{
+   RemoveAll();
+}
+
+
+
+//=========================================================================
+// SetCapacity
+// -----------
+//    Sets the maximum number of events in the history.
+//    All events of the history are released.
+//=========================================================================
+HRESULT AeEventHistory::SetCapacity( DWORD capacity )
+{
+   HRESULT hres = S_OK;
+
+   criticalSection_.Lock();
+   RemoveAll();
+   if (capacity) {
+      events_ = new AeEvent*[ capacity ];
+      if (events_) {
+         memset( events_, 0, capacity * sizeof (AeEvent*) );
+         capacity_ = capacity;
+      }
+      else {
+         hres = E_OUTOFMEMORY;
+      }
+   }
+   criticalSection_.Unlock();
+   return hres;
+}
+
+
+
+//=========================================================================
+// Add
+// ---
+//    Numbers the events and adds them to the history.
+//=========================================================================
+void AeEventHistory::Add( DWORD count, AeEvent** events )
+{
+   criticalSection_.Lock();
+   for (DWORD i = 0; i < count; i++) {
+      AeEvent* pEvent = events[i];
+      pEvent->m_ullSequence = nextSequence_;
+
+      if (capacity_) {
+         DWORD dwIndex = (DWORD)(nextSequence_ % capacity_);
+         if (events_[ dwIndex ]) {
+            events_[ dwIndex ]->Release();      // Overwrite the oldest event
+            firstSequence_++;
+         }
+         pEvent->AddRef();
+         events_[ dwIndex ] = pEvent;
+      }
+      else {
+         firstSequence_ = nextSequence_ + 1;    // No history
+      }
+      nextSequence_++;
+   }
+   criticalSection_.Unlock();
+}
+
+
+
+//=========================================================================
+// GetEvents
+// ---------
+//    Copies the references of the events in the specified range.
+//=========================================================================
+HRESULT AeEventHistory::GetEvents( ULONGLONG fromSequence, ULONGLONG toSequence, DWORD maxCount,
+                                   AeEvent** events, DWORD* count, ULONGLONG* nextSequence )
+{
+   HRESULT hres = S_OK;
+   DWORD   dwCount = 0;
+
+   criticalSection_.Lock();
+
+   if (fromSequence < firstSequence_) {
+      if (fromSequence < nextSequence_) {
+         hres = S_FALSE;                        // Some events are no longer available
+      }
+      fromSequence = firstSequence_;
+   }
+   if (toSequence > nextSequence_) {
+      toSequence = nextSequence_;
+   }
+   while (fromSequence < toSequence && dwCount < maxCount) {
+      AeEvent* pEvent = events_[ (DWORD)(fromSequence % capacity_) ];
+      pEvent->AddRef();
+      events[ dwCount++ ] = pEvent;
+      fromSequence++;
+   }
+
+   criticalSection_.Unlock();
+
+   *count = dwCount;
+   *nextSequence = fromSequence;
+   return hres;
+}
+
+
+
+//=========================================================================
+// NextSequence
+//=========================================================================
+ULONGLONG AeEventHistory::NextSequence()
+{
+   criticalSection_.Lock();
+   ULONGLONG ullNext = nextSequence_;
+   criticalSection_.Unlock();
+   return ullNext;
+}
+
+
+
+//=========================================================================
+// RemoveAll                                                       INTERNAL
+// ---------
+//    Releases all events of the history.
+//    criticalSection_ must be locked by the caller if required.
+//=========================================================================
+void AeEventHistory::RemoveAll()
+{
+   if (events_) {
+      for (DWORD i = 0; i < capacity_; i++) {
+         if (events_[i]) {
+            events_[i]->Release();
+         }
+      }
+      delete [] events_;
+      events_ = NULL;
+   }
+   capacity_      = 0;
+   firstSequence_ = nextSequence_;
+}
+//DOM-IGNORE-END
+#endif
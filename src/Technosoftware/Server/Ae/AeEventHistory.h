@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) 2020 Technosoftware GmbH. All rights reserved
+ * Web: https://technosoftware.com 
+ * 
+ * The source code in this file is covered under a dual-license scenario:
+ *   - Owner of a purchased license: SCLA 1.0
+ *   - GPL V3: everybody else
+ *
+ * SCLA license terms accompanied with this source code.
+ * See https://technosoftware.com/license/Source_Code_License_Agreement.pdf
+ *
+ * GNU General Public License as published by the Free Software Foundation;
+ * version 3 of the License are accompanied with this source code.
+ * See https://technosoftware.com/license/GPLv3License.txt
+ *
+ * This source code is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+
+
+#ifndef __AeEventHistory_H
+#define __AeEventHistory_H
+
+//DOM-IGNORE-BEGIN
+
+#if _MSC_VER >= 1000
+#pragma once
+#endif // _MSC_VER >= 1000
+
+class AeEvent;
+
+/**
+ * @class	AeEventHistory
+ *
+ * @brief	Bounded server-wide history of the recently fired events.
+ * 			Each fired event gets a monotonically increasing sequence number. The history
+ * 			keeps a reference to the latest events in a ring buffer, so a subscription of a
+ * 			reconnected client can replay the events fired since the last event it has
+ * 			seen. The lock of the history is only held to append events or to copy a range
+ * 			of event pointers, the replay itself runs outside of it.
+ */
+
+class AeEventHistory
+{
+public:
+   AeEventHistory();
+   ~AeEventHistory();
+
+   /**
+    * @fn	HRESULT AeEventHistory::SetCapacity( DWORD capacity );
+    *
+    * @brief	Sets the maximum number of events kept in the history. The events currently in
+    * 			the history are released. The sequence numbers continue.
+    *
+    * @param	capacity	Maximum number of events, 0 disables the history (default).
+    *
+    * @return	S_OK if succeeded; otherwise E_OUTOFMEMORY.
+    */
+
+   HRESULT SetCapacity( DWORD capacity );
+
+   /**
+    * @fn	void AeEventHistory::Add( DWORD count, AeEvent** events );
+    *
+    * @brief	Assigns the next sequence numbers to the specified events and adds them to the
+    * 			history. The oldest events are released if the history is full.
+    *
+    * @param	count 	Number of events.
+    * @param	events	The events to add.
+    */
+
+   void Add( DWORD count, AeEvent** events );
+
+   /**
+    * @fn	HRESULT AeEventHistory::GetEvents( ULONGLONG fromSequence, ULONGLONG toSequence, DWORD maxCount, AeEvent** events, DWORD* count, ULONGLONG* nextSequence );
+    *
+    * @brief	Gets the events of the history within a range of sequence numbers. The returned
+    * 			events are referenced and must be released by the caller.
+    *
+    * @param 		 	fromSequence	Sequence number of the first requested event.
+    * @param 		 	toSequence  	Sequence number after the last requested event.
+    * @param 		 	maxCount		Maximum number of returned events.
+    * @param [out]	events			Array with at least maxCount entries for the events.
+    * @param [out]	count			Number of returned events.
+    * @param [out]	nextSequence	Sequence number of the event following the returned
+    * 								ones.
+    *
+    * @return	S_OK if succeeded; S_FALSE if events starting from fromSequence are no longer
+    * 			in the history and only the remaining events are returned.
+    */
+
+   HRESULT GetEvents( ULONGLONG fromSequence, ULONGLONG toSequence, DWORD maxCount,
+                      AeEvent** events, DWORD* count, ULONGLONG* nextSequence );
+
+   /**
+    * @fn	ULONGLONG AeEventHistory::NextSequence();
+    *
+    * @brief	Gets the sequence number which is assigned to the next fired event.
+    *
+    * @return	The next sequence number.
+    */
+
+   ULONGLONG NextSequence();
+
+   /**
+    * @fn	DWORD AeEventHistory::Capacity() const;
+    *
+    * @brief	Gets the maximum number of events kept in the history.
+    *
+    * @return	The capacity, 0 if the history is disabled.
+    */
+
+   inline DWORD Capacity() const { return capacity_; }
+
+protected:
+   void RemoveAll();
+
+   /** @brief	Ring buffer with the events, the event with sequence n is at n % capacity_. */
+   AeEvent**               events_;
+
+   /** @brief	Maximum number of events in the history. */
+   DWORD                   capacity_;
+
+   /** @brief	Sequence number of the next added event, starts with 1. */
+   ULONGLONG               nextSequence_;
+
+   /** @brief	Sequence number of the oldest event in the history. */
+   ULONGLONG               firstSequence_;
+
+   CComAutoCriticalSection criticalSection_;
+};
+//DOM-IGNORE-END
+
+#endif // __AeEventHistory_H
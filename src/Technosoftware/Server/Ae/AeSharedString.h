@@ -0,0 +1,42 @@
+/*
+ * Copyright (c) 2020 Technosoftware GmbH. All rights reserved
+ * Web: https://technosoftware.com 
+ * 
+ * The source code in this file is covered under a dual-license scenario:
+ *   - Owner of a purchased license: SCLA 1.0
+ *   - GPL V3: everybody else
+ *
+ * SCLA license terms accompanied with this source code.
+ * See https://technosoftware.com/license/Source_Code_License_Agreement.pdf
+ *
+ * GNU General Public License as published by the Free Software Foundation;
+ * version 3 of the License are accompanied with this source code.
+ * See https://technosoftware.com/license/GPLv3License.txt
+ *
+ * This source code is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+
+#ifndef __AeSharedString_H
+#define __AeSharedString_H
+
+//DOM-IGNORE-BEGIN
+
+#if _MSC_VER >= 1000
+#pragma once
+#endif // _MSC_VER >= 1000
+
+#include "StringAtom.h"
+
+/**
+ * @brief	Immutable reference counted string referenced by the event instances.
+ * 			Sub condition names and messages repeat and are interned atoms. Source and
+ * 			condition names are unique and are not added to the atom pool.
+ */
+
+typedef StringAtom AeSharedString;
+//DOM-IGNORE-END
+
+#endif // __AeSharedString_H
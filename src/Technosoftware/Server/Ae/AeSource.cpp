@@ -39,6 +39,8 @@
 //=========================================================================
 AeSource::AeSource()
 {
+   m_pSharedName = NULL;
+   m_pAreaSet = NULL;
 }
 
 
@@ -84,6 +86,11 @@ HRESULT AeSource::Create( EventArea* pArea, LPCWSTR szName, BOOL fIsFullyQualifi
       }
    }
 
+   // the name used by the events of this source
+   if (SUCCEEDED( hres )) {
+      hres = AeSharedString::CreateUnique( m_wsName, &m_pSharedName );
+   }
+
    // attach this new source instance to the area
    if (SUCCEEDED( hres )) {
       hres = pArea->AttachSource( this );
@@ -91,6 +98,12 @@ HRESULT AeSource::Create( EventArea* pArea, LPCWSTR szName, BOOL fIsFullyQualifi
    if (SUCCEEDED( hres )) {
       m_csAreaRefs.Lock();                      // successfully attached
       hres = m_arAreaRefs.Add( pArea ) ? S_OK : E_OUTOFMEMORY;
+      if (SUCCEEDED( hres )) {
+         hres = UpdateAreaSet();
+         if (FAILED( hres )) {
+            m_arAreaRefs.Remove( pArea );
+         }
+      }
       if (FAILED( hres )) {
          pArea->DetachSource( this );
       }
@@ -115,6 +128,13 @@ AeSource::~AeSource()
    m_arAreaRefs.RemoveAll();
 
    m_csAreaRefs.Unlock();
+
+   if (m_pSharedName) {
+      m_pSharedName->Release();
+   }
+   if (m_pAreaSet) {
+      m_pAreaSet->Release();
+   }
 }
 
 
@@ -145,6 +165,12 @@ HRESULT AeSource::AddToAdditionalArea( EventArea* pArea )
 
       if (SUCCEEDED( hres )) {
          hres = m_arAreaRefs.Add( pArea ) ? S_OK : E_OUTOFMEMORY;
+         if (SUCCEEDED( hres )) {
+            hres = UpdateAreaSet();
+            if (FAILED( hres )) {
+               m_arAreaRefs.Remove( pArea );
+            }
+         }
          if (FAILED( hres )) {
             pArea->DetachSource( this );
          }
@@ -325,6 +351,9 @@ HRESULT AeSource::EnableConditions(
       if (hres == S_OK) {                       // If hres is S_FALSE then the condition is already in the in
          _ASSERTE( pEvent );                    // specified state and pEvent is NULL.
          hres = parEvents->Add( pEvent );
+         if (FAILED( hres )) {
+            pEvent->Release();
+         }
       }
       if (FAILED( hres )) {
          hresRet = S_FALSE;
@@ -398,6 +427,48 @@ HRESULT AeSource::GetAreaNames( LPVARIANT pvAreas )
 }
 
 
+//=========================================================================
+// GetAreaSet
+// ----------
+//    Returns the set with the indices of the areas to which this
+//    source belongs (without root area). The set is referenced by
+//    the caller.
+//=========================================================================
+AeAreaSet* AeSource::GetAreaSet()
+{
+   m_csAreaRefs.Lock();
+   AeAreaSet* pSet = m_pAreaSet;
+   if (pSet) {
+      pSet->AddRef();
+   }
+   m_csAreaRefs.Unlock();
+   return pSet;
+}
+
+
+//=========================================================================
+// UpdateConditionAreas
+// --------------------
+//    Updates the areas of all conditions which belongs to this source.
+//    Must be called after the source is added to an additional area.
+//    The condition map of the server must be locked by the caller.
+//=========================================================================
+HRESULT AeSource::UpdateConditionAreas()
+{
+   HRESULT hresRet = S_OK;
+
+   m_csCondRefs.Lock();
+   for (int i=0; i < m_arCondRefs.GetSize(); i++) {
+      HRESULT hres = m_arCondRefs[i]->UpdateAreas();
+      if (FAILED( hres )) {
+         hresRet = hres;
+      }
+   }
+   m_csCondRefs.Unlock();
+   return hresRet;
+}
+
+
 //-------------------------------------------------------------------------
 // IMPLEMENTATION
 //-------------------------------------------------------------------------
@@ -421,6 +492,39 @@ AeCondition* AeSource::LookupCondition( LPCWSTR szName )
    m_csCondRefs.Unlock();
    return pCond;
 }
+
+
+//=========================================================================
+// UpdateAreaSet
+// -------------
+//    Creates a new set with the indices of all areas in m_arAreaRefs.
+//    Events which still reference the previous set are not affected.
+//    m_csAreaRefs must be locked by the caller.
+//=========================================================================
+HRESULT AeSource::UpdateAreaSet()
+{
+   DWORD* pdwIndices = new DWORD [m_arAreaRefs.GetSize()];
+   if (!pdwIndices) return E_OUTOFMEMORY;
+
+   DWORD dwCount = 0;
+   for (int i=0; i < m_arAreaRefs.GetSize(); i++) {
+      if (!m_arAreaRefs[i]->IsRoot()) {         // The root area is used only internally
+         pdwIndices[dwCount++] = m_arAreaRefs[i]->Index();
+      }
+   }
+
+   AeAreaSet* pSet;
+   HRESULT hres = AeAreaSet::Create( pdwIndices, dwCount, &pSet );
+   delete [] pdwIndices;
+
+   if (SUCCEEDED( hres )) {
+      if (m_pAreaSet) {
+         m_pAreaSet->Release();
+      }
+      m_pAreaSet = pSet;
+   }
+   return hres;
+}
 //DOM-IGNORE-END
 
 
@@ -28,6 +28,8 @@
 #endif // _MSC_VER >= 1000
 
 #include "WideString.h"                         // for WideString
+#include "AeSharedString.h"
+#include "AeAreaSet.h"
 
 class EventArea;
 class AeCondition;
@@ -50,6 +52,7 @@ public:
 public:
    inline WideString&     Name()            { return m_wsName; }
    inline LPCWSTR          PartialName()     { return m_pszPartialName; }
+   inline AeSharedString*  SharedName()      { return m_pSharedName; }
 
 // Operations
 public:
@@ -79,6 +82,8 @@ public:
    /* [out] */                   AeEventArray* parEvents );
 
    HRESULT  GetAreaNames( LPVARIANT pvAreas );
+   AeAreaSet* GetAreaSet();                     // Caller must release the returned set
+   HRESULT  UpdateConditionAreas();
 
 // Implementation
 protected:
@@ -86,15 +91,21 @@ protected:
    LPCWSTR                          m_pszPartialName;
                                                 // Points to the partially source name in
                                                 // name_. Do not free this string !
+   AeSharedString*                  m_pSharedName;
+                                                // The fully qualified name referenced
+                                                // by all events of this source.
 
                                                 // This Source instance is member of this Areas
    CComAutoCriticalSection          m_csAreaRefs;
    CSimpleArray<EventArea*>        m_arAreaRefs;
+   AeAreaSet*                       m_pAreaSet; // Indices of the areas in m_arAreaRefs
+                                                // without the root area.
    
    CComAutoCriticalSection          m_csCondRefs;
    CSimpleArray<AeCondition*>   m_arCondRefs;
 
    AeCondition* LookupCondition( LPCWSTR szName );
+   HRESULT  UpdateAreaSet();
 };
 //DOM-IGNORE-END
 
@@ -23,6 +23,7 @@
 // INLCUDE
 //-------------------------------------------------------------------------
 #include "stdafx.h"                             // Generic server part headers
+#include <process.h>
 #include "MatchPattern.h"
 #include "DaDeviceItem.h"
 // Application specific definitions
@@ -45,6 +46,7 @@ DaBranch* DaBranch::m_pRoot = NULL;
 //=========================================================================
 DaLeaf::DaLeaf()
 {
+	m_pName = NULL;
 	m_pDItemRef = NULL;
 	m_fKillDeviceItemOnDestroy = FALSE;
 }
@@ -59,8 +61,13 @@ DaLeaf::DaLeaf()
 //=========================================================================
 HRESULT DaLeaf::Create( LPCWSTR szName, DaDeviceItem* pDItem )
 {
-	HRESULT hres = m_wsName.SetString( szName );
+	StringAtom* pName;
+	HRESULT hres = StringAtom::Create( szName, &pName );
 	if (SUCCEEDED( hres )) {
+		if (m_pName) {
+			m_pName->Release();
+		}
+		m_pName = pName;
 		m_pDItemRef = pDItem;
 	}
 	return hres;
@@ -76,6 +83,9 @@ DaLeaf::~DaLeaf()
 	if (m_pDItemRef && m_fKillDeviceItemOnDestroy) {
 		m_pDItemRef->Kill( TRUE );
 	}
+	if (m_pName) {
+		m_pName->Release();
+	}
 }
 
 
@@ -978,6 +988,71 @@ HRESULT DaBranch::RemoveDeviceItemAssociatedLeaf( LPCWSTR szItemID, BOOL fKillDe
 
 
 
+//=========================================================================
+// MoveMembersTo
+// -------------
+//    Moves all branches and leaves of this branch to the target branch.
+//    Branches which already exist in the target are merged.
+//    Leaves which already exist in the target are deleted and their
+//    Device Items are returned in arRejected.
+//    Used to publish branches built by DaAddressSpaceBuilder.
+//=========================================================================
+void DaBranch::MoveMembersTo( DaBranch* pTarget, CAtlArray<DaDeviceItem*>& arRejected )
+{
+	POSITION pos;
+
+	// Move all branches
+	DaBranch* pBranch;
+	DaBranch* pExisting;
+	m_csBranches.Lock();
+	pTarget->m_csBranches.Lock();
+	try
+	{
+		pos = m_mapBranches.GetStartPosition();
+		while (pos) {
+			pBranch = m_mapBranches.GetNextValue( pos );
+			if (pTarget->m_mapBranches.Lookup( pBranch->m_wsName, pExisting )) {
+				pBranch->MoveMembersTo( pExisting, arRejected );
+				delete pBranch;                     // Is empty now
+			}
+			else {
+				pBranch->m_pParent = pTarget;
+				pTarget->m_mapBranches.SetAt( pBranch->m_wsName, pBranch );
+			}
+		}
+		m_mapBranches.RemoveAll();
+	} catch (...) {
+	}
+	pTarget->m_csBranches.Unlock();
+	m_csBranches.Unlock();
+
+	// Move all leafs
+	DaLeaf* pLeaf;
+	DaLeaf* pExistingLeaf;
+	m_csLeafs.Lock();
+	pTarget->m_csLeafs.Lock();
+	try
+	{
+		pos = m_mapLeafs.GetStartPosition();
+		while (pos) {
+			pLeaf = m_mapLeafs.GetNextValue( pos );
+			if (pTarget->m_mapLeafs.Lookup( pLeaf->Name(), pExistingLeaf )) {
+				arRejected.Add( &pLeaf->DeviceItem() );
+				delete pLeaf;                       // The leaf already exist in the target
+			}
+			else {
+				pTarget->m_mapLeafs.SetAt( pLeaf->Name(), pLeaf );
+			}
+		}
+		m_mapLeafs.RemoveAll();
+	} catch (...) {
+	}
+	pTarget->m_csLeafs.Unlock();
+	m_csLeafs.Unlock();
+}
+
+
+
 //-------------------------------------------------------------------------
 // IMPLEMENTATION
 //-------------------------------------------------------------------------
@@ -1329,3 +1404,999 @@ void* DaBranch::new_realloc( void* memblock, size_t sizeOld, size_t sizeNew )
 	}
 	return pNew;                                 // Return new buffer
 }
+
+
+
+//-------------------------------------------------------------------------
+// CODE DaAddressSpaceBuilder
+//-------------------------------------------------------------------------
+
+//=========================================================================
+// Construction
+//=========================================================================
+DaAddressSpaceBuilder::DaAddressSpaceBuilder()
+{
+	m_ppDItems = NULL;
+	m_pErrors  = NULL;
+}
+
+
+
+//=========================================================================
+// Destructor
+//=========================================================================
+DaAddressSpaceBuilder::~DaAddressSpaceBuilder()
+{
+	RemovePartitions();
+}
+
+
+
+//=========================================================================
+// Build
+// -----
+//    Builds the branches and leaves for the specified Device Items.
+//    The Server Address Space is not accessed and must not be locked.
+//
+//    The items are distributed by the name of their top level branch
+//    to one partition per processor. Each partition is built by its own
+//    thread. Items with the same top level branch are always in the
+//    same partition, the partitions can therefore be built without
+//    any synchronization.
+//
+// Parameters:
+//    IN
+//       dwCount                 Number of Device Items.
+//       ppDItems                The Device Items. Must be valid until
+//                               Publish() is called.
+//    OUT
+//       pErrors                 The result for each item. E_INVALIDARG
+//                               if the ItemId is used more than once.
+//
+// Return:
+//    S_OK                       The partitions have been built.
+//    E_xxx                      An error occured.
+//=========================================================================
+HRESULT DaAddressSpaceBuilder::Build( DWORD dwCount, DaDeviceItem** ppDItems, HRESULT* pErrors )
+{
+	_ASSERTE( m_arPartitions.GetCount() == 0 );  // Build() must be called only once
+
+	m_ppDItems = ppDItems;
+	m_pErrors  = pErrors;
+
+	SYSTEM_INFO sysInfo;
+	GetSystemInfo( &sysInfo );
+	DWORD dwNumPartitions = sysInfo.dwNumberOfProcessors;
+	if (dwNumPartitions > MAXIMUM_WAIT_OBJECTS) {
+		dwNumPartitions = MAXIMUM_WAIT_OBJECTS;
+	}
+	if (dwNumPartitions > dwCount / 1000 + 1) {   // No threads for small lists
+		dwNumPartitions = dwCount / 1000 + 1;
+	}
+
+	try {
+		DWORD i;
+		for (i = 0; i < dwNumPartitions; i++) {
+			Partition* pPartition = new Partition;
+			if (pPartition == NULL) throw E_OUTOFMEMORY;
+			pPartition->pBuilder = this;
+			m_arPartitions.Add( pPartition );
+		}
+
+		// Distribute the items to the partitions
+		for (i = 0; i < dwCount; i++) {
+			LPWSTR szItemID;
+			pErrors[i] = ppDItems[i]->get_ItemIDPtr( &szItemID );
+			if (SUCCEEDED( pErrors[i] )) {
+				m_arPartitions[ PartitionOf( szItemID ) % dwNumPartitions ]->arIndex.Add( i );
+			}
+		}
+	}
+	catch (HRESULT hresEx) {
+		RemovePartitions();
+		return hresEx;
+	}
+	catch (...) {
+		RemovePartitions();
+		return E_OUTOFMEMORY;
+	}
+
+	if (dwNumPartitions == 1) {
+		BuildPartition( m_arPartitions[0] );
+		return S_OK;
+	}
+
+	// Build the partitions in parallel
+	HANDLE   ahThreads[ MAXIMUM_WAIT_OBJECTS ];
+	DWORD    dwNumThreads = 0;
+	for (DWORD i = 0; i < dwNumPartitions; i++) {
+		unsigned uThreadID;
+		ahThreads[ dwNumThreads ] = (HANDLE)_beginthreadex( NULL, 0, BuildPartitionThread,
+															m_arPartitions[i], 0, &uThreadID );
+		if (ahThreads[ dwNumThreads ]) {
+			dwNumThreads++;
+		}
+		else {
+			BuildPartition( m_arPartitions[i] );  // Cannot create thread, build it here
+		}
+	}
+	if (dwNumThreads) {
+		WaitForMultipleObjects( dwNumThreads, ahThreads, TRUE, INFINITE );
+		while (dwNumThreads--) {
+			CloseHandle( ahThreads[ dwNumThreads ] );
+		}
+	}
+	return S_OK;
+}
+
+
+
+//=========================================================================
+// Publish
+// -------
+//    Moves the built branches and leaves into the specified root branch.
+//    If the root has no branches with the same names (e.g. during server
+//    startup) the top level branches are taken over as they are.
+//    The caller must lock the access to the Server Address Space.
+//
+// Parameters:
+//    IN
+//       pRoot                   The root of the Server Address Space.
+//    OUT
+//       arRejected              The Device Items whose ItemId already
+//                               exists in the Server Address Space.
+//=========================================================================
+void DaAddressSpaceBuilder::Publish( DaBranch* pRoot, CAtlArray<DaDeviceItem*>& arRejected )
+{
+	for (size_t i = 0; i < m_arPartitions.GetCount(); i++) {
+		m_arPartitions[i]->branch.MoveMembersTo( pRoot, arRejected );
+	}
+	RemovePartitions();
+}
+
+
+
+//=========================================================================
+// PartitionOf
+// -----------
+//    Returns the hash code of the top level branch name of an ItemId.
+//=========================================================================
+DWORD DaAddressSpaceBuilder::PartitionOf( LPCWSTR szItemID ) const
+{
+	const WCHAR wcDelimiter = DaBranch::GetDelimiter();
+	if (wcschr( szItemID, wcDelimiter ) == NULL) {
+		return 0;                                 // Leaf of the root
+	}
+	DWORD dwHash = 0;
+	while (*szItemID && *szItemID != wcDelimiter) {
+		dwHash = (dwHash<<5)+dwHash+(*szItemID);
+		szItemID++;
+	}
+	return dwHash;
+}
+
+
+
+//=========================================================================
+// BuildPartition
+// --------------
+//    Adds the items of a partition to its detached root branch.
+//=========================================================================
+void DaAddressSpaceBuilder::BuildPartition( Partition* pPartition )
+{
+	for (size_t i = 0; i < pPartition->arIndex.GetCount(); i++) {
+		DWORD    dwIndex = pPartition->arIndex[i];
+		LPWSTR   szItemID;
+
+		HRESULT hres = m_ppDItems[ dwIndex ]->get_ItemIDPtr( &szItemID );
+		if (SUCCEEDED( hres )) {
+			hres = pPartition->branch.AddDeviceItem( szItemID, m_ppDItems[ dwIndex ] );
+		}
+		m_pErrors[ dwIndex ] = hres;
+	}
+}
+
+
+
+//=========================================================================
+// RemovePartitions
+//=========================================================================
+void DaAddressSpaceBuilder::RemovePartitions()
+{
+	for (size_t i = 0; i < m_arPartitions.GetCount(); i++) {
+		delete m_arPartitions[i];                 // Deletes the not published members
+	}
+	m_arPartitions.RemoveAll();
+}
+
+
+
+//=========================================================================
+// Thread building one partition
+//=========================================================================
+unsigned __stdcall BuildPartitionThread( void* pArg )
+{
+	DaAddressSpaceBuilder::Partition* pPartition = static_cast<DaAddressSpaceBuilder::Partition *>(pArg);
+	_ASSERTE( pPartition != NULL );
+
+	pPartition->pBuilder->BuildPartition( pPartition );
+
+	_endthreadex( 0 );
+	return 0;
+}
+
+
+
+//-------------------------------------------------------------------------
+// CLASS DaBrowseCache
+//-------------------------------------------------------------------------
+
+//=========================================================================
+// Constructor
+//=========================================================================
+DaBrowseCache::DaBrowseCache()
+{
+	m_pfnLoadChildren = NULL;
+	m_dwMaxNames      = 0;
+	m_dwNumOfNames    = 0;
+	m_pNewest         = NULL;
+	m_pOldest         = NULL;
+}
+
+
+
+//=========================================================================
+// Initializer
+// -----------
+//    pfnLoadChildren is called to get the children of a branch which is
+//    not in the cache. dwMaxNames is the number of names (branches,
+//    leaves and branch IDs) which may be cached before the least recently
+//    browsed branches are removed.
+//=========================================================================
+HRESULT DaBrowseCache::Create( PFNLOADCHILDREN pfnLoadChildren, DWORD dwMaxNames )
+{
+	if (pfnLoadChildren == NULL) return E_INVALIDARG;
+
+	m_pfnLoadChildren = pfnLoadChildren;
+	m_dwMaxNames      = dwMaxNames;
+	return S_OK;
+}
+
+
+
+//=========================================================================
+// Destructor
+//=========================================================================
+DaBrowseCache::~DaBrowseCache()
+{
+	RemoveAll();
+}
+
+
+
+//=========================================================================
+// SetMaxNames
+// -----------
+//    Changes the limit of the cache. Branches are removed if the cache
+//    contains more names than the new limit.
+//=========================================================================
+void DaBrowseCache::SetMaxNames( DWORD dwMaxNames )
+{
+	m_csBranches.Lock();
+	m_dwMaxNames = dwMaxNames;
+	EvictNoLock( NULL );
+	m_csBranches.Unlock();
+}
+
+
+
+//=========================================================================
+// RemoveAll
+// ---------
+//    Removes all branches from the cache. Branches which are currently
+//    used by a browse function are released after the function returns.
+//=========================================================================
+void DaBrowseCache::RemoveAll()
+{
+	m_csBranches.Lock();
+	while (m_pOldest) {
+		Branch* pBranch = m_pOldest;
+		UnlinkNoLock( pBranch );
+		ReleaseBranch( pBranch );
+	}
+	m_mapBranches.RemoveAll();
+	m_dwNumOfNames = 0;
+	m_csBranches.Unlock();
+}
+
+
+
+//=========================================================================
+// ChangeBrowsePosition
+// --------------------
+//    Moves the browse position szActualPosition up, down or to the
+//    specified branch. The branch is loaded if it's not in the cache.
+//
+// Parameters:
+//    IN
+//       szActualPosition        Fully qualified name of the current
+//                               position. NULL or an empty string is
+//                               the root.
+//       dwBrowseDirection       OPC_BROWSE_UP, OPC_BROWSE_DOWN or
+//                               OPC_BROWSE_TO.
+//       szPosition              Name of the branch for OPC_BROWSE_DOWN
+//                               or fully qualified name of the branch
+//                               for OPC_BROWSE_TO.
+//    OUT
+//       pszNewPosition          Fully qualified name of the new position.
+//                               Must be released with SysFreeString().
+//
+// Return:
+//    S_OK                       All succeeded
+//    E_FAIL                     Already at the root and OPC_BROWSE_UP
+//                               is specified.
+//    E_INVALIDARG               The branch doesn't exist.
+//    E_xxx                      An error occured.
+//=========================================================================
+HRESULT DaBrowseCache::ChangeBrowsePosition( LPCWSTR szActualPosition, OPCBROWSEDIRECTION dwBrowseDirection,
+											 LPCWSTR szPosition, BSTR* pszNewPosition )
+{
+	HRESULT  hres = S_OK;
+	BSTR     bstrNewPosition = NULL;
+
+	*pszNewPosition = NULL;
+	if (szActualPosition == NULL) {
+		szActualPosition = L"";
+	}
+
+	switch (dwBrowseDirection) {
+
+		case OPC_BROWSE_UP:
+			if (*szActualPosition == L'\0') {
+				return E_FAIL;                      // Already at the root
+			}
+			else {
+				LPCWSTR pszName = wcsrchr( szActualPosition, DaBranch::GetDelimiter() );
+				bstrNewPosition = pszName ? SysAllocStringLen( szActualPosition, (UINT)(pszName - szActualPosition) )
+										  : SysAllocString( L"" );
+				if (bstrNewPosition == NULL) {
+					hres = E_OUTOFMEMORY;
+				}
+			}
+			break;
+
+		case OPC_BROWSE_DOWN:
+			if (szPosition == NULL || *szPosition == L'\0') {
+				return E_INVALIDARG;
+			}
+			hres = JoinName( szActualPosition, szPosition, &bstrNewPosition );
+			if (SUCCEEDED( hres )) {
+				hres = ExistBranch( bstrNewPosition );
+			}
+			break;
+
+		case OPC_BROWSE_TO:
+			if (szPosition && *szPosition) {
+				hres = ExistBranch( szPosition );
+			}
+			else {
+				szPosition = L"";                   // Root
+			}
+			if (SUCCEEDED( hres )) {
+				bstrNewPosition = SysAllocString( szPosition );
+				if (bstrNewPosition == NULL) {
+					hres = E_OUTOFMEMORY;
+				}
+			}
+			break;
+
+		default:
+			return E_INVALIDARG;
+	}
+
+	if (FAILED( hres )) {
+		SysFreeString( bstrNewPosition );
+		return hres;
+	}
+	*pszNewPosition = bstrNewPosition;
+	return S_OK;
+}
+
+
+
+//=========================================================================
+// BrowseBranches
+// --------------
+//    Returns the name of the branches of szPosition which matches the
+//    specified filter.
+//
+// Return:
+//    S_OK                       All succeeded
+//    S_FALSE                    There are no branches which matches
+//                               the filter. Note : ppszBranches is NULL !
+//    E_INVALIDARG               The branch szPosition doesn't exist.
+//    E_xxx                      An error occured. ppszBranches is NULL !
+//=========================================================================
+HRESULT DaBrowseCache::BrowseBranches( LPCWSTR szPosition, LPCWSTR szFilterCriteria,
+									   LPDWORD pdwNumOfBranches, BSTR** ppszBranches )
+{
+	DWORD    dwMatch = 0;
+	Branch*  pBranch;
+
+	*pdwNumOfBranches = 0;
+	*ppszBranches = NULL;
+
+	HRESULT hres = AcquireBranch( szPosition, &pBranch );
+	if (FAILED( hres )) return hres;
+
+	try {
+		if (pBranch->dwNumOfBranches == 0) throw S_FALSE;
+
+		*ppszBranches = new BSTR [ pBranch->dwNumOfBranches ];
+		if (*ppszBranches == NULL) throw E_OUTOFMEMORY;
+
+		for (DWORD i = 0; i < pBranch->dwNumOfBranches; i++) {
+			LPCWSTR pszName = pBranch->ppszBranches[i];
+			if (FilterName( pszName, szFilterCriteria, TRUE )) {
+				(*ppszBranches)[dwMatch] = SysAllocString( pszName );
+				if ((*ppszBranches)[dwMatch] == NULL) throw E_OUTOFMEMORY;
+				dwMatch++;
+			}
+		}
+		if (dwMatch == 0) throw S_FALSE;          // No branches matches the filter
+
+		*pdwNumOfBranches = dwMatch;
+		hres = S_OK;
+	}
+	catch (HRESULT hresEx) {
+		hres = hresEx;
+	}
+	catch (...) {
+		hres = E_FAIL;
+	}
+	ReleaseBranch( pBranch );
+
+	if (hres != S_OK && *ppszBranches) {
+		while (dwMatch--) {
+			SysFreeString( (*ppszBranches)[dwMatch] );
+		}
+		delete [] (*ppszBranches);
+		*ppszBranches = NULL;
+	}
+	return hres;
+}
+
+
+
+//=========================================================================
+// BrowseLeafs
+// -----------
+//    Returns the name of the leaves of szPosition which matches the
+//    specified filters. Leaves with unknown data type pass any data type
+//    filter.
+//
+// Return:
+//    S_OK                       All succeeded
+//    S_FALSE                    There are no leafs which matches
+//                               the filter. Note : ppszLeafs is NULL !
+//    E_INVALIDARG               The branch szPosition doesn't exist.
+//    E_xxx                      An error occured. ppszLeafs is NULL !
+//=========================================================================
+HRESULT DaBrowseCache::BrowseLeafs( LPCWSTR szPosition, LPCWSTR szFilterCriteria, VARTYPE vtDataTypeFilter,
+									DWORD dwAccessRightsFilter, LPDWORD pdwNumOfLeafs, BSTR** ppszLeafs )
+{
+	DWORD    dwMatch = 0;
+	Branch*  pBranch;
+
+	*pdwNumOfLeafs = 0;
+	*ppszLeafs = NULL;
+
+	HRESULT hres = AcquireBranch( szPosition, &pBranch );
+	if (FAILED( hres )) return hres;
+
+	try {
+		if (pBranch->dwNumOfLeafs == 0) throw S_FALSE;
+
+		*ppszLeafs = new BSTR [ pBranch->dwNumOfLeafs ];
+		if (*ppszLeafs == NULL) throw E_OUTOFMEMORY;
+
+		for (DWORD i = 0; i < pBranch->dwNumOfLeafs; i++) {
+			const Leaf& leaf = pBranch->pLeafs[i];
+
+			if (dwAccessRightsFilter && (dwAccessRightsFilter & leaf.dwAccessRights) == 0) {
+				continue;
+			}
+			if ((vtDataTypeFilter != VT_EMPTY) && (leaf.vtDataType != VT_EMPTY) &&
+				(vtDataTypeFilter != leaf.vtDataType)) {
+				continue;
+			}
+			if (FilterName( leaf.pszName, szFilterCriteria, FALSE )) {
+				(*ppszLeafs)[dwMatch] = SysAllocString( leaf.pszName );
+				if ((*ppszLeafs)[dwMatch] == NULL) throw E_OUTOFMEMORY;
+				dwMatch++;
+			}
+		}
+		if (dwMatch == 0) throw S_FALSE;          // No leafs matches the filter
+
+		*pdwNumOfLeafs = dwMatch;
+		hres = S_OK;
+	}
+	catch (HRESULT hresEx) {
+		hres = hresEx;
+	}
+	catch (...) {
+		hres = E_FAIL;
+	}
+	ReleaseBranch( pBranch );
+
+	if (hres != S_OK && *ppszLeafs) {
+		while (dwMatch--) {
+			SysFreeString( (*ppszLeafs)[dwMatch] );
+		}
+		delete [] (*ppszLeafs);
+		*ppszLeafs = NULL;
+	}
+	return hres;
+}
+
+
+
+//=========================================================================
+// GetFullyQualifiedName
+// ---------------------
+//    Returns the fully qualified name of the branch or leaf szName of
+//    the branch szPosition. If szName is an empty string then the
+//    fully qualified name of szPosition is returned.
+//
+// Return:
+//    S_OK                       All succeeded
+//    E_INVALIDARG               szName is not a child of szPosition.
+//    E_xxx                      An error occured.
+//=========================================================================
+HRESULT DaBrowseCache::GetFullyQualifiedName( LPCWSTR szPosition, LPCWSTR szName, BSTR* pszFullyQualifiedName )
+{
+	Branch* pBranch;
+
+	*pszFullyQualifiedName = NULL;
+	if (szPosition == NULL) {
+		szPosition = L"";
+	}
+	if (szName == NULL || *szName == L'\0') {
+		*pszFullyQualifiedName = SysAllocString( szPosition );
+		return *pszFullyQualifiedName ? S_OK : E_OUTOFMEMORY;
+	}
+
+	HRESULT hres = AcquireBranch( szPosition, &pBranch );
+	if (FAILED( hres )) return hres;
+
+	BOOL fFound = FindBranchName( pBranch, szName ) || FindLeaf( pBranch, szName );
+	ReleaseBranch( pBranch );
+
+	if (!fFound) return E_INVALIDARG;
+	return JoinName( szPosition, szName, pszFullyQualifiedName );
+}
+
+
+
+//=========================================================================
+// AcquireBranch
+// -------------
+//    Returns the children of the branch szBranchID. The branch is loaded
+//    and added to the cache if it's not already cached. The returned
+//    branch must be released with ReleaseBranch().
+//
+// Return:
+//    S_OK                       All succeeded
+//    E_INVALIDARG               The branch doesn't exist.
+//    E_xxx                      An error occured.
+//=========================================================================
+HRESULT DaBrowseCache::AcquireBranch( LPCWSTR szBranchID, Branch** ppBranch )
+{
+	Branch*  pBranch;
+	Branch*  pCached;
+
+	*ppBranch = NULL;
+	if (szBranchID == NULL) {
+		szBranchID = L"";
+	}
+
+	m_csBranches.Lock();
+	if (m_mapBranches.Lookup( szBranchID, pCached )) {
+		InterlockedIncrement( &pCached->lRefCount );
+		TouchNoLock( pCached );
+		m_csBranches.Unlock();
+		*ppBranch = pCached;
+		return S_OK;
+	}
+	m_csBranches.Unlock();
+
+	// The parent must know the branch. This loads
+	// the missing parents of the branch.
+	HRESULT hres = ExistBranch( szBranchID );
+	if (FAILED( hres )) return hres;
+
+	// The loader is called without a lock because
+	// it may take some time.
+	hres = LoadBranch( szBranchID, &pBranch );
+	if (FAILED( hres )) return hres;
+
+	m_csBranches.Lock();
+	if (m_mapBranches.Lookup( szBranchID, pCached )) {
+		// Already loaded by another client
+		InterlockedIncrement( &pCached->lRefCount );
+		TouchNoLock( pCached );
+		m_csBranches.Unlock();
+		ReleaseBranch( pBranch );
+		*ppBranch = pCached;
+		return S_OK;
+	}
+	try {
+		m_mapBranches[ pBranch->pszID ] = pBranch;
+		InterlockedIncrement( &pBranch->lRefCount );   // Reference of the cache
+		m_dwNumOfNames += NumOfNames( pBranch );
+		TouchNoLock( pBranch );
+		EvictNoLock( pBranch );
+	}
+	catch (...) {
+		// The branch is returned but not cached
+	}
+	m_csBranches.Unlock();
+
+	*ppBranch = pBranch;
+	return S_OK;
+}
+
+
+
+//=========================================================================
+// ReleaseBranch
+// -------------
+//    Releases a branch returned by AcquireBranch() or LoadBranch().
+//=========================================================================
+void DaBrowseCache::ReleaseBranch( Branch* pBranch )
+{
+	if (InterlockedDecrement( &pBranch->lRefCount ) == 0) {
+		delete [] pBranch->pLeafs;
+		delete [] pBranch->ppszBranches;
+		delete [] pBranch->pNames;
+		delete pBranch;
+	}
+}
+
+
+
+//=========================================================================
+// ExistBranch
+// -----------
+//    Checks if the parent of szBranchID contains the branch.
+//
+// Return:
+//    S_OK                       The branch exists.
+//    E_INVALIDARG               The branch doesn't exist.
+//    E_xxx                      An error occured.
+//=========================================================================
+HRESULT DaBrowseCache::ExistBranch( LPCWSTR szBranchID )
+{
+	if (*szBranchID == L'\0') {
+		return S_OK;                              // The root always exists
+	}
+
+	CComBSTR bstrParent;
+	LPCWSTR  pszName = wcsrchr( szBranchID, DaBranch::GetDelimiter() );
+	if (pszName) {
+		bstrParent.Attach( SysAllocStringLen( szBranchID, (UINT)(pszName - szBranchID) ) );
+		pszName++;
+	}
+	else {
+		bstrParent.Attach( SysAllocString( L"" ) );
+		pszName = szBranchID;
+	}
+	if (!bstrParent) return E_OUTOFMEMORY;
+
+	Branch* pParent;
+	HRESULT hres = AcquireBranch( bstrParent, &pParent );
+	if (FAILED( hres )) return hres;
+
+	hres = FindBranchName( pParent, pszName ) ? S_OK : E_INVALIDARG;
+	ReleaseBranch( pParent );
+	return hres;
+}
+
+
+
+//=========================================================================
+// LoadBranch
+// ----------
+//    Gets the children of the branch szBranchID from the loader function
+//    and creates a new branch with a reference count of one. The names
+//    of the branch are stored in one buffer.
+//=========================================================================
+HRESULT DaBrowseCache::LoadBranch( LPCWSTR szBranchID, Branch** ppBranch )
+{
+	DWORD    dwNumOfBranches = 0;
+	LPWSTR*  ppszBranches = NULL;
+	DWORD    dwNumOfLeafs = 0;
+	LPWSTR*  ppszLeafs = NULL;
+	VARTYPE* pvtLeafs = NULL;
+	LPDWORD  pdwLeafAccessRights = NULL;
+	Branch*  pBranch = NULL;
+	DWORD    i;
+
+	*ppBranch = NULL;
+
+	HRESULT hres = m_pfnLoadChildren( szBranchID,
+									  &dwNumOfBranches, &ppszBranches,
+									  &dwNumOfLeafs, &ppszLeafs,
+									  &pvtLeafs, &pdwLeafAccessRights );
+	if (FAILED( hres )) return hres;
+
+	if (ppszBranches == NULL) dwNumOfBranches = 0;
+	if (ppszLeafs == NULL)    dwNumOfLeafs = 0;
+
+	try {
+		// Size of the name buffer
+		size_t cchNames = wcslen( szBranchID ) + 1;
+		for (i = 0; i < dwNumOfBranches; i++) {
+			if (ppszBranches[i]) cchNames += wcslen( ppszBranches[i] ) + 1;
+		}
+		for (i = 0; i < dwNumOfLeafs; i++) {
+			if (ppszLeafs[i]) cchNames += wcslen( ppszLeafs[i] ) + 1;
+		}
+
+		pBranch = new Branch;
+		if (pBranch == NULL) throw E_OUTOFMEMORY;
+		memset( pBranch, 0, sizeof (Branch) );
+		pBranch->lRefCount = 1;
+
+		pBranch->pNames = new WCHAR [ cchNames ];
+		if (pBranch->pNames == NULL) throw E_OUTOFMEMORY;
+		if (dwNumOfBranches) {
+			pBranch->ppszBranches = new LPCWSTR [ dwNumOfBranches ];
+			if (pBranch->ppszBranches == NULL) throw E_OUTOFMEMORY;
+		}
+		if (dwNumOfLeafs) {
+			pBranch->pLeafs = new Leaf [ dwNumOfLeafs ];
+			if (pBranch->pLeafs == NULL) throw E_OUTOFMEMORY;
+		}
+
+		WCHAR* pch = pBranch->pNames;
+		size_t cch = wcslen( szBranchID ) + 1;
+		wcscpy_s( pch, cchNames, szBranchID );
+		pBranch->pszID = pch;
+		pch += cch; cchNames -= cch;
+
+		for (i = 0; i < dwNumOfBranches; i++) {
+			if (ppszBranches[i] == NULL) continue;
+			cch = wcslen( ppszBranches[i] ) + 1;
+			wcscpy_s( pch, cchNames, ppszBranches[i] );
+			pBranch->ppszBranches[ pBranch->dwNumOfBranches++ ] = pch;
+			pch += cch; cchNames -= cch;
+		}
+		for (i = 0; i < dwNumOfLeafs; i++) {
+			if (ppszLeafs[i] == NULL) continue;
+			cch = wcslen( ppszLeafs[i] ) + 1;
+			wcscpy_s( pch, cchNames, ppszLeafs[i] );
+			Leaf& leaf = pBranch->pLeafs[ pBranch->dwNumOfLeafs++ ];
+			leaf.pszName        = pch;
+			leaf.vtDataType     = pvtLeafs ? pvtLeafs[i] : VT_EMPTY;
+			leaf.dwAccessRights = pdwLeafAccessRights ? pdwLeafAccessRights[i] : (OPC_READABLE | OPC_WRITEABLE);
+			pch += cch; cchNames -= cch;
+		}
+
+		// Sorted for the lookup with bsearch()
+		qsort( pBranch->ppszBranches, pBranch->dwNumOfBranches, sizeof (LPCWSTR), CompareNames );
+		qsort( pBranch->pLeafs, pBranch->dwNumOfLeafs, sizeof (Leaf), CompareLeafs );
+
+		*ppBranch = pBranch;
+		pBranch = NULL;
+		hres = S_OK;
+	}
+	catch (HRESULT hresEx) {
+		hres = hresEx;
+	}
+	catch (...) {
+		hres = E_FAIL;
+	}
+	if (pBranch) {
+		ReleaseBranch( pBranch );
+	}
+
+	// Release the arrays of the loader
+	for (i = 0; i < dwNumOfBranches; i++) {
+		CoTaskMemFree( ppszBranches[i] );
+	}
+	for (i = 0; i < dwNumOfLeafs; i++) {
+		CoTaskMemFree( ppszLeafs[i] );
+	}
+	CoTaskMemFree( ppszBranches );
+	CoTaskMemFree( ppszLeafs );
+	CoTaskMemFree( pvtLeafs );
+	CoTaskMemFree( pdwLeafAccessRights );
+
+	return hres;
+}
+
+
+
+//=========================================================================
+// TouchNoLock
+// -----------
+//    Marks the branch and all its cached parents as most recently used.
+//    The parents are moved after the branch so that a parent is always
+//    newer than its children.
+//    m_csBranches must be locked outside.
+//=========================================================================
+void DaBrowseCache::TouchNoLock( Branch* pBranch )
+{
+	MoveToNewestNoLock( pBranch );
+
+	size_t cchID = wcslen( pBranch->pszID );
+	if (cchID == 0) return;                       // Root
+
+	CAutoVectorPtr<WCHAR> szParent;
+	if (!szParent.Allocate( cchID + 1 )) return;
+	wcscpy_s( szParent, cchID + 1, pBranch->pszID );
+
+	WCHAR* pwc;
+	do {
+		pwc = wcsrchr( szParent, DaBranch::GetDelimiter() );
+		if (pwc) {
+			*pwc = L'\0';
+		}
+		else {
+			szParent[0] = L'\0';
+		}
+		Branch* pParent;
+		if (m_mapBranches.Lookup( szParent, pParent )) {
+			MoveToNewestNoLock( pParent );
+		}
+	} while (pwc);
+}
+
+
+
+//=========================================================================
+// MoveToNewestNoLock
+// ------------------
+//    m_csBranches must be locked outside.
+//=========================================================================
+void DaBrowseCache::MoveToNewestNoLock( Branch* pBranch )
+{
+	if (m_pNewest == pBranch) return;
+
+	UnlinkNoLock( pBranch );
+	pBranch->pOlder = m_pNewest;
+	pBranch->pNewer = NULL;
+	if (m_pNewest) {
+		m_pNewest->pNewer = pBranch;
+	}
+	m_pNewest = pBranch;
+	if (m_pOldest == NULL) {
+		m_pOldest = pBranch;
+	}
+}
+
+
+
+//=========================================================================
+// UnlinkNoLock
+// ------------
+//    Removes the branch from the list of the cached branches.
+//    m_csBranches must be locked outside.
+//=========================================================================
+void DaBrowseCache::UnlinkNoLock( Branch* pBranch )
+{
+	if (pBranch->pNewer) {
+		pBranch->pNewer->pOlder = pBranch->pOlder;
+	}
+	else if (m_pNewest == pBranch) {
+		m_pNewest = pBranch->pOlder;
+	}
+	if (pBranch->pOlder) {
+		pBranch->pOlder->pNewer = pBranch->pNewer;
+	}
+	else if (m_pOldest == pBranch) {
+		m_pOldest = pBranch->pNewer;
+	}
+	pBranch->pNewer = NULL;
+	pBranch->pOlder = NULL;
+}
+
+
+
+//=========================================================================
+// EvictNoLock
+// -----------
+//    Removes the least recently used branches until the cache contains
+//    no more than m_dwMaxNames names. The branch pKeep and its parents
+//    are never removed.
+//    m_csBranches must be locked outside.
+//=========================================================================
+void DaBrowseCache::EvictNoLock( Branch* pKeep )
+{
+	while (m_dwNumOfNames > m_dwMaxNames && m_pOldest && m_pOldest != pKeep) {
+		Branch* pBranch = m_pOldest;
+		UnlinkNoLock( pBranch );
+		m_mapBranches.RemoveKey( pBranch->pszID );
+		m_dwNumOfNames -= NumOfNames( pBranch );
+		ReleaseBranch( pBranch );                 // Reference of the cache
+	}
+}
+
+
+
+//=========================================================================
+// Helper functions
+//=========================================================================
+BOOL DaBrowseCache::FindBranchName( const Branch* pBranch, LPCWSTR szName )
+{
+	return bsearch( &szName, pBranch->ppszBranches, pBranch->dwNumOfBranches,
+					sizeof (LPCWSTR), CompareNames ) != NULL;
+}
+
+
+const DaBrowseCache::Leaf* DaBrowseCache::FindLeaf( const Branch* pBranch, LPCWSTR szName )
+{
+	Leaf key;
+	key.pszName = szName;
+	return (const Leaf*)bsearch( &key, pBranch->pLeafs, pBranch->dwNumOfLeafs,
+								 sizeof (Leaf), CompareLeafs );
+}
+
+
+int __cdecl DaBrowseCache::CompareNames( const void* pName1, const void* pName2 )
+{
+	return wcscmp( *(LPCWSTR*)pName1, *(LPCWSTR*)pName2 );
+}
+
+
+int __cdecl DaBrowseCache::CompareLeafs( const void* pLeaf1, const void* pLeaf2 )
+{
+	return wcscmp( ((const Leaf*)pLeaf1)->pszName, ((const Leaf*)pLeaf2)->pszName );
+}
+
+
+DWORD DaBrowseCache::NumOfNames( const Branch* pBranch )
+{
+	return pBranch->dwNumOfBranches + pBranch->dwNumOfLeafs + 1;   // + ID
+}
+
+
+HRESULT DaBrowseCache::JoinName( LPCWSTR szPosition, LPCWSTR szName, BSTR* pszFullName )
+{
+	if (*szPosition == L'\0') {
+		*pszFullName = SysAllocString( szName );
+	}
+	else {
+		UINT cchPosition = (UINT)wcslen( szPosition );
+		UINT cchName     = (UINT)wcslen( szName );
+		*pszFullName = SysAllocStringLen( NULL, cchPosition + 1 + cchName );
+		if (*pszFullName) {
+			wmemcpy( *pszFullName, szPosition, cchPosition );
+			(*pszFullName)[ cchPosition ] = DaBranch::GetDelimiter();
+			wmemcpy( *pszFullName + cchPosition + 1, szName, cchName );
+		}
+	}
+	return *pszFullName ? S_OK : E_OUTOFMEMORY;
+}
+
+
+
+//=========================================================================
+// FilterName
+// ----------
+//    Checks if the name matches the filter criteria.
+//=========================================================================
+BOOL DaBrowseCache::FilterName( LPCWSTR szName, LPCWSTR szFilterCriteria, BOOL fFilterBranch )
+{
+	if (szFilterCriteria && *szFilterCriteria) {
+		//
+		// TODO: Add server specific filtering if desired
+		//
+
+		// Call MatchPattern() to support default filtering
+		// specified by the DA specification.
+		return ::MatchPattern( szName, szFilterCriteria );
+	}
+	return TRUE;                                  // No filter is specified
+}
@@ -26,6 +26,7 @@
 #endif // _MSC_VER >= 1000
 
 #include "WideString.h"
+#include "StringAtom.h"
 #include "UtilityDefs.h"
 #include <atlcoll.h>
 
@@ -87,6 +88,9 @@ public:
    static void SetDelimiter( WCHAR wc ) {
       m_szDelimiter[0] = wc;
    }
+   static WCHAR GetDelimiter() {
+      return m_szDelimiter[0];
+   }
    HRESULT  AddBranch( LPCWSTR szBranchName, DaBranch** ppBranch );
    HRESULT  AddLeaf( LPCWSTR szLeafName, DaDeviceItem* pDItem );
    HRESULT  AddDeviceItem( LPCWSTR szSASName, DaDeviceItem* pDItem );
@@ -106,6 +110,7 @@ public:
    HRESULT  RemoveLeaf( LPCWSTR szLeafName, BOOL fKillDeviceItem = FALSE );
    HRESULT  RemoveBranch( LPCWSTR szBranchName, BOOL fKillDeviceItems = FALSE );
    HRESULT  RemoveDeviceItemAssociatedLeaf( LPCWSTR szItemID, BOOL fKillDeviceItem = FALSE );
+   void     MoveMembersTo( DaBranch* pTarget, CAtlArray<DaDeviceItem*>& arRejected );
 
 // Implementation
 protected:
@@ -156,7 +161,7 @@ public:
 
 // Attributes
 public:
-   inline WideString&     Name()               { return m_wsName; }
+   inline StringAtom&     Name()               { return *m_pName; }
    inline DaDeviceItem&     DeviceItem() const   { return *m_pDItemRef; }
 
 // Operations
@@ -166,7 +171,7 @@ public:
 
 // Implementation
 protected:
-   WideString    m_wsName;                     // The name of the leaf
+   StringAtom*   m_pName;                      // The interned name of the leaf
    DaDeviceItem*   m_pDItemRef;
 
    friend HRESULT DaBranch::RemoveLeaf( LPCWSTR, BOOL );
@@ -174,4 +179,149 @@ protected:
    BOOL           m_fKillDeviceItemOnDestroy;
 };
 
+//-----------------------------------------------------------------------------
+// CLASS DaAddressSpaceBuilder
+//-----------------------------------------------------------------------------
+// Builds the branches and leaves for a large number of Device Items in
+// parallel without locking the Server Address Space. The items are
+// distributed by their top level branch name to detached partitions which
+// are built by separate threads. Publish() moves the result into the
+// Server Address Space.
+class DaAddressSpaceBuilder
+{
+// Construction / Destruction
+public:
+   DaAddressSpaceBuilder();
+   ~DaAddressSpaceBuilder();
+
+// Operations
+public:
+   HRESULT  Build( DWORD dwCount, DaDeviceItem** ppDItems, HRESULT* pErrors );
+   void     Publish( DaBranch* pRoot, CAtlArray<DaDeviceItem*>& arRejected );
+
+// Implementation
+protected:
+   struct Partition
+   {
+      DaAddressSpaceBuilder*  pBuilder;
+      DaBranch                branch;          // Detached root of the partition
+      CAtlArray<DWORD>        arIndex;         // Indexes of the items in this partition
+   };
+
+   friend unsigned __stdcall BuildPartitionThread( void* pArg );
+
+   DWORD    PartitionOf( LPCWSTR szItemID ) const;
+   void     BuildPartition( Partition* pPartition );
+   void     RemovePartitions();
+
+   CAtlArray<Partition*>   m_arPartitions;
+   DaDeviceItem**          m_ppDItems;
+   HRESULT*                m_pErrors;
+};
+
+
+
+//-----------------------------------------------------------------------------
+// CLASS DaBrowseCache
+//-----------------------------------------------------------------------------
+// Server Address Space for servers whose namespace is too large or too
+// dynamic to be registered in advance. The children of a branch are
+// requested from a loader function when the branch is browsed the first
+// time and are kept in a cache limited by the number of cached names.
+//
+// If the limit is exceeded the least recently browsed branches are removed.
+// Using a branch also marks all its parent branches as used. Therefore the
+// branches of a subtree are always removed before the branches above it and
+// the cache memory is proportional to the part of the namespace the clients
+// actually visit.
+//
+// The browse position is the fully qualified name of a branch. An empty
+// string or NULL is the root.
+class DaBrowseCache
+{
+public:
+   // Returns the names of the branches and leaves of the branch szBranchID.
+   // The arrays and the names must be allocated with CoTaskMemAlloc().
+   // The function may return NULL for ppvtLeafs and ppdwLeafAccessRights.
+   // E_INVALIDARG is returned if the branch doesn't exist.
+   typedef HRESULT (*PFNLOADCHILDREN)( LPCWSTR szBranchID,
+                                       LPDWORD pdwNumOfBranches, LPWSTR** ppszBranches,
+                                       LPDWORD pdwNumOfLeafs, LPWSTR** ppszLeafs,
+                                       VARTYPE** ppvtLeafs, LPDWORD* ppdwLeafAccessRights );
+
+// Construction / Destruction
+public:
+   DaBrowseCache();
+   HRESULT Create( PFNLOADCHILDREN pfnLoadChildren, DWORD dwMaxNames );
+   ~DaBrowseCache();
+
+// Operations
+public:
+   void     SetMaxNames( DWORD dwMaxNames );
+   void     RemoveAll();
+
+   HRESULT  ChangeBrowsePosition( LPCWSTR szActualPosition, OPCBROWSEDIRECTION dwBrowseDirection,
+                                  LPCWSTR szPosition, BSTR* pszNewPosition );
+   HRESULT  BrowseBranches( LPCWSTR szPosition, LPCWSTR szFilterCriteria,
+                            LPDWORD pdwNumOfBranches, BSTR** ppszBranches );
+
+   HRESULT  BrowseLeafs( LPCWSTR szPosition, LPCWSTR szFilterCriteria, VARTYPE vtDataTypeFilter,
+                         DWORD dwAccessRightsFilter, LPDWORD pdwNumOfLeafs, BSTR** ppszLeafs );
+
+   HRESULT  GetFullyQualifiedName( LPCWSTR szPosition, LPCWSTR szName, BSTR* pszFullyQualifiedName );
+
+// Implementation
+protected:
+   struct Leaf
+   {
+      LPCWSTR        pszName;
+      VARTYPE        vtDataType;                // VT_EMPTY if unknown
+      DWORD          dwAccessRights;
+   };
+
+   // The children of one branch. Not changed after creation.
+   struct Branch
+   {
+      LONG           lRefCount;
+      LPCWSTR        pszID;                     // Fully qualified name, key of m_mapBranches
+      WCHAR*         pNames;                    // Buffer with the ID and all names
+      DWORD          dwNumOfBranches;
+      LPCWSTR*       ppszBranches;              // Sorted branch names
+      DWORD          dwNumOfLeafs;
+      Leaf*          pLeafs;                    // Sorted leaves
+      Branch*        pNewer;                    // List of the cached branches
+      Branch*        pOlder;                    // in the order of their last use
+   };
+
+   HRESULT  AcquireBranch( LPCWSTR szBranchID, Branch** ppBranch );
+   void     ReleaseBranch( Branch* pBranch );
+   HRESULT  ExistBranch( LPCWSTR szBranchID );
+   HRESULT  LoadBranch( LPCWSTR szBranchID, Branch** ppBranch );
+
+   void     TouchNoLock( Branch* pBranch );
+   void     MoveToNewestNoLock( Branch* pBranch );
+   void     UnlinkNoLock( Branch* pBranch );
+   void     EvictNoLock( Branch* pKeep );
+
+   static BOOL          FindBranchName( const Branch* pBranch, LPCWSTR szName );
+   static const Leaf*   FindLeaf( const Branch* pBranch, LPCWSTR szName );
+   static int __cdecl   CompareNames( const void* pName1, const void* pName2 );
+   static int __cdecl   CompareLeafs( const void* pLeaf1, const void* pLeaf2 );
+   static HRESULT       JoinName( LPCWSTR szPosition, LPCWSTR szName, BSTR* pszFullName );
+   static DWORD         NumOfNames( const Branch* pBranch );
+
+   BOOL     FilterName( LPCWSTR szName, LPCWSTR szFilterCriteria, BOOL fFilterBranch );
+
+   PFNLOADCHILDREN         m_pfnLoadChildren;
+   DWORD                   m_dwMaxNames;
+   DWORD                   m_dwNumOfNames;      // Names of all cached branches
+
+   CAtlMap<LPCWSTR,Branch*,LPCWSTRRefElementTraits<LPCWSTR> >  m_mapBranches;
+   Branch*                 m_pNewest;
+   Branch*                 m_pOldest;
+
+      // Protects the map, the list and the counters
+   CComAutoCriticalSection m_csBranches;
+};
+
 #endif // __HIERARCHICALSAS_H
@@ -0,0 +1,1061 @@
+/*
+ * Copyright (c) 2020 Technosoftware GmbH. All rights reserved
+ * Web: https://technosoftware.com
+ *
+ * The source code in this file is covered under a dual-license scenario:
+ *   - Owner of a purchased license: SCLA 1.0
+ *   - GPL V3: everybody else
+ *
+ * SCLA license terms accompanied with this source code.
+ * See https://technosoftware.com/license/Source_Code_License_Agreement.pdf
+ *
+ * GNU General Public License as published by the Free Software Foundation;
+ * version 3 of the License are accompanied with this source code.
+ * See https://technosoftware.com/license/GPLv3License.txt
+ *
+ * This source code is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+
+//-------------------------------------------------------------------------
+// INLCUDE
+//-------------------------------------------------------------------------
+#include "stdafx.h"                             // Generic server part headers
+#include "MatchPattern.h"
+#include "DaDeviceItem.h"
+// Application specific definitions
+#include "DaAddressSpace.h"
+#include "DaAddressSpaceTrie.h"
+
+//-------------------------------------------------------------------------
+// DEFINES
+//-------------------------------------------------------------------------
+#define NODEBLOCK_SIZE           4096           // Nodes per arena block
+#define NAMEBLOCK_SIZE           65536          // Characters per arena block
+#define INDEXBLOCK_SIZE          4096           // Hash index entries per block
+
+
+
+//-------------------------------------------------------------------------
+// CODE DaAddressSpaceTrie
+//-------------------------------------------------------------------------
+
+//=========================================================================
+// Construction
+//=========================================================================
+DaAddressSpaceTrie::DaAddressSpaceTrie()
+	: m_mapIndex( 1031, 0.75f, 0.25f, 2.25f, INDEXBLOCK_SIZE )
+{
+	memset( &m_Root, 0, sizeof (m_Root) );
+	m_Root.pszName    = L"";
+	m_pNodeBlock      = NULL;
+	m_dwNodesUsed     = 0;
+	m_pFreeNodes      = NULL;
+	m_pNameBlock      = NULL;
+	m_dwNameCharsUsed = 0;
+	m_dwNumOfLeafs    = 0;
+}
+
+
+
+//=========================================================================
+// Initializer
+// -----------
+//    Must be called after construction.
+//=========================================================================
+HRESULT DaAddressSpaceTrie::Create()
+{
+	return m_Lock.Initialize() ? S_OK : E_FAIL;
+}
+
+
+
+//=========================================================================
+// Destructor
+//=========================================================================
+DaAddressSpaceTrie::~DaAddressSpaceTrie()
+{
+	m_mapIndex.RemoveAll();
+	FreeArenas();
+}
+
+
+
+//-------------------------------------------------------------------------
+// OPERATIONS
+//-------------------------------------------------------------------------
+
+//=========================================================================
+// AddDeviceItem
+// -------------
+//    Adds a leaf with the specified Device Item. Not existing branches
+//    are created. See DaBranch::AddDeviceItem().
+//
+// Parameters:
+//    IN
+//       szSASName               The Name in the Server Address Space
+//       pDItem                  The DeviceItem
+//=========================================================================
+HRESULT DaAddressSpaceTrie::AddDeviceItem( LPCWSTR szSASName, DaDeviceItem* pDItem )
+{
+	HRESULT hres;
+
+	m_Lock.BeginWriting();
+	try {
+		hres = AddDeviceItemNoLock( szSASName, pDItem );
+	}
+	catch (...) {
+		hres = E_OUTOFMEMORY;
+	}
+	m_Lock.EndWriting();
+
+	return hres;
+}
+
+
+
+//=========================================================================
+// AddDeviceItems
+// --------------
+//    Adds the leaves of several Device Items with one lock of the trie.
+//    The ItemId is used as name in the Server Address Space.
+//
+// Parameters:
+//    IN
+//       dwCount                 Number of Device Items
+//       ppDItems                The Device Items
+//    OUT
+//       pErrors                 Result for each Device Item.
+//                               E_INVALIDARG if the ItemId already exist.
+// Return:
+//    S_OK                       All succeeded
+//    S_FALSE                    At least one Device Item was not added
+//=========================================================================
+HRESULT DaAddressSpaceTrie::AddDeviceItems( DWORD dwCount, DaDeviceItem** ppDItems, HRESULT* pErrors )
+{
+	HRESULT hres = S_OK;
+
+	m_Lock.BeginWriting();
+	for (DWORD i = 0; i < dwCount; i++) {
+		LPWSTR szItemID;
+		pErrors[i] = ppDItems[i]->get_ItemIDPtr( &szItemID );
+		if (SUCCEEDED( pErrors[i] )) {
+			try {
+				pErrors[i] = AddDeviceItemNoLock( szItemID, ppDItems[i] );
+			}
+			catch (...) {
+				pErrors[i] = E_OUTOFMEMORY;
+			}
+		}
+		if (FAILED( pErrors[i] )) {
+			hres = S_FALSE;
+		}
+	}
+	m_Lock.EndWriting();
+
+	return hres;
+}
+
+
+
+//=========================================================================
+// FindDeviceItem
+// --------------
+//    Searches the Device Item with the specified fully qualified ItemId.
+//    The returned Device Item is not attached.
+//
+// Parameters:
+//    IN
+//       szItemID                The fully qualified ItemId.
+//    OUT
+//       ppDItem                 The DeviceItem
+//=========================================================================
+HRESULT DaAddressSpaceTrie::FindDeviceItem( LPCWSTR szItemID, DaDeviceItem** ppDItem )
+{
+	*ppDItem = NULL;
+
+	m_Lock.BeginReading();
+	Node* pLeaf = FindLeafNoLock( szItemID );
+	if (pLeaf) {
+		*ppDItem = pLeaf->pDItem;
+	}
+	m_Lock.EndReading();
+
+	return (*ppDItem) ? S_OK : E_INVALIDARG;
+}
+
+
+
+//=========================================================================
+// ChangeBrowsePosition
+// --------------------
+//    Moves 'up' or 'down' or 'to' in the hierarchical space.
+//    See DaBranch::ChangeBrowsePosition().
+//
+// Parameters:
+//    IN
+//       pPosition               The current position.
+//       dwBrowseDirection       OPC_BROWSE_DOWN or OPC_BROWSE_UP or
+//                               OPC_BROWSE_TO
+//       szPosition              DOWN :   The name of the branch move into.
+//                               UP:      Is ignored.
+//                               TO:      The fully qualified branch name
+//                                        or a NULL-String to go to the
+//                                        root.
+//    OUT
+//       ppNewPos                The new position.
+//=========================================================================
+HRESULT DaAddressSpaceTrie::ChangeBrowsePosition( Node* pPosition, OPCBROWSEDIRECTION dwBrowseDirection,
+												  LPCWSTR szPosition, Node** ppNewPos )
+{
+	HRESULT hres = S_OK;
+	*ppNewPos = NULL;
+
+	m_Lock.BeginReading();
+	switch (dwBrowseDirection) {
+
+	  case OPC_BROWSE_UP:
+		  // ------------------------------------------------------------------
+		  if (pPosition->pParent) {
+			  *ppNewPos = pPosition->pParent;
+		  }
+		  else {
+			  hres = E_FAIL;                      // Moving up from the 'root'
+		  }
+		  break;
+
+	  case OPC_BROWSE_DOWN:
+		  // ------------------------------------------------------------------
+		  *ppNewPos = FindChildNoLock( pPosition, szPosition, (DWORD)wcslen( szPosition ), FALSE );
+		  if (*ppNewPos == NULL) {
+			  hres = E_INVALIDARG;                // Not found
+		  }
+		  break;
+
+	  case OPC_BROWSE_TO:
+		  // ------------------------------------------------------------------
+		  hres = ChangePositionDownNoLock( &m_Root, szPosition, ppNewPos );
+		  break;
+
+	  default:
+		  // ------------------------------------------------------------------
+		  hres = E_INVALIDARG;
+		  break;
+	}
+	m_Lock.EndReading();
+
+	return hres;
+}
+
+
+
+//=========================================================================
+// BrowseBranches
+// --------------
+//    Returns the name of the branches at the specified position which
+//    matches the specified filter. See DaBranch::BrowseBranches().
+//
+// Return:
+//    S_OK                       All succeeded
+//    S_FALSE                    There are no branches which matches
+//                               the filter. Note : ppszBranches is NULL !
+//    E_xxx                      An error occured. ppszBranches is NULL !
+//=========================================================================
+HRESULT DaAddressSpaceTrie::BrowseBranches( Node* pPosition, LPCWSTR szFilterCriteria,
+											LPDWORD pdwNumOfBranches, BSTR** ppszBranches )
+{
+	HRESULT           hres = S_OK;
+	CAtlArray<BSTR>   arNames;
+
+	*pdwNumOfBranches = 0;
+	*ppszBranches = NULL;
+
+	m_Lock.BeginReading();
+	try {
+		for (Node* pNode = pPosition->pFirstChild; pNode; pNode = pNode->pNextSibling) {
+			if (pNode->pDItem == NULL && FilterName( pNode->pszName, szFilterCriteria, TRUE )) {
+				BSTR szTmp = SysAllocStringLen( pNode->pszName, pNode->dwNameLen );
+				if (szTmp == NULL) throw E_OUTOFMEMORY;
+				arNames.Add( szTmp );
+			}
+		}
+	}
+	catch (HRESULT hresEx) {
+		hres = hresEx;
+	}
+	catch (...) {
+		hres = E_OUTOFMEMORY;
+	}
+	m_Lock.EndReading();
+
+	if (SUCCEEDED( hres )) {
+		hres = CopyNames( arNames, pdwNumOfBranches, ppszBranches );
+	}
+	else {
+		for (size_t i = 0; i < arNames.GetCount(); i++) {
+			SysFreeString( arNames[i] );
+		}
+	}
+	return hres;
+}
+
+
+
+//=========================================================================
+// BrowseLeafs
+// -----------
+//    Returns the name of the leafs at the specified position which
+//    matches the specified filters. See DaBranch::BrowseLeafs().
+//
+// Return:
+//    S_OK                       All succeeded
+//    S_FALSE                    There are no leafs which matches
+//                               the filter. Note : ppszLeafs is NULL !
+//    E_xxx                      An error occured. ppszLeafs is NULL !
+//=========================================================================
+HRESULT DaAddressSpaceTrie::BrowseLeafs( Node* pPosition, LPCWSTR szFilterCriteria, VARTYPE vtDataTypeFilter,
+										 DWORD dwAccessRightsFilter, LPDWORD pdwNumOfLeafs, BSTR** ppszLeafs )
+{
+	HRESULT           hres = S_OK;
+	CAtlArray<BSTR>   arNames;
+
+	*pdwNumOfLeafs = 0;
+	*ppszLeafs = NULL;
+
+	m_Lock.BeginReading();
+	try {
+		for (Node* pNode = pPosition->pFirstChild; pNode; pNode = pNode->pNextSibling) {
+			if (pNode->pDItem == NULL) {
+				continue;
+			}
+			HRESULT hresTmp = FilterLeaf( pNode, vtDataTypeFilter, dwAccessRightsFilter );
+			if (FAILED( hresTmp )) throw hresTmp;
+
+			if (hresTmp == S_OK && FilterName( pNode->pszName, szFilterCriteria, FALSE )) {
+				BSTR szTmp = SysAllocStringLen( pNode->pszName, pNode->dwNameLen );
+				if (szTmp == NULL) throw E_OUTOFMEMORY;
+				arNames.Add( szTmp );
+			}
+		}
+	}
+	catch (HRESULT hresEx) {
+		hres = hresEx;
+	}
+	catch (...) {
+		hres = E_OUTOFMEMORY;
+	}
+	m_Lock.EndReading();
+
+	if (SUCCEEDED( hres )) {
+		hres = CopyNames( arNames, pdwNumOfLeafs, ppszLeafs );
+	}
+	else {
+		for (size_t i = 0; i < arNames.GetCount(); i++) {
+			SysFreeString( arNames[i] );
+		}
+	}
+	return hres;
+}
+
+
+
+//=========================================================================
+// BrowseFlat
+// ----------
+//    All leaf names at and below the specified position which matches
+//    the specified filters are returned. For all leafs the fully
+//    qualified name is returned. See DaBranch::BrowseFlat().
+//
+// Return:
+//    S_OK                       All succeeded
+//    S_FALSE                    There are no leafs which matches
+//                               the filter. Note : ppszLeafs is NULL !
+//    E_xxx                      An error occured. ppszLeafs is NULL !
+//=========================================================================
+HRESULT DaAddressSpaceTrie::BrowseFlat( Node* pPosition, LPCWSTR szFilterCriteria, VARTYPE vtDataTypeFilter,
+										DWORD dwAccessRightsFilter, LPDWORD pdwNumOfLeafs, BSTR** ppszLeafs )
+{
+	HRESULT           hres;
+	CAtlArray<BSTR>   arNames;
+
+	*pdwNumOfLeafs = 0;
+	*ppszLeafs = NULL;
+
+	m_Lock.BeginReading();
+	try {
+		hres = BrowseFlatNoLock( pPosition, szFilterCriteria, vtDataTypeFilter, dwAccessRightsFilter, arNames );
+	}
+	catch (...) {
+		hres = E_OUTOFMEMORY;
+	}
+	m_Lock.EndReading();
+
+	if (SUCCEEDED( hres )) {
+		hres = CopyNames( arNames, pdwNumOfLeafs, ppszLeafs );
+	}
+	else {
+		for (size_t i = 0; i < arNames.GetCount(); i++) {
+			SysFreeString( arNames[i] );
+		}
+	}
+	return hres;
+}
+
+
+
+//=========================================================================
+// GetFullyQualifiedName
+// ---------------------
+//    Returns the fully qualified name of a branch or leaf member at or
+//    below the specified position. See DaBranch::GetFullyQualifiedName().
+//
+// Parameters:
+//    IN
+//       pPosition               The current position.
+//       szName                  The name of a branch or leaf member
+//                               at or below the position. If this
+//                               parameter is a NULL-String then the fully
+//                               qualified name of the position is
+//                               returned. If this parameter already
+//                               specifies a fully qualified name then
+//                               the same string is returned.
+//    OUT
+//       pszFullyQualifiedName   The fully qualified name.
+//=========================================================================
+HRESULT DaAddressSpaceTrie::GetFullyQualifiedName( Node* pPosition, LPCWSTR szName, BSTR* pszFullyQualifiedName )
+{
+	HRESULT  hres = E_INVALIDARG;
+	Node*    pNode;
+
+	*pszFullyQualifiedName = NULL;
+
+	m_Lock.BeginReading();
+	try {
+		if (*szName == L'\0') {                  // Return the fully qualified name of the position
+			throw GetFullyQualifiedNameNoLock( pPosition, pszFullyQualifiedName );
+		}
+		// First try if a branch name is specified
+		if (SUCCEEDED( ChangePositionDownNoLock( pPosition, szName, &pNode ) )) {
+			throw GetFullyQualifiedNameNoLock( pNode, pszFullyQualifiedName );
+		}
+
+		// It is not a branch name. Try if it is a leaf name.
+		pNode = NULL;
+		LPCWSTR pszLeaf = wcsrchr( szName, DaBranch::GetDelimiter() );
+		if (pszLeaf) {                           // szName includes a branch name
+			Node* pBranch;
+			if (SUCCEEDED( GetBranchNoLock( pPosition, szName, pszLeaf, FALSE, &pBranch ) )) {
+				pszLeaf++;
+				pNode = FindChildNoLock( pBranch, pszLeaf, (DWORD)wcslen( pszLeaf ), TRUE );
+			}
+		}
+		else {                                   // szName specifies a leaf of the position
+			pNode = FindChildNoLock( pPosition, szName, (DWORD)wcslen( szName ), TRUE );
+		}
+		if (pNode) {
+			LPWSTR szID;
+			hres = pNode->pDItem->get_ItemIDPtr( &szID );
+			if (FAILED( hres )) throw hres;
+			*pszFullyQualifiedName = SysAllocString( szID );
+			if (*pszFullyQualifiedName == NULL) throw E_OUTOFMEMORY;
+			throw S_OK;
+		}
+
+		// Check if szName specifies a fully qualified name
+		if (FindLeafNoLock( szName )) {
+			*pszFullyQualifiedName = SysAllocString( szName );
+			if (*pszFullyQualifiedName == NULL) throw E_OUTOFMEMORY;
+			hres = S_OK;
+		}
+	}
+	catch (HRESULT hresEx) {
+		hres = hresEx;
+	}
+	catch (...) {
+		hres = E_FAIL;
+	}
+	m_Lock.EndReading();
+
+	return hres;
+}
+
+
+
+//=========================================================================
+// RemoveAll
+// ---------
+//    Removes all branches and leaves and releases the arenas.
+//    If fKillDeviceItems is set then all Device Items associated with
+//    leafs are killed.
+//    Browse positions other than the root become invalid.
+//=========================================================================
+void DaAddressSpaceTrie::RemoveAll( BOOL fKillDeviceItems /* = FALSE */ )
+{
+	m_Lock.BeginWriting();
+	if (fKillDeviceItems) {
+		KillDeviceItemsNoLock( &m_Root );
+	}
+	m_mapIndex.RemoveAll();
+	FreeArenas();
+
+	m_Root.pFirstChild     = NULL;
+	m_Root.dwNumOfBranches = 0;
+	m_Root.dwNumOfLeafs    = 0;
+	m_dwNumOfLeafs         = 0;
+	m_Lock.EndWriting();
+}
+
+
+
+//=========================================================================
+// RemoveDeviceItemAssociatedLeaf
+// ------------------------------
+//    Removes the leaf whose associated Device Item has the specified
+//    fully qualified ItemId.
+//    If fKillDeviceItem is set then the Device Item associated with
+//    the leaf ist killed.
+//    The branches of the leaf are not removed.
+//=========================================================================
+HRESULT DaAddressSpaceTrie::RemoveDeviceItemAssociatedLeaf( LPCWSTR szItemID, BOOL fKillDeviceItem /* = FALSE */ )
+{
+	HRESULT hres = E_INVALIDARG;
+
+	m_Lock.BeginWriting();
+	Node* pLeaf = FindLeafNoLock( szItemID );
+	if (pLeaf) {
+		if (fKillDeviceItem) {
+			pLeaf->pDItem->Kill( TRUE );
+		}
+		RemoveNodeNoLock( pLeaf );
+		hres = S_OK;
+	}
+	m_Lock.EndWriting();
+
+	return hres;
+}
+
+
+
+//-------------------------------------------------------------------------
+// IMPLEMENTATION
+//-------------------------------------------------------------------------
+
+//=========================================================================
+// AddDeviceItemNoLock
+// -------------------
+//    Adds a leaf with the specified Device Item.
+//    The name after the last delimiter is the leaf name and all other
+//    names are branch names. Empty branch names are ignored.
+//    m_Lock must be locked for writing outside.
+//=========================================================================
+HRESULT DaAddressSpaceTrie::AddDeviceItemNoLock( LPCWSTR szSASName, DaDeviceItem* pDItem )
+{
+	HRESULT  hres;
+	Node*    pBranch = &m_Root;
+	LPCWSTR  pszLeaf = wcsrchr( szSASName, DaBranch::GetDelimiter() );
+
+	if (pszLeaf) {                               // There is at least one branch
+		hres = GetBranchNoLock( &m_Root, szSASName, pszLeaf, TRUE, &pBranch );
+		if (FAILED( hres )) return hres;
+		pszLeaf++;
+	}
+	else {
+		pszLeaf = szSASName;                      // There are no branches specified
+	}
+	if (*pszLeaf == L'\0') return E_INVALIDARG;  // Invalid SASName format
+
+	DWORD dwNameLen = (DWORD)wcslen( pszLeaf );
+	if (FindChildNoLock( pBranch, pszLeaf, dwNameLen, TRUE )) {
+		return E_INVALIDARG;                      // The leaf already exist at this level.
+	}
+	Node* pLeaf;
+	return AddChildNoLock( pBranch, pszLeaf, dwNameLen, pDItem, &pLeaf );
+}
+
+
+
+//=========================================================================
+// GetBranchNoLock
+// ---------------
+//    Returns the branch specified by the branch names between pszPath
+//    and pszPathEnd relative to pStart. Empty branch names are ignored.
+//    If fCreate is set then not existing branches are created.
+//    m_Lock must be locked outside; for writing if fCreate is set.
+//
+// Return:
+//    S_OK                       All succeeded
+//    E_INVALIDARG               A branch does not exist
+//    E_xxx                      An error occured.
+//=========================================================================
+HRESULT DaAddressSpaceTrie::GetBranchNoLock( Node* pStart, LPCWSTR pszPath, LPCWSTR pszPathEnd,
+											 BOOL fCreate, Node** ppBranch )
+{
+	WCHAR    wcDelimiter = DaBranch::GetDelimiter();
+	Node*    pBranch = pStart;
+	LPCWSTR  pszName = pszPath;
+
+	*ppBranch = NULL;
+	while (pszName < pszPathEnd) {
+		LPCWSTR pszNameEnd = pszName;
+		while (pszNameEnd < pszPathEnd && *pszNameEnd != wcDelimiter) {
+			pszNameEnd++;
+		}
+		DWORD dwNameLen = (DWORD)(pszNameEnd - pszName);
+		if (dwNameLen) {
+			Node* pNext = FindChildNoLock( pBranch, pszName, dwNameLen, FALSE );
+			if (pNext == NULL) {
+				if (!fCreate) return E_INVALIDARG;
+				HRESULT hres = AddChildNoLock( pBranch, pszName, dwNameLen, NULL, &pNext );
+				if (FAILED( hres )) return hres;
+			}
+			pBranch = pNext;
+		}
+		pszName = pszNameEnd + 1;
+	}
+	*ppBranch = pBranch;
+	return S_OK;
+}
+
+
+
+//=========================================================================
+// FindLeafNoLock
+// --------------
+//    Returns the leaf whose Device Item has the specified fully
+//    qualified ItemId or NULL if there is no such leaf.
+//    The leaf is searched with the path of the ItemId.
+//    m_Lock must be locked outside.
+//=========================================================================
+DaAddressSpaceTrie::Node* DaAddressSpaceTrie::FindLeafNoLock( LPCWSTR szItemID )
+{
+	Node*    pBranch = &m_Root;
+	LPCWSTR  pszLeaf = wcsrchr( szItemID, DaBranch::GetDelimiter() );
+
+	if (pszLeaf) {
+		if (FAILED( GetBranchNoLock( &m_Root, szItemID, pszLeaf, FALSE, &pBranch ) )) {
+			return NULL;
+		}
+		pszLeaf++;
+	}
+	else {
+		pszLeaf = szItemID;
+	}
+
+	Node* pLeaf = FindChildNoLock( pBranch, pszLeaf, (DWORD)wcslen( pszLeaf ), TRUE );
+	if (pLeaf) {
+		LPWSTR szID;
+		if (FAILED( pLeaf->pDItem->get_ItemIDPtr( &szID ) ) || wcscmp( szID, szItemID ) != 0) {
+			pLeaf = NULL;                          // Leaf of another ItemId
+		}
+	}
+	return pLeaf;
+}
+
+
+
+//=========================================================================
+// FindChildNoLock
+// ---------------
+//    Returns the branch or leaf with the specified name below pParent
+//    or NULL if there is no such member.
+//    m_Lock must be locked outside.
+//=========================================================================
+DaAddressSpaceTrie::Node* DaAddressSpaceTrie::FindChildNoLock( const Node* pParent, LPCWSTR pszName,
+															   DWORD dwNameLen, BOOL fLeaf )
+{
+	Key key;
+	key.pParent   = pParent;
+	key.pszName   = pszName;
+	key.dwNameLen = dwNameLen;
+	key.fLeaf     = fLeaf;
+
+	const CAtlMap<Key,Node*,KeyTraits>::CPair* pPair = m_mapIndex.Lookup( key );
+	return pPair ? pPair->m_value : NULL;
+}
+
+
+
+//=========================================================================
+// AddChildNoLock
+// --------------
+//    Adds a branch (pDItem is NULL) or a leaf below pParent.
+//    The caller must check that the member does not exist.
+//    m_Lock must be locked for writing outside.
+//=========================================================================
+HRESULT DaAddressSpaceTrie::AddChildNoLock( Node* pParent, LPCWSTR pszName, DWORD dwNameLen,
+											DaDeviceItem* pDItem, Node** ppChild )
+{
+	*ppChild = NULL;
+
+	Node* pNode = AllocNode();
+	if (pNode == NULL) return E_OUTOFMEMORY;
+
+	pNode->pszName = AllocName( pszName, dwNameLen );
+	if (pNode->pszName == NULL) {
+		pNode->pNextSibling = m_pFreeNodes;
+		m_pFreeNodes = pNode;
+		return E_OUTOFMEMORY;
+	}
+	pNode->dwNameLen = dwNameLen;
+	pNode->pParent   = pParent;
+	pNode->pDItem    = pDItem;
+
+	Key key;
+	key.pParent   = pParent;
+	key.pszName   = pNode->pszName;
+	key.dwNameLen = dwNameLen;
+	key.fLeaf     = pDItem ? TRUE : FALSE;
+	m_mapIndex.SetAt( key, pNode );
+
+	pNode->pNextSibling = pParent->pFirstChild;  // Link as first member
+	if (pParent->pFirstChild) {
+		pParent->pFirstChild->pPrevSibling = pNode;
+	}
+	pParent->pFirstChild = pNode;
+
+	if (pDItem) {
+		pParent->dwNumOfLeafs++;
+		m_dwNumOfLeafs++;
+	}
+	else {
+		pParent->dwNumOfBranches++;
+	}
+	*ppChild = pNode;
+	return S_OK;
+}
+
+
+
+//=========================================================================
+// RemoveNodeNoLock
+// ----------------
+//    Removes a leaf or an empty branch. The node is reused by the next
+//    AddChildNoLock(); the name is released with the arena.
+//    m_Lock must be locked for writing outside.
+//=========================================================================
+void DaAddressSpaceTrie::RemoveNodeNoLock( Node* pNode )
+{
+	_ASSERTE( pNode != &m_Root && pNode->pFirstChild == NULL );
+
+	Key key;
+	key.pParent   = pNode->pParent;
+	key.pszName   = pNode->pszName;
+	key.dwNameLen = pNode->dwNameLen;
+	key.fLeaf     = pNode->pDItem ? TRUE : FALSE;
+	m_mapIndex.RemoveKey( key );
+
+	Node* pParent = pNode->pParent;
+	if (pNode->pPrevSibling) {
+		pNode->pPrevSibling->pNextSibling = pNode->pNextSibling;
+	}
+	else {
+		pParent->pFirstChild = pNode->pNextSibling;
+	}
+	if (pNode->pNextSibling) {
+		pNode->pNextSibling->pPrevSibling = pNode->pPrevSibling;
+	}
+
+	if (pNode->pDItem) {
+		pParent->dwNumOfLeafs--;
+		m_dwNumOfLeafs--;
+	}
+	else {
+		pParent->dwNumOfBranches--;
+	}
+
+	memset( pNode, 0, sizeof (Node) );
+	pNode->pNextSibling = m_pFreeNodes;
+	m_pFreeNodes = pNode;
+}
+
+
+
+//=========================================================================
+// ChangePositionDownNoLock
+// ------------------------
+//    Returns the branch at the specified position relative to
+//    pPosition. The position can specifiy more than one branch level.
+//    A position without branch names returns the root.
+//    m_Lock must be locked outside.
+//=========================================================================
+HRESULT DaAddressSpaceTrie::ChangePositionDownNoLock( Node* pPosition, LPCWSTR szPosition, Node** ppNewPos )
+{
+	WCHAR szDelimiter[2] = { DaBranch::GetDelimiter(), L'\0' };
+
+	*ppNewPos = NULL;
+	if (szPosition == NULL || szPosition[ wcsspn( szPosition, szDelimiter ) ] == L'\0') {
+		*ppNewPos = &m_Root;                      // Move to the root if the string is empty
+		return S_OK;
+	}
+	return GetBranchNoLock( pPosition, szPosition, szPosition + wcslen( szPosition ), FALSE, ppNewPos );
+}
+
+
+
+//=========================================================================
+// GetFullyQualifiedNameNoLock
+// ---------------------------
+//    Returns the fully qualified name of a branch.
+//    m_Lock must be locked outside.
+//=========================================================================
+HRESULT DaAddressSpaceTrie::GetFullyQualifiedNameNoLock( const Node* pNode, BSTR* pszFullyQualifiedName )
+{
+	const Node* pTmp;
+	UINT        uLen = 0;
+
+	for (pTmp = pNode; pTmp != &m_Root; pTmp = pTmp->pParent) {
+		uLen += pTmp->dwNameLen;
+		if (pTmp->pParent != &m_Root) {
+			uLen++;                                // The delimiter character
+		}
+	}
+
+	*pszFullyQualifiedName = SysAllocStringLen( NULL, uLen );
+	if (*pszFullyQualifiedName == NULL) return E_OUTOFMEMORY;
+
+	WCHAR* pwc = *pszFullyQualifiedName + uLen;  // Build the name from the end
+	for (pTmp = pNode; pTmp != &m_Root; pTmp = pTmp->pParent) {
+		pwc -= pTmp->dwNameLen;
+		wmemcpy( pwc, pTmp->pszName, pTmp->dwNameLen );
+		if (pTmp->pParent != &m_Root) {
+			*(--pwc) = DaBranch::GetDelimiter();
+		}
+	}
+	return S_OK;
+}
+
+
+
+//=========================================================================
+// FilterLeaf
+// ----------
+//    Checks if the Device Item of the leaf passes the data type and
+//    access rights filters.
+//
+// Return:
+//    S_OK                       The leaf passes the filters
+//    S_FALSE                    The leaf does not pass the filters
+//    E_xxx                      An error occured.
+//=========================================================================
+HRESULT DaAddressSpaceTrie::FilterLeaf( Node* pLeaf, VARTYPE vtDataTypeFilter, DWORD dwAccessRightsFilter )
+{
+	DaDeviceItem& DItem = *pLeaf->pDItem;
+
+	if (dwAccessRightsFilter) {
+		DWORD dwAccessRights;
+		HRESULT hres = DItem.get_AccessRights( &dwAccessRights );
+		if (FAILED( hres )) return hres;
+		if ((dwAccessRightsFilter & dwAccessRights) == 0) {
+			return S_FALSE;
+		}
+	}
+	if ((vtDataTypeFilter != VT_EMPTY) &&
+		(vtDataTypeFilter != DItem.get_CanonicalDataType())) {
+		return S_FALSE;
+	}
+	return S_OK;
+}
+
+
+
+//=========================================================================
+// BrowseFlatNoLock
+// ----------------
+//    Adds the fully qualified names of all leafs at and below pPosition
+//    which matches the specified filters to arNames.
+//    m_Lock must be locked outside.
+//=========================================================================
+HRESULT DaAddressSpaceTrie::BrowseFlatNoLock( Node* pPosition, LPCWSTR szFilterCriteria, VARTYPE vtDataTypeFilter,
+											  DWORD dwAccessRightsFilter, CAtlArray<BSTR>& arNames )
+{
+	HRESULT hres;
+
+	for (Node* pNode = pPosition->pFirstChild; pNode; pNode = pNode->pNextSibling) {
+
+		if (pNode->pDItem == NULL) {             // Branch
+			hres = BrowseFlatNoLock( pNode, szFilterCriteria, vtDataTypeFilter, dwAccessRightsFilter, arNames );
+			if (FAILED( hres )) return hres;
+			continue;
+		}
+
+		hres = FilterLeaf( pNode, vtDataTypeFilter, dwAccessRightsFilter );
+		if (FAILED( hres )) return hres;
+		if (hres == S_OK) {
+			LPWSTR szID;
+			hres = pNode->pDItem->get_ItemIDPtr( &szID );
+			if (FAILED( hres )) return hres;
+			if (FilterName( szID, szFilterCriteria, FALSE )) {
+				BSTR szTmp = SysAllocString( szID );
+				if (szTmp == NULL) return E_OUTOFMEMORY;
+				arNames.Add( szTmp );
+			}
+		}
+	}
+	return S_OK;
+}
+
+
+
+//=========================================================================
+// KillDeviceItemsNoLock
+// ---------------------
+//    Kills the Device Items of all leafs at and below pPosition.
+//    m_Lock must be locked for writing outside.
+//=========================================================================
+void DaAddressSpaceTrie::KillDeviceItemsNoLock( Node* pPosition )
+{
+	for (Node* pNode = pPosition->pFirstChild; pNode; pNode = pNode->pNextSibling) {
+		if (pNode->pDItem) {
+			pNode->pDItem->Kill( TRUE );
+		}
+		else {
+			KillDeviceItemsNoLock( pNode );
+		}
+	}
+}
+
+
+
+//=========================================================================
+// AllocNode
+// ---------
+//    Returns a cleared node from the free list or the node arena.
+//=========================================================================
+DaAddressSpaceTrie::Node* DaAddressSpaceTrie::AllocNode()
+{
+	Node* pNode = m_pFreeNodes;
+	if (pNode) {
+		m_pFreeNodes = pNode->pNextSibling;
+	}
+	else {
+		if (m_pNodeBlock == NULL || m_dwNodesUsed == NODEBLOCK_SIZE) {
+			Node* pBlock = new Node[ NODEBLOCK_SIZE ];
+			if (pBlock == NULL) return NULL;
+			m_arNodeBlocks.Add( pBlock );
+			m_pNodeBlock  = pBlock;
+			m_dwNodesUsed = 0;
+		}
+		pNode = &m_pNodeBlock[ m_dwNodesUsed++ ];
+	}
+	memset( pNode, 0, sizeof (Node) );
+	return pNode;
+}
+
+
+
+//=========================================================================
+// AllocName
+// ---------
+//    Returns a terminated copy of the name in the name arena.
+//    Long names get their own block.
+//=========================================================================
+LPCWSTR DaAddressSpaceTrie::AllocName( LPCWSTR pszName, DWORD dwNameLen )
+{
+	WCHAR*   pszCopy;
+	DWORD    dwSize = dwNameLen + 1;
+
+	if (dwSize > NAMEBLOCK_SIZE / 16) {
+		pszCopy = new WCHAR[ dwSize ];
+		if (pszCopy == NULL) return NULL;
+		m_arNameBlocks.Add( pszCopy );
+	}
+	else {
+		if (m_pNameBlock == NULL || m_dwNameCharsUsed + dwSize > NAMEBLOCK_SIZE) {
+			WCHAR* pBlock = new WCHAR[ NAMEBLOCK_SIZE ];
+			if (pBlock == NULL) return NULL;
+			m_arNameBlocks.Add( pBlock );
+			m_pNameBlock      = pBlock;
+			m_dwNameCharsUsed = 0;
+		}
+		pszCopy = &m_pNameBlock[ m_dwNameCharsUsed ];
+		m_dwNameCharsUsed += dwSize;
+	}
+	wmemcpy( pszCopy, pszName, dwNameLen );
+	pszCopy[ dwNameLen ] = L'\0';
+	return pszCopy;
+}
+
+
+
+//=========================================================================
+// FreeArenas
+// ----------
+//    Releases all node and name blocks.
+//=========================================================================
+void DaAddressSpaceTrie::FreeArenas()
+{
+	size_t i;
+	for (i = 0; i < m_arNodeBlocks.GetCount(); i++) {
+		delete [] m_arNodeBlocks[i];
+	}
+	m_arNodeBlocks.RemoveAll();
+	for (i = 0; i < m_arNameBlocks.GetCount(); i++) {
+		delete [] m_arNameBlocks[i];
+	}
+	m_arNameBlocks.RemoveAll();
+
+	m_pNodeBlock      = NULL;
+	m_dwNodesUsed     = 0;
+	m_pFreeNodes      = NULL;
+	m_pNameBlock      = NULL;
+	m_dwNameCharsUsed = 0;
+}
+
+
+
+//=========================================================================
+// FilterName
+// ----------
+//    Filters a branch or leaf name with the specified filter.
+//    See DaBranch::FilterName().
+//=========================================================================
+BOOL DaAddressSpaceTrie::FilterName( LPCWSTR szName, LPCWSTR szFilterCriteria, BOOL fFilterBranch )
+{
+	if (szFilterCriteria && *szFilterCriteria) {
+		//
+		// TODO: Add server specific filtering if desired
+		//
+
+		// Call MatchPattern() to support default filtering
+		// specified by the DA specification.
+		return ::MatchPattern( szName, szFilterCriteria );
+	}
+	return TRUE;                                 // No filter is specified
+}
+
+
+
+//=========================================================================
+// CopyNames
+// ---------
+//    Returns the collected names in an array allocated with the 'new'
+//    operator. The names are released if the array cannot be allocated.
+//
+// Return:
+//    S_OK                       All succeeded
+//    S_FALSE                    There are no names. ppszNames is NULL !
+//    E_OUTOFMEMORY              Not enough memory. ppszNames is NULL !
+//=========================================================================
+HRESULT DaAddressSpaceTrie::CopyNames( CAtlArray<BSTR>& arNames, LPDWORD pdwNumOfNames, BSTR** ppszNames )
+{
+	DWORD dwCount = (DWORD)arNames.GetCount();
+
+	*pdwNumOfNames = 0;
+	*ppszNames = NULL;
+	if (dwCount == 0) {
+		return S_FALSE;
+	}
+
+	*ppszNames = new BSTR [ dwCount ];
+	if (*ppszNames == NULL) {
+		while (dwCount--) {
+			SysFreeString( arNames[ dwCount ] );
+		}
+		return E_OUTOFMEMORY;
+	}
+	memcpy( *ppszNames, arNames.GetData(), dwCount * sizeof (BSTR) );
+	*pdwNumOfNames = dwCount;
+	return S_OK;
+}
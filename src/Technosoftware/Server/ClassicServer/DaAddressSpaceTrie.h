@@ -0,0 +1,170 @@
+/*
+ * Copyright (c) 2020 Technosoftware GmbH. All rights reserved
+ * Web: https://technosoftware.com
+ *
+ * The source code in this file is covered under a dual-license scenario:
+ *   - Owner of a purchased license: SCLA 1.0
+ *   - GPL V3: everybody else
+ *
+ * SCLA license terms accompanied with this source code.
+ * See https://technosoftware.com/license/Source_Code_License_Agreement.pdf
+ *
+ * GNU General Public License as published by the Free Software Foundation;
+ * version 3 of the License are accompanied with this source code.
+ * See https://technosoftware.com/license/GPLv3License.txt
+ *
+ * This source code is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+#ifndef __DAADDRESSSPACETRIE_H
+#define __DAADDRESSSPACETRIE_H
+
+#if _MSC_VER >= 1000
+#pragma once
+#endif // _MSC_VER >= 1000
+
+#include "ReadWriteLock.h"
+#include <atlcoll.h>
+
+
+class DaDeviceItem;
+
+//-----------------------------------------------------------------------------
+// CLASS DaAddressSpaceTrie
+//-----------------------------------------------------------------------------
+// Compact representation of the hierarchical Server Address Space for
+// servers with a very large number of items.
+//
+// The ItemIds are split at the delimiter character of DaBranch into
+// segments. Each segment is a node of a trie; branches and leaves are
+// nodes with and without a Device Item. The nodes and their names are
+// allocated in blocks (arenas) and all nodes share one hash index of
+// (parent, segment) and one reader/writer lock. Compared with DaBranch
+// and DaLeaf no node owns maps or critical sections.
+//
+// The browse, filter and lookup functions have the same contract as the
+// functions of DaBranch with the same names. The browse position is
+// the branch node returned by Root() or ChangeBrowsePosition().
+class DaAddressSpaceTrie
+{
+// Construction / Destruction
+public:
+   DaAddressSpaceTrie();
+   HRESULT Create();
+   ~DaAddressSpaceTrie();
+
+// Attributes
+public:
+   // A branch or leaf. Branch nodes are used as browse position.
+   struct Node
+   {
+      Node*          pParent;
+      Node*          pFirstChild;               // Branches and leaves of a branch
+      Node*          pNextSibling;              // Also links the free nodes
+      Node*          pPrevSibling;
+      LPCWSTR        pszName;                   // Segment name, stored in the name arena
+      DWORD          dwNameLen;
+      DWORD          dwNumOfBranches;
+      DWORD          dwNumOfLeafs;
+      DaDeviceItem*  pDItem;                    // NULL for branches
+   };
+
+   inline Node*   Root()                        { return &m_Root; }
+   inline DWORD   NumOfLeafs() const            { return m_dwNumOfLeafs; }
+
+// Operations
+public:
+   HRESULT  AddDeviceItem( LPCWSTR szSASName, DaDeviceItem* pDItem );
+   HRESULT  AddDeviceItems( DWORD dwCount, DaDeviceItem** ppDItems, HRESULT* pErrors );
+   HRESULT  FindDeviceItem( LPCWSTR szItemID, DaDeviceItem** ppDItem );
+
+   HRESULT  ChangeBrowsePosition( Node* pPosition, OPCBROWSEDIRECTION dwBrowseDirection,
+                                  LPCWSTR szPosition, Node** ppNewPos );
+   HRESULT  BrowseBranches( Node* pPosition, LPCWSTR szFilterCriteria,
+                            LPDWORD pdwNumOfBranches, BSTR** ppszBranches );
+
+   HRESULT  BrowseLeafs( Node* pPosition, LPCWSTR szFilterCriteria, VARTYPE vtDataTypeFilter,
+                         DWORD dwAccessRightsFilter, LPDWORD pdwNumOfLeafs, BSTR** ppszLeafs );
+
+   HRESULT  BrowseFlat( Node* pPosition, LPCWSTR szFilterCriteria, VARTYPE vtDataTypeFilter,
+                        DWORD dwAccessRightsFilter, LPDWORD pdwNumOfLeafs, BSTR** ppszLeafs );
+
+   HRESULT  GetFullyQualifiedName( Node* pPosition, LPCWSTR szName, BSTR* pszFullyQualifiedName );
+   void     RemoveAll( BOOL fKillDeviceItems = FALSE );
+   HRESULT  RemoveDeviceItemAssociatedLeaf( LPCWSTR szItemID, BOOL fKillDeviceItem = FALSE );
+
+// Implementation
+protected:
+   // Key of the hash index. The name needs not to be terminated.
+   struct Key
+   {
+      const Node*    pParent;
+      LPCWSTR        pszName;
+      DWORD          dwNameLen;
+      BOOL           fLeaf;
+   };
+
+   class KeyTraits : public CElementTraitsBase< Key >
+   {
+   public:
+      static ULONG Hash( const Key& key )
+         {
+            ULONG nHash = (ULONG)((ULONG_PTR)key.pParent >> 4) ^ (key.fLeaf ? 0x9E3779B9 : 0);
+            for (DWORD i = 0; i < key.dwNameLen; i++) {
+               nHash = (nHash<<5)+nHash+key.pszName[i];
+            }
+            return nHash;
+         }
+
+      static bool CompareElements( const Key& key1, const Key& key2 ) throw()
+         {
+            return key1.pParent   == key2.pParent &&
+                   key1.fLeaf     == key2.fLeaf &&
+                   key1.dwNameLen == key2.dwNameLen &&
+                   wmemcmp( key1.pszName, key2.pszName, key1.dwNameLen ) == 0;
+         }
+   };
+
+   HRESULT  AddDeviceItemNoLock( LPCWSTR szSASName, DaDeviceItem* pDItem );
+   HRESULT  GetBranchNoLock( Node* pStart, LPCWSTR pszPath, LPCWSTR pszPathEnd,
+                             BOOL fCreate, Node** ppBranch );
+   Node*    FindLeafNoLock( LPCWSTR szItemID );
+   Node*    FindChildNoLock( const Node* pParent, LPCWSTR pszName, DWORD dwNameLen, BOOL fLeaf );
+   HRESULT  AddChildNoLock( Node* pParent, LPCWSTR pszName, DWORD dwNameLen,
+                            DaDeviceItem* pDItem, Node** ppChild );
+   void     RemoveNodeNoLock( Node* pNode );
+   HRESULT  ChangePositionDownNoLock( Node* pPosition, LPCWSTR szPosition, Node** ppNewPos );
+   HRESULT  GetFullyQualifiedNameNoLock( const Node* pNode, BSTR* pszFullyQualifiedName );
+   HRESULT  FilterLeaf( Node* pLeaf, VARTYPE vtDataTypeFilter, DWORD dwAccessRightsFilter );
+   HRESULT  BrowseFlatNoLock( Node* pPosition, LPCWSTR szFilterCriteria, VARTYPE vtDataTypeFilter,
+                              DWORD dwAccessRightsFilter, CAtlArray<BSTR>& arNames );
+   void     KillDeviceItemsNoLock( Node* pPosition );
+
+   Node*    AllocNode();
+   LPCWSTR  AllocName( LPCWSTR pszName, DWORD dwNameLen );
+   void     FreeArenas();
+
+   BOOL     FilterName( LPCWSTR szName, LPCWSTR szFilterCriteria, BOOL fFilterBranch );
+   HRESULT  CopyNames( CAtlArray<BSTR>& arNames, LPDWORD pdwNumOfNames, BSTR** ppszNames );
+
+   Node                    m_Root;              // Never part of the node arena
+   CAtlMap<Key,Node*,KeyTraits>  m_mapIndex;    // (parent, segment) -> node
+
+   CAtlArray<Node*>        m_arNodeBlocks;      // Node arena
+   Node*                   m_pNodeBlock;        // Block used for new nodes
+   DWORD                   m_dwNodesUsed;       // Nodes used in m_pNodeBlock
+   Node*                   m_pFreeNodes;        // Removed nodes for reuse
+
+   CAtlArray<WCHAR*>       m_arNameBlocks;      // Name arena
+   WCHAR*                  m_pNameBlock;        // Block used for new names
+   DWORD                   m_dwNameCharsUsed;   // Characters used in m_pNameBlock
+
+   DWORD                   m_dwNumOfLeafs;
+
+      // One lock for all nodes
+   ReadWriteLock           m_Lock;
+};
+
+#endif // __DAADDRESSSPACETRIE_H
@@ -42,6 +42,10 @@ extern bool 	 gUseOnAddItem;
 extern bool 	 gUseOnRemoveItem;
 extern WCHAR* 	 gVendorName;
 
+// Max. number of names kept in the browse cache if the
+// branches are supplied on demand by OnBrowseChildren().
+#define BROWSE_CACHE_MAX_NAMES   500000
+
 //-----------------------------------------------------------------------------
 // CODE
 //-----------------------------------------------------------------------------
@@ -95,6 +99,25 @@ DaServer::DaServer()
 	m_hUpdateThread = NULL;
 	m_dwServerState = OPC_STATUS_FAILED;
 	m_dwBandWith = 0xFFFFFFFF;
+	m_pSASTrie = NULL;
+	m_pBrowseCache = NULL;
+}
+
+
+//=============================================================================
+// Selects the compact Server Address Space
+// ----------------------------------------
+//    The Server Address Space is stored in a DaAddressSpaceTrie instead
+//    of DaBranch and DaLeaf objects. Recommended for servers with a very
+//    large number of items. Must be called before Create().
+//=============================================================================
+HRESULT DaServer::UseCompactAddressSpace()
+{
+	if (m_fCreated || m_pSASTrie) {
+		return E_FAIL;
+	}
+	m_pSASTrie = new DaAddressSpaceTrie;
+	return m_pSASTrie ? S_OK : E_OUTOFMEMORY;
 }
 
 
@@ -123,6 +146,16 @@ HRESULT DaServer::Create(DWORD   dwUpdateRate,
 			dwUpdateRate))              // Device Update rate in ms
 
 			CHECK_RESULT(m_SASRoot.CreateAsRoot())	   // Initialize hierarchical SAS
+			if (m_pSASTrie) {
+				CHECK_RESULT(m_pSASTrie->Create())	   // Initialize compact SAS
+			}
+#ifdef _OPC_DLL
+			if (pOnBrowseChildren != NULL && gdwBrowseMode == 0) {
+				m_pBrowseCache = new DaBrowseCache;      // Branches supplied on demand
+				CHECK_PTR(m_pBrowseCache)
+				CHECK_RESULT(m_pBrowseCache->Create(LoadBrowseChildren, BROWSE_CACHE_MAX_NAMES))
+			}
+#endif
 			// Define the callbacks used by this server
 #ifdef _OPC_NET
 			LOGFMTT("OnDefineCallbacks() called...");
@@ -134,11 +167,17 @@ HRESULT DaServer::Create(DWORD   dwUpdateRate,
 
 #ifdef _OPC_DLL
 			CHECK_RESULT(pOnDefineDaCallbacks(IClassicBaseNodeManager::AddItem, IClassicBaseNodeManager::RemoveItem, IClassicBaseNodeManager::AddProperty, IClassicBaseNodeManager::SetItemValue, IClassicBaseNodeManager::SetServerState, IClassicBaseNodeManager::GetActiveItems, IClassicBaseNodeManager::FireShutdownRequest, IClassicBaseNodeManager::GetClients, IClassicBaseNodeManager::GetGroups, IClassicBaseNodeManager::GetGroupState, IClassicBaseNodeManager::GetItemStates))
+			if (pOnDefineDaBulkCallbacks != NULL) {
+				CHECK_RESULT(pOnDefineDaBulkCallbacks(IClassicBaseNodeManager::AddItems))
+			}
 			// Create the Items supported by this server
 #ifdef   _OPC_SRV_AE                            // Alarms & Events Server
 			CHECK_RESULT(pOnDefineAeCallbacks(IClassicBaseNodeManager::AddSimpleEventCategory, IClassicBaseNodeManager::AddTrackingEventCategory, IClassicBaseNodeManager::AddConditionEventCategory, IClassicBaseNodeManager::AddEventAttribute,
 				IClassicBaseNodeManager::AddSingleStateConditionDefinition, IClassicBaseNodeManager::AddMultiStateConditionDefinition, IClassicBaseNodeManager::AddSubConditionDefinition, IClassicBaseNodeManager::AddArea, IClassicBaseNodeManager::AddSource, IClassicBaseNodeManager::AddExistingSource,
 				IClassicBaseNodeManager::AddCondition, IClassicBaseNodeManager::ProcessSimpleEvent, IClassicBaseNodeManager::ProcessTrackingEvent, IClassicBaseNodeManager::ProcessConditionStateChanges, IClassicBaseNodeManager::AckCondition))
+			if (pOnDefineAeBulkCallbacks != NULL) {
+				CHECK_RESULT(pOnDefineAeBulkCallbacks(IClassicBaseNodeManager::ProcessEvents))
+			}
 #endif
 			// Create the Items supported by this server
 			LOGFMTT("OnCreateServerItems() called...");
@@ -173,6 +212,14 @@ DaServer::~DaServer()
 	m_dwServerState = OPC_STATUS_SUSPENDED;
 	KillUpdateThread();
 	DeleteServerItems();
+	if (m_pSASTrie) {
+		delete m_pSASTrie;
+		m_pSASTrie = NULL;
+	}
+	if (m_pBrowseCache) {
+		delete m_pBrowseCache;
+		m_pBrowseCache = NULL;
+	}
 }
 
 
@@ -256,7 +303,12 @@ HRESULT DaServer::OnCreateCustomServerData(LPVOID* customData)
 	}
 #endif
 	if (hres == S_OK) {
-		*customData = SASRoot();
+		if (m_pSASTrie) {
+			*customData = m_pSASTrie->Root();
+		}
+		else {
+			*customData = SASRoot();
+		}
 	}
 
 	LOGFMTT("OnClientConnect() finished with hres = 0x%x.", hres);
@@ -922,7 +974,30 @@ HRESULT DaServer::OnBrowseChangeAddressSpacePosition(
 {
 	HRESULT hres;
 
-	if (gdwBrowseMode == 0)
+	if (gdwBrowseMode == 0 && m_pBrowseCache)
+	{
+		BSTR bstrNewPos;
+
+		hres = m_pBrowseCache->ChangeBrowsePosition(*szActualPosition, dwBrowseDirection, szString, &bstrNewPos);
+		if (SUCCEEDED(hres)) {
+			*szActualPosition = bstrNewPos;
+		}
+	}
+	else if (gdwBrowseMode == 0 && m_pSASTrie)
+	{
+		DaAddressSpaceTrie::Node* pCurrentPos = static_cast<DaAddressSpaceTrie::Node*>(*customData);
+		_ASSERTE(pCurrentPos);
+		DaAddressSpaceTrie::Node* pNewPos;
+
+		hres = m_pSASTrie->ChangeBrowsePosition(pCurrentPos, dwBrowseDirection, szString, &pNewPos);
+		if (SUCCEEDED(hres)) {
+			hres = m_pSASTrie->GetFullyQualifiedName(pNewPos, L"", szActualPosition);
+			if (SUCCEEDED(hres)) {
+				*customData = pNewPos;
+			}
+		}
+	}
+	else if (gdwBrowseMode == 0)
 	{
 		DaBranch* pCurrentPos = static_cast<DaBranch*>(*customData);
 		_ASSERTE(pCurrentPos);
@@ -976,7 +1051,29 @@ HRESULT DaServer::OnBrowseGetFullItemIdentifier(
 	/*[in,out]     */          LPVOID            * customData)
 {
 	HRESULT hres;
-	if (gdwBrowseMode == 0)
+	if (gdwBrowseMode == 0 && m_pBrowseCache)
+	{
+		hres = m_pBrowseCache->GetFullyQualifiedName(szActualPosition, szItemDataID, szItemID);
+		if (hres == E_INVALIDARG) {
+			// Not browsed but may be a registered item
+			DaDeviceItem* pDItem;
+			if (SUCCEEDED(FindDeviceItem(szItemDataID, &pDItem))) {
+				pDItem->Detach();
+				*szItemID = SysAllocString(szItemDataID);
+				hres = *szItemID ? S_OK : E_OUTOFMEMORY;
+			}
+		}
+	}
+	else if (gdwBrowseMode == 0 && m_pSASTrie)
+	{
+		DaAddressSpaceTrie::Node* pCurrentPos = static_cast<DaAddressSpaceTrie::Node*>(*customData);
+		_ASSERTE(pCurrentPos);
+
+		m_ItemListLock.BeginReading();               // protect item list access
+		hres = m_pSASTrie->GetFullyQualifiedName(pCurrentPos, szItemDataID, szItemID);
+		m_ItemListLock.EndReading();                 // release item list protection
+	}
+	else if (gdwBrowseMode == 0)
 	{
 		DaBranch* pCurrentPos = static_cast<DaBranch*>(*customData);
 		_ASSERTE(pCurrentPos);
@@ -1042,7 +1139,86 @@ HRESULT DaServer::OnBrowseItemIdentifiers(
 	/*[in,out]     */          LPVOID            * customData)
 {
 	HRESULT hres;
-	if (gdwBrowseMode == 0)
+	if (gdwBrowseMode == 0 && m_pBrowseCache)
+	{
+		if (dwAccessRightsFilter == 0) {             // 0 indicates no filtering
+			dwAccessRightsFilter = OPC_READABLE | OPC_WRITEABLE;
+		}
+
+		hres = E_INVALIDARG;
+		switch (dwBrowseFilterType) {
+
+		case OPC_BRANCH:
+			hres = m_pBrowseCache->BrowseBranches(szActualPosition, szFilterCriteria, pNrItemIds, ppItemIds);
+			break;
+
+		case OPC_LEAF:
+			hres = m_pBrowseCache->BrowseLeafs(szActualPosition, szFilterCriteria, vtDataTypeFilter,
+				dwAccessRightsFilter,
+				pNrItemIds, ppItemIds);
+			break;
+
+		case OPC_FLAT:
+			// The plugin namespace is not loaded completely. Only the
+			// registered items below the position are returned.
+			*pNrItemIds = 0;
+			*ppItemIds = NULL;
+			hres = S_FALSE;
+			m_ItemListLock.BeginReading();         // protect item list access
+			if (m_pSASTrie) {
+				DaAddressSpaceTrie::Node* pPos;
+				if (SUCCEEDED(m_pSASTrie->ChangeBrowsePosition(m_pSASTrie->Root(), OPC_BROWSE_TO,
+					szActualPosition ? szActualPosition : L"", &pPos))) {
+					hres = m_pSASTrie->BrowseFlat(pPos, szFilterCriteria, vtDataTypeFilter,
+						dwAccessRightsFilter,
+						pNrItemIds, ppItemIds);
+				}
+			}
+			else {
+				DaBranch* pPos;
+				if (SUCCEEDED(m_SASRoot.ChangeBrowsePosition(OPC_BROWSE_TO,
+					szActualPosition ? szActualPosition : L"", &pPos))) {
+					hres = pPos->BrowseFlat(szFilterCriteria, vtDataTypeFilter,
+						dwAccessRightsFilter,
+						pNrItemIds, ppItemIds);
+				}
+			}
+			m_ItemListLock.EndReading();           // release item list protection
+			break;
+		}
+	}
+	else if (gdwBrowseMode == 0 && m_pSASTrie)
+	{
+		DaAddressSpaceTrie::Node* pCurrentPos = static_cast<DaAddressSpaceTrie::Node*>(*customData);
+		_ASSERTE(pCurrentPos);
+
+		if (dwAccessRightsFilter == 0) {             // 0 indicates no filtering
+			dwAccessRightsFilter = OPC_READABLE | OPC_WRITEABLE;
+		}
+
+		hres = E_INVALIDARG;
+		switch (dwBrowseFilterType) {
+
+		case OPC_BRANCH:
+			hres = m_pSASTrie->BrowseBranches(pCurrentPos, szFilterCriteria, pNrItemIds, ppItemIds);
+			break;
+
+		case OPC_LEAF:
+			hres = m_pSASTrie->BrowseLeafs(pCurrentPos, szFilterCriteria, vtDataTypeFilter,
+				dwAccessRightsFilter,
+				pNrItemIds, ppItemIds);
+			break;
+
+		case OPC_FLAT:
+			m_ItemListLock.BeginReading();         // protect item list access
+			hres = m_pSASTrie->BrowseFlat(pCurrentPos, szFilterCriteria, vtDataTypeFilter,
+				dwAccessRightsFilter,
+				pNrItemIds, ppItemIds);
+			m_ItemListLock.EndReading();           // release item list protection
+			break;
+		}
+	}
+	else if (gdwBrowseMode == 0)
 	{
 
 		DaBranch* pCurrentPos = static_cast<DaBranch*>(*customData);
@@ -1418,6 +1594,22 @@ HRESULT DaServer::OnReleasePropertyCookie(
 }
 
 
+//=============================================================================
+// Get Property Device Item
+// ------------------------
+//    Returns the Device Item of the 'cookie' parameter. Required if the
+//    static property values are cached (see SetItemPropertyCaching()).
+//
+// SampleServer:
+//    OnQueryItemProperties() stores the Device Item in the 'cookie'.
+//=============================================================================
+DaDeviceItem* DaServer::OnGetPropertyDeviceItem(
+	/*[in]         */          LPVOID         pCookie)
+{
+	return static_cast<DaDeviceItem*>(pCookie);
+}
+
+
 //-----------------------------------------------------------------------------
 // DaServer Specific Functions
 //-----------------------------------------------------------------------------
@@ -1437,7 +1629,14 @@ HRESULT DaServer::DeleteServerItems()
 {
 	m_ItemListLock.BeginWriting();               // protect item list access
 	// we modify the item list
+	ClearItemIDCache();                          // Releases the cached Device Items
 	m_SASRoot.RemoveAll();
+	if (m_pSASTrie) {
+		m_pSASTrie->RemoveAll();
+	}
+	if (m_pBrowseCache) {
+		m_pBrowseCache->RemoveAll();
+	}
 	m_arServerItems.RemoveAll();
 
 	m_ItemListLock.EndWriting();                 // release item list protection
@@ -1459,7 +1658,12 @@ HRESULT DaServer::AddDeviceItem(DeviceItem* pDItem)
 		LPWSTR pwszItemID;
 		hres = pDItem->get_ItemIDPtr(&pwszItemID);
 		if (SUCCEEDED(hres)) {
-			hres = m_SASRoot.AddDeviceItem(pwszItemID, pDItem);
+			if (m_pSASTrie) {
+				hres = m_pSASTrie->AddDeviceItem(pwszItemID, pDItem);
+			}
+			else {
+				hres = m_SASRoot.AddDeviceItem(pwszItemID, pDItem);
+			}
 		}
 		if (FAILED(hres)) {
 			m_arServerItems.Remove(pDItem);
@@ -1467,6 +1671,89 @@ HRESULT DaServer::AddDeviceItem(DeviceItem* pDItem)
 	}
 
 	m_ItemListLock.EndWriting();                 // release item list protection
+
+	if (SUCCEEDED(hres)) {
+		DaDeviceItem* pItem = pDItem;
+		RestoreCachedValues(1, &pItem);          // Last known value from the cache snapshot
+	}
+	return hres;
+}
+
+//=============================================================================
+// Adds several Device Items to the Server Address Space               INTERNAL
+// The branches and leaves are built without locking the item list.
+// The item list is locked only to move the built branches into the
+// Server Address Space and to add the items to the server item list.
+// Items with errors are not added and must be deleted by the caller.
+// The compact Server Address Space is not built in advance. The leaves
+// are added with one lock of the trie.
+//=============================================================================
+HRESULT DaServer::AddDeviceItems(DWORD dwCount, DeviceItem** ppDItems, HRESULT* errors)
+{
+	HRESULT hres = S_OK;
+	DWORD i;
+
+	DaDeviceItem** ppItems = new DaDeviceItem*[dwCount];
+	if (ppItems == NULL) return E_OUTOFMEMORY;
+	for (i = 0; i < dwCount; i++) {
+		ppItems[i] = ppDItems[i];
+	}
+
+	DaAddressSpaceBuilder builder;
+	if (m_pSASTrie == NULL) {
+		hres = builder.Build(dwCount, ppItems, errors);
+		if (FAILED(hres)) {
+			delete[] ppItems;
+			return hres;
+		}
+	}
+
+	CAtlArray<DaDeviceItem*> arRejected;
+	m_ItemListLock.BeginWriting();               // protect item list access
+	// we modify the item list
+	if (m_pSASTrie) {
+		m_pSASTrie->AddDeviceItems(dwCount, ppItems, errors);
+	}
+	else {
+		builder.Publish(&m_SASRoot, arRejected);
+	}
+
+	if (arRejected.GetCount()) {                 // ItemIds which already exist
+		CAtlMap<DaDeviceItem*, DWORD> mapIndex;
+		for (i = 0; i < dwCount; i++) {
+			mapIndex.SetAt(ppItems[i], i);
+		}
+		for (size_t n = 0; n < arRejected.GetCount(); n++) {
+			if (mapIndex.Lookup(arRejected[n], i)) {
+				errors[i] = E_INVALIDARG;
+			}
+		}
+	}
+
+	for (i = 0; i < dwCount; i++) {
+		if (SUCCEEDED(errors[i])) {
+			if (!m_arServerItems.Add(ppDItems[i])) {
+				LPWSTR pwszItemID;
+				ppDItems[i]->get_ItemIDPtr(&pwszItemID);
+				if (m_pSASTrie) {
+					m_pSASTrie->RemoveDeviceItemAssociatedLeaf(pwszItemID);
+				}
+				else {
+					m_SASRoot.RemoveDeviceItemAssociatedLeaf(pwszItemID);
+				}
+				errors[i] = E_OUTOFMEMORY;
+			}
+		}
+		if (FAILED(errors[i])) {
+			hres = S_FALSE;
+			ppItems[i] = NULL;
+		}
+	}
+
+	m_ItemListLock.EndWriting();                 // release item list protection
+
+	RestoreCachedValues(dwCount, ppItems);       // Last known values from the cache snapshot
+	delete[] ppItems;
 	return hres;
 }
 
@@ -1481,9 +1768,15 @@ HRESULT DaServer::RemoveDeviceItem(DeviceItem* pDItem)
 	// we modify the item list
 	hres = pDItem->get_ItemIDPtr(&pwszItemID);
 	if (SUCCEEDED(hres)) {
-		hres = m_SASRoot.RemoveDeviceItemAssociatedLeaf(pwszItemID);
+		if (m_pSASTrie) {
+			hres = m_pSASTrie->RemoveDeviceItemAssociatedLeaf(pwszItemID);
+		}
+		else {
+			hres = m_SASRoot.RemoveDeviceItemAssociatedLeaf(pwszItemID);
+		}
 	}
 	if (SUCCEEDED(hres)) {
+		RemoveFromItemIDCache(pDItem);          // Release the reference of the cache
 		pDItem->Kill(false);
 		if (pDItem->get_RefCount() == 0) {
 			DeleteDeviceItem(pDItem);
@@ -1519,6 +1812,7 @@ void DaServer::DeleteDeviceItem(DeviceItem* pDItem)
 //=============================================================================
 HRESULT DaServer::FindDeviceItem(LPCWSTR szItemID, DaDeviceItem** ppDItem)
 {
+	HRESULT hres;
 	*ppDItem = NULL;
 
 	//
@@ -1545,7 +1839,13 @@ HRESULT DaServer::FindDeviceItem(LPCWSTR szItemID, DaDeviceItem** ppDItem)
 
 	m_ItemListLock.BeginReading();               // Protect item list access
 
-	if (SUCCEEDED(m_SASRoot.FindDeviceItem(szItemID, ppDItem))) {
+	if (m_pSASTrie) {
+		hres = m_pSASTrie->FindDeviceItem(szItemID, ppDItem);
+	}
+	else {
+		hres = m_SASRoot.FindDeviceItem(szItemID, ppDItem);
+	}
+	if (SUCCEEDED(hres)) {
 		(*ppDItem)->Attach();
 	}
 
@@ -1555,6 +1855,44 @@ HRESULT DaServer::FindDeviceItem(LPCWSTR szItemID, DaDeviceItem** ppDItem)
 }
 
 
+//=============================================================================
+// Returns the children of a branch for the browse cache               INTERNAL
+// -----------------------------------------------------
+//    Called by DaBrowseCache if a branch is browsed which is not cached.
+//    The arrays are allocated by the plugin with CoTaskMemAlloc() and
+//    released by DaBrowseCache.
+//=============================================================================
+HRESULT DaServer::LoadBrowseChildren(LPCWSTR szBranchID,
+	LPDWORD pdwNumOfBranches, LPWSTR** ppszBranches,
+	LPDWORD pdwNumOfLeafs, LPWSTR** ppszLeafs,
+	VARTYPE** ppvtLeafs, LPDWORD* ppdwLeafAccessRights)
+{
+	HRESULT hres = E_NOTIMPL;
+	int     noBranches = 0;
+	int     noLeafs = 0;
+	int*    pAccessRights = NULL;
+
+	*ppszBranches = NULL;
+	*ppszLeafs = NULL;
+	*ppvtLeafs = NULL;
+
+#ifdef _OPC_DLL
+	if (pOnBrowseChildren != NULL)
+	{
+		hres = (*pOnBrowseChildren)(szBranchID, &noBranches, ppszBranches, &noLeafs, ppszLeafs, ppvtLeafs, &pAccessRights);
+	}
+#endif
+
+	*pdwNumOfBranches = noBranches > 0 ? noBranches : 0;
+	*pdwNumOfLeafs = noLeafs > 0 ? noLeafs : 0;
+	*ppdwLeafAccessRights = (LPDWORD)pAccessRights;
+
+	USES_CONVERSION;
+	LOGFMTT("OnBrowseChildren( %s ) finished with hres = 0x%x.", W2A(szBranchID), hres);
+	return hres;
+}
+
+
 //=============================================================================
 // IMPLEMENTATION DaDeviceCache
 //=============================================================================
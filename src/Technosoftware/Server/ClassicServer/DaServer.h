@@ -27,6 +27,7 @@
 
 #include "DaBaseServer.h"
 #include "DaAddressSpace.h"
+#include "DaAddressSpaceTrie.h"
 
 
 //-----------------------------------------------------------------------------
@@ -100,6 +101,8 @@ HRESULT DLLCALL AddItem(
 	void** deviceItemHandle
 	);
 
+HRESULT DLLCALL AddItems(int numItems, DaItemDefinition* items, void** deviceItemHandles, HRESULT* errors);
+
 HRESULT DLLCALL RemoveItem(void* deviceItem);
 
 HRESULT DLLCALL AddProperty(int propertyID, LPWSTR description, LPVARIANT valueType);
@@ -145,6 +148,8 @@ HRESULT DLLCALL ProcessTrackingEvent(int categoryId, int sourceId, LPWSTR messag
 
 HRESULT DLLCALL ProcessConditionStateChanges(int count, AeConditionState* conditionStateChanges);
 
+HRESULT DLLCALL ProcessEvents(int count, AeEventDefinition* events, HRESULT* errors);
+
 HRESULT DLLCALL AckCondition(int conditionId, LPWSTR comment);
 
 void DLLCALL GetConnectedClients(int * numClientHandles, void* ** clientHandles, LPWSTR ** clientNames);
@@ -161,10 +166,13 @@ typedef DLLIMP ServerRegDefs * (DLLCALL * PFNONGETDASEERVERREGISTRYDEFINITION)(v
 typedef DLLIMP ServerRegDefs * (DLLCALL * PFNONGETAESEERVERREGISTRYDEFINITION)(void);
 typedef DLLIMP HRESULT(DLLCALL * PFNONGETDASERVERPARAMETERS) (int *, WCHAR *, int *);
 typedef DLLIMP HRESULT(DLLCALL * PFNONDEFINEDACALLBACKS) (AddItemPtr AddItem, RemoveItemPtr RemoveItem, AddPropertyPtr AddProperty, SetItemValuePtr SetItemValue, SetServerStatePtr SetServerState, GetActiveItemsPtr GetActiveItems, FireShutdownRequestPtr fireShutdownRequest, GetClientsPtr getClients, GetGroupsPtr getGroups, GetGroupStatePtr getGroupState, GetItemStatesPtr getItemStates);
+typedef DLLIMP HRESULT(DLLCALL * PFNONDEFINEDABULKCALLBACKS) (AddItemsPtr AddItems);
 typedef DLLIMP HRESULT(DLLCALL * PFNONCREATESERVERITEMS) ();
 typedef DLLIMP HRESULT(DLLCALL * PFNONCLIENTCONNECT) (void);
 typedef DLLIMP HRESULT(DLLCALL * PFNONCLIENTDISCONNECT) (void);
 typedef DLLIMP HRESULT(DLLCALL * PFNONREQUESTITEMS) (int numItems, LPWSTR *fullItemIds, VARTYPE *dataTypes);
+typedef DLLIMP HRESULT(DLLCALL * PFNONGETDAADDRESSSPACEPARAMETERS) (bool * useCompactAddressSpace);
+typedef DLLIMP HRESULT(DLLCALL * PFNONBROWSECHILDREN) (LPCWSTR branchId, int * noBranches, LPWSTR ** branchNames, int * noLeafs, LPWSTR ** leafNames, VARTYPE ** leafDataTypes, int ** leafAccessRights);
 typedef DLLIMP void (DLLCALL * PFNONSTARTUPSIGNAL) (char* pszParam);
 typedef DLLIMP void (DLLCALL * PFNONSHUTDOWNSIGNAL) (void);
 typedef DLLIMP HRESULT(DLLCALL * PFNONREFRESHITEMS) (int numItems, void *itemHandles);
@@ -185,6 +193,7 @@ typedef DLLIMP HRESULT(DLLCALL * PFNONDEFINEAECALLBACKS) (AddSimpleEventCategory
 	AddSubConditionDefinitionPtr addSubCondition, AddAreaPtr AddArea, AddSourcePtr AddSource, AddExistingSourcePtr AddExistingSource,
 	AddConditionPtr AddCondition, ProcessSimpleEventPtr ProcessSimpleEvent, ProcessTrackingEventPtr ProcessTrackingEvent,
 	ProcessConditionStateChangesPtr ProcessConditionStateChanges, AckConditionPtr AckCondition);
+typedef DLLIMP HRESULT(DLLCALL * PFNONDEFINEAEBULKCALLBACKS) (ProcessEventsPtr ProcessEvents);
 
 typedef DLLIMP HRESULT(DLLCALL * PFNONTRANSLATETOItemId) (int dwCondID, int dwSubCondDefID, int dwAttrID, LPWSTR* pszItemID, LPWSTR* pszNodeName, CLSID* pCLSID);
 typedef DLLIMP HRESULT(DLLCALL * PFNONACKNOTIFICATION) (int dwCondID, int dwSubCondDefID);
@@ -198,10 +207,13 @@ extern PFNONGETDASEERVERREGISTRYDEFINITION pOnGetDaServerDefinition;
 extern PFNONGETAESEERVERREGISTRYDEFINITION pOnGetAeServerDefinition;
 extern PFNONGETDASERVERPARAMETERS pOnGetDaServerParameters;
 extern PFNONDEFINEDACALLBACKS pOnDefineDaCallbacks;
+extern PFNONDEFINEDABULKCALLBACKS pOnDefineDaBulkCallbacks;
 extern PFNONCREATESERVERITEMS pOnCreateServerItems;
 extern PFNONCLIENTCONNECT pOnClientConnect;
 extern PFNONCLIENTDISCONNECT pOnClientDisconnect;
 extern PFNONREQUESTITEMS pOnRequestItems;
+extern PFNONBROWSECHILDREN pOnBrowseChildren;
+extern PFNONGETDAADDRESSSPACEPARAMETERS pOnGetDaAddressSpaceParameters;
 extern PFNONSTARTUPSIGNAL pOnStartupSignal;
 extern PFNONSHUTDOWNSIGNAL pOnShutdownSignal;
 extern PFNONREFRESHITEMS pOnRefreshItems;
@@ -217,6 +229,7 @@ extern PFNONADDITEM pOnAddItem;
 extern PFNONREMOVEITEM pOnRemoveItem;
 
 extern PFNONDEFINEAECALLBACKS pOnDefineAeCallbacks;
+extern PFNONDEFINEAEBULKCALLBACKS pOnDefineAeBulkCallbacks;
 extern PFNONTRANSLATETOItemId pOnTranslateToItemId;
 extern PFNONACKNOTIFICATION pOnAckNotification;
 extern PFNONGETLICENSEINFORMATION pOnGetLicenseInformation;
@@ -317,12 +330,15 @@ public:
 	inline void SetServerState(OPCSERVERSTATE serverState) { m_dwServerState = serverState; m_fServerStateChanged = TRUE; }
 	inline DWORD BandWidth() const { return m_dwBandWith; }
 	inline DaBranch* SASRoot() { return &m_SASRoot; }
+	inline DaAddressSpaceTrie* SASTrie() { return m_pSASTrie; }
 
 
 
 	// Operations
 public:
+	HRESULT UseCompactAddressSpace();
 	HRESULT AddDeviceItem(DeviceItem* pDItem);
+	HRESULT AddDeviceItems(DWORD dwCount, DeviceItem** ppDItems, HRESULT* errors);
 	HRESULT RemoveDeviceItem(DeviceItem* pDItem);
 	void DeleteDeviceItem(DeviceItem* pDItem);
 
@@ -475,6 +491,9 @@ protected:
 	HRESULT OnReleasePropertyCookie(
 		/*[in] */ LPVOID pCookie);
 
+	DaDeviceItem* OnGetPropertyDeviceItem(
+		/*[in] */ LPVOID pCookie);
+
 	//////////////////////////////////////////////////////////////
 	// Implementation internal functions (application specific) //
 	//////////////////////////////////////////////////////////////
@@ -483,6 +502,10 @@ protected:
 	HRESULT CreateUpdateThread();
 	HRESULT KillUpdateThread();
 	HRESULT FindDeviceItem(LPCWSTR szItemID, DaDeviceItem** ppDItem);
+	static HRESULT LoadBrowseChildren(LPCWSTR szBranchID,
+		LPDWORD pdwNumOfBranches, LPWSTR** ppszBranches,
+		LPDWORD pdwNumOfLeafs, LPWSTR** ppszLeafs,
+		VARTYPE** ppvtLeafs, LPDWORD* ppdwLeafAccessRights);
 
 
 	// Handle of the Refresh Thread
@@ -497,6 +520,12 @@ protected:
 	// Root of the hierarchical Server Address Space
 	DaBranch m_SASRoot;
 
+	// Compact Server Address Space used instead of m_SASRoot if not NULL
+	DaAddressSpaceTrie* m_pSASTrie;
+
+	// Branches supplied on demand by the plugin if not NULL
+	DaBrowseCache* m_pBrowseCache;
+
 	BOOL m_fCreated;
 };
 
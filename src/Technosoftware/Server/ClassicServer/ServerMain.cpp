@@ -87,6 +87,7 @@ bool 		gUseOnItemRequest = true;
 bool		gUseOnRefreshItems = true;
 bool 		gUseOnAddItem = false;
 bool 		gUseOnRemoveItem = false;
+bool		gUseCompactAddressSpace = false;
 LPWSTR	    gVendorName;
 
 
@@ -106,10 +107,13 @@ PFNONGETLOGPATH						   pOnGetLogPath;
 PFNONGETDASEERVERREGISTRYDEFINITION    pOnGetDaServerDefinition;
 PFNONGETDASERVERPARAMETERS             pOnGetDaServerParameters;
 PFNONDEFINEDACALLBACKS                 pOnDefineDaCallbacks;
+PFNONDEFINEDABULKCALLBACKS             pOnDefineDaBulkCallbacks;
 PFNONCREATESERVERITEMS                 pOnCreateServerItems;
 PFNONCLIENTCONNECT                     pOnClientConnect;
 PFNONCLIENTDISCONNECT                  pOnClientDisconnect;
 PFNONREQUESTITEMS                      pOnRequestItems;
+PFNONBROWSECHILDREN                    pOnBrowseChildren;
+PFNONGETDAADDRESSSPACEPARAMETERS       pOnGetDaAddressSpaceParameters;
 PFNONSTARTUPSIGNAL                     pOnStartupSignal;
 PFNONSHUTDOWNSIGNAL                    pOnShutdownSignal;
 PFNONREFRESHITEMS                      pOnRefreshItems;
@@ -126,6 +130,7 @@ PFNONREMOVEITEM						   pOnRemoveItem;
 
 #ifdef   _OPC_SRV_AE                            // Alarms & Events Server
 PFNONDEFINEAECALLBACKS                 pOnDefineAeCallbacks;
+PFNONDEFINEAEBULKCALLBACKS             pOnDefineAeBulkCallbacks;
 PFNONTRANSLATETOItemId                 pOnTranslateToItemId;
 PFNONACKNOTIFICATION                   pOnAckNotification;
 PFNONGETAESEERVERREGISTRYDEFINITION    pOnGetAeServerDefinition;
@@ -272,6 +277,11 @@ HRESULT LoadAppDLL( LPCTSTR DLLName, BOOL & fErrMsgDisplayed )
 		hres = TYPE_E_DLLFUNCTIONNOTFOUND ;
 	}
 
+	pOnDefineDaBulkCallbacks = (PFNONDEFINEDABULKCALLBACKS)GetProcAddress( gDLLHandle, "OnDefineDaBulkCallbacks" );
+	/*
+	* OnDefineDaBulkCallbacks is optional and can be missed
+	*/
+
 	pOnCreateServerItems = (PFNONCREATESERVERITEMS)GetProcAddress( gDLLHandle, "OnCreateServerItems" );
 	if (pOnCreateServerItems == NULL)
 	{
@@ -311,6 +321,16 @@ HRESULT LoadAppDLL( LPCTSTR DLLName, BOOL & fErrMsgDisplayed )
 	*/
 	//if (pOnRequestItems == NULL)        hres = TYPE_E_DLLFUNCTIONNOTFOUND ;
 
+	pOnBrowseChildren = (PFNONBROWSECHILDREN)GetProcAddress( gDLLHandle, "OnBrowseChildren" );
+	/*
+	* OnBrowseChildren is optional and can be missed
+	*/
+
+	pOnGetDaAddressSpaceParameters = (PFNONGETDAADDRESSSPACEPARAMETERS)GetProcAddress( gDLLHandle, "OnGetDaAddressSpaceParameters" );
+	/*
+	* OnGetDaAddressSpaceParameters is optional and can be missed
+	*/
+
 	pOnStartupSignal = (PFNONSTARTUPSIGNAL)GetProcAddress( gDLLHandle, "OnStartupSignal" );
 	if (pOnStartupSignal == NULL)
 	{
@@ -377,6 +397,11 @@ HRESULT LoadAppDLL( LPCTSTR DLLName, BOOL & fErrMsgDisplayed )
 	pOnDefineAeCallbacks = (PFNONDEFINEAECALLBACKS)GetProcAddress( gDLLHandle, "OnDefineAeCallbacks" );	
 	if (pOnDefineAeCallbacks == NULL)     hres = TYPE_E_DLLFUNCTIONNOTFOUND ;
 
+	pOnDefineAeBulkCallbacks = (PFNONDEFINEAEBULKCALLBACKS)GetProcAddress( gDLLHandle, "OnDefineAeBulkCallbacks" );
+	/*
+	* OnDefineAeBulkCallbacks is optional and can be missed
+	*/
+
 	pOnTranslateToItemId = (PFNONTRANSLATETOItemId)GetProcAddress( gDLLHandle, "OnTranslateToItemId" );	
 	if (pOnTranslateToItemId == NULL)     hres = TYPE_E_DLLFUNCTIONNOTFOUND ;
 
@@ -731,6 +756,21 @@ LPSERVERREGDEFS OnGetServerRegistryDefs()
 
 	LOGFMTT("OnGetDAOptimizationParameters() finished with hres = 0x%x.", hres);
 
+	// Get Server Address Space Parameters from DLL
+#ifdef _OPC_DLL
+	if (pOnGetDaAddressSpaceParameters != NULL) {
+		hres = (*pOnGetDaAddressSpaceParameters) ( &gUseCompactAddressSpace );
+
+		// Error handling
+		if (FAILED( hres )) {
+			LOGFMTE("OnGetDaAddressSpaceParameters() failed with hres = 0x%x.", hres);
+			exit(hres);							// Terminate the application if something goes wrong
+		}
+
+		LOGFMTT("OnGetDaAddressSpaceParameters() finished with hres = 0x%x.", hres);
+	}
+#endif
+
 	DaBranch::SetDelimiter(wDelimiter);
 	// Get DA Server Registry Defs from DLL
 #ifdef _OPC_NET
@@ -867,6 +907,15 @@ HRESULT OnInitializeServer()
 		hres = gpEventServer->Create();
 	}
 #endif
+	if (gUseCompactAddressSpace) {
+		hres = gpDataServer->UseCompactAddressSpace();
+		if (FAILED( hres )) {
+			LOGFMTE("UseCompactAddressSpace() failed with hres = 0x%x.", hres);
+		}
+		else {
+			LOGFMTI("Compact Server Address Space used.");
+		}
+	}
 	hres = gpDataServer->Create(
 		gdwUpdateCyclePeriod,					// Device Update rate in ms
 		gpszDLLParams,							// Parameter string for the Application-DLL
@@ -34,6 +34,34 @@ static CSimplePtrArray<WideString*> m_apPropDescr;
 
 namespace IClassicBaseNodeManager
 {
+	//=========================================================================
+	// CreateAnalogEUInfo
+	// ------------------
+	//    Creates the EU Info of an analog item. The EU Info contains exactly
+	//    two doubles corresponding to the LOW and HI EU range.
+	//=========================================================================
+	static HRESULT CreateAnalogEUInfo(double minValue, double maxValue, LPVARIANT pvEUInfo)
+	{
+		SAFEARRAYBOUND rgs;
+		rgs.cElements = 2;
+		rgs.lLbound = 0;
+
+		V_ARRAY(pvEUInfo) = SafeArrayCreate(VT_R8, 1, &rgs);
+		if (V_ARRAY(pvEUInfo) == NULL) return E_OUTOFMEMORY;
+		V_VT(pvEUInfo) = VT_ARRAY | VT_R8;
+
+		long lElIndex = 0;                             // LOW EU range
+		HRESULT hres = SafeArrayPutElement(V_ARRAY(pvEUInfo), &lElIndex, &minValue);
+		if (SUCCEEDED(hres)) {
+			lElIndex++;                                 // HI  EU range
+			hres = SafeArrayPutElement(V_ARRAY(pvEUInfo), &lElIndex, &maxValue);
+		}
+		if (FAILED(hres)) {
+			VariantClear(pvEUInfo);
+		}
+		return hres;
+	}
+
 	//=========================================================================
 	// AddItem
 	// -------
@@ -117,6 +145,105 @@ namespace IClassicBaseNodeManager
 		return hres;
 	}
 
+	//=========================================================================
+	// AddItems
+	// --------
+	//    Creates several items in the server data structure.
+	//    The items are created and the branches of the address space are
+	//    built before the item list of the server is locked.
+	//=========================================================================
+	HRESULT DLLCALL AddItems(int numItems, DaItemDefinition* items, void** deviceItemHandles, HRESULT* errors)
+	{
+		HRESULT hrRet = S_OK;
+		int i;
+
+		LOGFMTT("AddItems() called from plugin for %d items.", numItems);
+		if (numItems <= 0) return S_OK;
+		if (items == NULL) return E_INVALIDARG;
+
+		DeviceItem** ppItems = new DeviceItem*[numItems];
+		HRESULT* pErrors = new HRESULT[numItems];
+		int* pIndex = new int[numItems];
+		if (ppItems == NULL || pErrors == NULL || pIndex == NULL) {
+			if (ppItems) delete[] ppItems;
+			if (pErrors) delete[] pErrors;
+			if (pIndex) delete[] pIndex;
+			return E_OUTOFMEMORY;
+		}
+
+		// Create the items
+		DWORD dwNumCreated = 0;
+		for (i = 0; i < numItems; i++) {
+			HRESULT hres = S_OK;
+			OPCEUTYPE eEUType = static_cast<OPCEUTYPE>(items[i].EuType);
+			VARIANT varEUInfo;
+			VariantInit(&varEUInfo);
+
+			if (deviceItemHandles != NULL) {
+				deviceItemHandles[i] = NULL;
+			}
+			if (eEUType == OPC_ANALOG) {
+				hres = CreateAnalogEUInfo(items[i].MinValue, items[i].MaxValue, &varEUInfo);
+			}
+			else if (eEUType != OPC_NOENUM) {
+				hres = E_INVALIDARG;                     // Enumerated EU needs the strings
+			}
+
+			DeviceItem* pItem = NULL;
+			if (SUCCEEDED(hres)) {
+				pItem = new DeviceItem;                  // Allocate space for new server item.
+				hres = pItem ? S_OK : E_OUTOFMEMORY;
+			}
+			if (SUCCEEDED(hres)) {                     // Initialize new Item instance
+				hres = pItem->Create(items[i].ItemId, static_cast<DWORD>(items[i].AccessRights), &items[i].InitValue, items[i].Active,
+					0, NULL, NULL, eEUType, (eEUType == OPC_ANALOG) ? &varEUInfo : NULL);
+			}
+			VariantClear(&varEUInfo);
+			VariantClear(&items[i].InitValue);
+
+			if (SUCCEEDED(hres)) {
+				ppItems[dwNumCreated] = pItem;
+				pIndex[dwNumCreated++] = i;
+			}
+			else {
+				if (pItem) delete pItem;
+				if (errors != NULL) {
+					errors[i] = hres;
+				}
+				hrRet = S_FALSE;
+			}
+		}
+
+		// Add the items to the item list and the Server Address Space
+		if (dwNumCreated) {
+			HRESULT hres = gpDataServer->AddDeviceItems(dwNumCreated, ppItems, pErrors);
+			for (DWORD n = 0; n < dwNumCreated; n++) {
+				if (FAILED(hres)) {
+					pErrors[n] = hres;
+				}
+				i = pIndex[n];
+				if (errors != NULL) {
+					errors[i] = pErrors[n];
+				}
+				if (SUCCEEDED(pErrors[n])) {
+					if (deviceItemHandles != NULL) {
+						deviceItemHandles[i] = ppItems[n];
+					}
+				}
+				else {
+					delete ppItems[n];                     // Not added to the server
+					hrRet = S_FALSE;
+				}
+			}
+		}
+
+		delete[] ppItems;
+		delete[] pErrors;
+		delete[] pIndex;
+		LOGFMTT("AddItems() finished with hres = 0x%x.", hrRet);
+		return hrRet;
+	}
+
 	HRESULT DLLCALL RemoveItem(void* deviceItem)
 	{
 		HRESULT			hres = E_FAIL;
@@ -515,6 +642,45 @@ namespace IClassicBaseNodeManager
 	#endif
 	}
 
+	HRESULT  DLLCALL ProcessEvents(int count, AeEventDefinition* events, HRESULT* errors)
+	{
+		HRESULT			hres = S_OK;
+
+		LOGFMTT("ProcessEvents() called from plugin.");
+
+	#ifdef _OPC_SRV_AE
+		if (count <= 0 || events == NULL) {
+			return E_INVALIDARG;
+		}
+
+		EVENTDATA* pEvents = new EVENTDATA[count];
+		if (pEvents == NULL) {
+			return E_OUTOFMEMORY;
+		}
+
+		for (int i = 0; i < count; i++)
+		{
+			pEvents[i].m_dwCatID = events[i].CategoryId;
+			pEvents[i].m_dwSrcID = events[i].SourceId;
+			pEvents[i].m_szMessage = events[i].Message;
+			pEvents[i].m_dwSeverity = events[i].Severity;
+			pEvents[i].m_szActorID = events[i].ActorId;
+			pEvents[i].m_dwAttrCount = events[i].AttributeCount;
+			pEvents[i].m_pvAttrValues = events[i].AttributeValues;
+			pEvents[i].m_pftTimeStamp = events[i].TimeStamp;
+		}
+
+		hres = gpEventServer->ProcessEvents(count, pEvents, errors);
+		delete[] pEvents;
+
+		LOGFMTT("ProcessEvents() finished with hres = 0x%x.", hres);
+		return hres;
+	#else
+		LOGFMTE("ProcessEvents() not implemented.");
+		return E_NOTIMPL;
+	#endif
+	}
+
 	HRESULT  DLLCALL AckCondition(int conditionId, LPWSTR comment)
 	{
 		HRESULT hres = S_OK;
@@ -18,6 +18,7 @@
  * or FITNESS FOR A PARTICULAR PURPOSE.
  */
 
+
 #ifndef _COpcMap_H_
 #define _COpcMap_H_
 
@@ -37,9 +38,121 @@
 typedef struct TOpcPos{}* OPC_POS;
 #endif //_OPC_POS
 
+//==============================================================================
+// FUNCTION: OpcHashString
+// PURPOSE:  String hash key generator (djb2). Used for all string keys so
+//           that a map with COpcString keys can be searched with a LPCWSTR.
+inline UINT OpcHashString(LPCWSTR wszKey)
+{
+    if (wszKey == NULL) return -1;
+
+	UINT nHash = 5381;
+	while (*wszKey)
+		nHash = (nHash<<5) + nHash + *wszKey++;
+	return nHash;
+}
+
+//==============================================================================
+// FUNCTION: HashKey<KEY>
+// PURPOSE:  Default hash key generator for integers and pointers.
+//           The whole 64-bit value is mixed (Fibonacci hashing) so that
+//           aligned pointers with the same lower 32 bits do not collide.
+template<class KEY>
+inline UINT HashKey(const KEY& cKey)
+{
+	ULONGLONG ullKey = (ULONGLONG)(UINT_PTR)cKey;
+	return (UINT)((ullKey * 0x9E3779B97F4A7C15ULL) >> 32);
+}
+
+//==============================================================================
+// FUNCTION: HashKey<LPCTSTR>
+// PURPOSE:  String hash key generator.
+template<> 
+inline UINT HashKey<LPCTSTR> (const LPCTSTR& tsKey)
+{
+    LPCTSTR key = tsKey;
+    if (key == NULL) return -1;
+
+	UINT nHash = 5381;
+	while (*key)
+		nHash = (nHash<<5) + nHash + *key++;
+	return nHash;
+}
+
+//==============================================================================
+// FUNCTION: HashKey<COpcString>
+// PURPOSE:  String object hash key generator.
+template<> 
+inline UINT HashKey<COpcString> (const COpcString& cKey)
+{
+    return OpcHashString((LPCWSTR)cKey);
+}
+
+//==============================================================================
+// FUNCTION: IsKeyEqual<KEY>
+// PURPOSE:  Default key comparison.
+template<class KEY, class KEYARG>
+inline bool IsKeyEqual(const KEY& cKey1, const KEYARG& cKey2)
+{
+	return (cKey1 == cKey2);
+}
+
+//==============================================================================
+// FUNCTION: IsKeyEqual<LPCTSTR>
+// PURPOSE:  String keys are compared by value like they are hashed.
+template<> 
+inline bool IsKeyEqual<LPCTSTR,LPCTSTR> (const LPCTSTR& tsKey1, const LPCTSTR& tsKey2)
+{
+    if (tsKey1 == tsKey2) return true;
+    if (tsKey1 == NULL || tsKey2 == NULL) return false;
+	return (_tcscmp(tsKey1, tsKey2) == 0);
+}
+
+#ifndef UNICODE
+//==============================================================================
+// FUNCTION: HashKey<LPCWSTR>
+// PURPOSE:  Wide string hash key generator, LPCTSTR covers it with UNICODE.
+template<> 
+inline UINT HashKey<LPCWSTR> (const LPCWSTR& wszKey)
+{
+    return OpcHashString(wszKey);
+}
+
+//==============================================================================
+// FUNCTION: IsKeyEqual<LPCWSTR>
+// PURPOSE:  Wide string keys are compared by value like they are hashed.
+template<> 
+inline bool IsKeyEqual<LPCWSTR,LPCWSTR> (const LPCWSTR& wszKey1, const LPCWSTR& wszKey2)
+{
+    if (wszKey1 == wszKey2) return true;
+    if (wszKey1 == NULL || wszKey2 == NULL) return false;
+	return (wcscmp(wszKey1, wszKey2) == 0);
+}
+#endif
+
 //==============================================================================
 // CLASS:   COpcMap<KEY, VALUE>
 // PURPOSE: Defines a hash table template class.
+//
+// The entries are allocated in blocks like before and never move. They are
+// found through an index which uses open addressing with linear probing and
+// Robin Hood insertion: each slot holds the hash of the key, the distance
+// from the home slot and a pointer to the entry. Lookups compare the stored
+// hash before the key is accessed and stop as soon as a slot is closer to its
+// home slot than the searched key would be. Slots are removed with backward
+// shift, so no tombstones are needed. Probe sequences do not wrap around; they
+// run into a few overflow slots behind the home slots and the last slot is
+// always unused.
+//
+// Value pointers and positions stay valid until their own entry is removed.
+// GetNextAssoc() advances the position before it returns, so the key just
+// returned can be removed with RemoveKey() while the map is enumerated:
+//
+//     OPC_POS pos = cMap.GetStartPosition();
+//     while (pos != NULL) {
+//         cMap.GetNextAssoc(pos, cKey, cValue);
+//         if (...) cMap.RemoveKey(cKey);
+//     }
 
 template<class KEY,class VALUE>
 class COpcMap 
@@ -57,11 +170,12 @@ public:
     public:
 
         COpcEntry* pNext;
+        COpcEntry* pPrev;
         KEY        cKey;
         VALUE      cValue;
         UINT       uHash;
 
-        COpcEntry() : pNext(NULL), uHash(0) {}
+        COpcEntry() : pNext(NULL), pPrev(NULL), uHash(0) {}
     };
 
     //==========================================================================
@@ -89,18 +203,29 @@ public:
         COpcEntry* pEntries;
     };
 
+    //==========================================================================
+    // COpcSlot
+    struct COpcSlot
+    {
+        COpcEntry* pEntry;
+        UINT       uHash;
+        UINT       uDistance; // 1 + distance from the home slot, 0 if unused
+    };
+
 public:
 
     //==========================================================================
     // Constructor
     COpcMap(int nBlockSize = 10, int uTableSize = 17)
     :
-        m_pUnusedEntries(NULL),
+        m_pSlots(NULL),
+        m_uTableSize(0),
+        m_uSlots(0),
         m_uCount(0),
+        m_pFirst(NULL),
+        m_pUnusedEntries(NULL),
         m_pBlocks(NULL),
-        m_uBlockSize(nBlockSize),
-        m_ppHashTable(NULL),
-        m_uTableSize(0)
+        m_uBlockSize(nBlockSize)
     {
         InitHashTable(uTableSize);
     }
@@ -109,12 +234,14 @@ public:
     // Copy Constructor
     COpcMap(const COpcMap& cMap)
     :
-        m_pUnusedEntries(NULL),
+        m_pSlots(NULL),
+        m_uTableSize(0),
+        m_uSlots(0),
         m_uCount(0),
+        m_pFirst(NULL),
+        m_pUnusedEntries(NULL),
         m_pBlocks(NULL),
-        m_uBlockSize(cMap.m_uBlockSize),
-        m_ppHashTable(NULL),
-        m_uTableSize(0)
+        m_uBlockSize(cMap.m_uBlockSize)
     {
         *this = cMap;
     }
@@ -124,13 +251,18 @@ public:
     ~COpcMap()
     {
         RemoveAll();
-        delete [] m_ppHashTable;
+        delete [] m_pSlots;
     }
 
     //==========================================================================
     // Assignment
     COpcMap& operator=(const COpcMap& cMap)
     {
+        if (this == &cMap)
+        {
+            return *this;
+        }
+
         InitHashTable(cMap.m_uTableSize);
 
         KEY cKey;
@@ -164,45 +296,43 @@ public:
     // Lookup - return false if not there
     bool Lookup(const KEY& cKey, VALUE** ppValue = NULL) const
     {
-        COpcEntry* pEntry = Find(cKey);
-
-        if (pEntry == NULL)
-        {
-            return false;
-        }
-
-        if (ppValue != NULL)
-        {
-            *ppValue = &(pEntry->cValue);
-        }
-
-        return true;
+        return CopyResult(Find(cKey, HashKey(cKey)), ppValue);
     }
 
     //==========================================================================
     // Lookup - return false if not there
     bool Lookup(const KEY& cKey, VALUE& cValue) const
     {
-        COpcEntry* pEntry = Find(cKey);
+        return CopyResult(Find(cKey, HashKey(cKey)), cValue);
+    }
 
-        if (pEntry == NULL)
-        {
-            return false;
-        }
+    //==========================================================================
+    // LookupString - return false if not there
+    //
+    // Searches a map with string keys (e.g. COpcString) without creating a
+    // temporary key object. KEY must be comparable with LPCWSTR.
+    bool LookupString(LPCWSTR wszKey, VALUE** ppValue = NULL) const
+    {
+        return CopyResult(Find(wszKey, OpcHashString(wszKey)), ppValue);
+    }
 
-        cValue = pEntry->cValue;
-        return true;
+    //==========================================================================
+    // LookupString - return false if not there
+    bool LookupString(LPCWSTR wszKey, VALUE& cValue) const
+    {
+        return CopyResult(Find(wszKey, OpcHashString(wszKey)), cValue);
     }
 
     //==========================================================================
     // Lookup - and add if not there
     VALUE& operator[](const KEY& cKey)
     {
-        COpcEntry* pEntry = Find(cKey);
+        UINT uHash = HashKey(cKey);
+        COpcEntry* pEntry = Find(cKey, uHash);
 
         if (pEntry == NULL)
         {
-            pEntry = NewEntry(cKey);
+            pEntry = NewEntry(cKey, uHash);
         }
 
         return pEntry->cValue;
@@ -217,34 +347,23 @@ public:
 
     //==========================================================================
     // RemoveKey - removing existing (key, ?) pair
+    //
+    // May be called for the key just returned by GetNextAssoc() while the
+    // map is enumerated (see above).
     bool RemoveKey(const KEY& cKey)
     {
-        UINT uBin = HashKey(cKey)%m_uTableSize;
-        COpcEntry* pEntry = m_ppHashTable[uBin];
-        COpcEntry* pPrev  = NULL;
+        COpcSlot* pSlot = FindSlot(cKey, HashKey(cKey));
 
-        while (pEntry != NULL)
+        if (pSlot == NULL)
         {
-            if (pEntry->cKey == cKey)
-            {
-                if (pPrev == NULL)
-                {
-                    m_ppHashTable[uBin] = pEntry->pNext;
-                }
-                else
-                {
-                    pPrev->pNext = pEntry->pNext;
-                }
-
-                FreeEntry(pEntry);
-                return true;
-            }
-
-            pPrev  = pEntry;
-            pEntry = pEntry->pNext;
+            return false;
         }
 
-        return false;
+        COpcEntry* pEntry = pSlot->pEntry;
+
+        FreeSlot((UINT)(pSlot - m_pSlots));
+        FreeEntry(pEntry);
+        return true;
     }
 
     //==========================================================================
@@ -262,28 +381,17 @@ public:
         }
 
         m_uCount   = 0;
+        m_pFirst   = NULL;
         m_pUnusedEntries = NULL;
         m_pBlocks  = NULL;
-        memset(m_ppHashTable, 0, m_uTableSize*sizeof(COpcEntry*));
+        memset(m_pSlots, 0, m_uSlots*sizeof(COpcSlot));
     }
 
     //==========================================================================
     // GetStartPosition
     OPC_POS GetStartPosition() const
     {
-        UINT uBin = 0;
-
-        while (uBin < m_uTableSize && m_ppHashTable[uBin] == NULL) 
-        {
-            uBin++;
-        }
-
-        if (uBin == m_uTableSize)
-        {
-            return (OPC_POS)NULL;
-        }
-
-        return (OPC_POS)m_ppHashTable[uBin];
+        return (OPC_POS)m_pFirst;
     }
 
     //==========================================================================
@@ -295,7 +403,7 @@ public:
 
         cKey = pEntry->cKey;
 
-        pos = GetNextAssoc(pos);
+        pos = (OPC_POS)pEntry->pNext;
     }
 
     //==========================================================================
@@ -308,7 +416,7 @@ public:
         cKey = pEntry->cKey;
         cValue = pEntry->cValue;
 
-        pos = GetNextAssoc(pos);
+        pos = (OPC_POS)pEntry->pNext;
     }
 
     //==========================================================================
@@ -321,7 +429,7 @@ public:
         cKey = pEntry->cKey;
         pValue = &(pEntry->cValue);
 
-        pos = GetNextAssoc(pos);
+        pos = (OPC_POS)pEntry->pNext;
     }
     
 	//==========================================================================
@@ -350,7 +458,7 @@ public:
     // GetPosition
     OPC_POS GetPosition(const KEY& cKey) const
     {
-        return (OPC_POS)Find(cKey);
+        return (OPC_POS)Find(cKey, HashKey(cKey));
     }
 
     //==========================================================================
@@ -393,75 +501,201 @@ public:
 
     //==========================================================================
     // InitHashTable
+    //
+    // The table size is rounded up to the next power of two which can hold
+    // the current entries. The index is rebuilt from the stored hashes, the
+    // keys are not hashed again and the entries are not moved.
     void InitHashTable(UINT uTableSize)
     {
-        COpcEntry* pEntries = NULL;
+        UINT uNewSize = 8;
 
-        for (UINT ii = 0; ii < m_uTableSize; ii++)
+        while (uNewSize < uTableSize || !IsLoadAcceptable(m_uCount, uNewSize))
         {
-            COpcEntry* pEntry = m_ppHashTable[ii];
-            COpcEntry* pNext  = NULL;
+            uNewSize <<= 1;
+        }
 
-            while (pEntry != NULL)
-            {
-                pNext         = pEntry->pNext;
-                pEntry->pNext = pEntries;
-                pEntries      = pEntry;
-                pEntry        = pNext;
-            }
+        while (!BuildIndex(uNewSize))
+        {
+            uNewSize <<= 1;
         }
+    }
 
-        delete [] m_ppHashTable;
+private:
 
-        m_uTableSize = uTableSize;
-        m_ppHashTable = new COpcEntry*[m_uTableSize];
-        memset(m_ppHashTable, 0, m_uTableSize*sizeof(COpcEntry*));
+    // Max. number of slots behind the home slots used by the probe sequences.
+    enum { MAX_OVERFLOW = 32 };
 
-        COpcEntry* pEntry = pEntries;
-        COpcEntry* pNext  = NULL;
+    //==========================================================================
+    // IsLoadAcceptable - max. load factor is 7/8
+    static bool IsLoadAcceptable(UINT uCount, UINT uTableSize)
+    {
+        return ((ULONGLONG)uCount*8 < (ULONGLONG)uTableSize*7);
+    }
 
-        while (pEntry != NULL)
+    //==========================================================================
+    // CopyResult - returns the result of Find() to the caller of Lookup()
+    static bool CopyResult(COpcEntry* pEntry, VALUE** ppValue)
+    {
+        if (pEntry == NULL)
         {
-            pNext = pEntry->pNext;
+            return false;
+        }
+
+        if (ppValue != NULL)
+        {
+            *ppValue = &(pEntry->cValue);
+        }
 
-            UINT uBin = (pEntry->uHash)%m_uTableSize;
-            pEntry->pNext       = m_ppHashTable[uBin];
-            m_ppHashTable[uBin] = pEntry;
+        return true;
+    }
 
-            pEntry = pNext;
+    //==========================================================================
+    // CopyResult - returns the result of Find() to the caller of Lookup()
+    static bool CopyResult(COpcEntry* pEntry, VALUE& cValue)
+    {
+        if (pEntry == NULL)
+        {
+            return false;
         }
+
+        cValue = pEntry->cValue;
+        return true;
     }
 
-private:
+    //==========================================================================
+    // FindSlot
+    template<class KEYARG>
+    COpcSlot* FindSlot(const KEYARG& cKey, UINT uHash) const
+    {
+        UINT uIndex    = uHash & (m_uTableSize - 1);
+        UINT uDistance = 1;
+
+        for (;;)
+        {
+            COpcSlot* pSlot = &(m_pSlots[uIndex]);
+
+            // an unused slot or a slot closer to its home slot ends the probe.
+            if (pSlot->uDistance < uDistance)
+            {
+                return NULL;
+            }
+
+            if (pSlot->uHash == uHash && IsKeyEqual(pSlot->pEntry->cKey, cKey))
+            {
+                return pSlot;
+            }
+
+            uIndex++;                   // ends at the latest in the unused last slot
+            uDistance++;
+        }
+    }
 
     //==========================================================================
     // Find
-    COpcEntry* Find(const KEY& cKey) const
+    template<class KEYARG>
+    COpcEntry* Find(const KEYARG& cKey, UINT uHash) const
+    {
+        COpcSlot* pSlot = FindSlot(cKey, uHash);
+        return (pSlot != NULL) ? pSlot->pEntry : NULL;
+    }
+
+    //==========================================================================
+    // BuildIndex
+    //
+    // Creates the index with the specified number of home slots for all
+    // entries. Returns false if an entry would have to use the last slot.
+    bool BuildIndex(UINT uTableSize)
+    {
+        delete [] m_pSlots;
+
+        m_uTableSize = uTableSize;
+        m_uSlots     = uTableSize + ((uTableSize < MAX_OVERFLOW) ? uTableSize : MAX_OVERFLOW);
+        m_pSlots     = new COpcSlot[m_uSlots];
+        memset(m_pSlots, 0, m_uSlots*sizeof(COpcSlot));
+
+        for (COpcEntry* pEntry = m_pFirst; pEntry != NULL; pEntry = pEntry->pNext)
+        {
+            if (!InsertSlot(pEntry))
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    //==========================================================================
+    // InsertSlot
+    //
+    // Adds an entry to the index. The entry takes the slot of the first
+    // slot which is closer to its home slot; the displaced slots are moved
+    // towards the end of the probe sequence. Returns false if the last slot
+    // had to be used; the index must then be rebuilt with more slots.
+    bool InsertSlot(COpcEntry* pEntry)
     {
-        UINT uBin = HashKey(cKey)%m_uTableSize;
-        COpcEntry* pEntry = m_ppHashTable[uBin];
+        COpcSlot cInsert;
+        UINT     uIndex = pEntry->uHash & (m_uTableSize - 1);
 
-        while (pEntry != NULL)
+        cInsert.pEntry    = pEntry;
+        cInsert.uHash     = pEntry->uHash;
+        cInsert.uDistance = 1;
+
+        for (;;)
         {
-            if (pEntry->cKey == cKey)
+            COpcSlot* pSlot = &(m_pSlots[uIndex]);
+
+            if (pSlot->uDistance == 0)
             {
-                return pEntry;
+                *pSlot = cInsert;
+                return (uIndex < m_uSlots - 1);
             }
 
-            pEntry = pEntry->pNext;
+            if (pSlot->uDistance < cInsert.uDistance)
+            {
+                COpcSlot cSwap = *pSlot;
+                *pSlot = cInsert;
+                cInsert = cSwap;
+            }
+
+            uIndex++;
+            cInsert.uDistance++;
         }
+    }
 
-        return NULL;
+    //==========================================================================
+    // FreeSlot
+    //
+    // Removes the slot and shifts the following slots of the probe sequence
+    // one slot back.
+    void FreeSlot(UINT uIndex)
+    {
+        for (;;)
+        {
+            UINT uNext = uIndex + 1;    // the last slot is always unused
+
+            if (m_pSlots[uNext].uDistance <= 1)
+            {
+                break;
+            }
+
+            m_pSlots[uIndex] = m_pSlots[uNext];
+            m_pSlots[uIndex].uDistance--;
+            uIndex = uNext;
+        }
+
+        memset(&(m_pSlots[uIndex]), 0, sizeof(COpcSlot));
     }
 
     //==========================================================================
     // NewEntry
-    COpcEntry* NewEntry(const KEY& cKey)
+    //
+    // Inserts a key which is not yet in the table.
+    COpcEntry* NewEntry(const KEY& cKey, UINT uHash)
     {
         // optimize hash table size.
-        if (m_uTableSize < 1.2*m_uCount)
+        if (!IsLoadAcceptable(m_uCount + 1, m_uTableSize))
         {
-            InitHashTable(2*m_uCount);
+            InitHashTable(m_uTableSize*2);
         }
 
         // create a new block if necessary.
@@ -485,16 +719,26 @@ private:
         COpcEntry* pEntry   = m_pUnusedEntries;
         m_pUnusedEntries   = m_pUnusedEntries->pNext;
 
-        // insert entry into hash table.
+        // insert entry at the start of the list of used entries.
         pEntry->cKey  = cKey;
-        pEntry->uHash = HashKey(cKey);
+        pEntry->uHash = uHash;
+        pEntry->pPrev = NULL;
+        pEntry->pNext = m_pFirst;
 
-        UINT uBin           = pEntry->uHash%m_uTableSize;
-        pEntry->pNext       = m_ppHashTable[uBin];
-        m_ppHashTable[uBin] = pEntry;
+        if (m_pFirst != NULL)
+        {
+            m_pFirst->pPrev = pEntry;
+        }
 
+        m_pFirst = pEntry;
         m_uCount++;
 
+        // insert entry into the index.
+        if (!InsertSlot(pEntry))
+        {
+            InitHashTable(m_uTableSize*2);
+        }
+
         return pEntry;
     }
 
@@ -502,6 +746,27 @@ private:
     // FreeEntry
     void FreeEntry(COpcEntry* pEntry)
     {
+        // remove from the list of used entries
+        if (pEntry->pPrev != NULL)
+        {
+            pEntry->pPrev->pNext = pEntry->pNext;
+        }
+        else
+        {
+            m_pFirst = pEntry->pNext;
+        }
+
+        if (pEntry->pNext != NULL)
+        {
+            pEntry->pNext->pPrev = pEntry->pPrev;
+        }
+
+        // release the resources of the key and the value
+        pEntry->cKey   = KEY();
+        pEntry->cValue = VALUE();
+        pEntry->uHash  = 0;
+        pEntry->pPrev  = NULL;
+
         // return to unused entries list
         pEntry->pNext    = m_pUnusedEntries;
         m_pUnusedEntries = pEntry;
@@ -515,84 +780,18 @@ private:
         }
     }
 
-    //==========================================================================
-    // GetNextAssoc
-    OPC_POS GetNextAssoc(OPC_POS pos) const
-    {
-        COpcEntry* pEntry = (COpcEntry*)pos;
-        OPC_ASSERT(pos != NULL);
-
-        if (pEntry->pNext == NULL)
-        {
-            UINT uBin = pEntry->uHash%m_uTableSize;
-
-            do
-            {
-                uBin++;
-            }
-            while (uBin < m_uTableSize && m_ppHashTable[uBin] == NULL);
-
-            if (uBin == m_uTableSize)
-            {
-                return (OPC_POS)NULL;
-            }
-
-            return (OPC_POS)m_ppHashTable[uBin];
-        }
-
-        return (OPC_POS)pEntry->pNext;
-    }
-
     //==========================================================================
     // Members
-    COpcEntry** m_ppHashTable;
-    UINT        m_uTableSize;
+    COpcSlot*   m_pSlots;
+    UINT        m_uTableSize;   // number of home slots, a power of two
+    UINT        m_uSlots;       // home slots and overflow slots
     UINT        m_uCount;
+    COpcEntry*  m_pFirst;       // list of used entries, enumeration order
     COpcEntry*  m_pUnusedEntries;
     COpcBlock*  m_pBlocks;
     UINT        m_uBlockSize;
 };
 
-
-//==============================================================================
-// FUNCTION: HashKey<KEY>
-// PURPOSE:  Default hash key generator.
-template<class KEY>
-inline UINT HashKey(const KEY& cKey)
-{
-	return ((UINT)(void*)(DWORD)cKey) >> 4;
-}
-
-//==============================================================================
-// FUNCTION: HashKey<LPCTSTR>
-// PURPOSE:  String hash key generator.
-template<> 
-inline UINT HashKey<LPCTSTR> (const LPCTSTR& tsKey)
-{
-    LPCTSTR key = tsKey;
-    if (key == NULL) return -1;
-
-	UINT nHash = 0;
-	while (*key)
-		nHash = (nHash<<5) + nHash + *key++;
-	return nHash;
-}
-
-//==============================================================================
-// FUNCTION: HashKey<COpcString>
-// PURPOSE:  String object hash key generator.
-template<> 
-inline UINT HashKey<COpcString> (const COpcString& cKey)
-{
-    LPCTSTR key = cKey;
-    if (key == NULL) return -1;
-
-	UINT nHash = 0;
-	while (*key)
-		nHash = (nHash<<5) + nHash + *key++;
-	return nHash;
-}
-
 //==============================================================================
 // TYPE:    COpcStringMap
 // PURPOSE: A string to string map.
@@ -604,4 +803,3 @@ template class OPCUTILS_API COpcMap<COpcString,COpcString>;
 //#endif
 
 #endif //ndef _COpcMap_H_
-
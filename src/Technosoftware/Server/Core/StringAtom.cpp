@@ -0,0 +1,353 @@
+/*
+ * Copyright (c) 2020 Technosoftware GmbH. All rights reserved
+ * Web: https://technosoftware.com 
+ * 
+ * The source code in this file is covered under a dual-license scenario:
+ *   - Owner of a purchased license: SCLA 1.0
+ *   - GPL V3: everybody else
+ *
+ * SCLA license terms accompanied with this source code.
+ * See https://technosoftware.com/license/Source_Code_License_Agreement.pdf
+ *
+ * GNU General Public License as published by the Free Software Foundation;
+ * version 3 of the License are accompanied with this source code.
+ * See https://technosoftware.com/license/GPLv3License.txt
+ *
+ * This source code is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+//DOM-IGNORE-BEGIN
+
+//-----------------------------------------------------------------------------
+// INLCUDE
+//-----------------------------------------------------------------------------
+#include <stdafx.h>
+#include <stddef.h>
+#include "StringAtom.h"
+
+//-----------------------------------------------------------------------------
+// CLASS StringAtomPool
+//-----------------------------------------------------------------------------
+// Hash table with all atoms. The table is split into shards with their own
+// lock, so threads creating atoms in parallel (e.g. while the address space
+// is built) do not block each other.
+//
+// The reference count of an atom drops to zero only while the lock of its
+// shard is held (see StringAtom::Release()). Therefore Create() never finds
+// an atom which is about to be deleted.
+class StringAtomPool
+{
+public:
+   StringAtomPool();
+
+   HRESULT  Create( LPCWSTR text, StringAtom** atom );
+   void     Remove( StringAtom* atom );
+   DWORD    Count();
+
+protected:
+   enum { NUM_SHARDS = 16, MIN_BUCKETS = 64 };
+
+   struct Shard
+   {
+      CComAutoCriticalSection lock;
+      StringAtom**            buckets;
+      DWORD                   numBuckets;       // Always a power of two
+      DWORD                   count;
+   };
+
+   inline Shard& ShardOf( ULONG hash ) { return shards_[ hash >> 28 ]; }
+   void     Grow( Shard& shard );
+
+   Shard    shards_[ NUM_SHARDS ];
+};
+
+
+StringAtomPool::StringAtomPool()
+{
+   for (int i = 0; i < NUM_SHARDS; i++) {
+      shards_[i].buckets    = NULL;
+      shards_[i].numBuckets = 0;
+      shards_[i].count      = 0;
+   }
+}
+
+
+HRESULT StringAtomPool::Create( LPCWSTR text, StringAtom** atom )
+{
+   DWORD length;
+   ULONG hash = StringAtom::HashOf( text, &length );
+   Shard& shard = ShardOf( hash );
+   HRESULT hres = S_OK;
+
+   shard.lock.Lock();
+
+   StringAtom* pAtom = NULL;
+   if (shard.buckets) {
+      pAtom = shard.buckets[ hash & (shard.numBuckets - 1) ];
+      while (pAtom) {
+         if (pAtom->hash_ == hash && pAtom->length_ == length &&
+             wmemcmp( pAtom->text_, text, length ) == 0) {
+            break;
+         }
+         pAtom = pAtom->next_;
+      }
+   }
+
+   if (pAtom) {
+      pAtom->AddRef();                          // Existing atom
+   }
+   else {
+      if (shard.count >= shard.numBuckets) {
+         Grow( shard );
+      }
+                                                // text_ has already space for the EOS
+      pAtom = static_cast<StringAtom*>(malloc( offsetof( StringAtom, text_ ) + (length + 1) * sizeof (WCHAR) ));
+      if (!pAtom || !shard.buckets) {
+         if (pAtom) free( pAtom );
+         pAtom = NULL;
+         hres = E_OUTOFMEMORY;
+      }
+      else {
+         pAtom->refCount_ = 1;
+         pAtom->hash_     = hash;
+         pAtom->length_   = length;
+         pAtom->pooled_   = TRUE;
+         wmemcpy( pAtom->text_, text, length );
+         pAtom->text_[ length ] = L'\0';
+
+         StringAtom** ppBucket = &shard.buckets[ hash & (shard.numBuckets - 1) ];
+         pAtom->next_ = *ppBucket;
+         *ppBucket = pAtom;
+         shard.count++;
+      }
+   }
+
+   shard.lock.Unlock();
+
+   *atom = pAtom;
+   return hres;
+}
+
+
+void StringAtomPool::Remove( StringAtom* atom )
+{
+   Shard& shard = ShardOf( atom->hash_ );
+
+   shard.lock.Lock();
+   if (InterlockedDecrement( &atom->refCount_ ) == 0) {
+      StringAtom** ppAtom = &shard.buckets[ atom->hash_ & (shard.numBuckets - 1) ];
+      while (*ppAtom != atom) {
+         _ASSERTE( *ppAtom );
+         ppAtom = &(*ppAtom)->next_;
+      }
+      *ppAtom = atom->next_;
+      shard.count--;
+      free( atom );
+   }
+   shard.lock.Unlock();
+}
+
+
+DWORD StringAtomPool::Count()
+{
+   DWORD count = 0;
+   for (int i = 0; i < NUM_SHARDS; i++) {
+      shards_[i].lock.Lock();
+      count += shards_[i].count;
+      shards_[i].lock.Unlock();
+   }
+   return count;
+}
+
+
+//=========================================================================
+// Grow
+// ----
+//    Doubles the number of buckets of the shard. The atoms are moved by
+//    their stored hash. If out of memory the current buckets are kept.
+//    The lock of the shard must be held by the caller.
+//=========================================================================
+void StringAtomPool::Grow( Shard& shard )
+{
+   DWORD numBuckets = shard.numBuckets ? shard.numBuckets * 2 : MIN_BUCKETS;
+   StringAtom** buckets = new StringAtom* [ numBuckets ];
+   if (!buckets) {
+      return;
+   }
+   memset( buckets, 0, numBuckets * sizeof (StringAtom*) );
+
+   for (DWORD i = 0; i < shard.numBuckets; i++) {
+      StringAtom* pAtom = shard.buckets[i];
+      while (pAtom) {
+         StringAtom* pNext = pAtom->next_;
+         StringAtom** ppBucket = &buckets[ pAtom->hash_ & (numBuckets - 1) ];
+         pAtom->next_ = *ppBucket;
+         *ppBucket = pAtom;
+         pAtom = pNext;
+      }
+   }
+
+   if (shard.buckets) {
+      delete [] shard.buckets;
+   }
+   shard.buckets    = buckets;
+   shard.numBuckets = numBuckets;
+}
+
+
+//=========================================================================
+// The pool is created with the first atom and never deleted. Atoms
+// referenced by static objects may be released after all destructors
+// of this module have been called.
+//=========================================================================
+static StringAtomPool* StringAtomPoolInstance()
+{
+   static StringAtomPool* s_pPool = NULL;
+
+   if (s_pPool == NULL) {
+      StringAtomPool* pPool = new StringAtomPool;
+      if (pPool == NULL) {
+         return NULL;
+      }
+      if (InterlockedCompareExchangePointer( (PVOID*)&s_pPool, pPool, NULL ) != NULL) {
+         delete pPool;                          // Created concurrently by another thread
+      }
+   }
+   return s_pPool;
+}
+
+
+//-----------------------------------------------------------------------------
+// CODE StringAtom
+//-----------------------------------------------------------------------------
+
+HRESULT StringAtom::Create( LPCWSTR text, StringAtom** atom )
+{
+   *atom = NULL;
+
+   StringAtomPool* pPool = StringAtomPoolInstance();
+   if (pPool == NULL) {
+      return E_OUTOFMEMORY;
+   }
+   return pPool->Create( text ? text : L"", atom );
+}
+
+
+HRESULT StringAtom::CreateUnique( LPCWSTR text, StringAtom** atom )
+{
+   DWORD length;
+   if (text == NULL) {
+      text = L"";
+   }
+   ULONG hash = HashOf( text, &length );
+                                                // text_ has already space for the EOS
+   StringAtom* pAtom = static_cast<StringAtom*>(malloc( offsetof( StringAtom, text_ ) + (length + 1) * sizeof (WCHAR) ));
+   *atom = pAtom;
+   if (pAtom == NULL) {
+      return E_OUTOFMEMORY;
+   }
+   pAtom->refCount_ = 1;
+   pAtom->hash_     = hash;
+   pAtom->length_   = length;
+   pAtom->pooled_   = FALSE;
+   pAtom->next_     = NULL;
+   wmemcpy( pAtom->text_, text, length );
+   pAtom->text_[ length ] = L'\0';
+   return S_OK;
+}
+
+
+//=========================================================================
+// Empty
+// -----
+//    The atom of the empty string is referenced by this function and
+//    therefore never deleted.
+//=========================================================================
+StringAtom* StringAtom::Empty()
+{
+   static StringAtom* s_pEmpty = NULL;
+
+   if (s_pEmpty == NULL) {
+      StringAtom* pAtom;
+      if (FAILED( Create( L"", &pAtom ) )) {
+         return NULL;
+      }
+      if (InterlockedCompareExchangePointer( (PVOID*)&s_pEmpty, pAtom, NULL ) != NULL) {
+         pAtom->Release();                      // Referenced concurrently by another thread
+      }
+   }
+   s_pEmpty->AddRef();
+   return s_pEmpty;
+}
+
+
+DWORD StringAtom::PoolCount()
+{
+   StringAtomPool* pPool = StringAtomPoolInstance();
+   return pPool ? pPool->Count() : 0;
+}
+
+
+void StringAtom::Release()
+{
+   if (!pooled_) {
+      if (InterlockedDecrement( &refCount_ ) == 0) {
+         free( this );
+      }
+      return;
+   }
+
+   LONG refCount = refCount_;
+   while (refCount > 1) {                       // Not the last reference, no lock required
+      LONG prev = InterlockedCompareExchange( &refCount_, refCount - 1, refCount );
+      if (prev == refCount) {
+         return;
+      }
+      refCount = prev;
+   }
+   StringAtomPoolInstance()->Remove( this );    // Maybe the last reference
+}
+
+
+LPWSTR StringAtom::CopyCOM() const
+{
+   LPWSTR copy = static_cast<LPWSTR>(CoTaskMemAlloc( (length_ + 1) * sizeof (WCHAR) ));
+   if (copy) {
+      memcpy( copy, text_, (length_ + 1) * sizeof (WCHAR) );
+   }
+   return copy;
+}
+
+
+BSTR StringAtom::CopyBSTR() const
+{
+   return SysAllocStringLen( text_, length_ );
+}
+
+
+//=========================================================================
+// HashOf
+// ------
+//    djb2 followed by a final mix, so that also the upper bits which
+//    select the shard depend on all characters.
+//=========================================================================
+ULONG StringAtom::HashOf( LPCWSTR text, DWORD* length )
+{
+   ULONG hash = 5381;
+   LPCWSTR pch = text;
+
+   while (*pch) {
+      hash = (hash << 5) + hash + *pch++;
+   }
+   *length = (DWORD)(pch - text);
+
+   hash ^= hash >> 16;
+   hash *= 0x85EBCA6B;
+   hash ^= hash >> 13;
+   hash *= 0xC2B2AE35;
+   hash ^= hash >> 16;
+   return hash;
+}
+//DOM-IGNORE-END
@@ -0,0 +1,185 @@
+/*
+ * Copyright (c) 2020 Technosoftware GmbH. All rights reserved
+ * Web: https://technosoftware.com 
+ * 
+ * The source code in this file is covered under a dual-license scenario:
+ *   - Owner of a purchased license: SCLA 1.0
+ *   - GPL V3: everybody else
+ *
+ * SCLA license terms accompanied with this source code.
+ * See https://technosoftware.com/license/Source_Code_License_Agreement.pdf
+ *
+ * GNU General Public License as published by the Free Software Foundation;
+ * version 3 of the License are accompanied with this source code.
+ * See https://technosoftware.com/license/GPLv3License.txt
+ *
+ * This source code is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+
+#ifndef __StringAtom_H_
+#define __StringAtom_H_
+
+//DOM-IGNORE-BEGIN
+
+#if _MSC_VER >= 1000
+#pragma once
+#endif // _MSC_VER >= 1000
+
+
+//-----------------------------------------------------------------------
+// CLASS
+//-----------------------------------------------------------------------
+
+/**
+ * @class	StringAtom
+ *
+ * @brief	Immutable, reference counted and interned wide string.
+ * 			Atoms created by Create() are kept in a global pool: creating an atom for a text
+ * 			which already exists returns the existing atom. Use it only for texts which repeat,
+ * 			like leaf names, sub condition names and event messages; two pooled atoms are equal
+ * 			if the pointers are equal.
+ * 			Unique texts like fully qualified source names are created by CreateUnique(). Such
+ * 			atoms are not in the pool, so creating and releasing them does not lock the pool.
+ * 			The length and the hash of the text are computed once when the atom is created.
+ */
+
+class StringAtom
+{
+// Construction / Destruction
+public:
+
+   /**
+    * @fn	static HRESULT StringAtom::Create( LPCWSTR text, StringAtom** atom );
+    *
+    * @brief	Returns the atom for the specified text. The atom is created if the text is not
+    * 			yet in the pool.
+    *
+    * @param 		 	text	The text. A NULL pointer is handled like an empty string.
+    * @param [out]	atom	The atom, referenced by the caller.
+    *
+    * @return	S_OK if succeeded; otherwise E_OUTOFMEMORY.
+    */
+
+   static HRESULT Create( LPCWSTR text, StringAtom** atom );
+
+   /**
+    * @fn	static HRESULT StringAtom::CreateUnique( LPCWSTR text, StringAtom** atom );
+    *
+    * @brief	Creates a new atom which is not added to the pool. Use it for texts which do not
+    * 			repeat. The atom is not equal by pointer to any other atom.
+    *
+    * @param 		 	text	The text. A NULL pointer is handled like an empty string.
+    * @param [out]	atom	The atom, referenced by the caller.
+    *
+    * @return	S_OK if succeeded; otherwise E_OUTOFMEMORY.
+    */
+
+   static HRESULT CreateUnique( LPCWSTR text, StringAtom** atom );
+
+   /**
+    * @fn	static StringAtom* StringAtom::Empty();
+    *
+    * @brief	Returns the atom of the empty string. The caller must release the returned atom.
+    *
+    * @return	The empty string or a NULL pointer if out of memory.
+    */
+
+   static StringAtom* Empty();
+
+   /**
+    * @fn	static DWORD StringAtom::PoolCount();
+    *
+    * @brief	Returns the number of atoms currently in the pool.
+    *
+    * @return	The number of atoms.
+    */
+
+   static DWORD PoolCount();
+
+// Attributes
+public:
+
+   /**
+    * @fn	inline LPWSTR StringAtom::Text() const
+    *
+    * @brief	Returns the text. The text must not be changed or freed.
+    *
+    * @return	The text.
+    */
+
+   inline LPWSTR Text() const { return const_cast<LPWSTR>(text_); }
+
+   inline operator LPCWSTR() const { return text_; }
+
+   /** @brief	Number of characters without the terminating zero. */
+   inline DWORD Length() const { return length_; }
+
+   /** @brief	Hash of the text. */
+   inline ULONG Hash() const { return hash_; }
+
+// Operations
+public:
+   inline void AddRef() { InterlockedIncrement( &refCount_ ); }
+
+   /**
+    * @fn	void StringAtom::Release();
+    *
+    * @brief	Releases a reference. The atom is removed from the pool and deleted with the last
+    * 			reference.
+    */
+
+   void Release();
+
+   /**
+    * @fn	LPWSTR StringAtom::CopyCOM() const;
+    *
+    * @brief	Returns a copy of the text. Memory is allocated from the COM memory manager.
+    *
+    * @return	The copy or a NULL pointer if out of memory.
+    */
+
+   LPWSTR   CopyCOM() const;
+
+   /**
+    * @fn	BSTR StringAtom::CopyBSTR() const;
+    *
+    * @brief	Returns a BSTR copy of the text.
+    *
+    * @return	The copy or a NULL pointer if out of memory.
+    */
+
+   BSTR     CopyBSTR() const;
+
+   /**
+    * @fn	static ULONG StringAtom::HashOf( LPCWSTR text, DWORD* length );
+    *
+    * @brief	Computes the hash used by the pool.
+    *
+    * @param 		 	text  	The text.
+    * @param [out]	length	Number of characters without the terminating zero.
+    *
+    * @return	The hash.
+    */
+
+   static ULONG HashOf( LPCWSTR text, DWORD* length );
+
+// Implementation
+protected:
+   friend class StringAtomPool;
+
+   StringAtom();                                // Created and deleted only by the pool
+   ~StringAtom();
+
+   LONG           refCount_;
+   ULONG          hash_;
+   DWORD          length_;
+   BOOL           pooled_;                      // FALSE if created by CreateUnique()
+   StringAtom*    next_;                        // Next atom in the same hash bucket
+   WCHAR          text_[1];                     // Allocated with the required size
+};
+//DOM-IGNORE-END
+
+#endif // __StringAtom_H_
@@ -31,6 +31,12 @@
 
 using namespace IClassicBaseNodeManager;
 
+//-------------------------------------------------------------------------
+// DEFINES
+//-------------------------------------------------------------------------
+#define EVENT_HISTORY_SIZE       1000           // Events kept for the replay
+                                                // of reconnected clients
+
 //-------------------------------------------------------------------------
 // CODE
 //-------------------------------------------------------------------------
@@ -70,6 +76,11 @@ HRESULT AeServer::Create()
 	HRESULT hres = AeBaseServer::Create();
 	if (FAILED( hres )) return hres;
 
+	// Keep the recent events so that clients which reconnect get the
+	// events they missed with their next Refresh().
+	hres = SetEventHistorySize( EVENT_HISTORY_SIZE );
+	if (FAILED( hres )) return hres;
+
 	// Order of implemented steps
 
 	// 1) Define the Event Categories
@@ -23,6 +23,7 @@
 // INLCUDE
 //-------------------------------------------------------------------------
 #include "stdafx.h"                             // Generic server part headers
+#include <process.h>
 #include "MatchPattern.h"
 #include "DaDeviceItem.h"
 // Application specific definitions
@@ -46,6 +47,7 @@ DaBranch* DaBranch::m_pRoot = NULL;
 //=========================================================================
 DaLeaf::DaLeaf()
 {
+	m_pName = NULL;
 	m_pDItemRef = NULL;
 	m_fKillDeviceItemOnDestroy = FALSE;
 }
@@ -60,8 +62,13 @@ DaLeaf::DaLeaf()
 //=========================================================================
 HRESULT DaLeaf::Create( LPCWSTR szName, DaDeviceItem* pDItem )
 {
-	HRESULT hres = m_wsName.SetString( szName );
+	StringAtom* pName;
+	HRESULT hres = StringAtom::Create( szName, &pName );
 	if (SUCCEEDED( hres )) {
+		if (m_pName) {
+			m_pName->Release();
+		}
+		m_pName = pName;
 		m_pDItemRef = pDItem;
 	}
 	return hres;
@@ -80,6 +87,9 @@ DaLeaf::~DaLeaf()
 	if (m_pDItemRef && m_fKillDeviceItemOnDestroy) {
 		m_pDItemRef->Kill( TRUE );
 	}
+	if (m_pName) {
+		m_pName->Release();
+	}
 }
 
 
@@ -990,6 +1000,71 @@ HRESULT DaBranch::RemoveDeviceItemAssociatedLeaf( LPCWSTR szItemID, BOOL fKillDe
 
 
 
+//=========================================================================
+// MoveMembersTo
+// -------------
+//    Moves all branches and leaves of this branch to the target branch.
+//    Branches which already exist in the target are merged.
+//    Leaves which already exist in the target are deleted and their
+//    Device Items are returned in arRejected.
+//    Used to publish branches built by DaAddressSpaceBuilder.
+//=========================================================================
+void DaBranch::MoveMembersTo( DaBranch* pTarget, CAtlArray<DaDeviceItem*>& arRejected )
+{
+	POSITION pos;
+
+	// Move all branches
+	DaBranch* pBranch;
+	DaBranch* pExisting;
+	m_csBranches.BeginWriting();
+	pTarget->m_csBranches.BeginWriting();
+	try
+	{
+		pos = m_mapBranches.GetStartPosition();
+		while (pos) {
+			pBranch = m_mapBranches.GetNextValue( pos );
+			if (pTarget->m_mapBranches.Lookup( pBranch->m_wsName, pExisting )) {
+				pBranch->MoveMembersTo( pExisting, arRejected );
+				delete pBranch;                     // Is empty now
+			}
+			else {
+				pBranch->m_pParent = pTarget;
+				pTarget->m_mapBranches.SetAt( pBranch->m_wsName, pBranch );
+			}
+		}
+		m_mapBranches.RemoveAll();
+	} catch (...) {
+	}
+	pTarget->m_csBranches.EndWriting();
+	m_csBranches.EndWriting();
+
+	// Move all leafs
+	DaLeaf* pLeaf;
+	DaLeaf* pExistingLeaf;
+	m_csLeafs.BeginWriting();
+	pTarget->m_csLeafs.BeginWriting();
+	try
+	{
+		pos = m_mapLeafs.GetStartPosition();
+		while (pos) {
+			pLeaf = m_mapLeafs.GetNextValue( pos );
+			if (pTarget->m_mapLeafs.Lookup( pLeaf->Name(), pExistingLeaf )) {
+				arRejected.Add( &pLeaf->DeviceItem() );
+				delete pLeaf;                       // The leaf already exist in the target
+			}
+			else {
+				pTarget->m_mapLeafs.SetAt( pLeaf->Name(), pLeaf );
+			}
+		}
+		m_mapLeafs.RemoveAll();
+	} catch (...) {
+	}
+	pTarget->m_csLeafs.EndWriting();
+	m_csLeafs.EndWriting();
+}
+
+
+
 //-------------------------------------------------------------------------
 // IMPLEMENTATION
 //-------------------------------------------------------------------------
@@ -1341,3 +1416,223 @@ void* DaBranch::new_realloc( void* memblock, size_t sizeOld, size_t sizeNew )
 	}
 	return pNew;                                 // Return new buffer
 }
+
+
+
+//-------------------------------------------------------------------------
+// CODE DaAddressSpaceBuilder
+//-------------------------------------------------------------------------
+
+//=========================================================================
+// Construction
+//=========================================================================
+DaAddressSpaceBuilder::DaAddressSpaceBuilder()
+{
+	m_ppDItems = NULL;
+	m_pErrors  = NULL;
+}
+
+
+
+//=========================================================================
+// Destructor
+//=========================================================================
+DaAddressSpaceBuilder::~DaAddressSpaceBuilder()
+{
+	RemovePartitions();
+}
+
+
+
+//=========================================================================
+// Build
+// -----
+//    Builds the branches and leaves for the specified Device Items.
+//    The Server Address Space is not accessed and must not be locked.
+//
+//    The items are distributed by the name of their top level branch
+//    to one partition per processor. Each partition is built by its own
+//    thread. Items with the same top level branch are always in the
+//    same partition, the partitions can therefore be built without
+//    any synchronization.
+//
+// Parameters:
+//    IN
+//       dwCount                 Number of Device Items.
+//       ppDItems                The Device Items. Must be valid until
+//                               Publish() is called.
+//    OUT
+//       pErrors                 The result for each item. E_INVALIDARG
+//                               if the ItemId is used more than once.
+//
+// Return:
+//    S_OK                       The partitions have been built.
+//    E_xxx                      An error occured.
+//=========================================================================
+HRESULT DaAddressSpaceBuilder::Build( DWORD dwCount, DaDeviceItem** ppDItems, HRESULT* pErrors )
+{
+	_ASSERTE( m_arPartitions.GetCount() == 0 );  // Build() must be called only once
+
+	m_ppDItems = ppDItems;
+	m_pErrors  = pErrors;
+
+	SYSTEM_INFO sysInfo;
+	GetSystemInfo( &sysInfo );
+	DWORD dwNumPartitions = sysInfo.dwNumberOfProcessors;
+	if (dwNumPartitions > MAXIMUM_WAIT_OBJECTS) {
+		dwNumPartitions = MAXIMUM_WAIT_OBJECTS;
+	}
+	if (dwNumPartitions > dwCount / 1000 + 1) {   // No threads for small lists
+		dwNumPartitions = dwCount / 1000 + 1;
+	}
+
+	try {
+		DWORD i;
+		for (i = 0; i < dwNumPartitions; i++) {
+			Partition* pPartition = new Partition;
+			if (pPartition == NULL) throw E_OUTOFMEMORY;
+			pPartition->pBuilder = this;
+			m_arPartitions.Add( pPartition );
+		}
+
+		// Distribute the items to the partitions
+		for (i = 0; i < dwCount; i++) {
+			LPWSTR szItemID;
+			pErrors[i] = ppDItems[i]->get_ItemIDPtr( &szItemID );
+			if (SUCCEEDED( pErrors[i] )) {
+				m_arPartitions[ PartitionOf( szItemID ) % dwNumPartitions ]->arIndex.Add( i );
+			}
+		}
+	}
+	catch (HRESULT hresEx) {
+		RemovePartitions();
+		return hresEx;
+	}
+	catch (...) {
+		RemovePartitions();
+		return E_OUTOFMEMORY;
+	}
+
+	if (dwNumPartitions == 1) {
+		BuildPartition( m_arPartitions[0] );
+		return S_OK;
+	}
+
+	// Build the partitions in parallel
+	HANDLE   ahThreads[ MAXIMUM_WAIT_OBJECTS ];
+	DWORD    dwNumThreads = 0;
+	for (DWORD i = 0; i < dwNumPartitions; i++) {
+		unsigned uThreadID;
+		ahThreads[ dwNumThreads ] = (HANDLE)_beginthreadex( NULL, 0, BuildPartitionThread,
+															m_arPartitions[i], 0, &uThreadID );
+		if (ahThreads[ dwNumThreads ]) {
+			dwNumThreads++;
+		}
+		else {
+			BuildPartition( m_arPartitions[i] );  // Cannot create thread, build it here
+		}
+	}
+	if (dwNumThreads) {
+		WaitForMultipleObjects( dwNumThreads, ahThreads, TRUE, INFINITE );
+		while (dwNumThreads--) {
+			CloseHandle( ahThreads[ dwNumThreads ] );
+		}
+	}
+	return S_OK;
+}
+
+
+
+//=========================================================================
+// Publish
+// -------
+//    Moves the built branches and leaves into the specified root branch.
+//    If the root has no branches with the same names (e.g. during server
+//    startup) the top level branches are taken over as they are.
+//    The caller must lock the access to the Server Address Space.
+//
+// Parameters:
+//    IN
+//       pRoot                   The root of the Server Address Space.
+//    OUT
+//       arRejected              The Device Items whose ItemId already
+//                               exists in the Server Address Space.
+//=========================================================================
+void DaAddressSpaceBuilder::Publish( DaBranch* pRoot, CAtlArray<DaDeviceItem*>& arRejected )
+{
+	for (size_t i = 0; i < m_arPartitions.GetCount(); i++) {
+		m_arPartitions[i]->branch.MoveMembersTo( pRoot, arRejected );
+	}
+	RemovePartitions();
+}
+
+
+
+//=========================================================================
+// PartitionOf
+// -----------
+//    Returns the hash code of the top level branch name of an ItemId.
+//=========================================================================
+DWORD DaAddressSpaceBuilder::PartitionOf( LPCWSTR szItemID ) const
+{
+	const WCHAR wcDelimiter = DaBranch::GetDelimiter();
+	if (wcschr( szItemID, wcDelimiter ) == NULL) {
+		return 0;                                 // Leaf of the root
+	}
+	DWORD dwHash = 0;
+	while (*szItemID && *szItemID != wcDelimiter) {
+		dwHash = (dwHash<<5)+dwHash+(*szItemID);
+		szItemID++;
+	}
+	return dwHash;
+}
+
+
+
+//=========================================================================
+// BuildPartition
+// --------------
+//    Adds the items of a partition to its detached root branch.
+//=========================================================================
+void DaAddressSpaceBuilder::BuildPartition( Partition* pPartition )
+{
+	for (size_t i = 0; i < pPartition->arIndex.GetCount(); i++) {
+		DWORD    dwIndex = pPartition->arIndex[i];
+		LPWSTR   szItemID;
+
+		HRESULT hres = m_ppDItems[ dwIndex ]->get_ItemIDPtr( &szItemID );
+		if (SUCCEEDED( hres )) {
+			hres = pPartition->branch.AddDeviceItem( szItemID, m_ppDItems[ dwIndex ] );
+		}
+		m_pErrors[ dwIndex ] = hres;
+	}
+}
+
+
+
+//=========================================================================
+// RemovePartitions
+//=========================================================================
+void DaAddressSpaceBuilder::RemovePartitions()
+{
+	for (size_t i = 0; i < m_arPartitions.GetCount(); i++) {
+		delete m_arPartitions[i];                 // Deletes the not published members
+	}
+	m_arPartitions.RemoveAll();
+}
+
+
+
+//=========================================================================
+// Thread building one partition
+//=========================================================================
+unsigned __stdcall BuildPartitionThread( void* pArg )
+{
+	DaAddressSpaceBuilder::Partition* pPartition = static_cast<DaAddressSpaceBuilder::Partition *>(pArg);
+	_ASSERTE( pPartition != NULL );
+
+	pPartition->pBuilder->BuildPartition( pPartition );
+
+	_endthreadex( 0 );
+	return 0;
+}
@@ -26,6 +26,7 @@
 #endif // _MSC_VER >= 1000
 
 #include "WideString.h"
+#include "StringAtom.h"
 #include "UtilityDefs.h"
 #include <atlcoll.h>
 
@@ -88,6 +89,9 @@ public:
    static void SetDelimiter( WCHAR wc ) {
       m_szDelimiter[0] = wc;
    }
+   static WCHAR GetDelimiter() {
+      return m_szDelimiter[0];
+   }
    HRESULT  AddBranch( LPCWSTR szBranchName, DaBranch** ppBranch );
    HRESULT  AddLeaf( LPCWSTR szLeafName, DaDeviceItem* pDItem );
    HRESULT  AddDeviceItem( LPCWSTR szSASName, DaDeviceItem* pDItem );
@@ -107,6 +111,7 @@ public:
    HRESULT  RemoveLeaf( LPCWSTR szLeafName, BOOL fKillDeviceItem = FALSE );
    HRESULT  RemoveBranch( LPCWSTR szBranchName, BOOL fKillDeviceItems = FALSE );
    HRESULT  RemoveDeviceItemAssociatedLeaf( LPCWSTR szItemID, BOOL fKillDeviceItem = FALSE );
+   void     MoveMembersTo( DaBranch* pTarget, CAtlArray<DaDeviceItem*>& arRejected );
 
 // Implementation
 protected:
@@ -157,7 +162,7 @@ public:
 
 // Attributes
 public:
-   inline WideString&     Name()               { return m_wsName; }
+   inline StringAtom&     Name()               { return *m_pName; }
    inline DaDeviceItem&     DeviceItem() const   { return *m_pDItemRef; }
 
 // Operations
@@ -167,7 +172,7 @@ public:
 
 // Implementation
 protected:
-   WideString    m_wsName;                     // The name of the leaf
+   StringAtom*   m_pName;                      // The interned name of the leaf
    DaDeviceItem*   m_pDItemRef;
 
    friend HRESULT DaBranch::RemoveLeaf( LPCWSTR, BOOL );
@@ -175,4 +180,44 @@ protected:
    BOOL           m_fKillDeviceItemOnDestroy;
 };
 
+//-----------------------------------------------------------------------------
+// CLASS DaAddressSpaceBuilder
+//-----------------------------------------------------------------------------
+// Builds the branches and leaves for a large number of Device Items in
+// parallel without locking the Server Address Space. The items are
+// distributed by their top level branch name to detached partitions which
+// are built by separate threads. Publish() moves the result into the
+// Server Address Space.
+class DaAddressSpaceBuilder
+{
+// Construction / Destruction
+public:
+   DaAddressSpaceBuilder();
+   ~DaAddressSpaceBuilder();
+
+// Operations
+public:
+   HRESULT  Build( DWORD dwCount, DaDeviceItem** ppDItems, HRESULT* pErrors );
+   void     Publish( DaBranch* pRoot, CAtlArray<DaDeviceItem*>& arRejected );
+
+// Implementation
+protected:
+   struct Partition
+   {
+      DaAddressSpaceBuilder*  pBuilder;
+      DaBranch                branch;          // Detached root of the partition
+      CAtlArray<DWORD>        arIndex;         // Indexes of the items in this partition
+   };
+
+   friend unsigned __stdcall BuildPartitionThread( void* pArg );
+
+   DWORD    PartitionOf( LPCWSTR szItemID ) const;
+   void     BuildPartition( Partition* pPartition );
+   void     RemovePartitions();
+
+   CAtlArray<Partition*>   m_arPartitions;
+   DaDeviceItem**          m_ppDItems;
+   HRESULT*                m_pErrors;
+};
+
 #endif // __HIERARCHICALSAS_H
@@ -23,6 +23,8 @@
  //-----------------------------------------------------------------------------
 #include "stdafx.h"
 #include "DaComBaseServer.h"
+#include "DaConfigSnapshot.h"
+#include "UtilityFuncs.h"
 #include "Logger.h"
 
 
@@ -56,20 +58,24 @@
 //=============================================================================
 // IOPCServerDisp::SaveConfig                                         INTERFACE
 //=============================================================================
-STDMETHODIMP DaComBaseServer:: SaveConfig( 
-	/* [in] */                    BSTR        FileName )
+STDMETHODIMP DaComBaseServer::SaveConfig(
+	/* [in] */                    BSTR        FileName)
 {
-	return E_NOTIMPL;
+	USES_CONVERSION;
+	LOGFMTI("IOPCServerDisp::SaveConfig file %s", FileName ? W2A(FileName) : "");
+	return Save(FileName, FALSE);
 }
 
 
 //=============================================================================
 // IOPCServerDisp::LoadConfig                                         INTERFACE
 //=============================================================================
-STDMETHODIMP DaComBaseServer:: LoadConfig(
-	/*[in]*/                      BSTR        FileName )
+STDMETHODIMP DaComBaseServer::LoadConfig(
+	/*[in]*/                      BSTR        FileName)
 {
-	return E_NOTIMPL;
+	USES_CONVERSION;
+	LOGFMTI("IOPCServerDisp::LoadConfig file %s", FileName ? W2A(FileName) : "");
+	return Load(FileName, STGM_READ);
 }
 
 
@@ -77,39 +83,98 @@ STDMETHODIMP DaComBaseServer:: LoadConfig(
 //////////////////////////////// IPersistFile /////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
 
+//=============================================================================
+// SetPersistFileName
+// ------------------
+//    Remembers the current configuration file.
+//=============================================================================
+static HRESULT SetPersistFileName(DaComBaseServer* pServer, LPCOLESTR pszFileName)
+{
+	LPWSTR pszCopy = WSTRClone((WCHAR *)pszFileName, NULL);
+	if (pszCopy == NULL) {
+		return E_OUTOFMEMORY;
+	}
+	pServer->persistCritSec_.Lock();
+	WSTRFree(pServer->persistFileName_, NULL);
+	pServer->persistFileName_ = pszCopy;
+	pServer->persistCritSec_.Unlock();
+	return S_OK;
+}
+
+
 //=============================================================================
 // IPersistFile::IsDirty                                              INTERFACE
+//
+// The groups and items are not tracked for changes, so the configuration is
+// always reported as changed.
 //=============================================================================
-STDMETHODIMP DaComBaseServer:: IsDirty( void )
+STDMETHODIMP DaComBaseServer::IsDirty(void)
 {
 	LOGFMTI("IPersistFile::IsDirty");
-	return E_NOTIMPL;
+	return S_OK;
 }
 
 
 //=============================================================================
 // IPersistFile::Load                                                 INTERFACE
+//
+// Restores the groups and items of a configuration snapshot. Groups with a
+// name already used by this server instance and unknown items are skipped.
 //=============================================================================
 STDMETHODIMP DaComBaseServer::Load(
-								  /* [in] */                    LPCOLESTR   pszFileName,
-								  /* [in] */                    DWORD       dwMode )
+	/* [in] */                    LPCOLESTR   pszFileName,
+	/* [in] */                    DWORD       dwMode)
 {
 	USES_CONVERSION; 
+	if (pszFileName == NULL) {
+		return E_INVALIDARG;
+	}
 	LOGFMTI("IPersistFile::Load file %s", W2A(pszFileName));
-	return E_NOTIMPL;
+
+	HRESULT hr = DaConfigSnapshot::Load(daGenericServer_, pszFileName);
+	if (FAILED(hr)) {
+		LOGFMTE("IPersistFile::Load failed with 0x%X", hr);
+		return hr;
+	}
+	return SetPersistFileName(this, pszFileName);
 }
 
 
 //=============================================================================
 // IPersistFile::Save                                                 INTERFACE
+//
+// Saves the private groups with their items to a configuration snapshot.
+// If pszFileName is NULL the current file is used.
 //=============================================================================
 STDMETHODIMP DaComBaseServer::Save(
-								  /* [in, unique] */            LPCOLESTR   pszFileName,
-								  /* [in]         */            BOOL        fRemember )
+	/* [in, unique] */            LPCOLESTR   pszFileName,
+	/* [in]         */            BOOL        fRemember)
 {
 	USES_CONVERSION;
-	LOGFMTI("IPersistFile::Save file %s", W2A(pszFileName));
-	return E_NOTIMPL;
+	HRESULT hr;
+
+	if (pszFileName == NULL) {
+		persistCritSec_.Lock();
+		LPWSTR pszCurFile = WSTRClone(persistFileName_, NULL);
+		persistCritSec_.Unlock();
+		if (pszCurFile == NULL) {
+			return E_INVALIDARG;                     // No current file
+		}
+		LOGFMTI("IPersistFile::Save file %s", W2A(pszCurFile));
+		hr = DaConfigSnapshot::Save(daGenericServer_, pszCurFile);
+		WSTRFree(pszCurFile, NULL);
+	}
+	else {
+		LOGFMTI("IPersistFile::Save file %s", W2A(pszFileName));
+		hr = DaConfigSnapshot::Save(daGenericServer_, pszFileName);
+		if (SUCCEEDED(hr) && fRemember) {
+			hr = SetPersistFileName(this, pszFileName);
+		}
+	}
+	if (FAILED(hr)) {
+		LOGFMTE("IPersistFile::Save failed with 0x%X", hr);
+	}
+	return hr;
 }
 
 
@@ -117,32 +182,46 @@ STDMETHODIMP DaComBaseServer::Save(
 // IPersistFile::SaveCompleted                                        INTERFACE
 //=============================================================================
 STDMETHODIMP DaComBaseServer::SaveCompleted(
-	/* [in, unique] */            LPCOLESTR   pszFileName )
+	/* [in, unique] */            LPCOLESTR   pszFileName)
 {
 	USES_CONVERSION;
-	LOGFMTI("IPersistFile::SaveCompleted file %s", W2A(pszFileName));
-	return E_NOTIMPL;
+	LOGFMTI("IPersistFile::SaveCompleted file %s", pszFileName ? W2A(pszFileName) : "");
+	return S_OK;
 }
 
 
 //=============================================================================
 // IPersistFile::GetCurFile                                           INTERFACE
+//
+// Returns the current configuration file or, if there is none, the default
+// save prompt with S_FALSE.
 //=============================================================================
 STDMETHODIMP DaComBaseServer::GetCurFile(
-										/* [out] */                   LPOLESTR *  ppszFileName )
+	/* [out] */                   LPOLESTR *  ppszFileName)
 {
 	LOGFMTI("IPersistFile::GetCurFile");
 
-	*ppszFileName = NULL;
-	return E_NOTIMPL;
+	if (ppszFileName == NULL) {
+		return E_INVALIDARG;
+	}
+
+	persistCritSec_.Lock();
+	BOOL fCurFile = (persistFileName_ != NULL);
+	*ppszFileName = WSTRClone(fCurFile ? persistFileName_ : L"*.dacfg", pIMalloc);
+	persistCritSec_.Unlock();
+
+	if (*ppszFileName == NULL) {
+		return E_OUTOFMEMORY;
+	}
+	return fCurFile ? S_OK : S_FALSE;
 }
 
 
 //=============================================================================
 // IPersistFile::GetClassID                                           INTERFACE
 //=============================================================================
-STDMETHODIMP DaComBaseServer:: GetClassID( 
-	/* [out] */                   CLSID    *  pClassID )
+STDMETHODIMP DaComBaseServer::GetClassID(
+	/* [out] */                   CLSID    *  pClassID)
 {
 	LOGFMTI("IPersistFile::GetClassID");
 
@@ -1313,6 +1313,22 @@ HRESULT DaServer::OnReleasePropertyCookie(
 }
 
 
+//=============================================================================
+// Get Property Device Item
+// ------------------------
+//    Returns the Device Item of the 'cookie' parameter. Required if the
+//    static property values are cached (see SetItemPropertyCaching()).
+//
+// SampleServer:
+//    OnQueryItemProperties() stores the Device Item in the 'cookie'.
+//=============================================================================
+DaDeviceItem* DaServer::OnGetPropertyDeviceItem(
+    /*[in]         */          LPVOID         pCookie)
+{
+    return static_cast<DaDeviceItem*>(pCookie);
+}
+
+
 //-----------------------------------------------------------------------------
 // DaServer Specific Functions
 //-----------------------------------------------------------------------------
@@ -1332,6 +1348,7 @@ HRESULT DaServer::DeleteServerItems()
 {
     m_ItemListLock.BeginWriting();               // protect item list access
     // we modify the item list
+    ClearItemIDCache();                          // Releases the cached Device Items
     m_SASRoot.RemoveAll();
     m_arServerItems.RemoveAll();
 
@@ -1362,6 +1379,75 @@ HRESULT DaServer::AddDeviceItem(DeviceItem* pDItem)
     }
 
     m_ItemListLock.EndWriting();                 // release item list protection
+
+    if (SUCCEEDED(hres)) {
+        DaDeviceItem* pItem = pDItem;
+        RestoreCachedValues(1, &pItem);          // Last known value from the cache snapshot
+    }
+    return hres;
+}
+
+//=============================================================================
+// Adds several Device Items to the Server Address Space               INTERNAL
+// The branches and leaves are built without locking the item list.
+// The item list is locked only to move the built branches into the
+// Server Address Space and to add the items to the server item list.
+// Items with errors are not added and must be deleted by the caller.
+//=============================================================================
+HRESULT DaServer::AddDeviceItems(DWORD dwCount, DeviceItem** ppDItems, HRESULT* errors)
+{
+    HRESULT hres;
+    DWORD i;
+
+    DaDeviceItem** ppItems = new DaDeviceItem*[dwCount];
+    if (ppItems == NULL) return E_OUTOFMEMORY;
+    for (i = 0; i < dwCount; i++) {
+        ppItems[i] = ppDItems[i];
+    }
+
+    DaAddressSpaceBuilder builder;
+    hres = builder.Build(dwCount, ppItems, errors);
+    if (FAILED(hres)) {
+        delete[] ppItems;
+        return hres;
+    }
+
+    CAtlArray<DaDeviceItem*> arRejected;
+    m_ItemListLock.BeginWriting();               // protect item list access
+    // we modify the item list
+    builder.Publish(&m_SASRoot, arRejected);
+
+    if (arRejected.GetCount()) {                 // ItemIds which already exist
+        CAtlMap<DaDeviceItem*, DWORD> mapIndex;
+        for (i = 0; i < dwCount; i++) {
+            mapIndex.SetAt(ppItems[i], i);
+        }
+        for (size_t n = 0; n < arRejected.GetCount(); n++) {
+            if (mapIndex.Lookup(arRejected[n], i)) {
+                errors[i] = E_INVALIDARG;
+            }
+        }
+    }
+
+    for (i = 0; i < dwCount; i++) {
+        if (SUCCEEDED(errors[i])) {
+            if (!m_arServerItems.Add(ppDItems[i])) {
+                LPWSTR pwszItemID;
+                ppDItems[i]->get_ItemIDPtr(&pwszItemID);
+                m_SASRoot.RemoveDeviceItemAssociatedLeaf(pwszItemID);
+                errors[i] = E_OUTOFMEMORY;
+            }
+        }
+        if (FAILED(errors[i])) {
+            hres = S_FALSE;
+            ppItems[i] = NULL;
+        }
+    }
+
+    m_ItemListLock.EndWriting();                 // release item list protection
+
+    RestoreCachedValues(dwCount, ppItems);       // Last known values from the cache snapshot
+    delete[] ppItems;
     return hres;
 }
 
@@ -1379,6 +1465,7 @@ HRESULT DaServer::RemoveDeviceItem(DeviceItem* pDItem)
         hres = m_SASRoot.RemoveDeviceItemAssociatedLeaf(pwszItemID);
     }
     if (SUCCEEDED(hres)) {
+        RemoveFromItemIDCache(pDItem);          // Release the reference of the cache
         pDItem->Kill(false);
         if (pDItem->get_RefCount() == 0) {
             DeleteDeviceItem(pDItem);
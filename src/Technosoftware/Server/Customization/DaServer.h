@@ -152,6 +152,7 @@ public:
 // Operations
 public:
    HRESULT AddDeviceItem( DeviceItem* pDItem );
+   HRESULT AddDeviceItems( DWORD dwCount, DeviceItem** ppDItems, HRESULT* errors );
    HRESULT RemoveDeviceItem( DeviceItem* pDItem );
    void DeleteDeviceItem( DeviceItem* pDItem );
 
@@ -304,6 +305,9 @@ protected:
    HRESULT OnReleasePropertyCookie(
          /*[in]         */          LPVOID         pCookie );
 
+   DaDeviceItem* OnGetPropertyDeviceItem(
+         /*[in]         */          LPVOID         pCookie );
+
    //////////////////////////////////////////////////////////////
    // Implementation internal functions (application specific) //
    //////////////////////////////////////////////////////////////
@@ -24,7 +24,12 @@
 #include "DaComServer.h"
 #include "DaGenericServer.h"
 #include "DaBaseServer.h"
+#include "DaRefreshCoalescer.h"
+#include "DaWriteBatcher.h"
+#include "DaCacheSnapshot.h"
+#include "DaItemIDCache.h"
 #include "UtilityFuncs.h"
+#include "Logger.h"
 #include "IClassicBaseNodeManager.h" 
 
 //=========================================================================
@@ -36,6 +41,14 @@ DaBaseServer::DaBaseServer(void)
     baseUpdateRate_ = 0;
     name_ = NULL;
     instanceIndex_ = 0;
+    refreshCoalescer_ = new DaRefreshCoalescer();
+    writeBatcher_ = new DaWriteBatcher();
+    outboundQueueSize_ = 0;
+    chunkMaxItems_ = 0;
+    chunkMaxBytes_ = 0;
+    cacheSnapshot_ = NULL;
+    propertyCaching_ = FALSE;
+    itemIDCache_ = new DaItemIDCache();
     InitializeCriticalSection(&criticalSection_);
     InitializeCriticalSection(&serversCriticalSection_);
 }
@@ -62,6 +75,23 @@ DaBaseServer::~DaBaseServer()
 	}
 
 	itemProperties_.~OpenArray();
+
+    if (refreshCoalescer_) {
+        delete refreshCoalescer_;
+        refreshCoalescer_ = NULL;
+    }
+    if (writeBatcher_) {
+        delete writeBatcher_;
+        writeBatcher_ = NULL;
+    }
+    if (cacheSnapshot_) {
+        delete cacheSnapshot_;
+        cacheSnapshot_ = NULL;
+    }
+    if (itemIDCache_) {
+        delete itemIDCache_;
+        itemIDCache_ = NULL;
+    }
 	
     DeleteCriticalSection(&serversCriticalSection_);
     DeleteCriticalSection(&criticalSection_);
@@ -123,6 +153,407 @@ HRESULT DaBaseServer::GetItemProperty(DWORD dwPropID, DaItemProperty** ppProp)
 }
 
 
+//=========================================================================
+// GetItemProperties
+// -----------------
+//    Gets the values of the requested properties for several items.
+//    The available property IDs of each item are sorted so the requested
+//    IDs can be checked without comparing each with all available IDs.
+//
+// return:
+//    S_OK if succeeded for all properties; otherwise S_FALSE.
+//=========================================================================
+HRESULT DaBaseServer::GetItemProperties(
+    DWORD                numItems,
+    LPWSTR            *  itemIDs,
+    DWORD                numProps,
+    DWORD             *  propIDs,
+    LPVARIANT            values,
+    HRESULT           *  errors,
+    HRESULT           *  itemErrors)
+{
+    HRESULT hrRet = S_OK;
+
+    for (DWORD i = 0; i < numItems; i++) {
+
+        HRESULT*  pErrors = &errors[i * numProps];
+        LPDWORD   pdwAvailIDs = NULL;
+        DWORD     dwNumAvail = 0;
+        LPVOID    pCookie = NULL;
+        DWORD     z;
+
+        itemErrors[i] = OnQueryItemProperties(itemIDs[i], &dwNumAvail, &pdwAvailIDs, &pCookie);
+        if (FAILED(itemErrors[i])) {
+            for (z = 0; z < numProps; z++) {
+                pErrors[z] = itemErrors[i];
+            }
+            hrRet = S_FALSE;
+            continue;
+        }
+
+        // Sort the available IDs (insertion sort, the lists are short)
+        for (z = 1; z < dwNumAvail; z++) {
+            DWORD dwID = pdwAvailIDs[z];
+            DWORD n = z;
+            while (n > 0 && pdwAvailIDs[n - 1] > dwID) {
+                pdwAvailIDs[n] = pdwAvailIDs[n - 1];
+                n--;
+            }
+            pdwAvailIDs[n] = dwID;
+        }
+
+        for (z = 0; z < numProps; z++) {
+            pErrors[z] = OPC_E_INVALID_PID;
+            DWORD dwLow = 0;
+            DWORD dwHigh = dwNumAvail;
+            while (dwLow < dwHigh) {
+                DWORD dwMid = (dwLow + dwHigh) / 2;
+                if (pdwAvailIDs[dwMid] == propIDs[z]) {
+                    pErrors[z] = S_OK;
+                    break;
+                }
+                if (pdwAvailIDs[dwMid] < propIDs[z]) {
+                    dwLow = dwMid + 1;
+                }
+                else {
+                    dwHigh = dwMid;
+                }
+            }
+        }
+
+        if (GetItemPropertyValues(itemIDs[i], pCookie, numProps, propIDs,
+                                  &values[i * numProps], pErrors) != S_OK) {
+            hrRet = S_FALSE;
+        }
+
+        itemErrors[i] = OnReleasePropertyCookie(pCookie);
+        if (FAILED(itemErrors[i])) {
+            hrRet = S_FALSE;
+        }
+        if (pdwAvailIDs) {
+            delete[] pdwAvailIDs;
+        }
+    }
+    return hrRet;
+}
+
+
+//=========================================================================
+// GetItemPropertyValues
+// ---------------------
+//    Gets the values of the properties with a succeeded result in errors.
+//    If property caching is enabled the static values are read from the
+//    table of the Device Item. Values not yet in the table are read with
+//    OnGetItemProperty() and added to a new table.
+//
+// return:
+//    S_OK if succeeded for all properties; otherwise S_FALSE.
+//=========================================================================
+HRESULT DaBaseServer::GetItemPropertyValues(
+    LPCWSTR              itemID,
+    LPVOID               cookie,
+    DWORD                numProps,
+    DWORD             *  propIDs,
+    LPVARIANT            values,
+    HRESULT           *  errors)
+{
+    HRESULT              hrRet = S_OK;
+    DaDeviceItem*        pDItem = propertyCaching_ ? OnGetPropertyDeviceItem(cookie) : NULL;
+    DaItemPropertyTable* pTable = NULL;
+    DWORD                dwRevision = 0;
+    LPDWORD              pdwNewIdx = NULL;
+    DWORD                dwNumNew = 0;
+
+    if (pDItem) {
+        pDItem->get_PropertyTable(&pTable, &dwRevision);
+        pdwNewIdx = new DWORD[numProps];        // Indices of static values to add
+    }
+
+    for (DWORD i = 0; i < numProps; i++) {
+        if (FAILED(errors[i])) {
+            hrRet = S_FALSE;
+            continue;                           // Property not available
+        }
+        if (pTable && pTable->Lookup(propIDs[i], &values[i]) == S_OK) {
+            continue;                           // Cached static value
+        }
+        errors[i] = OnGetItemProperty(itemID, propIDs[i], &values[i], cookie);
+        if (FAILED(errors[i])) {
+            hrRet = S_FALSE;
+        }
+        else if (pdwNewIdx && DaItemPropertyTable::IsStaticProperty(propIDs[i])) {
+            pdwNewIdx[dwNumNew++] = i;
+        }
+    }
+
+    if (dwNumNew) {
+        LPDWORD   pdwIDs = new DWORD[dwNumNew];
+        LPVARIANT pvValues = new VARIANT[dwNumNew];
+        if (pdwIDs && pvValues) {
+            for (DWORD n = 0; n < dwNumNew; n++) {
+                pdwIDs[n] = propIDs[pdwNewIdx[n]];
+                pvValues[n] = values[pdwNewIdx[n]]; // No copy, the values are copied by Create()
+            }
+            DaItemPropertyTable* pNewTable = NULL;
+            if (SUCCEEDED(DaItemPropertyTable::Create(pTable, dwNumNew, pdwIDs, pvValues, &pNewTable))) {
+                pDItem->set_PropertyTable(pNewTable, dwRevision);
+                pNewTable->Release();
+            }
+        }
+        if (pdwIDs) delete[] pdwIDs;
+        if (pvValues) delete[] pvValues;
+    }
+
+    if (pdwNewIdx) {
+        delete[] pdwNewIdx;
+    }
+    if (pTable) {
+        pTable->Release();
+    }
+    return hrRet;
+}
+
+
+//=========================================================================
+// SetItemIDCacheSize
+//=========================================================================
+void DaBaseServer::SetItemIDCacheSize(DWORD maxItems)
+{
+    if (itemIDCache_) {
+        itemIDCache_->SetCapacity(maxItems);
+    }
+}
+
+
+//=========================================================================
+// RemoveFromItemIDCache
+//=========================================================================
+void DaBaseServer::RemoveFromItemIDCache(DaDeviceItem* deviceItem)
+{
+    if (itemIDCache_) {
+        itemIDCache_->Remove(deviceItem);
+    }
+}
+
+
+//=========================================================================
+// ClearItemIDCache
+//=========================================================================
+void DaBaseServer::ClearItemIDCache()
+{
+    if (itemIDCache_) {
+        itemIDCache_->RemoveAll();
+    }
+}
+
+
+//=========================================================================
+// ValidateItemIDs
+// ---------------
+//    Resolves the ItemIDs of the stateless IOPCItemIO functions.
+//    Only the ItemIDs not found in the cache are passed to
+//    OnValidateItems().
+//
+// return:
+//    S_OK if succeeded for all items; otherwise S_FALSE.
+//=========================================================================
+HRESULT DaBaseServer::ValidateItemIDs(
+    DWORD                numItems,
+    LPCWSTR           *  itemIDs,
+    VARTYPE           *  requestedTypes,
+    DaDeviceItem      ** deviceItems,
+    HRESULT           *  errors)
+{
+    BOOL    fCache = (itemIDCache_ && itemIDCache_->IsEnabled()) ? TRUE : FALSE;
+    HRESULT hrRet = S_OK;
+    DWORD   dwNumMissed = 0;
+    DWORD   i;
+
+    CAutoVectorPtr<DWORD>         avpMissed;    // Indices of the items to validate
+    CAutoVectorPtr<OPCITEMDEF>    avpItemDefs;
+    CAutoVectorPtr<DaDeviceItem*> avpDItems;
+    CAutoVectorPtr<HRESULT>       avpErrors;
+
+    if (!avpMissed.Allocate(numItems) || !avpItemDefs.Allocate(numItems) ||
+        !avpDItems.Allocate(numItems) || !avpErrors.Allocate(numItems)) {
+        for (i = 0; i < numItems; i++) {
+            deviceItems[i] = NULL;
+            errors[i] = E_OUTOFMEMORY;
+        }
+        return S_FALSE;
+    }
+
+    for (i = 0; i < numItems; i++) {
+        deviceItems[i] = NULL;
+        errors[i] = S_OK;
+        if (fCache && itemIDCache_->Lookup(itemIDs[i], &deviceItems[i])) {
+            continue;                           // Resolved without validation
+        }
+
+        OPCITEMDEF* pItemDef = &avpItemDefs[dwNumMissed];
+        pItemDef->szAccessPath = L"";
+        pItemDef->szItemID = (LPWSTR)itemIDs[i];
+        pItemDef->bActive = TRUE;
+        pItemDef->hClient = i;
+        pItemDef->dwBlobSize = 0;
+        pItemDef->pBlob = NULL;
+        pItemDef->vtRequestedDataType = requestedTypes ? requestedTypes[i] : VT_EMPTY;
+        pItemDef->wReserved = 0;
+
+        avpDItems[dwNumMissed] = NULL;
+        avpErrors[dwNumMissed] = S_OK;
+        avpMissed[dwNumMissed++] = i;
+    }
+
+    if (dwNumMissed) {
+        hrRet = OnValidateItems(
+            OPC_VALIDATEREQ_DEVICEITEMS,
+            FALSE,                              // No Blob Update
+            dwNumMissed,
+            avpItemDefs,
+            avpDItems,
+            NULL,
+            avpErrors);
+
+        _ASSERTE(SUCCEEDED(hrRet));             // Must return S_OK or S_FALSE
+
+        for (DWORD n = 0; n < dwNumMissed; n++) {
+            i = avpMissed[n];
+            deviceItems[i] = avpDItems[n];
+            errors[i] = avpErrors[n];
+            if (fCache && deviceItems[i]) {
+                itemIDCache_->Add(itemIDs[i], deviceItems[i]);
+            }
+        }
+    }
+    return hrRet;
+}
+
+
+//=========================================================================
+// RefreshInputCache
+// -----------------
+//    Refreshes the cache of the specified items. If enabled concurrent
+//    requests for the same items and reason are coalesced into one
+//    OnRefreshInputCache() call.
+//
+// return:
+//    S_OK if succeeded for all items; otherwise S_FALSE.
+//=========================================================================
+HRESULT DaBaseServer::RefreshInputCache(
+    OPC_REFRESH_REASON   dwReason,
+    DWORD                numItems,
+    DaDeviceItem      ** pDevItemPtr,
+    HRESULT           *  errors)
+{
+    if (refreshCoalescer_ == NULL) {
+        return OnRefreshInputCache(dwReason, numItems, pDevItemPtr, errors);
+    }
+    return refreshCoalescer_->Refresh(this, dwReason, numItems, pDevItemPtr, errors);
+}
+
+
+//=========================================================================
+// SetRefreshCoalescing
+//=========================================================================
+void DaBaseServer::SetRefreshCoalescing(BOOL enabled, DWORD joinWindow /* = 0 */)
+{
+    if (refreshCoalescer_) {
+        refreshCoalescer_->SetEnabled(enabled);
+        refreshCoalescer_->SetJoinWindow(joinWindow);
+    }
+}
+
+
+//=========================================================================
+// GetDeduplicatedReadCount
+//=========================================================================
+LONG DaBaseServer::GetDeduplicatedReadCount()
+{
+    return refreshCoalescer_ ? refreshCoalescer_->DeduplicatedReads() : 0;
+}
+
+
+//=========================================================================
+// RefreshOutputDevices
+// --------------------
+//    Writes the values of the specified items. If write batching is
+//    enabled the write requests within the batching window are passed
+//    with one OnRefreshOutputDevices() call.
+//
+// return:
+//    S_OK if succeeded for all items; otherwise S_FALSE.
+//=========================================================================
+HRESULT DaBaseServer::RefreshOutputDevices(
+    OPC_REFRESH_REASON   dwReason,
+    LPWSTR               szActorID,
+    DWORD                numItems,
+    DaDeviceItem      ** pDevItemPtr,
+    OPCITEMVQT        *  pItemVQTs,
+    HRESULT           *  errors)
+{
+    if (writeBatcher_ == NULL) {
+        return OnRefreshOutputDevices(dwReason, szActorID, numItems, pDevItemPtr, pItemVQTs, errors);
+    }
+    return writeBatcher_->Write(this, dwReason, szActorID, numItems, pDevItemPtr, pItemVQTs, errors);
+}
+
+
+//=========================================================================
+// SetWriteBatching
+//=========================================================================
+void DaBaseServer::SetWriteBatching(DWORD window)
+{
+    if (writeBatcher_) {
+        writeBatcher_->SetWindow(window);
+    }
+}
+
+
+//=========================================================================
+// GetMergedWriteCount
+//=========================================================================
+LONG DaBaseServer::GetMergedWriteCount()
+{
+    return writeBatcher_ ? writeBatcher_->MergedWrites() : 0;
+}
+
+
+//=========================================================================
+// EnableCacheSnapshot
+//=========================================================================
+HRESULT DaBaseServer::EnableCacheSnapshot(LPCWSTR fileName, DWORD interval)
+{
+    if (cacheSnapshot_) {
+        return E_FAIL;                          // Already enabled
+    }
+
+    DaCacheSnapshot* pSnapshot = new DaCacheSnapshot();
+    if (pSnapshot == NULL) {
+        return E_OUTOFMEMORY;
+    }
+    HRESULT hres = pSnapshot->Create(fileName, interval, &readWriteLock_);
+    if (FAILED(hres)) {
+        LOGFMTE("EnableCacheSnapshot() failed with hres = 0x%x.", hres);
+        delete pSnapshot;
+        return hres;
+    }
+    cacheSnapshot_ = pSnapshot;
+    return S_OK;
+}
+
+
+//=========================================================================
+// RestoreCachedValues
+//=========================================================================
+void DaBaseServer::RestoreCachedValues(DWORD numItems, DaDeviceItem** deviceItems)
+{
+    if (cacheSnapshot_) {
+        cacheSnapshot_->Restore(numItems, deviceItems);
+    }
+}
+
+
 //=========================================================================
 // FireShutdownRequest
 // -------------------
@@ -110,6 +110,10 @@ typedef enum tagOPC_VALIDATE_REQUEST {
 
 class DaDeviceItem;
 class DaGenericServer;
+class DaRefreshCoalescer;
+class DaWriteBatcher;
+class DaCacheSnapshot;
+class DaItemIDCache;
 
 /**
  * @class	DaBaseServer
@@ -318,6 +322,255 @@ public:
         /*[in, size_is(,numItems)]          */ OPCITEMVQT               * pItemVQTs,
         /*[in, size_is(,numItems)]          */ HRESULT                  * errors) = 0;
 
+    /**
+     * @fn  HRESULT DaBaseServer::RefreshInputCache( OPC_REFRESH_REASON dwReason, DWORD numItems, DaDeviceItem ** pDevItemPtr, HRESULT * errors);
+     *
+     * @brief   Refreshes the cache of the specified items from the device. Used by the generic
+     *          server part instead of calling OnRefreshInputCache() directly. If enabled with
+     *          SetRefreshCoalescing() concurrent requests for the same items and reason are
+     *          coalesced into one OnRefreshInputCache() call and share its individual item
+     *          results.
+     *
+     * @param   dwReason                The reason of the refresh.
+     * @param   numItems                Number of items.
+     * @param [in]      pDevItemPtr     The Device Items. Entries may be NULL.
+     * @param [in,out]  errors          The individual item results.
+     *
+     * @return  S_OK if the refresh succeeded for all items; otherwise S_FALSE.
+     */
+
+    HRESULT RefreshInputCache(
+        /*[in]                              */ OPC_REFRESH_REASON         dwReason,
+        /*[in]                              */ DWORD                      numItems,
+        /*[in, size_is(,numItems)]          */ DaDeviceItem            ** pDevItemPtr,
+        /*[in, size_is(,numItems)]          */ HRESULT                  * errors);
+
+    /**
+     * @fn  void DaBaseServer::SetRefreshCoalescing(BOOL enabled, DWORD joinWindow = 0);
+     *
+     * @brief   Configures the coalescing of concurrent device reads done by RefreshInputCache().
+     *
+     * @param   enabled     TRUE to coalesce concurrent device reads. Disabled by default.
+     * @param   joinWindow  Time in ms a finished device read can still be shared. 0 shares only
+     *                      device reads in progress.
+     */
+
+    void SetRefreshCoalescing(BOOL enabled, DWORD joinWindow = 0);
+
+    /**
+     * @fn  LONG DaBaseServer::GetDeduplicatedReadCount();
+     *
+     * @brief   Gets the number of item device reads which were served by a concurrent device
+     *          read of another request.
+     *
+     * @return  The number of deduplicated item reads.
+     */
+
+    LONG GetDeduplicatedReadCount();
+
+    /**
+     * @fn  HRESULT DaBaseServer::RefreshOutputDevices( OPC_REFRESH_REASON dwReason, LPWSTR szActorID, DWORD numItems, DaDeviceItem ** pDevItemPtr, OPCITEMVQT * pItemVQTs, HRESULT * errors);
+     *
+     * @brief   Writes the specified values to the device. Used by the generic server part
+     *          instead of calling OnRefreshOutputDevices() directly. If write batching is
+     *          enabled the write requests of all clients within the batching window are passed
+     *          with a single OnRefreshOutputDevices() call.
+     *
+     * @param   dwReason                The reason of the write.
+     * @param [in]      szActorID       The client name.
+     * @param   numItems                Number of items.
+     * @param [in]      pDevItemPtr     The Device Items. Entries may be NULL.
+     * @param [in]      pItemVQTs       The values to write.
+     * @param [in,out]  errors          The individual item results.
+     *
+     * @return  S_OK if the write succeeded for all items; otherwise S_FALSE.
+     */
+
+    HRESULT RefreshOutputDevices(
+        /*[in]                              */ OPC_REFRESH_REASON         dwReason,
+        /*[in, string]                      */ LPWSTR                     szActorID,
+        /*[in]                              */ DWORD                      numItems,
+        /*[in, size_is(,numItems)]          */ DaDeviceItem            ** pDevItemPtr,
+        /*[in, size_is(,numItems)]          */ OPCITEMVQT               * pItemVQTs,
+        /*[in, size_is(,numItems)]          */ HRESULT                  * errors);
+
+    /**
+     * @fn  void DaBaseServer::SetWriteBatching(DWORD window);
+     *
+     * @brief   Configures the batching of device writes done by RefreshOutputDevices().
+     *
+     * @param   window  Time in ms write requests are collected before they are passed to
+     *                  OnRefreshOutputDevices(). 0 disables write batching (default).
+     */
+
+    void SetWriteBatching(DWORD window);
+
+    /**
+     * @fn  LONG DaBaseServer::GetMergedWriteCount();
+     *
+     * @brief   Gets the number of item writes which were superseded by a later write of the
+     *          same item within the batching window.
+     *
+     * @return  The number of merged item writes.
+     */
+
+    LONG GetMergedWriteCount();
+
+    /**
+     * @fn  void DaBaseServer::SetOutboundQueueSize(DWORD maxItems);
+     *
+     * @brief   Configures the outbound queue used to deliver the data change callbacks of each
+     *          client. With a queue a slow client no longer blocks the update thread. Pending
+     *          values of the same item are replaced by the latest value if the client falls
+     *          behind. Applies to clients connecting after the call.
+     *
+     * @param   maxItems    Maximum number of pending item values per client. 0 disables the
+     *                      queue and the callbacks are sent by the update thread (default).
+     */
+
+    void SetOutboundQueueSize(DWORD maxItems) { outboundQueueSize_ = maxItems; }
+
+    /**
+     * @fn  DWORD DaBaseServer::GetOutboundQueueSize();
+     *
+     * @brief   Gets the maximum number of pending item values per client.
+     *
+     * @return  The outbound queue size, 0 if the queue is not used.
+     */
+
+    DWORD GetOutboundQueueSize() { return outboundQueueSize_; }
+
+    /**
+     * @fn  void DaBaseServer::SetDataChangeChunking(DWORD maxItems, DWORD maxBytes);
+     *
+     * @brief   Limits the size of a single data change callback. Large change sets of a group
+     *          are split into a sequence of callbacks so the memory used per callback is
+     *          bounded and the client receives the first values sooner.
+     *
+     * @param   maxItems    Maximum number of items per callback. 0 means no item limit (default).
+     * @param   maxBytes    Maximum estimated size in bytes of the item values per callback. 0
+     *                      means no size limit (default). A callback contains at least one item.
+     */
+
+    void SetDataChangeChunking(DWORD maxItems, DWORD maxBytes) { chunkMaxItems_ = maxItems; chunkMaxBytes_ = maxBytes; }
+
+    /**
+     * @fn  DWORD DaBaseServer::GetDataChangeChunkItems();
+     *
+     * @brief   Gets the maximum number of items per data change callback.
+     *
+     * @return  The maximum number of items, 0 if not limited.
+     */
+
+    DWORD GetDataChangeChunkItems() { return chunkMaxItems_; }
+
+    /**
+     * @fn  DWORD DaBaseServer::GetDataChangeChunkBytes();
+     *
+     * @brief   Gets the maximum estimated size in bytes of the item values per data change
+     *          callback.
+     *
+     * @return  The maximum size in bytes, 0 if not limited.
+     */
+
+    DWORD GetDataChangeChunkBytes() { return chunkMaxBytes_; }
+
+    /**
+     * @fn  void DaBaseServer::SetItemPropertyCaching(BOOL enabled);
+     *
+     * @brief   Enables the cache of the static item property values like EU Info or the
+     *          description. The values are stored per Device Item and discarded if the item
+     *          is changed. Requires OnGetPropertyDeviceItem(). If the application changes the
+     *          value of a static property it must call DaDeviceItem::InvalidatePropertyTable().
+     *
+     * @param   enabled TRUE to cache the static property values; FALSE to read every value
+     *                  with OnGetItemProperty() (default).
+     */
+
+    void SetItemPropertyCaching(BOOL enabled) { propertyCaching_ = enabled; }
+
+    /**
+     * @fn  void DaBaseServer::SetItemIDCacheSize(DWORD maxItems);
+     *
+     * @brief   Configures the cache of the ItemIDs resolved by IOPCItemIO::Read() and
+     *          IOPCItemIO::WriteVQT(). Cached ItemIDs are not validated again with
+     *          OnValidateItems(). The cache holds a reference to the Device Items; the server
+     *          must call RemoveFromItemIDCache() before a Device Item is killed.
+     *
+     * @param   maxItems    Maximum number of cached ItemIDs, the least recently used are
+     *                      removed first. 0 disables the cache (default).
+     */
+
+    void SetItemIDCacheSize(DWORD maxItems);
+
+    /**
+     * @fn  void DaBaseServer::RemoveFromItemIDCache(DaDeviceItem* deviceItem);
+     *
+     * @brief   Removes a Device Item from the ItemID cache. Must be called before the Device
+     *          Item is killed.
+     *
+     * @param [in]  deviceItem  The Device Item.
+     */
+
+    void RemoveFromItemIDCache(DaDeviceItem* deviceItem);
+
+    /**
+     * @fn  void DaBaseServer::ClearItemIDCache();
+     *
+     * @brief   Removes all Device Items from the ItemID cache. Must be called before the Device
+     *          Items are deleted.
+     */
+
+    void ClearItemIDCache();
+
+    /**
+     * @fn  HRESULT DaBaseServer::ValidateItemIDs(DWORD numItems, LPCWSTR* itemIDs, VARTYPE* requestedTypes, DaDeviceItem** deviceItems, HRESULT* errors);
+     *
+     * @brief   Gets the Device Items of ItemIDs. ItemIDs found in the ItemID cache are not
+     *          validated; all others are validated with one call of OnValidateItems() and
+     *          added to the cache.
+     *
+     * @param   numItems            Number of items.
+     * @param   itemIDs             The ItemIDs.
+     * @param   requestedTypes      The requested data types or NULL for VT_EMPTY.
+     * @param [out] deviceItems     The attached Device Items; NULL if validation failed.
+     * @param [out] errors          The individual item results.
+     *
+     * @return  S_OK if succeeded for all items; otherwise S_FALSE.
+     */
+
+    HRESULT ValidateItemIDs(DWORD numItems, LPCWSTR* itemIDs, VARTYPE* requestedTypes,
+                            DaDeviceItem** deviceItems, HRESULT* errors);
+
+    /**
+     * @fn  HRESULT DaBaseServer::EnableCacheSnapshot(LPCWSTR fileName, DWORD interval);
+     *
+     * @brief   Enables the warm-start snapshot of the Device Item caches. The values of changed
+     *          items are written periodically to a memory mapped file. After a restart the
+     *          stored values are restored with quality OPC_QUALITY_LAST_KNOWN until the device
+     *          delivers new values. Must be called before the Device Items are added.
+     *
+     * @param   fileName    Name of the snapshot file.
+     * @param   interval    Time in ms between two writes of the changed items.
+     *
+     * @return  S_OK if succeeded; otherwise an error code.
+     */
+
+    HRESULT EnableCacheSnapshot(LPCWSTR fileName, DWORD interval);
+
+    /**
+     * @fn  void DaBaseServer::RestoreCachedValues(DWORD numItems, DaDeviceItem** deviceItems);
+     *
+     * @brief   Restores the last known values of Device Items added to the server address
+     *          space and tracks the changes of their cache. Does nothing if the cache snapshot
+     *          is not enabled.
+     *
+     * @param   numItems        Number of items.
+     * @param   deviceItems     The Device Items. Entries may be NULL.
+     */
+
+    void RestoreCachedValues(DWORD numItems, DaDeviceItem** deviceItems);
+
     ///////////////////////////////////////////
     // Server Address Space Browse Functions //
     ///////////////////////////////////////////
@@ -387,6 +640,15 @@ public:
         return S_OK;
     }
 
+    // Returns the Device Item the property cookie refers to or NULL
+    // if the cookie is not a Device Item. Used by the cache of the
+    // static item property values.
+    virtual DaDeviceItem* OnGetPropertyDeviceItem(
+        /*[in]         */                   LPVOID         pCookie)
+    {
+        return NULL;
+    }
+
     //////////////////////////////////////////////////////////
     // End of functions located in the server-specific part //
     //////////////////////////////////////////////////////////
@@ -495,6 +757,48 @@ public:
     // Returns the item property definition with the specified ID
     HRESULT GetItemProperty(DWORD dwPropID, DaItemProperty** ppProp);
 
+    /**
+     * @fn  HRESULT DaBaseServer::GetItemProperties(DWORD numItems, LPWSTR* itemIDs, DWORD numProps, DWORD* propIDs, LPVARIANT values, HRESULT* errors, HRESULT* itemErrors);
+     *
+     * @brief   Gets the values of the same properties of several items. The available
+     *          properties are queried once per item.
+     *
+     * @param   numItems            Number of items.
+     * @param   itemIDs             The ItemIDs.
+     * @param   numProps            Number of requested properties per item.
+     * @param   propIDs             The requested property IDs.
+     * @param [out] values          numItems * numProps initialized values, the values of an
+     *                              item are stored consecutively.
+     * @param [out] errors          numItems * numProps results. OPC_E_INVALID_PID if the item
+     *                              has not the property.
+     * @param [out] itemErrors      The result of OnQueryItemProperties() for each item.
+     *
+     * @return  S_OK if succeeded for all properties; otherwise S_FALSE.
+     */
+
+    HRESULT GetItemProperties(DWORD numItems, LPWSTR* itemIDs, DWORD numProps, DWORD* propIDs,
+                              LPVARIANT values, HRESULT* errors, HRESULT* itemErrors);
+
+    /**
+     * @fn  HRESULT DaBaseServer::GetItemPropertyValues(LPCWSTR itemID, LPVOID cookie, DWORD numProps, DWORD* propIDs, LPVARIANT values, HRESULT* errors);
+     *
+     * @brief   Gets the values of properties which are available for the item. Static
+     *          property values are taken from the cache of the Device Item if enabled.
+     *
+     * @param   itemID          The ItemID.
+     * @param   cookie          The cookie returned by OnQueryItemProperties().
+     * @param   numProps        Number of properties.
+     * @param   propIDs         The property IDs.
+     * @param [out] values      The initialized values.
+     * @param [in,out] errors   Only properties with a succeeded result are read; the result
+     *                          of reading the property is returned.
+     *
+     * @return  S_OK if succeeded for all properties; otherwise S_FALSE.
+     */
+
+    HRESULT GetItemPropertyValues(LPCWSTR itemID, LPVOID cookie, DWORD numProps, DWORD* propIDs,
+                                  LPVARIANT values, HRESULT* errors);
+
     // Add a new item property definition
     inline
         HRESULT AddItemProperty(DaItemProperty* pProp)
@@ -562,6 +866,30 @@ private:
 
     /** @brief	this list conatains all Item Properties which may be attached to an item. */
     OpenArray<DaItemProperty *> itemProperties_;
+
+    /** @brief	coalesces concurrent device reads of RefreshInputCache(). */
+    DaRefreshCoalescer* refreshCoalescer_;
+
+    /** @brief	batches device writes of RefreshOutputDevices(). */
+    DaWriteBatcher* writeBatcher_;
+
+    /** @brief	maximum number of pending item values per client, 0 if no outbound queue. */
+    DWORD outboundQueueSize_;
+
+    /** @brief	maximum number of items per data change callback, 0 if not limited. */
+    DWORD chunkMaxItems_;
+
+    /** @brief	maximum size in bytes per data change callback, 0 if not limited. */
+    DWORD chunkMaxBytes_;
+
+    /** @brief	warm-start snapshot of the Device Item caches, NULL if not enabled. */
+    DaCacheSnapshot* cacheSnapshot_;
+
+    /** @brief	tells whether the static item property values are cached. */
+    BOOL propertyCaching_;
+
+    /** @brief	resolved ItemIDs of the IOPCItemIO functions. */
+    DaItemIDCache* itemIDCache_;
 };
 
 #endif // __SERVERCLASSHANDLER_
@@ -435,8 +435,6 @@ STDMETHODIMP DaBrowse::GetProperties(
 {
 	LOGFMTI("IOPCBrowse::GetProperties");
 
-	VARIANT value;
-	VariantInit(&value);
 	*ppItemProperties = NULL;                    // Note : Proxy/Stub checks if the pointers are NULL
 
 	if (dwItemCount == 0) {
@@ -458,6 +456,8 @@ STDMETHODIMP DaBrowse::GetProperties(
 		DWORD    dwRevisedPropertyCount = 0;
 		DWORD*   pdwRevisedPropertyIDs = NULL;
 		HRESULT* phrRevisedErrorIDs = NULL;
+		VARIANT* pValues = NULL;
+		HRESULT* phrValues = NULL;
 
 		LPVOID   pCookie = NULL;
 		BOOL     fReleaseCookie = FALSE;
@@ -481,6 +481,25 @@ STDMETHODIMP DaBrowse::GetProperties(
 			InitArrayOfOPCITEMPROPERTY(dwRevisedPropertyCount, pProps[i].pItemProperties);
 			pProps[i].dwNumProperties = dwRevisedPropertyCount;
 
+			if (bReturnPropertyValues) {
+				// Get the values of all properties with one call
+				phrValues = new HRESULT[dwRevisedPropertyCount];
+				_OPC_CHECK_PTR(phrValues);
+				pValues = new VARIANT[dwRevisedPropertyCount];
+				_OPC_CHECK_PTR(pValues);
+				for (DWORD z = 0; z < dwRevisedPropertyCount; z++) {
+					VariantInit(&pValues[z]);
+					phrValues[z] = phrRevisedErrorIDs[z];
+				}
+				m_pServerHandler->GetItemPropertyValues(
+					pszItemIDs[i],
+					pCookie,
+					dwRevisedPropertyCount,
+					pdwRevisedPropertyIDs,
+					pValues,
+					phrValues);
+			}
+
 			pProps[i].hrErrorID = S_OK;
 			// Get Information for all requested Properties of an Item
 			for (DWORD z = 0; z < dwRevisedPropertyCount; z++) {
@@ -536,13 +555,10 @@ STDMETHODIMP DaBrowse::GetProperties(
 						//
 						{
 							if (bReturnPropertyValues) {
-								HRESULT hrGet = m_pServerHandler->OnGetItemProperty(
-									pszItemIDs[i],
-									pdwRevisedPropertyIDs[z],
-									&value,
-									pCookie);
-								VariantCopy(&pProps[i].pItemProperties[z].vValue, &value);
-								_OPC_CHECK_HR(hrGet);
+								// Move the value, it is no longer used
+								pProps[i].pItemProperties[z].vValue = pValues[z];
+								VariantInit(&pValues[z]);
+								_OPC_CHECK_HR(phrValues[z]);
 							}
 						}
 
@@ -560,7 +576,6 @@ STDMETHODIMP DaBrowse::GetProperties(
 					ReleaseOPCITEMPROPERTY(&pProps[i].pItemProperties[z]);
 					pProps[i].hrErrorID = S_FALSE;
 				}
-				VariantClear(&value);
 
 			} // Get Information for all requested Properties of an Item
 		}
@@ -582,6 +597,15 @@ STDMETHODIMP DaBrowse::GetProperties(
 		if (phrRevisedErrorIDs) {
 			delete[] phrRevisedErrorIDs;
 		}
+		if (pValues) {
+			for (DWORD z = 0; z < dwRevisedPropertyCount; z++) {
+				VariantClear(&pValues[z]);
+			}
+			delete[] pValues;
+		}
+		if (phrValues) {
+			delete[] phrValues;
+		}
 
 		if (fReleaseCookie) {
 			m_pServerHandler->OnReleasePropertyCookie(pCookie);
@@ -591,7 +615,6 @@ STDMETHODIMP DaBrowse::GetProperties(
 	} // Get Properties for all specified Items
 
 	*ppItemProperties = pProps;
-	VariantClear(&value);
 	return hrRet;
 }
 
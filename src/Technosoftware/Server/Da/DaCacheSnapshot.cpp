@@ -0,0 +1,535 @@
+/*
+ * Copyright (c) 2020 Technosoftware GmbH. All rights reserved
+ * Web: https://technosoftware.com
+ *
+ * The source code in this file is covered under a dual-license scenario:
+ *   - Owner of a purchased license: SCLA 1.0
+ *   - GPL V3: everybody else
+ *
+ * SCLA license terms accompanied with this source code.
+ * See https://technosoftware.com/license/Source_Code_License_Agreement.pdf
+ *
+ * GNU General Public License as published by the Free Software Foundation;
+ * version 3 of the License are accompanied with this source code.
+ * See https://technosoftware.com/license/GPLv3License.txt
+ *
+ * This source code is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+ //DOM-IGNORE-BEGIN
+
+#include "stdafx.h"
+#include <process.h>
+#include <stddef.h>
+#include "DaCacheSnapshot.h"
+#include "DaDeviceItem.h"
+#include "UtilityFuncs.h"
+#include "Logger.h"
+
+//-------------------------------------------------------------------------
+// Snapshot File Format
+//-------------------------------------------------------------------------
+//
+//    CacheFileHeader
+//    CacheRecord    one record per item, 8-byte aligned
+//    ...
+//
+// A record is appended when the value of an item is written for the
+// first time. Afterwards only the value, quality and timestamp of the
+// record are updated in place.
+
+#define DACACHE_MAGIC            0x48434344     // 'DCCH'
+#define DACACHE_VERSION          1
+#define DACACHE_MIN_SIZE         (64 * 1024)    // Initial size of the mapping
+
+struct CacheFileHeader
+{
+   DWORD    magic;
+   WORD     version;
+   WORD     headerSize;
+   DWORD    dataSize;                     // Used bytes including the header
+   DWORD    reserved;
+};
+
+struct CacheRecord
+{
+   DWORD    recordSize;
+   WORD     vt;                           // VT_EMPTY if no value is stored
+   WORD     quality;
+   FILETIME timeStamp;
+   LONGLONG value;                        // Value part of the VARIANT
+   DWORD    idLength;                     // Number of characters without the terminating zero
+   WCHAR    itemID[1];
+};
+
+//=========================================================================
+// RecordSize
+//=========================================================================
+static ULONGLONG RecordSize( ULONGLONG idLength )
+{
+   return (offsetof( CacheRecord, itemID ) + (idLength + 1) * sizeof( WCHAR ) + 7) & ~(ULONGLONG)7;
+}
+
+
+
+//=========================================================================
+// Constructor
+//=========================================================================
+DaCacheSnapshot::DaCacheSnapshot( void )
+{
+   hFile_      = INVALID_HANDLE_VALUE;
+   hMapping_   = NULL;
+   view_       = NULL;
+   viewSize_   = 0;
+   cacheLock_  = NULL;
+   interval_   = 0;
+   hStopEvent_ = NULL;
+   hThread_    = NULL;
+   InitializeCriticalSection( &criticalSection_ );
+   InitializeCriticalSection( &fileCritSec_ );
+}
+
+
+
+//=========================================================================
+// Destructor
+//=========================================================================
+DaCacheSnapshot::~DaCacheSnapshot()
+{
+   if (hThread_) {
+      SetEvent( hStopEvent_ );
+
+      // Wait max 60 secs until the writer thread has terminated.
+      if (WaitForSingleObject( hThread_, 60000 ) == WAIT_TIMEOUT) {
+         TerminateThread( hThread_, 1 );
+      }
+      CloseHandle( hThread_ );
+      hThread_ = NULL;
+   }
+   if (hStopEvent_) {
+      CloseHandle( hStopEvent_ );
+      hStopEvent_ = NULL;
+   }
+
+   if (cacheLock_) {
+      Flush();                                  // Write the items which are still dirty
+   }
+
+   POSITION pos = index_.GetStartPosition();
+   while (pos) {
+      delete [] (LPWSTR)index_.GetNext( pos )->m_key;
+   }
+   index_.RemoveAll();
+
+   if (hFile_ != INVALID_HANDLE_VALUE) {
+      LARGE_INTEGER dataSize;
+      dataSize.QuadPart = view_ ? ((CacheFileHeader*)view_)->dataSize : 0;
+      UnmapNoLock();
+      if (dataSize.QuadPart) {                  // Remove the unused part of the mapping
+         SetFilePointerEx( hFile_, dataSize, NULL, FILE_BEGIN );
+         SetEndOfFile( hFile_ );
+      }
+      CloseHandle( hFile_ );
+      hFile_ = INVALID_HANDLE_VALUE;
+   }
+
+   DeleteCriticalSection( &fileCritSec_ );
+   DeleteCriticalSection( &criticalSection_ );
+}
+
+
+
+//=========================================================================
+// Create
+// ------
+//    Opens or creates the snapshot file and starts the writer thread.
+//    A file with an unknown format is overwritten.
+//=========================================================================
+HRESULT DaCacheSnapshot::Create( LPCWSTR fileName, DWORD interval, ReadWriteLock* cacheLock )
+{
+   _ASSERTE( cacheLock );
+   _ASSERTE( hThread_ == NULL );
+
+   if (fileName == NULL || *fileName == L'\0' || interval == 0) {
+      return E_INVALIDARG;
+   }
+
+   hFile_ = CreateFileW( fileName, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL,
+                         OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL );
+   if (hFile_ == INVALID_HANDLE_VALUE) {
+      return HRESULT_FROM_WIN32( GetLastError() );
+   }
+
+   LARGE_INTEGER fileSize;
+   if (!GetFileSizeEx( hFile_, &fileSize )) {
+      return HRESULT_FROM_WIN32( GetLastError() );
+   }
+   if (fileSize.QuadPart > MAXLONG) {
+      return E_FAIL;
+   }
+
+   EnterCriticalSection( &fileCritSec_ );
+   HRESULT hr = MapNoLock( (fileSize.LowPart > DACACHE_MIN_SIZE) ? fileSize.LowPart : DACACHE_MIN_SIZE );
+   if (SUCCEEDED( hr )) {
+      hr = LoadIndexNoLock();
+   }
+   LeaveCriticalSection( &fileCritSec_ );
+   if (FAILED( hr )) {
+      return hr;
+   }
+
+   cacheLock_ = cacheLock;
+   interval_  = interval;
+
+   hStopEvent_ = CreateEvent( NULL, TRUE, FALSE, NULL );
+   if (hStopEvent_ == NULL) {
+      return HRESULT_FROM_WIN32( GetLastError() );
+   }
+
+   unsigned uThreadID;
+   hThread_ = (HANDLE)_beginthreadex( NULL, 0, CacheSnapshotThreadHandler, this, 0, &uThreadID );
+   if (hThread_ == 0) {
+      return HRESULT_FROM_WIN32( GetLastError() );
+   }
+
+   LOGFMTI( "Cache snapshot opened with %lu items", (DWORD)index_.GetCount() );
+   return S_OK;
+}
+
+
+
+//=========================================================================
+// Restore
+// -------
+//    Restores the stored values and connects the items to the snapshot.
+//    From now on the items report changes of their cache.
+//=========================================================================
+void DaCacheSnapshot::Restore( DWORD numItems, DaDeviceItem** deviceItems )
+{
+   EnterCriticalSection( &fileCritSec_ );
+
+   for (DWORD i = 0; i < numItems; i++) {
+
+      DaDeviceItem* pDItem = deviceItems[i];
+      if (pDItem == NULL) {
+         continue;
+      }
+
+      LPWSTR      pItemID = NULL;
+      DWORD       offset;
+
+      pDItem->get_ItemIDPtr( &pItemID );
+
+      if (view_ && pItemID && index_.Lookup( pItemID, offset )) {
+         const CacheRecord* pRec = (const CacheRecord*)(view_ + offset);
+         if (pRec->vt != VT_EMPTY && IsPersistable( pRec->vt )) {
+            VARIANT  vValue;
+            FILETIME ftTimeStamp = pRec->timeStamp;
+            VariantInit( &vValue );
+            V_VT( &vValue ) = pRec->vt;
+            memcpy( &vValue.llVal, &pRec->value, sizeof( pRec->value ) );
+            pDItem->set_CacheSnapshot( this, &vValue,
+                                       OPC_QUALITY_LAST_KNOWN | (pRec->quality & OPC_LIMIT_MASK),
+                                       &ftTimeStamp );
+            continue;
+         }
+      }
+      pDItem->set_CacheSnapshot( this );
+   }
+
+   LeaveCriticalSection( &fileCritSec_ );
+}
+
+
+
+//=========================================================================
+// MarkDirty
+// ---------
+//    The item is attached as long as it is in the dirty list.
+//    Killed items cannot be attached and are not added.
+//=========================================================================
+void DaCacheSnapshot::MarkDirty( DaDeviceItem* deviceItem )
+{
+   EnterCriticalSection( &criticalSection_ );
+   if (deviceItem->Attach() >= 0) {
+      dirty_.Add( deviceItem );
+   }
+   LeaveCriticalSection( &criticalSection_ );
+}
+
+
+
+//=========================================================================
+// Flush
+// -----
+//    Takes the dirty items and copies their values within the reader
+//    lock of the cache. The records are updated afterwards without
+//    holding the lock.
+//=========================================================================
+void DaCacheSnapshot::Flush( void )
+{
+   CAtlArray<DaDeviceItem*> items;
+
+   EnterCriticalSection( &criticalSection_ );
+   items.Copy( dirty_ );
+   dirty_.RemoveAll();
+   LeaveCriticalSection( &criticalSection_ );
+
+   size_t numItems = items.GetCount();
+   if (numItems == 0) {
+      return;
+   }
+
+   VARIANT*  pValues     = new VARIANT[ numItems ];
+   WORD*     pQualities  = new WORD[ numItems ];
+   FILETIME* pTimeStamps = new FILETIME[ numItems ];
+   size_t    i;
+
+   if (pValues && pQualities && pTimeStamps) {
+
+      //
+      // Copy the dirty slice
+      //
+      cacheLock_->BeginReading();
+      for (i = 0; i < numItems; i++) {
+         items[i]->TakeCacheSnapshotValue( &pValues[i], &pQualities[i], &pTimeStamps[i] );
+      }
+      cacheLock_->EndReading();
+
+      //
+      // Update the records
+      //
+      EnterCriticalSection( &fileCritSec_ );
+      for (i = 0; i < numItems && view_; i++) {
+
+         LPWSTR      pItemID = NULL;
+         DWORD       offset;
+
+         items[i]->get_ItemIDPtr( &pItemID );
+
+         if (V_VT( &pValues[i] ) == VT_EMPTY || pItemID == NULL) {
+            continue;                           // Value type not persisted
+         }
+         if (!index_.Lookup( pItemID, offset )) {
+            offset = AppendRecordNoLock( pItemID );
+            if (offset == 0) {
+               continue;
+            }
+         }
+         CacheRecord* pRec = (CacheRecord*)(view_ + offset);
+         memcpy( &pRec->value, &pValues[i].llVal, sizeof( pRec->value ) );
+         pRec->timeStamp = pTimeStamps[i];
+         pRec->quality   = pQualities[i];
+         pRec->vt        = V_VT( &pValues[i] );
+      }
+      if (view_) {
+         FlushViewOfFile( view_, ((CacheFileHeader*)view_)->dataSize );
+      }
+      LeaveCriticalSection( &fileCritSec_ );
+   }
+
+   if (pValues)     delete [] pValues;
+   if (pQualities)  delete [] pQualities;
+   if (pTimeStamps) delete [] pTimeStamps;
+
+   // Detach outside of the critical sections because
+   // Detach() may delete killed items.
+   for (i = 0; i < numItems; i++) {
+      items[i]->Detach();
+   }
+}
+
+
+
+//=========================================================================
+// IsPersistable
+//=========================================================================
+BOOL DaCacheSnapshot::IsPersistable( VARTYPE vt )
+{
+   switch (vt) {
+      case VT_I1:    case VT_UI1:
+      case VT_I2:    case VT_UI2:
+      case VT_I4:    case VT_UI4:
+      case VT_INT:   case VT_UINT:
+      case VT_I8:    case VT_UI8:
+      case VT_R4:    case VT_R8:
+      case VT_CY:    case VT_DATE:
+      case VT_BOOL:  case VT_ERROR:
+         return TRUE;
+      default:
+         return FALSE;
+   }
+}
+
+
+
+//=========================================================================
+// MapNoLock
+// ---------
+//    Maps the file with the specified size. The file is enlarged if
+//    required.
+//    fileCritSec_ must be entered outside.
+//=========================================================================
+HRESULT DaCacheSnapshot::MapNoLock( DWORD size )
+{
+   UnmapNoLock();
+
+   hMapping_ = CreateFileMappingW( hFile_, NULL, PAGE_READWRITE, 0, size, NULL );
+   if (hMapping_ == NULL) {
+      return HRESULT_FROM_WIN32( GetLastError() );
+   }
+   view_ = (BYTE*)MapViewOfFile( hMapping_, FILE_MAP_WRITE, 0, 0, size );
+   if (view_ == NULL) {
+      HRESULT hr = HRESULT_FROM_WIN32( GetLastError() );
+      CloseHandle( hMapping_ );
+      hMapping_ = NULL;
+      return hr;
+   }
+   viewSize_ = size;
+   return S_OK;
+}
+
+
+
+//=========================================================================
+// UnmapNoLock
+//    fileCritSec_ must be entered outside.
+//=========================================================================
+void DaCacheSnapshot::UnmapNoLock( void )
+{
+   if (view_) {
+      FlushViewOfFile( view_, 0 );
+      UnmapViewOfFile( view_ );
+      view_ = NULL;
+   }
+   if (hMapping_) {
+      CloseHandle( hMapping_ );
+      hMapping_ = NULL;
+   }
+   viewSize_ = 0;
+}
+
+
+
+//=========================================================================
+// LoadIndexNoLock
+// ---------------
+//    Builds the index of the stored items. A new or incompatible file is
+//    initialized as an empty snapshot; a truncated record and all
+//    following records are discarded.
+//    fileCritSec_ must be entered outside.
+//=========================================================================
+HRESULT DaCacheSnapshot::LoadIndexNoLock( void )
+{
+   CacheFileHeader* pHdr = (CacheFileHeader*)view_;
+
+   if (pHdr->magic != DACACHE_MAGIC || pHdr->version != DACACHE_VERSION ||
+       pHdr->headerSize != sizeof( CacheFileHeader ) ||
+       pHdr->dataSize < sizeof( CacheFileHeader ) || pHdr->dataSize > viewSize_) {
+      memset( pHdr, 0, sizeof( CacheFileHeader ) );
+      pHdr->magic      = DACACHE_MAGIC;
+      pHdr->version    = DACACHE_VERSION;
+      pHdr->headerSize = sizeof( CacheFileHeader );
+      pHdr->dataSize   = sizeof( CacheFileHeader );
+      return S_OK;
+   }
+
+   DWORD offset = pHdr->headerSize;
+   while (offset + RecordSize( 0 ) <= pHdr->dataSize) {
+
+      const CacheRecord* pRec = (const CacheRecord*)(view_ + offset);
+      if (pRec->recordSize != RecordSize( pRec->idLength ) ||
+          (ULONGLONG)offset + pRec->recordSize > pHdr->dataSize ||
+          pRec->itemID[ pRec->idLength ] != L'\0') {
+         break;                                 // Invalid record
+      }
+
+      DWORD existing;
+      if (!index_.Lookup( pRec->itemID, existing )) {
+         LPWSTR pItemID = WSTRClone( pRec->itemID, NULL );
+         if (pItemID == NULL) {                 // Key must not point into the view
+            return E_OUTOFMEMORY;               // because it can be remapped.
+         }
+         index_.SetAt( pItemID, offset );
+      }                                         // else duplicate record
+      offset += pRec->recordSize;
+   }
+   pHdr->dataSize = offset;
+   return S_OK;
+}
+
+
+
+//=========================================================================
+// AppendRecordNoLock
+// ------------------
+//    Appends an empty record for the item and enlarges the mapping if
+//    required.
+//    fileCritSec_ must be entered outside.
+//
+// return:
+//    The offset of the record or 0 if it cannot be added.
+//=========================================================================
+DWORD DaCacheSnapshot::AppendRecordNoLock( LPCWSTR itemID )
+{
+   DWORD     idLength = (DWORD)wcslen( itemID );
+   ULONGLONG size     = RecordSize( idLength );
+   DWORD     offset   = ((CacheFileHeader*)view_)->dataSize;
+
+   LPWSTR pKey = WSTRClone( itemID, NULL );
+   if (pKey == NULL) {
+      return 0;
+   }
+
+   if (offset + size > viewSize_) {
+      DWORD     oldSize = viewSize_;
+      ULONGLONG newSize = viewSize_;
+      while (offset + size > newSize) {
+         newSize *= 2;
+      }
+      if (newSize > MAXLONG || FAILED( MapNoLock( (DWORD)newSize ) )) {
+         LOGFMTE( "Cache snapshot: file cannot be enlarged" );
+         if (view_ == NULL) {
+            MapNoLock( oldSize );               // Keep the existing records
+         }
+         delete [] pKey;
+         return 0;
+      }
+   }
+
+   CacheRecord* pRec = (CacheRecord*)(view_ + offset);
+   memset( pRec, 0, (size_t)size );
+   pRec->recordSize = (DWORD)size;
+   pRec->vt         = VT_EMPTY;
+   pRec->idLength   = idLength;
+   memcpy( pRec->itemID, itemID, (idLength + 1) * sizeof( WCHAR ) );
+
+   ((CacheFileHeader*)view_)->dataSize = offset + (DWORD)size;
+
+   index_.SetAt( pKey, offset );
+   return offset;
+}
+
+
+
+//=========================================================================
+// CacheSnapshotThreadHandler
+// --------------------------
+//    Writes the dirty items periodically.
+//=========================================================================
+unsigned __stdcall CacheSnapshotThreadHandler( void* pArg )
+{
+   DaCacheSnapshot* pSnapshot = static_cast<DaCacheSnapshot *>(pArg);
+   _ASSERTE( pSnapshot != NULL );
+
+   while (WaitForSingleObject( pSnapshot->hStopEvent_, pSnapshot->interval_ ) == WAIT_TIMEOUT) {
+      pSnapshot->Flush();
+   }
+
+   _endthreadex( 0 );
+   return 0;
+}
+
+//DOM-IGNORE-END
@@ -0,0 +1,190 @@
+/*
+ * Copyright (c) 2020 Technosoftware GmbH. All rights reserved
+ * Web: https://technosoftware.com
+ *
+ * The source code in this file is covered under a dual-license scenario:
+ *   - Owner of a purchased license: SCLA 1.0
+ *   - GPL V3: everybody else
+ *
+ * SCLA license terms accompanied with this source code.
+ * See https://technosoftware.com/license/Source_Code_License_Agreement.pdf
+ *
+ * GNU General Public License as published by the Free Software Foundation;
+ * version 3 of the License are accompanied with this source code.
+ * See https://technosoftware.com/license/GPLv3License.txt
+ *
+ * This source code is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+#ifndef __DACACHESNAPSHOT_H_
+#define __DACACHESNAPSHOT_H_
+
+#if _MSC_VER >= 1000
+#pragma once
+#endif // _MSC_VER >= 1000
+
+//DOM-IGNORE-BEGIN
+
+#include <atlcoll.h>
+#include "StringAtom.h"
+#include "ReadWriteLock.h"
+
+class DaDeviceItem;
+
+/**
+ * @class	DaCacheSnapshot
+ *
+ * @brief	Persists the value, quality and timestamp of the Device Item caches in a memory
+ * 			mapped file so that a restarted server can provide the last known values until the
+ * 			device delivers new values.
+ *
+ * 			Device Items mark themselves dirty when their cache is updated. A writer thread
+ * 			periodically takes the values of the dirty items and updates their records in the
+ * 			file; items which have not changed are not written. The reader lock of the cache
+ * 			is held only while the values of the dirty items are copied.
+ *
+ * 			Only values which do not own memory are persisted (numbers, dates, currency,
+ * 			booleans and error codes). Strings and arrays start with an empty cache as before.
+ */
+
+class DaCacheSnapshot
+{
+   public:
+
+      /**
+       * @fn	DaCacheSnapshot::DaCacheSnapshot( void );
+       *
+       * @brief	Constructor.
+       */
+
+      DaCacheSnapshot( void );
+
+      /**
+       * @fn	DaCacheSnapshot::~DaCacheSnapshot();
+       *
+       * @brief	Stops the writer thread, writes the values of the items which are still dirty
+       * 			and closes the file.
+       */
+
+      ~DaCacheSnapshot();
+
+      /**
+       * @fn	HRESULT DaCacheSnapshot::Create( LPCWSTR fileName, DWORD interval, ReadWriteLock* cacheLock );
+       *
+       * @brief	Opens or creates the snapshot file, loads the index of the stored items and starts
+       * 			the writer thread.
+       *
+       * @param 		fileName 	Name of the snapshot file.
+       * @param 		interval 	Time in ms between two writes of the dirty items.
+       * @param [in]	cacheLock	The lock which protects the Device Item caches against
+       * 							updates from the device.
+       *
+       * @return	S_OK if succeeded; otherwise an error code.
+       */
+
+      HRESULT Create( LPCWSTR fileName, DWORD interval, ReadWriteLock* cacheLock );
+
+      /**
+       * @fn	void DaCacheSnapshot::Restore( DWORD numItems, DaDeviceItem** deviceItems );
+       *
+       * @brief	Restores the stored values of the specified items with quality
+       * 			OPC_QUALITY_LAST_KNOWN and connects the items to the snapshot. Must be called
+       * 			once when the items are added to the server address space.
+       *
+       * @param 		numItems   	Number of items.
+       * @param [in]	deviceItems	The Device Items.
+       */
+
+      void Restore( DWORD numItems, DaDeviceItem** deviceItems );
+
+      /**
+       * @fn	void DaCacheSnapshot::MarkDirty( DaDeviceItem* deviceItem );
+       *
+       * @brief	Adds an item whose cache was updated to the dirty items. Called by the Device
+       * 			Item within its critical section. Killed items are not added.
+       *
+       * @param [in]	deviceItem	The Device Item.
+       */
+
+      void MarkDirty( DaDeviceItem* deviceItem );
+
+      /**
+       * @fn	void DaCacheSnapshot::Flush( void );
+       *
+       * @brief	Writes the values of the dirty items to the file.
+       */
+
+      void Flush( void );
+
+      /**
+       * @fn	static BOOL DaCacheSnapshot::IsPersistable( VARTYPE vt );
+       *
+       * @brief	Checks if values of the specified type can be stored in the snapshot.
+       *
+       * @param	vt	The data type.
+       *
+       * @return	TRUE if the value does not own memory; otherwise FALSE.
+       */
+
+      static BOOL IsPersistable( VARTYPE vt );
+
+   private:
+
+      friend unsigned __stdcall CacheSnapshotThreadHandler( void* pArg );
+
+      HRESULT MapNoLock( DWORD size );
+      void UnmapNoLock( void );
+      HRESULT LoadIndexNoLock( void );
+      DWORD AppendRecordNoLock( LPCWSTR itemID );
+
+      /**
+       * @class	ItemIDTraits
+       *
+       * @brief	The ItemIDs are compared by value and not by pointer.
+       */
+
+      class ItemIDTraits : public CElementTraitsBase< LPCWSTR >
+      {
+      public:
+         static ULONG Hash( LPCWSTR itemID )
+            {
+               DWORD dwLength;
+               return StringAtom::HashOf( itemID, &dwLength );
+            }
+
+         static bool CompareElements( LPCWSTR itemID1, LPCWSTR itemID2 )
+            {
+               return (wcscmp( itemID1, itemID2 ) == 0) ? true : false;
+            }
+
+         static int CompareElementsOrdered( LPCWSTR itemID1, LPCWSTR itemID2 )
+            {
+               return wcscmp( itemID1, itemID2 );
+            }
+      };
+
+      /** @brief	Device Items with changed cache, each attached. Protected by criticalSection_. */
+      CAtlArray<DaDeviceItem*> dirty_;
+      CRITICAL_SECTION criticalSection_;
+
+      /** @brief	Maps the Item IDs to the offset of their record. The keys are own copies. */
+      CAtlMap<LPCWSTR, DWORD, ItemIDTraits> index_;
+
+      /** @brief	Protects the file mapping and index_. */
+      CRITICAL_SECTION fileCritSec_;
+
+      HANDLE         hFile_;
+      HANDLE         hMapping_;
+      BYTE*          view_;
+      DWORD          viewSize_;
+
+      ReadWriteLock* cacheLock_;
+      DWORD          interval_;
+      HANDLE         hStopEvent_;
+      HANDLE         hThread_;
+};
+//DOM-IGNORE-END
+
+#endif // __DACACHESNAPSHOT_H_
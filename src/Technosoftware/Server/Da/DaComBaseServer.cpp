@@ -23,6 +23,7 @@
 #include "stdafx.h"
 #include "DaComBaseServer.h"
 #include "DaGenericServer.h"
+#include "UtilityFuncs.h"
 #include "Logger.h"
 
 /////////////////////////////////////////////////////////////////////////////
@@ -45,6 +46,7 @@ DaComBaseServer::DaComBaseServer()
         creationFailed_ = TRUE;
     }
     daGenericServer_ = NULL;
+    persistFileName_ = NULL;
 }
 
 
@@ -61,6 +63,7 @@ DaComBaseServer::~DaComBaseServer()
 		LOGFMTI("Client disconnects from Server '%s'", W2A(pName));
         delete pName;
     }
+    WSTRFree(persistFileName_, NULL);
 }
 
 
@@ -462,6 +462,12 @@ public:
      */
 
     SRVINSTHANDLE  serverInstanceHandle_;
+
+    /** @brief   Current configuration file of IPersistFile. NULL if not yet loaded or saved. */
+    LPWSTR persistFileName_;
+
+    /** @brief   Protects persistFileName_. */
+    CComAutoCriticalSection persistCritSec_;
 };
 //DOM-IGNORE-END
 
@@ -694,36 +694,16 @@ STDMETHODIMP DaComBaseServer::Read(
 		_OPC_CHECK_PTR( ppDItems );
 		memset( ppDItems, 0, sizeof (DaDeviceItem*) * dwCount );
 
-		CAutoVectorPtr<OPCITEMDEF> avpItemDefs;
-		if (!avpItemDefs.Allocate( dwCount )) throw E_OUTOFMEMORY;
-
-		for (i = 0; i < dwCount; i++) {
-			ppDItems[i] = NULL;
-
-			OPCITEMDEF* pItemDef = &avpItemDefs[i];
-			pItemDef->szAccessPath = L"";
-			pItemDef->szItemID = (LPWSTR)pszItemIDs[i];
-			pItemDef->bActive = TRUE;
-			pItemDef->hClient = i;
-			pItemDef->dwBlobSize = 0;
-			pItemDef->pBlob = NULL;
-			pItemDef->vtRequestedDataType = VT_EMPTY;
-			pItemDef->wReserved = 0;
-		}
-
-		hrRet = daBaseServer_->OnValidateItems(
-			OPC_VALIDATEREQ_DEVICEITEMS,
-			FALSE,                  // No Blob Update
+		// Resolve the ItemIDs, cached ItemIDs are not validated again
+		hrRet = daBaseServer_->ValidateItemIDs(
 			dwCount,
-			avpItemDefs,
+			pszItemIDs,
+			NULL,                   // No requested data types
 			ppDItems,
-			NULL,
 			*ppErrors );
 
 		_ASSERTE( SUCCEEDED( hrRet ) );           // Must return S_OK or S_FALSE
 
-		avpItemDefs.Free();                       // No longer used
-
 		DWORD dwNumOfItemsWithReadAccess = 0;
 		for (i = 0; i < dwCount; i++) {           // Items must have Read Access
 			if (ppDItems[i]) {
@@ -822,34 +802,24 @@ STDMETHODIMP DaComBaseServer::WriteVQT(
 		_OPC_CHECK_PTR( ppDItems );
 		memset( ppDItems, NULL, sizeof (DaDeviceItem*) * dwCount );
 
-		CAutoVectorPtr<OPCITEMDEF> avpItemDefs;
-		if (!avpItemDefs.Allocate( dwCount )) throw E_OUTOFMEMORY;
+		CAutoVectorPtr<VARTYPE> avpReqTypes;
+		if (!avpReqTypes.Allocate( dwCount )) throw E_OUTOFMEMORY;
 
 		for (i = 0; i < dwCount; i++) {
-			OPCITEMDEF* pItemDef = &avpItemDefs[i];
-			pItemDef->szAccessPath = L"";
-			pItemDef->szItemID = (LPWSTR)pszItemIDs[i];
-			pItemDef->bActive = TRUE;
-			pItemDef->hClient = i;
-			pItemDef->dwBlobSize = 0;
-			pItemDef->pBlob = NULL;
-			pItemDef->vtRequestedDataType = V_VT( &pItemVQT[i].vDataValue );
-			pItemDef->wReserved = 0;
+			avpReqTypes[i] = V_VT( &pItemVQT[i].vDataValue );
 		}
 
-		hrRet = daBaseServer_->OnValidateItems(
-			OPC_VALIDATEREQ_DEVICEITEMS,
-			FALSE,                  // No Blob Update
+		// Resolve the ItemIDs, cached ItemIDs are not validated again.
+		// The value type of cached items is checked by InternalWriteVQT().
+		hrRet = daBaseServer_->ValidateItemIDs(
 			dwCount,
-			avpItemDefs,
+			pszItemIDs,
+			avpReqTypes,
 			ppDItems,
-			NULL,
 			*ppErrors );
 
 		_ASSERTE( SUCCEEDED( hrRet ) );           // Must return S_OK or S_FALSE
 
-		avpItemDefs.Free();                       // No longer used
-
 		DWORD dwNumOfItemsWithWriteAccess = 0;
 		for (i = 0; i < dwCount; i++) {           // Items must have Write Access
 			if (ppDItems[i]) {
@@ -0,0 +1,683 @@
+/*
+ * Copyright (c) 2020 Technosoftware GmbH. All rights reserved
+ * Web: https://technosoftware.com
+ *
+ * The source code in this file is covered under a dual-license scenario:
+ *   - Owner of a purchased license: SCLA 1.0
+ *   - GPL V3: everybody else
+ *
+ * SCLA license terms accompanied with this source code.
+ * See https://technosoftware.com/license/Source_Code_License_Agreement.pdf
+ *
+ * GNU General Public License as published by the Free Software Foundation;
+ * version 3 of the License are accompanied with this source code.
+ * See https://technosoftware.com/license/GPLv3License.txt
+ *
+ * This source code is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+ //DOM-IGNORE-BEGIN
+
+#include "stdafx.h"
+#include <atlcoll.h>
+#include "UtilityFuncs.h"
+#include "DaConfigSnapshot.h"
+#include "DaGenericServer.h"
+#include "DaGenericGroup.h"
+#include "DaGenericItem.h"
+#include "DaDeviceItem.h"
+#include "Logger.h"
+
+//-------------------------------------------------------------------------
+// Snapshot File Format
+//-------------------------------------------------------------------------
+//
+//    SnapshotHeader
+//    SnapshotGroup  [ numGroups ]     items of a group are stored contiguous
+//    SnapshotItem   [ numItems ]
+//    WCHAR          [ stringsSize / sizeof( WCHAR ) ]
+//                                     zero-terminated strings, the string
+//                                     at offset 0 is the empty string
+//
+// All sections are 4-byte aligned. Strings are referenced by their
+// offset in WCHARs from the begin of the string table.
+// The record sizes are stored in the header; a reader of the same
+// version accepts larger records and ignores the additional data.
+
+#define DACFG_MAGIC              0x47464344     // 'DCFG'
+#define DACFG_VERSION            1
+
+#define DACFG_GROUP_ACTIVE       0x0001
+
+#define DACFG_ITEM_ACTIVE        0x0001
+#define DACFG_ITEM_PHYVAL        0x0002
+#define DACFG_ITEM_BUFFER        0x0004
+#define DACFG_ITEM_DEADBAND      0x0008
+
+#pragma pack( push, 4 )
+
+struct SnapshotHeader
+{
+   DWORD    magic;
+   WORD     version;
+   WORD     headerSize;
+   WORD     groupSize;
+   WORD     itemSize;
+   DWORD    fileSize;
+   DWORD    checksum;                     // FNV-1a of all data after the header
+   DWORD    numGroups;
+   DWORD    groupsOffset;
+   DWORD    numItems;
+   DWORD    itemsOffset;
+   DWORD    stringsOffset;
+   DWORD    stringsSize;                  // in bytes
+};
+
+struct SnapshotGroup
+{
+   DWORD    nameOffset;
+   DWORD    firstItem;
+   DWORD    numItems;
+   DWORD    requestedUpdateRate;
+   LONG     timeBias;
+   FLOAT    percentDeadband;
+   DWORD    lcid;
+   DWORD    clientHandle;
+   DWORD    keepAliveTime;
+   DWORD    flags;                        // DACFG_GROUP_xxx
+};
+
+struct SnapshotItem
+{
+   DWORD    itemIdOffset;
+   DWORD    accessPathOffset;
+   DWORD    clientHandle;
+   WORD     requestedDataType;
+   WORD     flags;                        // DACFG_ITEM_xxx
+   FLOAT    percentDeadband;              // valid if DACFG_ITEM_DEADBAND is set
+   DWORD    samplingRate;
+};
+
+#pragma pack( pop )
+
+
+
+//=========================================================================
+// Checksum
+// --------
+//    32-bit FNV-1a hash of the specified data. The hash of the previous
+//    section is passed to continue the hash over several sections.
+//=========================================================================
+#define DACFG_CHECKSUM_INIT      2166136261UL
+
+static DWORD Checksum( DWORD hash, const BYTE* data, DWORD size )
+{
+   for (DWORD i = 0; i < size; i++) {
+      hash ^= data[i];
+      hash *= 16777619UL;
+   }
+   return hash;
+}
+
+
+
+//=========================================================================
+// AddString
+// ---------
+//    Appends a string to the string table and returns its offset.
+//    NULL and empty strings share the entry at offset 0.
+//=========================================================================
+static DWORD AddString( CAtlArray<WCHAR>& strings, LPCWSTR str )
+{
+   if (str == NULL || *str == L'\0') {
+      return 0;
+   }
+   DWORD offset = (DWORD)strings.GetCount();
+   size_t len = wcslen( str ) + 1;
+   strings.SetCount( offset + len );
+   memcpy( strings.GetData() + offset, str, len * sizeof( WCHAR ) );
+   return offset;
+}
+
+
+
+//=========================================================================
+// WriteSection
+//=========================================================================
+static HRESULT WriteSection( HANDLE hFile, const void* data, DWORD size )
+{
+   DWORD dwWritten;
+   if (size == 0) {
+      return S_OK;
+   }
+   if (!WriteFile( hFile, data, size, &dwWritten, NULL ) || dwWritten != size) {
+      return HRESULT_FROM_WIN32( GetLastError() );
+   }
+   return S_OK;
+}
+
+
+
+//=========================================================================
+// Save
+// ----
+//    The private groups are nailed and their attributes recorded within
+//    the group list critical section. The items are recorded afterwards
+//    group by group within the item list critical section of the group.
+//=========================================================================
+HRESULT DaConfigSnapshot::Save( DaGenericServer* server, LPCWSTR fileName )
+{
+   if (server == NULL || fileName == NULL || *fileName == L'\0') {
+      return E_INVALIDARG;
+   }
+
+   CAtlArray<DaGenericGroup*> groupPtrs;
+   CAtlArray<SnapshotGroup>   groups;
+   CAtlArray<SnapshotItem>    items;
+   CAtlArray<WCHAR>           strings;
+   DaGenericGroup*            group;
+   DaGenericItem*             item;
+   long                       idx, pgh;
+   size_t                     g;
+   int                        res;
+
+   strings.Add( L'\0' );                        // The empty string at offset 0
+
+   //
+   // Record the private groups
+   //
+   EnterCriticalSection( &server->m_GroupsCritSec );
+
+   res = server->m_GroupList.First( &idx );
+   while (SUCCEEDED( res )) {
+      if (SUCCEEDED( server->m_GroupList.GetElem( idx, &group ) ) &&
+          !group->Killed() && !group->GetPublicInfo( &pgh )) {
+
+         SnapshotGroup rec;
+         memset( &rec, 0, sizeof( rec ) );
+         rec.nameOffset          = AddString( strings, group->m_Name );
+         rec.requestedUpdateRate = group->m_RequestedUpdateRate;
+         rec.timeBias            = group->m_TimeBias;
+         rec.percentDeadband     = group->m_PercentDeadband;
+         rec.lcid                = group->m_dwLCID;
+         rec.clientHandle        = group->m_hClientGroupHandle;
+         rec.keepAliveTime       = group->KeepAliveTime();
+         rec.flags               = group->GetActiveState() ? DACFG_GROUP_ACTIVE : 0;
+
+         group->Attach();                       // Nail the group until its items are recorded
+         groupPtrs.Add( group );
+         groups.Add( rec );
+      }
+      res = server->m_GroupList.Next( idx, &idx );
+   }
+
+   LeaveCriticalSection( &server->m_GroupsCritSec );
+
+   //
+   // Record the items of the groups
+   //
+   for (g = 0; g < groups.GetCount(); g++) {
+
+      group = groupPtrs[g];
+      groups[g].firstItem = (DWORD)items.GetCount();
+
+      EnterCriticalSection( &group->m_ItemsCritSec );
+
+      res = group->m_oaItems.First( &idx );
+      while (SUCCEEDED( res )) {
+         DaDeviceItem* pDItem;
+         if (SUCCEEDED( group->m_oaItems.GetElem( idx, &item ) ) && !item->Killed() &&
+             item->AttachDeviceItem( &pDItem ) > 0) {
+
+            SnapshotItem   rec;
+            ITEMDEFEXT     extDef;
+            LPWSTR         szItemID;
+            LPWSTR         szAccessPath = NULL;
+            FLOAT          fltItemDeadband;
+
+            memset( &rec, 0, sizeof( rec ) );
+            pDItem->get_ItemIDPtr( &szItemID );
+            pDItem->get_AccessPath( &szAccessPath );
+            item->get_ExtItemDef( &extDef );
+
+            rec.itemIdOffset      = AddString( strings, szItemID );
+            rec.accessPathOffset  = AddString( strings, szAccessPath );
+            rec.clientHandle      = item->get_ClientHandle();
+            rec.requestedDataType = item->get_RequestedDataType();
+            rec.samplingRate      = item->get_SamplingRate();
+            if (item->get_Active()) {
+               rec.flags |= DACFG_ITEM_ACTIVE;
+            }
+            if (extDef.m_fPhyvalItem) {
+               rec.flags |= DACFG_ITEM_PHYVAL;
+            }
+            if (item->get_BufferEnable()) {
+               rec.flags |= DACFG_ITEM_BUFFER;
+            }
+            if (SUCCEEDED( pDItem->GetItemDeadband( &fltItemDeadband ) )) {
+               rec.flags |= DACFG_ITEM_DEADBAND;
+               rec.percentDeadband = fltItemDeadband;
+            }
+            items.Add( rec );
+
+            WSTRFree( szAccessPath, NULL );
+            pDItem->Detach();
+         }
+         res = group->m_oaItems.Next( idx, &idx );
+      }
+
+      LeaveCriticalSection( &group->m_ItemsCritSec );
+
+      groups[g].numItems = (DWORD)items.GetCount() - groups[g].firstItem;
+      group->Detach();
+   }
+
+   //
+   // Build the header
+   //
+   if (strings.GetCount() & 1) {
+      strings.Add( L'\0' );                     // Keep the file size 4-byte aligned
+   }
+
+   SnapshotHeader hdr;
+   memset( &hdr, 0, sizeof( hdr ) );
+   hdr.magic         = DACFG_MAGIC;
+   hdr.version       = DACFG_VERSION;
+   hdr.headerSize    = sizeof( SnapshotHeader );
+   hdr.groupSize     = sizeof( SnapshotGroup );
+   hdr.itemSize      = sizeof( SnapshotItem );
+   hdr.numGroups     = (DWORD)groups.GetCount();
+   hdr.groupsOffset  = sizeof( SnapshotHeader );
+   hdr.numItems      = (DWORD)items.GetCount();
+   hdr.itemsOffset   = hdr.groupsOffset + hdr.numGroups * sizeof( SnapshotGroup );
+   hdr.stringsOffset = hdr.itemsOffset + hdr.numItems * sizeof( SnapshotItem );
+   hdr.stringsSize   = (DWORD)( strings.GetCount() * sizeof( WCHAR ) );
+   hdr.fileSize      = hdr.stringsOffset + hdr.stringsSize;
+
+   hdr.checksum = Checksum( DACFG_CHECKSUM_INIT, (const BYTE*)groups.GetData(), hdr.numGroups * sizeof( SnapshotGroup ) );
+   hdr.checksum = Checksum( hdr.checksum, (const BYTE*)items.GetData(), hdr.numItems * sizeof( SnapshotItem ) );
+   hdr.checksum = Checksum( hdr.checksum, (const BYTE*)strings.GetData(), hdr.stringsSize );
+
+   //
+   // Write a temporary file and replace the snapshot file
+   //
+   size_t len     = wcslen( fileName ) + 5;
+   LPWSTR tmpName = new WCHAR[ len ];
+   if (tmpName == NULL) {
+      return E_OUTOFMEMORY;
+   }
+   wcscpy_s( tmpName, len, fileName );
+   wcscat_s( tmpName, len, L".tmp" );
+
+   HANDLE hFile = CreateFileW( tmpName, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+                               FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL );
+   if (hFile == INVALID_HANDLE_VALUE) {
+      HRESULT hrOpen = HRESULT_FROM_WIN32( GetLastError() );
+      delete [] tmpName;
+      return hrOpen;
+   }
+
+   HRESULT hr = WriteSection( hFile, &hdr, sizeof( hdr ) );
+   if (SUCCEEDED( hr )) {
+      hr = WriteSection( hFile, groups.GetData(), hdr.numGroups * sizeof( SnapshotGroup ) );
+   }
+   if (SUCCEEDED( hr )) {
+      hr = WriteSection( hFile, items.GetData(), hdr.numItems * sizeof( SnapshotItem ) );
+   }
+   if (SUCCEEDED( hr )) {
+      hr = WriteSection( hFile, strings.GetData(), hdr.stringsSize );
+   }
+   CloseHandle( hFile );
+
+   if (SUCCEEDED( hr ) && !MoveFileExW( tmpName, fileName, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH )) {
+      hr = HRESULT_FROM_WIN32( GetLastError() );
+   }
+   if (FAILED( hr )) {
+      DeleteFileW( tmpName );
+   }
+   delete [] tmpName;
+   if (FAILED( hr )) {
+      return hr;
+   }
+
+   LOGFMTI( "Configuration snapshot saved: %lu groups, %lu items", hdr.numGroups, hdr.numItems );
+   return S_OK;
+}
+
+
+
+//=========================================================================
+// SectionFits
+// -----------
+//    Checks if a section with the specified number of records is within
+//    the mapped file.
+//=========================================================================
+static BOOL SectionFits( DWORD offset, DWORD count, DWORD recordSize, DWORD fileSize )
+{
+   if (offset & 3) {
+      return FALSE;                             // Not aligned
+   }
+   ULONGLONG end = (ULONGLONG)offset + (ULONGLONG)count * recordSize;
+   return (end <= fileSize) ? TRUE : FALSE;
+}
+
+
+
+//=========================================================================
+// Validate
+// --------
+//    Checks the header, the checksum and all offsets of a mapped
+//    snapshot so that the records can be accessed without further
+//    range checks.
+//=========================================================================
+static HRESULT Validate( const BYTE* pView, DWORD fileSize )
+{
+   const SnapshotHeader* pHdr = (const SnapshotHeader*)pView;
+
+   if (fileSize < sizeof( SnapshotHeader ) ||
+       pHdr->magic != DACFG_MAGIC ||
+       pHdr->version != DACFG_VERSION ||
+       pHdr->headerSize < sizeof( SnapshotHeader ) ||
+       pHdr->groupSize < sizeof( SnapshotGroup ) || (pHdr->groupSize & 3) ||
+       pHdr->itemSize < sizeof( SnapshotItem ) || (pHdr->itemSize & 3) ||
+       pHdr->fileSize != fileSize) {
+      return E_FAIL;
+   }
+
+   if (!SectionFits( pHdr->groupsOffset, pHdr->numGroups, pHdr->groupSize, fileSize ) ||
+       !SectionFits( pHdr->itemsOffset, pHdr->numItems, pHdr->itemSize, fileSize ) ||
+       !SectionFits( pHdr->stringsOffset, pHdr->stringsSize, 1, fileSize ) ||
+       pHdr->groupsOffset < pHdr->headerSize ||
+       pHdr->stringsSize < sizeof( WCHAR ) || (pHdr->stringsSize % sizeof( WCHAR ))) {
+      return E_FAIL;
+   }
+
+   DWORD checksum = Checksum( DACFG_CHECKSUM_INIT, pView + pHdr->groupsOffset, pHdr->numGroups * pHdr->groupSize );
+   checksum = Checksum( checksum, pView + pHdr->itemsOffset, pHdr->numItems * pHdr->itemSize );
+   checksum = Checksum( checksum, pView + pHdr->stringsOffset, pHdr->stringsSize );
+   if (checksum != pHdr->checksum) {
+      return E_FAIL;
+   }
+
+   // The string table must be terminated; then all strings
+   // starting within the table are terminated.
+   const WCHAR* pStrings = (const WCHAR*)(pView + pHdr->stringsOffset);
+   DWORD        numChars = pHdr->stringsSize / sizeof( WCHAR );
+   if (pStrings[ numChars - 1 ] != L'\0') {
+      return E_FAIL;
+   }
+
+   // The item ranges of the groups must follow each other without
+   // gaps or overlaps; Restore() uses each item only once.
+   DWORD i;
+   DWORD nextItem = 0;
+   for (i = 0; i < pHdr->numGroups; i++) {
+      const SnapshotGroup* pGroup = (const SnapshotGroup*)(pView + pHdr->groupsOffset + i * pHdr->groupSize);
+      if (pGroup->nameOffset >= numChars ||
+          pGroup->firstItem != nextItem ||
+          (ULONGLONG)pGroup->firstItem + pGroup->numItems > pHdr->numItems) {
+         return E_FAIL;
+      }
+      nextItem = pGroup->firstItem + pGroup->numItems;
+   }
+   for (i = 0; i < pHdr->numItems; i++) {
+      const SnapshotItem* pItem = (const SnapshotItem*)(pView + pHdr->itemsOffset + i * pHdr->itemSize);
+      if (pItem->itemIdOffset >= numChars || pItem->accessPathOffset >= numChars) {
+         return E_FAIL;
+      }
+   }
+   return S_OK;
+}
+
+
+
+//=========================================================================
+// Restore
+// -------
+//    Creates the groups and items of a validated snapshot.
+//
+//    All items are validated with one call of OnValidateItems(). The
+//    item definitions refer directly to the strings of the mapped file.
+//    The item table of each group is preallocated and the items are
+//    inserted within one item list critical section.
+//=========================================================================
+static HRESULT Restore( DaGenericServer* server, const BYTE* pView )
+{
+   const SnapshotHeader* pHdr     = (const SnapshotHeader*)pView;
+   const WCHAR*          pStrings = (const WCHAR*)(pView + pHdr->stringsOffset);
+   DWORD                 numItems = pHdr->numItems;
+   DaBaseServer*         pServerHandler = server->m_pServerHandler;
+   OPCITEMDEF*           pDefs     = NULL;
+   DaDeviceItem**        ppDItems  = NULL;
+   HRESULT*              pErr      = NULL;
+   HRESULT               hr        = S_OK;
+   BOOL                  fSkipped  = FALSE;
+   DWORD                 i, n;
+
+   //
+   // Resolve all items at once
+   //
+   if (numItems) {
+      pDefs    = new OPCITEMDEF[ numItems ];
+      ppDItems = new DaDeviceItem*[ numItems ];
+      pErr     = new HRESULT[ numItems ];
+      if (pDefs == NULL || ppDItems == NULL || pErr == NULL) {
+         hr = E_OUTOFMEMORY;
+         goto RestoreExit;
+      }
+      for (i = 0; i < numItems; i++) {
+         const SnapshotItem* pItem = (const SnapshotItem*)(pView + pHdr->itemsOffset + i * pHdr->itemSize);
+         pDefs[i].szAccessPath        = (LPWSTR)(pStrings + pItem->accessPathOffset);
+         pDefs[i].szItemID            = (LPWSTR)(pStrings + pItem->itemIdOffset);
+         pDefs[i].bActive             = (pItem->flags & DACFG_ITEM_ACTIVE) ? TRUE : FALSE;
+         pDefs[i].hClient             = pItem->clientHandle;
+         pDefs[i].dwBlobSize          = 0;
+         pDefs[i].pBlob               = NULL;
+         pDefs[i].vtRequestedDataType = pItem->requestedDataType;
+         pDefs[i].wReserved           = 0;
+         ppDItems[i]                  = NULL;
+         pErr[i]                      = S_OK;
+      }
+      hr = pServerHandler->OnValidateItems( OPC_VALIDATEREQ_DEVICEITEMS,
+                                            FALSE,            // No Blob Update
+                                            numItems,
+                                            pDefs,
+                                            ppDItems,
+                                            NULL,
+                                            pErr );
+      if (FAILED( hr )) {
+         goto RestoreExit;
+      }
+   }
+
+   //
+   // Create the groups with their items
+   //
+   for (i = 0; i < pHdr->numGroups; i++) {
+
+      const SnapshotGroup* pRec = (const SnapshotGroup*)(pView + pHdr->groupsOffset + i * pHdr->groupSize);
+      LPCWSTR           szName = pStrings + pRec->nameOffset;
+      DaGenericGroup*   group  = NULL;
+      DaGenericGroup*   foundGroup;
+      long              sgh;
+      LONG              timeBias = pRec->timeBias;
+      FLOAT             percentDeadband = pRec->percentDeadband;
+
+      // Group names must be unique among the private groups
+      EnterCriticalSection( &server->m_GroupsCritSec );
+      HRESULT res = (*szName == L'\0') ? S_OK : server->SearchGroup( FALSE, szName, &foundGroup, &sgh );
+      LeaveCriticalSection( &server->m_GroupsCritSec );
+
+      if (FAILED( res )) {
+         group = new DaGenericGroup();
+         if (group == NULL) {
+            res = E_OUTOFMEMORY;
+         }
+         else {
+            res = group->Create( server,
+                                 szName,
+                                 (pRec->flags & DACFG_GROUP_ACTIVE) ? TRUE : FALSE,
+                                 &timeBias,
+                                 pRec->requestedUpdateRate,
+                                 pRec->clientHandle,
+                                 &percentDeadband,
+                                 pRec->lcid,
+                                 FALSE,
+                                 0,
+                                 &sgh );
+            if (FAILED( res )) {
+               delete group;
+               group = NULL;
+            }
+         }
+      }
+      else {
+         res = OPC_E_DUPLICATENAME;
+      }
+
+      if (group == NULL) {
+         USES_CONVERSION;
+         LOGFMTE( "Configuration snapshot: group '%s' not restored, error 0x%X", W2A( szName ), res );
+         fSkipped = TRUE;
+      }
+      else if (pRec->keepAliveTime) {
+         DWORD dwRevised;
+         group->SetKeepAlive( pRec->keepAliveTime, &dwRevised );
+      }
+
+      if (group) {
+         EnterCriticalSection( &group->m_ItemsCritSec );
+         group->m_oaItems.Reserve( pRec->numItems );
+      }
+
+      for (n = pRec->firstItem; n < pRec->firstItem + pRec->numItems; n++) {
+
+         if (SUCCEEDED( pErr[n] ) && (ppDItems[n] == NULL || ppDItems[n]->Killed())) {
+            pErr[n] = OPC_E_UNKNOWNITEMID;
+         }
+         if (group && SUCCEEDED( pErr[n] )) {
+
+            const SnapshotItem* pItem = (const SnapshotItem*)(pView + pHdr->itemsOffset + n * pHdr->itemSize);
+            DaGenericItem*    pGItem = new DaGenericItem();
+            long              hServerHandle;
+
+            if (pGItem == NULL) {
+               pErr[n] = E_OUTOFMEMORY;
+            }
+            else {
+               pErr[n] = pGItem->Create( pDefs[n].bActive,
+                                         pDefs[n].hClient,
+                                         pDefs[n].vtRequestedDataType,
+                                         group,
+                                         ppDItems[n],
+                                         &hServerHandle,
+                                         (pItem->flags & DACFG_ITEM_PHYVAL) ? TRUE : FALSE );
+               if (FAILED( pErr[n] )) {
+                  delete pGItem;
+               }
+            }
+            if (SUCCEEDED( pErr[n] )) {
+               if (pItem->samplingRate) {
+                  pGItem->set_SamplingRate( pItem->samplingRate );
+               }
+               if (pItem->flags & DACFG_ITEM_BUFFER) {
+                  pGItem->set_BufferEnable( TRUE );
+               }
+               if (pItem->flags & DACFG_ITEM_DEADBAND) {
+                  ppDItems[n]->SetItemDeadband( pItem->percentDeadband );
+               }
+            }
+         }
+         if (FAILED( pErr[n] ) || group == NULL) {
+            fSkipped = TRUE;
+         }
+         if (ppDItems[n]) {
+            ppDItems[n]->Detach();              // Attach from OnValidateItems() no longer required
+            ppDItems[n] = NULL;
+         }
+      }
+
+      if (group) {
+         LeaveCriticalSection( &group->m_ItemsCritSec );
+      }
+   }
+
+   for (i = 0; i < numItems; i++) {             // Items not referenced by a group
+      if (ppDItems[i]) {
+         ppDItems[i]->Detach();
+      }
+   }
+
+   LOGFMTI( "Configuration snapshot restored: %lu groups, %lu items", pHdr->numGroups, numItems );
+   hr = fSkipped ? S_FALSE : S_OK;
+
+RestoreExit:
+   if (ppDItems) delete [] ppDItems;
+   if (pDefs) delete [] pDefs;
+   if (pErr)  delete [] pErr;
+   return hr;
+}
+
+
+
+//=========================================================================
+// Load
+// ----
+//    The snapshot is mapped copy-on-write so that the item definitions
+//    passed to OnValidateItems() can refer to the mapped strings.
+//=========================================================================
+HRESULT DaConfigSnapshot::Load( DaGenericServer* server, LPCWSTR fileName )
+{
+   if (server == NULL || fileName == NULL || *fileName == L'\0') {
+      return E_INVALIDARG;
+   }
+
+   HANDLE hFile = CreateFileW( fileName, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                               FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL );
+   if (hFile == INVALID_HANDLE_VALUE) {
+      return HRESULT_FROM_WIN32( GetLastError() );
+   }
+
+   HRESULT        hr;
+   LARGE_INTEGER  fileSize;
+   if (!GetFileSizeEx( hFile, &fileSize )) {
+      hr = HRESULT_FROM_WIN32( GetLastError() );
+      CloseHandle( hFile );
+      return hr;
+   }
+   if (fileSize.QuadPart < sizeof( SnapshotHeader ) || fileSize.QuadPart > MAXDWORD) {
+      CloseHandle( hFile );
+      LOGFMTE( "Configuration snapshot: invalid file size" );
+      return E_FAIL;
+   }
+
+   HANDLE hMapping = CreateFileMappingW( hFile, NULL, PAGE_WRITECOPY, 0, 0, NULL );
+   if (hMapping == NULL) {
+      hr = HRESULT_FROM_WIN32( GetLastError() );
+      CloseHandle( hFile );
+      return hr;
+   }
+
+   const BYTE* pView = (const BYTE*)MapViewOfFile( hMapping, FILE_MAP_COPY, 0, 0, 0 );
+   if (pView == NULL) {
+      hr = HRESULT_FROM_WIN32( GetLastError() );
+   }
+   else {
+      hr = Validate( pView, fileSize.LowPart );
+      if (FAILED( hr )) {
+         LOGFMTE( "Configuration snapshot: invalid or incompatible file" );
+      }
+      else {
+         hr = Restore( server, pView );
+      }
+      UnmapViewOfFile( pView );
+   }
+
+   CloseHandle( hMapping );
+   CloseHandle( hFile );
+   return hr;
+}
+
+//DOM-IGNORE-END
@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2020 Technosoftware GmbH. All rights reserved
+ * Web: https://technosoftware.com
+ *
+ * The source code in this file is covered under a dual-license scenario:
+ *   - Owner of a purchased license: SCLA 1.0
+ *   - GPL V3: everybody else
+ *
+ * SCLA license terms accompanied with this source code.
+ * See https://technosoftware.com/license/Source_Code_License_Agreement.pdf
+ *
+ * GNU General Public License as published by the Free Software Foundation;
+ * version 3 of the License are accompanied with this source code.
+ * See https://technosoftware.com/license/GPLv3License.txt
+ *
+ * This source code is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+#ifndef __DACONFIGSNAPSHOT_H_
+#define __DACONFIGSNAPSHOT_H_
+
+#if _MSC_VER >= 1000
+#pragma once
+#endif // _MSC_VER >= 1000
+
+//DOM-IGNORE-BEGIN
+
+class DaGenericServer;
+
+/**
+ * @class	DaConfigSnapshot
+ *
+ * @brief	Saves and restores the private groups of a server instance with their items,
+ * 			deadbands, update and sampling rates in a binary snapshot file. Used by the
+ * 			IPersistFile and IOPCServerDisp configuration functions.
+ *
+ * 			The snapshot is a versioned file with fixed-size, 4-byte aligned records and a
+ * 			string table. It is restored directly from a read-only file mapping: all items of
+ * 			the snapshot are validated with one call of OnValidateItems() and the item tables
+ * 			of the groups are preallocated before the items are inserted.
+ */
+
+class DaConfigSnapshot
+{
+   public:
+
+      /**
+       * @fn	static HRESULT DaConfigSnapshot::Save( DaGenericServer* server, LPCWSTR fileName );
+       *
+       * @brief	Writes the private groups of a server instance to a snapshot file. The file
+       * 			is written to a temporary file first and replaces an existing file only if
+       * 			it was written completely.
+       *
+       * @param [in]	server  	The server instance.
+       * @param 		fileName	Name of the snapshot file.
+       *
+       * @return	S_OK if succeeded; otherwise an error code.
+       */
+
+      static HRESULT Save( DaGenericServer* server, LPCWSTR fileName );
+
+      /**
+       * @fn	static HRESULT DaConfigSnapshot::Load( DaGenericServer* server, LPCWSTR fileName );
+       *
+       * @brief	Restores the groups and items of a snapshot file in a server instance. Groups
+       * 			whose name is already used by the server instance and items which are no
+       * 			longer valid are skipped.
+       *
+       * @param [in]	server  	The server instance.
+       * @param 		fileName	Name of the snapshot file.
+       *
+       * @return	S_OK if all groups and items are restored; S_FALSE if some groups or
+       * 			items are skipped; otherwise an error code.
+       */
+
+      static HRESULT Load( DaGenericServer* server, LPCWSTR fileName );
+};
+//DOM-IGNORE-END
+
+#endif // __DACONFIGSNAPSHOT_H_
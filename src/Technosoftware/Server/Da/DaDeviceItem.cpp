@@ -26,6 +26,8 @@
 #include "UtilityFuncs.h"
 #include "variantconversion.h"
 #include "DaBaseServer.h"
+#include "DaCacheSnapshot.h"
+#include "StringAtom.h"
 
 
 //=========================================================================
@@ -35,6 +37,7 @@ DaDeviceItem::DaDeviceItem( void )
 {
    m_ItemID             = NULL;
    m_AccessPath         = NULL;
+   m_AccessPathHash     = 0;
    m_Active             = FALSE;
    m_ToKill             = FALSE;
    m_RefCount           = 0;
@@ -46,6 +49,10 @@ DaDeviceItem::DaDeviceItem( void )
    m_dwActiveCount      = 0;
    m_dAnalogEURange     = 0;
    m_fltPercentDeadband = -1;
+   m_pCacheSnapshot     = NULL;
+   m_fCacheDirty        = FALSE;
+   m_pPropertyTable     = NULL;
+   m_dwPropertyRevision = 0;
 
    VariantInit( &m_EUInfo );
    VariantInit( &m_Value  );
@@ -125,6 +132,9 @@ DaDeviceItem::~DaDeviceItem()
    if (m_AccessPath) {
       delete m_AccessPath;
    }
+   if (m_pPropertyTable) {
+      m_pPropertyTable->Release();
+   }
    VariantClear( &m_Value );
    VariantClear( &m_EUInfo );
    DeleteCriticalSection( &m_CritSec );
@@ -203,6 +213,7 @@ HRESULT DaDeviceItem::set_ItemID( LPWSTR ItemID )
       delete m_ItemID;
       m_ItemID = NULL;
    }
+   InvalidatePropertyTable();
 
    if ( ItemID != NULL ) {
       m_ItemID = WSTRClone( ItemID, NULL );
@@ -504,6 +515,7 @@ HRESULT DaDeviceItem::set_EUData( OPCEUTYPE EUType, VARIANT *pEUInfo )
 
    LeaveCriticalSection( &m_CritSec );
    VariantClear( &varOld );            // Clear temporary variant
+   InvalidatePropertyTable();
 
    return hres;
 }
@@ -589,6 +601,7 @@ HRESULT DaDeviceItem::get_AccessRights( DWORD *pAccessRights )
 HRESULT DaDeviceItem::set_AccessRights( DWORD DaAccessRights )
 {
    m_AccessRights = DaAccessRights;
+   InvalidatePropertyTable();
    return S_OK;
 }
 
@@ -654,11 +667,16 @@ HRESULT DaDeviceItem::get_OPCITEMRESULT( BOOL blobUpdate, OPCITEMRESULT* pItemRe
 //
 // Value.vt contains the requested data type to which the returned value
 // should be converted from the cache value (which has canonical data type)
+//
+// pfnConverter is the conversion function selected for the canonical and
+// requested data type (e.g. by DaGenericItem::set_RequestedDataType()).
+// VariantFromVariant() is used if NULL.
 //   
 //=========================================================================
 HRESULT DaDeviceItem::get_ItemValue( LPVARIANT   pvValue,
                                     LPWORD      pwQuality,
-                                    LPFILETIME  pftTimeStamp )
+                                    LPFILETIME  pftTimeStamp,
+                                    VARIANTCONVERTER pfnConverter /* = NULL */ )
 {
    _ASSERTE( pvValue );                         // Must not be NULL
    _ASSERTE( pwQuality );                       // Must not be NULL
@@ -671,8 +689,11 @@ HRESULT DaDeviceItem::get_ItemValue( LPVARIANT   pvValue,
                                                 // 'vt' data member with requested data type was valid.
    EnterCriticalSection( &m_CritSec );
 
-   hr = VariantFromVariant(   pvValue,
-                              vtRequestedDataType, &m_Value );
+   if (pfnConverter == NULL) {
+      pfnConverter = VariantFromVariant;
+   }
+   hr = pfnConverter(   pvValue,
+                        vtRequestedDataType, &m_Value );
 
    if (SUCCEEDED( hr )) {
       *pwQuality     = m_Quality;
@@ -724,6 +745,7 @@ HRESULT DaDeviceItem::set_ItemValue( LPVARIANT   pvValue,
    if (SUCCEEDED( hres )) {
       m_Quality   = wQuality;
       m_TimeStamp = ftTimeStamp;
+      MarkCacheDirty();
    }
 
    LeaveCriticalSection( &m_CritSec );
@@ -750,12 +772,14 @@ HRESULT DaDeviceItem::set_ItemQuality(  WORD        wQuality,
       EnterCriticalSection( &m_CritSec );
       m_Quality   = wQuality;
       m_TimeStamp = ftTimeStamp;
+      MarkCacheDirty();
       LeaveCriticalSection( &m_CritSec );
    }
    else {
       EnterCriticalSection( &m_CritSec );
       m_Quality   = wQuality;
       m_TimeStamp = *pftTimeStamp;
+      MarkCacheDirty();
       LeaveCriticalSection( &m_CritSec );
    }
    return S_OK;
@@ -804,6 +828,7 @@ HRESULT DaDeviceItem::set_ItemVQT( OPCITEMVQT* pItemVQT )
       EnterCriticalSection( &m_CritSec );
       m_Quality   = wQuality;
       m_TimeStamp = ftTimeStamp;
+      MarkCacheDirty();
       LeaveCriticalSection( &m_CritSec );
    }
    else {
@@ -815,6 +840,7 @@ HRESULT DaDeviceItem::set_ItemVQT( OPCITEMVQT* pItemVQT )
       if (SUCCEEDED( hr )) {
          m_Quality   = wQuality;
          m_TimeStamp = ftTimeStamp;
+         MarkCacheDirty();
       }
       LeaveCriticalSection( &m_CritSec );
    }
@@ -867,8 +893,91 @@ BOOL DaDeviceItem::IsTimeStampOlderThan( LPFILETIME pftTimeStamp )
    return (lRes == -1) ? TRUE : FALSE;
 }
 
+
+
+//=========================================================================
+// IsTimeStampOlderThan
+// --------------------
+//    Same as above but with the time as 64-bit integer so the caller
+//    can calculate the time once for several items.
+//=========================================================================
+BOOL DaDeviceItem::IsTimeStampOlderThan( ULONGLONG ullTimeStamp )
+{
+   EnterCriticalSection( &m_CritSec );
+   ULONGLONG ullItem = ((ULONGLONG)m_TimeStamp.dwHighDateTime << 32) | m_TimeStamp.dwLowDateTime;
+   LeaveCriticalSection( &m_CritSec );
+
+   return (ullItem < ullTimeStamp) ? TRUE : FALSE;
+}
+
    
    
+//=========================================================================
+// get_PropertyTable
+// -----------------
+//    Returns the table with the cached static property values.
+//    The returned table must be released by the caller.
+//=========================================================================
+void DaDeviceItem::get_PropertyTable( DaItemPropertyTable** ppTable, LPDWORD pdwRevision )
+{
+   EnterCriticalSection( &m_CritSec );
+   *ppTable = m_pPropertyTable;
+   if (m_pPropertyTable) {
+      m_pPropertyTable->AddRef();
+   }
+   *pdwRevision = m_dwPropertyRevision;
+   LeaveCriticalSection( &m_CritSec );
+}
+
+
+
+//=========================================================================
+// set_PropertyTable
+// -----------------
+//    The table is not stored if the item was changed after the caller
+//    has read the values; they may be out of date.
+//=========================================================================
+void DaDeviceItem::set_PropertyTable( DaItemPropertyTable* pTable, DWORD dwRevision )
+{
+   DaItemPropertyTable* pOld = NULL;
+
+   EnterCriticalSection( &m_CritSec );
+   if (dwRevision == m_dwPropertyRevision) {
+      pOld = m_pPropertyTable;
+      m_pPropertyTable = pTable;
+      if (pTable) {
+         pTable->AddRef();
+      }
+   }
+   LeaveCriticalSection( &m_CritSec );
+
+   if (pOld) {
+      pOld->Release();
+   }
+}
+
+
+
+//=========================================================================
+// InvalidatePropertyTable
+//=========================================================================
+void DaDeviceItem::InvalidatePropertyTable( void )
+{
+   DaItemPropertyTable* pOld;
+
+   EnterCriticalSection( &m_CritSec );
+   pOld = m_pPropertyTable;
+   m_pPropertyTable = NULL;
+   m_dwPropertyRevision++;
+   LeaveCriticalSection( &m_CritSec );
+
+   if (pOld) {
+      pOld->Release();
+   }
+}
+
+
+
 //=========================================================================
 // get_PropertyValue
 // -----------------
@@ -907,7 +1016,7 @@ HRESULT DaDeviceItem::get_PropertyValue( DaBaseServer* const pServerHandler,
          {
                                                 // Refresh Cache from Device
             DaDeviceItem* pDevItem = this;
-            pServerHandler->OnRefreshInputCache( OPC_REFRESH_CLIENT, 1, &pDevItem, &hres );
+            pServerHandler->RefreshInputCache( OPC_REFRESH_CLIENT, 1, &pDevItem, &hres );
             if (SUCCEEDED( hres )) {            // Use the individual item error as return code
                                                 // Cache refresh succeeded
 
@@ -1061,6 +1170,7 @@ HRESULT DaDeviceItem::set_AccessPath( LPWSTR AccessPath )
       delete m_AccessPath;
    }
 
+   m_AccessPathHash = 0;
    if( AccessPath == NULL) {           // no path definition
       m_AccessPath = NULL;             // clear member variable
    } else {                              // Path definition passed
@@ -1069,6 +1179,8 @@ HRESULT DaDeviceItem::set_AccessPath( LPWSTR AccessPath )
          LeaveCriticalSection( &m_CritSec );
          return E_OUTOFMEMORY;         // error
       }
+      DWORD dwLength;
+      m_AccessPathHash = StringAtom::HashOf( m_AccessPath, &dwLength );
    }
 
    LeaveCriticalSection( &m_CritSec );
@@ -1192,4 +1304,74 @@ HRESULT DaDeviceItem::ClearItemDeadband()
    return hr;
 }
 
+
+
+//=========================================================================
+// Connects the item to the cache snapshot
+// ---------------------------------------
+//    The last known value is only restored if the cache still has the
+//    initial BAD quality, that is it was not yet updated by the device.
+//=========================================================================
+void DaDeviceItem::set_CacheSnapshot( DaCacheSnapshot* pSnapshot,
+                                      const VARIANT* pvLastKnown,   /* = NULL */
+                                      WORD wQuality,                /* = OPC_QUALITY_LAST_KNOWN */
+                                      const FILETIME* pftTimeStamp  /* = NULL */ )
+{
+   EnterCriticalSection( &m_CritSec );
+
+   if (pvLastKnown && (m_Quality & OPC_QUALITY_MASK) == OPC_QUALITY_BAD &&
+       V_VT( pvLastKnown ) == get_CanonicalDataType()) {
+      if (SUCCEEDED( VariantCopy( &m_Value, (VARIANT*)pvLastKnown ) )) {
+         m_Quality = wQuality;
+         if (pftTimeStamp) {
+            m_TimeStamp = *pftTimeStamp;
+         }
+      }
+   }
+   m_pCacheSnapshot = pSnapshot;
+   m_fCacheDirty    = FALSE;
+
+   LeaveCriticalSection( &m_CritSec );
+}
+
+
+
+//=========================================================================
+// Returns the cache for the snapshot
+// ----------------------------------
+//    Values which own memory (strings, arrays, interfaces) are not
+//    persisted; for these only VT_EMPTY is returned.
+//=========================================================================
+void DaDeviceItem::TakeCacheSnapshotValue( LPVARIANT   pvValue,
+                                           LPWORD      pwQuality,
+                                           LPFILETIME  pftTimeStamp )
+{
+   EnterCriticalSection( &m_CritSec );
+
+   if (DaCacheSnapshot::IsPersistable( V_VT( &m_Value ) )) {
+      *pvValue = m_Value;                       // No memory owned by the value
+   }
+   else {
+      VariantInit( pvValue );
+   }
+   *pwQuality     = m_Quality;
+   *pftTimeStamp  = m_TimeStamp;
+   m_fCacheDirty  = FALSE;
+
+   LeaveCriticalSection( &m_CritSec );
+}
+
+
+
+//=========================================================================
+// Adds the item to the dirty items of the cache snapshot
+//=========================================================================
+void DaDeviceItem::MarkCacheDirty( void )
+{
+   if (m_pCacheSnapshot && !m_fCacheDirty) {
+      m_fCacheDirty = TRUE;
+      m_pCacheSnapshot->MarkDirty( this );
+   }
+}
+
 //DOM-IGNORE-END
@@ -26,7 +26,11 @@
 #pragma once
 #endif // _MSC_VER >= 1000
 
+#include "VariantConversion.h"
+
 class DaBaseServer;
+class DaCacheSnapshot;
+class DaItemPropertyTable;
 
 
 class DaDeviceItem  {
@@ -122,10 +126,13 @@ public:
       //--------------------------------------------------------------
       // Read current value, quality and time stamp
       // with requested data type in Value.vt
+      // The value is converted with pfnConverter if specified
+      // (see GetVariantConverter()).
       //--------------------------------------------------------------
    virtual HRESULT get_ItemValue(   LPVARIANT pvValue,
                                     LPWORD pwQuality,
-                                    LPFILETIME pftTimeStamp );
+                                    LPFILETIME pftTimeStamp,
+                                    VARIANTCONVERTER pfnConverter = NULL );
 
       //--------------------------------------------------------------
       // Converts the specified variant value from one type to
@@ -138,6 +145,7 @@ public:
       // Compares the current TimeStamp with the specified value
       //--------------------------------------------------------------
    virtual BOOL IsTimeStampOlderThan( LPFILETIME pftTimeStamp );
+   BOOL         IsTimeStampOlderThan( ULONGLONG ullTimeStamp );
 
 
       //--------------------------------------------------------------
@@ -147,9 +155,28 @@ public:
                                        DWORD dwPropID,
                                        LPVARIANT pvPropData );
 
+      //--------------------------------------------------------------
+      // Static Property Table (see DaItemPropertyTable)
+      //--------------------------------------------------------------
+            // Returns the referenced table (may be NULL) and the revision
+            // which must be passed to set_PropertyTable().
+   void     get_PropertyTable( DaItemPropertyTable** ppTable, LPDWORD pdwRevision );
+
+            // Replaces the table if it was not invalidated since the
+            // specified revision was returned by get_PropertyTable().
+   void     set_PropertyTable( DaItemPropertyTable* pTable, DWORD dwRevision );
+
+            // Discards the cached static property values. Must be called
+            // if the application changes the value of a static property.
+   void     InvalidatePropertyTable( void );
+
    inline BOOL  HasReadAccess()  const { return (m_AccessRights & OPC_READABLE) ? TRUE : FALSE; }
    inline BOOL  HasWriteAccess() const { return (m_AccessRights & OPC_WRITEABLE) ? TRUE : FALSE; }
 
+            // Hash of the access path, 0 if there is none. Used to group
+            // device reads by access path without copying the path.
+   inline ULONG AccessPathHash()  const { return m_AccessPathHash; }
+
       //--------------------------------------------------------------
       // Item Deadband
       //--------------------------------------------------------------
@@ -157,6 +184,23 @@ public:
    virtual HRESULT GetItemDeadband( FLOAT* pfltPercentDeadband );
    virtual HRESULT ClearItemDeadband();
 
+      //--------------------------------------------------------------
+      // Cache Snapshot (see DaCacheSnapshot)
+      //--------------------------------------------------------------
+            // Connects the item to the snapshot. If specified the last known
+            // value is restored as long as the cache was not yet updated.
+   void     set_CacheSnapshot( DaCacheSnapshot* pSnapshot,
+                               const VARIANT* pvLastKnown = NULL,
+                               WORD wQuality = OPC_QUALITY_LAST_KNOWN,
+                               const FILETIME* pftTimeStamp = NULL );
+
+            // Returns the cache for the snapshot and resets the dirty flag.
+            // Only values which do not own memory are returned; the value
+            // is VT_EMPTY for other types.
+   void     TakeCacheSnapshotValue( LPVARIANT pvValue,
+                                    LPWORD pwQuality,
+                                    LPFILETIME pftTimeStamp );
+
 public:
       //--------------------------------------------------------------
       // to protect members of this class from multi thread access
@@ -179,12 +223,13 @@ public:
 
 protected:
                // zero terminated string that uniquely
-               // identifies the item (UNICODE!) 
+               // identifies the item (UNICODE!)
    LPWSTR      m_ItemID;
 
                // recommandation to the server on 'how to get the data' 
                //    ex. through which COM port 
    LPWSTR      m_AccessPath;
+   ULONG       m_AccessPathHash;          // hash of m_AccessPath, 0 if NULL
 
                // tells whether the cache for this item should be refreshed.
                // Group specific handling is controlled by the Active Flag
@@ -209,6 +254,14 @@ protected:
    WORD        m_Quality ;                // OPC quality flag
    FILETIME    m_TimeStamp ;              // time when the item cache was written
 
+               // Cache Snapshot
+   DaCacheSnapshot* m_pCacheSnapshot;     // NULL if the cache is not persisted
+   BOOL        m_fCacheDirty;             // cache changed since it was taken for the snapshot
+
+               // Static Property Table
+   DaItemPropertyTable* m_pPropertyTable; // NULL if no values are cached
+   DWORD       m_dwPropertyRevision;      // incremented if the table is invalidated
+
                // the blob is a (zero terminated?) string 
                //    provided by the client or by the server 
                //    that should or could help the server 
@@ -257,6 +310,10 @@ protected:
                // are attached to this item.
       DWORD    m_dwActiveCount;
 
+               // Adds the item to the dirty items of the snapshot.
+               // Must be called within m_CritSec.
+      void     MarkCacheDirty( void );
+
 };
 
 #endif // __DEVICEITEM_H_
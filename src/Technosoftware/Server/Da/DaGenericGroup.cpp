@@ -26,6 +26,7 @@
 #include "stdafx.h"
 #include "UtilityFuncs.h"
 #include "FixOutArray.h"
+#include "VariantPack.h"
 #include "DaGenericGroup.h"
 #include "DaGenericServer.h"
 #include "DaPublicGroup.h"
@@ -57,10 +58,13 @@ DaGenericGroup::DaGenericGroup( void )
 	m_StreamData      = 0;        // Async handling formats
 	m_StreamDataTime  = 0;
 	m_StreamWrite     = 0;
+	m_pStreamBuffer   = NULL;
 
 	m_dwKeepAliveTime = 0;
 	m_dwKeepAliveCount= 0;
 
+	m_lNumSampledItems= 0;
+
 	// for access to members of this group (mostly m_RefCount and m_ToKill)
 	InitializeCriticalSection( &m_CritSec );
 
@@ -578,6 +582,9 @@ DaGenericGroup::~DaGenericGroup()
 	if (m_Name) {
 		WSTRFree( m_Name );
 	}
+	if (m_pStreamBuffer) {
+		delete m_pStreamBuffer;
+	}
 
 	// kill local data
 	DeleteCriticalSection( &m_CritSec );
@@ -884,6 +891,8 @@ GetCOMItemBadExit0:
 //       these are the items eliminated before read ...
 //       pItemValues[x].vDataValue.vt contains the requested data type
 //       or VT_EMPTY if the canonical data type should be used.
+//    -  If ppGItems is specified the values are converted with the
+//       conversion function selected by the Generic Items.
 //                                              
 // return:
 //    S_OK if succeeded for all items; otherwise S_FALSE.
@@ -895,7 +904,8 @@ HRESULT DaGenericGroup::InternalRead(
 									DaDeviceItem    ** ppItems,
 									OPCITEMSTATE   *  pItemValues,
 									HRESULT        *  errors,
-									BOOL           *  pfPhyval /* = NULL */ )
+									BOOL           *  pfPhyval /* = NULL */,
+									DaGenericItem  ** ppGItems /* = NULL */ )
 {
 	DWORD       i;
 	VARIANT     *pvValue;
@@ -905,7 +915,7 @@ HRESULT DaGenericGroup::InternalRead(
 	hresReturn = S_OK;
 
 	if (dwSource == OPC_DS_DEVICE) {             // Refresh the chache for the requested items
-		hresReturn = m_pServerHandler->OnRefreshInputCache( OPC_REFRESH_CLIENT, numItems, ppItems, errors );
+		hresReturn = m_pServerHandler->RefreshInputCache( OPC_REFRESH_CLIENT, numItems, ppItems, errors );
 		_ASSERTE( SUCCEEDED( hresReturn ) );      // Must return S_OK or S_FALSE
 	}
 	// handle read/write locking
@@ -934,7 +944,8 @@ HRESULT DaGenericGroup::InternalRead(
 		hres = pDItem->get_ItemValue(
 			pvValue,                      // Value
 			&pItemValues[i].wQuality,     // Quality
-			&pItemValues[i].ftTimeStamp );// Timestamp
+			&pItemValues[i].ftTimeStamp,  // Timestamp
+			(ppGItems && ppGItems[i]) ? ppGItems[i]->get_Converter() : NULL );
 
 		pItemValues[i].wReserved = 0;             // initialize reserve field, Version 1.3
 
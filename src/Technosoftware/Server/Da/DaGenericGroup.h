@@ -36,6 +36,7 @@ class DaGenericServer;
 class DaBaseServer;
 class DaItem;
 class DaDeviceItem;
+class VariantStreamBuffer;
 
 
 
@@ -202,6 +203,10 @@ public:
    UINT     m_StreamWrite ;         // Write Complete
                // WIDE CHARS version also!
 
+               // Memory of the last data stream, reused for the next one.
+               // NULL while a stream is created (see SendDataStream).
+   VariantStreamBuffer* volatile m_pStreamBuffer;
+
                // Callback Interface Pointers
                // ---------------------------
                //    If the flag _Module.m_fMarshalCallbacks is TRUE then
@@ -242,6 +247,11 @@ public:
                // protects m_dwKeepAliveTime and m_dwKeepAliveCount
    CComAutoCriticalSection m_csKeepAlive;
 
+               // Number of items with an own sampling rate (IOPCItemSamplingMgt).
+               // Maintained by the items, the sampling of the group is skipped
+               // if there are no such items.
+   LONG  m_lNumSampledItems;
+
 
                // Array of pointers to the thread handling objects for the group's 
                // async read, write and refresh requests
@@ -391,7 +401,9 @@ public:
                   DaDeviceItem    ** ppItems, 
                   OPCITEMSTATE   *  pItemValues,
                   HRESULT        *  ppErrors,
-                  BOOL           *  pfPhyval = NULL   // Only used by CALL-R
+                  BOOL           *  pfPhyval = NULL,  // Only used by CALL-R
+                  DaGenericItem  ** ppGItems = NULL   // Generic Items with the selected
+                                                      // data type conversion
                   );
 
       //--------------------------------------------------------------
@@ -516,6 +528,23 @@ public:
       //--------------------------------------------------------------
    HRESULT UpdateNotify( void );
 
+      //--------------------------------------------------------------
+      // samples the items with an own sampling rate, called with
+      // each base update cycle of an active group
+      //--------------------------------------------------------------
+   HRESULT SampleItems( void );
+
+      //--------------------------------------------------------------
+      // sends the changed item values to the client (callback and
+      // sinks), used directly or by the outbound queue of the server
+      //--------------------------------------------------------------
+   HRESULT TransmitToClient( BOOL custom, BOOL WithTime, BOOL DataCallbackOnly,
+                             long NumItems, OPCITEMSTATE* pItemStates, HRESULT* pErr );
+
+      // sends one chunk of changed item values, used by TransmitToClient
+   HRESULT TransmitChunkToClient( BOOL custom, BOOL WithTime, BOOL DataCallbackOnly,
+                                  long NumItems, OPCITEMSTATE* pItemStates, HRESULT* pErr );
+
       //--------------------------------------------------------------
       // returns the actual base update rate
       // from which   m_ticks  is calculated
@@ -534,6 +563,12 @@ private:
       //--------------------------------------------------------------
    HRESULT UpdateToClient( BOOL custom, BOOL WithTime, BOOL DataCallbackOnly );
 
+      //--------------------------------------------------------------
+      // reads and sends the values of a portion of the items to update
+      //--------------------------------------------------------------
+   HRESULT UpdateItemsToClient( BOOL custom, BOOL WithTime, BOOL DataCallbackOnly,
+                                long NumItems, DaGenericItem** ppGItems, DaDeviceItem** ppDItems );
+
   };
 //DOM-IGNORE-END
 
@@ -44,8 +44,20 @@ DaGenericItem::DaGenericItem( )
    m_ToKill             = FALSE;
    m_pGroup             = NULL;
    m_DeviceItem         = NULL;
+   m_pfnConverter       = VariantFromVariant;
    m_LastReadQuality    = OPC_QUALITY_BAD;
 
+   m_dwSamplingRate     = 0;
+   m_dwSamplingBaseRate = 0;
+   m_dwSamplingTicks    = 0;
+   m_dwSamplingTickCount= 0;
+   m_fSampled           = FALSE;
+   m_fBufferEnable      = FALSE;
+   m_pSamples           = NULL;
+   m_dwFirstSample      = 0;
+   m_dwNumSamples       = 0;
+   m_fSampleOverflow    = FALSE;
+
    memset( &m_ExtItemDef, 0, sizeof (ITEMDEFEXT) );
 
       // for access to members of this group (mostly m_RefCount and m_ToKill)
@@ -86,6 +98,7 @@ HRESULT DaGenericItem::Create( BOOL            Active,
    m_ClientHandle       = Client ;
    m_RequestedDataType  = ReqDataType ;
    m_DeviceItem         = pDeviceItem ;
+   m_pfnConverter       = GetVariantConverter( pDeviceItem->get_CanonicalDataType(), ReqDataType );
 
 
    m_DeviceItem->Attach() ;                  // Inc DeviceItem RefCount
@@ -147,6 +160,7 @@ HRESULT DaGenericItem::Create(
    m_Active             = pCloned->m_Active;
    m_ClientHandle       = pCloned->m_ClientHandle ;
    m_RequestedDataType  = pCloned->m_RequestedDataType ;
+   m_pfnConverter       = pCloned->m_pfnConverter ;
 
    res = pCloned->get_ExtItemDef( &m_ExtItemDef );
    if ( FAILED(res) ) {
@@ -173,6 +187,10 @@ HRESULT DaGenericItem::Create(
 
    m_Created = TRUE;
 
+                              // The sampling definitions are copied
+   set_SamplingRate( pCloned->get_SamplingRate() );
+   set_BufferEnable( pCloned->get_BufferEnable() );
+
                               // Notify the attached DeviceItem if there
                               // is a new active item.
    if (m_Active && pGroup->GetActiveState()) {
@@ -209,6 +227,10 @@ DaGenericItem::~DaGenericItem()
       m_pGroup->m_oaItems.PutElem( m_ServerHandle, NULL );
       LeaveCriticalSection( &m_pGroup->m_ItemsCritSec );
 
+      if (m_dwSamplingRate) {
+         InterlockedDecrement( &m_pGroup->m_lNumSampledItems );
+      }
+
       m_pGroup->Detach();
 
          // Dec DeviceItem RefCount
@@ -216,6 +238,13 @@ DaGenericItem::~DaGenericItem()
    }
    VariantClear( &m_LastReadValue ) ;
 
+   if (m_pSamples) {
+      for (DWORD i = 0; i < ITEM_SAMPLE_BUFFER_SIZE; i++) {
+         VariantClear( &m_pSamples[i].vDataValue );
+      }
+      delete [] m_pSamples;
+   }
+
       // kill local data
    DeleteCriticalSection( &m_CritSec );
 
@@ -525,6 +554,261 @@ void DaGenericItem::ResetLastRead( void )
 
 
 
+//=====================================================================================
+// Get the revised sampling rate of the item
+// Returns 0 if the item is sampled with the update rate of the group.
+//=====================================================================================
+DWORD DaGenericItem::get_SamplingRate( void )
+{
+      DWORD dw;
+
+   EnterCriticalSection( &m_CritSec );
+   dw = m_dwSamplingRate;
+   LeaveCriticalSection( &m_CritSec );
+   return dw;
+}
+
+
+
+//=====================================================================================
+// Set the revised sampling rate of the item
+// ----------------------------------------
+//    0 clears the sampling rate and the item is sampled with the
+//    update rate of the group. The group counts the items with an
+//    own sampling rate so that the update thread can skip the
+//    sampling of groups without such items.
+//=====================================================================================
+HRESULT DaGenericItem::set_SamplingRate( DWORD dwSamplingRate )
+{
+   _ASSERTE( m_Created );
+
+   EnterCriticalSection( &m_CritSec );
+
+   if (m_dwSamplingRate == 0 && dwSamplingRate != 0) {
+      InterlockedIncrement( &m_pGroup->m_lNumSampledItems );
+   }
+   else if (m_dwSamplingRate != 0 && dwSamplingRate == 0) {
+      InterlockedDecrement( &m_pGroup->m_lNumSampledItems );
+   }
+
+   m_dwSamplingRate     = dwSamplingRate;
+   m_dwSamplingBaseRate = 0;                    // Ticks are calculated with the next cycle
+   m_fSampled           = TRUE;                 // Include the item in the next update
+
+   LeaveCriticalSection( &m_CritSec );
+   return S_OK;
+}
+
+
+
+//=====================================================================================
+// Get the buffer enable flag
+//=====================================================================================
+BOOL DaGenericItem::get_BufferEnable( void )
+{
+      BOOL b;
+
+   EnterCriticalSection( &m_CritSec );
+   b = m_fBufferEnable;
+   LeaveCriticalSection( &m_CritSec );
+   return b;
+}
+
+
+
+//=====================================================================================
+// Set the buffer enable flag
+// Disabling the buffer discards all samples not sent yet.
+//=====================================================================================
+HRESULT DaGenericItem::set_BufferEnable( BOOL fEnable )
+{
+   EnterCriticalSection( &m_CritSec );
+
+   m_fBufferEnable = fEnable;
+   if (!fEnable && m_pSamples) {
+      for (DWORD i = 0; i < ITEM_SAMPLE_BUFFER_SIZE; i++) {
+         VariantClear( &m_pSamples[i].vDataValue );
+      }
+      delete [] m_pSamples;
+      m_pSamples        = NULL;
+      m_dwFirstSample   = 0;
+      m_dwNumSamples    = 0;
+      m_fSampleOverflow = FALSE;
+   }
+
+   LeaveCriticalSection( &m_CritSec );
+   return S_OK;
+}
+
+
+
+//=====================================================================================
+// SampleTick
+// ----------
+//    Called by the update thread with each base update cycle of an
+//    active group. The number of cycles between two samples is
+//    recalculated if the base update rate has changed.
+//
+//    Returns TRUE if the item must be sampled with this cycle.
+//=====================================================================================
+BOOL DaGenericItem::SampleTick( DWORD dwBaseUpdateRate )
+{
+      BOOL fDue = FALSE;
+
+   EnterCriticalSection( &m_CritSec );
+
+   if (m_dwSamplingRate && dwBaseUpdateRate) {
+
+      if (m_dwSamplingBaseRate != dwBaseUpdateRate) {
+         m_dwSamplingBaseRate  = dwBaseUpdateRate;
+         m_dwSamplingTicks     = m_dwSamplingRate / dwBaseUpdateRate;
+         if (m_dwSamplingTicks == 0) {
+            m_dwSamplingTicks = 1;
+         }
+         m_dwSamplingTickCount = 1;             // Sample with this cycle
+      }
+
+      if (--m_dwSamplingTickCount == 0) {
+         m_dwSamplingTickCount = m_dwSamplingTicks;
+         m_fSampled = TRUE;
+         fDue = TRUE;
+      }
+   }
+
+   LeaveCriticalSection( &m_CritSec );
+   return fDue;
+}
+
+
+
+//=====================================================================================
+// CheckSampledAndReset
+// --------------------
+//    Used by the group update to skip items with a sampling rate slower
+//    than the update rate of the group if they have not been sampled
+//    since the last update.
+//=====================================================================================
+BOOL DaGenericItem::CheckSampledAndReset( void )
+{
+      BOOL b = TRUE;
+
+   EnterCriticalSection( &m_CritSec );
+   if (m_dwSamplingRate) {
+      b = m_fSampled;
+      m_fSampled = FALSE;
+   }
+   LeaveCriticalSection( &m_CritSec );
+   return b;
+}
+
+
+
+//=====================================================================================
+// AddSample
+// ---------
+//    Appends a copy of the item state to the sample buffer. If the buffer
+//    is full the oldest sample is discarded and the overflow is reported
+//    with the next delivery of the samples.
+//=====================================================================================
+HRESULT DaGenericItem::AddSample( const OPCITEMSTATE& State )
+{
+      HRESULT hres = S_OK;
+
+   EnterCriticalSection( &m_CritSec );
+
+   if (!m_fBufferEnable) {
+      LeaveCriticalSection( &m_CritSec );
+      return E_FAIL;
+   }
+
+   if (m_pSamples == NULL) {
+      m_pSamples = new OPCITEMSTATE[ ITEM_SAMPLE_BUFFER_SIZE ];
+      if (m_pSamples == NULL) {
+         LeaveCriticalSection( &m_CritSec );
+         return E_OUTOFMEMORY;
+      }
+      for (DWORD i = 0; i < ITEM_SAMPLE_BUFFER_SIZE; i++) {
+         VariantInit( &m_pSamples[i].vDataValue );
+      }
+      m_dwFirstSample = 0;
+      m_dwNumSamples  = 0;
+   }
+
+   if (m_dwNumSamples == ITEM_SAMPLE_BUFFER_SIZE) {
+      VariantClear( &m_pSamples[ m_dwFirstSample ].vDataValue );
+      m_dwFirstSample = (m_dwFirstSample + 1) % ITEM_SAMPLE_BUFFER_SIZE;
+      m_dwNumSamples--;
+      m_fSampleOverflow = TRUE;
+   }
+
+   OPCITEMSTATE* pSample = &m_pSamples[ (m_dwFirstSample + m_dwNumSamples) % ITEM_SAMPLE_BUFFER_SIZE ];
+   pSample->hClient     = State.hClient;
+   pSample->ftTimeStamp = State.ftTimeStamp;
+   pSample->wQuality    = State.wQuality;
+   pSample->wReserved   = State.wReserved;
+   hres = VariantCopy( &pSample->vDataValue, const_cast<VARIANT*>(&State.vDataValue) );
+   if (SUCCEEDED( hres )) {
+      m_dwNumSamples++;
+   }
+
+   LeaveCriticalSection( &m_CritSec );
+   return hres;
+}
+
+
+
+//=====================================================================================
+// Returns the number of buffered samples
+//=====================================================================================
+DWORD DaGenericItem::get_SampleCount( void )
+{
+      DWORD dw;
+
+   EnterCriticalSection( &m_CritSec );
+   dw = m_dwNumSamples;
+   LeaveCriticalSection( &m_CritSec );
+   return dw;
+}
+
+
+
+//=====================================================================================
+// TakeSamples
+// -----------
+//    Moves the buffered samples in chronological order to the specified
+//    arrays which must have space for get_SampleCount() elements. The
+//    VARIANTs are moved, not copied. If samples have been discarded the
+//    first sample is marked with OPC_S_DATAQUEUEOVERFLOW.
+//
+//    Returns the number of samples moved.
+//=====================================================================================
+DWORD DaGenericItem::TakeSamples( OPCITEMSTATE* pStates, HRESULT* pErrors )
+{
+      DWORD i, dwNum;
+
+   EnterCriticalSection( &m_CritSec );
+
+   dwNum = m_dwNumSamples;
+   for (i = 0; i < dwNum; i++) {
+      OPCITEMSTATE* pSample = &m_pSamples[ (m_dwFirstSample + i) % ITEM_SAMPLE_BUFFER_SIZE ];
+      pStates[i] = *pSample;                    // Moves the VARIANT
+      VariantInit( &pSample->vDataValue );
+      pErrors[i] = S_OK;
+   }
+   if (dwNum && m_fSampleOverflow) {
+      pErrors[0] = OPC_S_DATAQUEUEOVERFLOW;
+   }
+
+   m_dwFirstSample   = 0;
+   m_dwNumSamples    = 0;
+   m_fSampleOverflow = FALSE;
+
+   LeaveCriticalSection( &m_CritSec );
+   return dwNum;
+}
+
+
+
 //=====================================================================================
 // Get the data type requestd by the client
 //=====================================================================================
@@ -598,6 +882,7 @@ HRESULT DaGenericItem::set_RequestedDataType( VARTYPE RequestedDataType )
    }
    if (SUCCEEDED( hres )) {
       m_RequestedDataType = RequestedDataType;  // Accepted data type
+      m_pfnConverter = GetVariantConverter( m_DeviceItem->get_CanonicalDataType(), RequestedDataType );
    }
    LeaveCriticalSection( &m_CritSec );
    return hres;
@@ -606,6 +891,23 @@ HRESULT DaGenericItem::set_RequestedDataType( VARTYPE RequestedDataType )
 
 
 
+//=====================================================================================
+// Get the function converting the canonical to the requested data type
+//=====================================================================================
+VARIANTCONVERTER DaGenericItem::get_Converter( void )
+{
+      VARIANTCONVERTER pfn;
+
+   _ASSERTE( ( m_Created == TRUE ) );
+
+   EnterCriticalSection( &m_CritSec );
+   pfn = m_pfnConverter ;
+   LeaveCriticalSection( &m_CritSec );
+   return pfn;
+}
+
+
+
 //=====================================================================================
 // Get the client handle
 //=====================================================================================
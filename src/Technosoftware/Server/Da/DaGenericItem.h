@@ -25,6 +25,10 @@
 
 #include "DaDeviceItem.h"
 
+// Maximum number of samples buffered for an item between two updates of
+// the group. If the buffer overflows the oldest sample is discarded.
+#define ITEM_SAMPLE_BUFFER_SIZE  (100)
+
 
 /////////////////////////////////////////////////////////////////
 // Item Definition Extension
@@ -144,6 +148,9 @@ public:
    VARTYPE get_RequestedDataType( void ) ;
    HRESULT set_RequestedDataType( VARTYPE RequestedDataType ) ;
 
+            // Get the function converting the canonical to the requested data type
+   VARIANTCONVERTER get_Converter( void ) ;
+
             // Get/Set the client handle
    unsigned long get_ClientHandle( void ) ;
    void          set_ClientHandle( unsigned long ClientHandle ) ;
@@ -183,6 +190,28 @@ public:
    HRESULT  UpdateLastRead( VARIANT vValue, WORD wQuality );
    void     ResetLastRead( void );
 
+      // ===============================================================
+      // Sampling rate and buffering (IOPCItemSamplingMgt)
+      // ===============================================================
+
+                  // Get/Set the revised sampling rate; 0 if the item is
+                  // sampled with the update rate of the group.
+   DWORD    get_SamplingRate( void );
+   HRESULT  set_SamplingRate( DWORD dwSamplingRate );
+                  // Get/Set the buffer enable flag
+   BOOL     get_BufferEnable( void );
+   HRESULT  set_BufferEnable( BOOL fEnable );
+                  // Advances the sampling schedule by one base update cycle.
+                  // Returns TRUE if the item must be sampled now.
+   BOOL     SampleTick( DWORD dwBaseUpdateRate );
+                  // Returns TRUE if the item has been sampled since the last
+                  // call or has no own sampling rate.
+   BOOL     CheckSampledAndReset( void );
+                  // Functions to handle the buffered samples
+   HRESULT  AddSample( const OPCITEMSTATE& State );
+   DWORD    get_SampleCount( void );
+   DWORD    TakeSamples( OPCITEMSTATE* pStates, HRESULT* pErrors );
+
 
 //=============================  Member Variables  ==================================
 protected:
@@ -228,9 +257,30 @@ protected:
                   // Requested data type
    VARTYPE        m_RequestedDataType;
 
+                  // Conversion from the canonical to the requested data type.
+                  // Selected if the requested data type is set.
+   VARIANTCONVERTER m_pfnConverter;
+
                   // Connection to the Device Item instance
    DaDeviceItem *  m_DeviceItem;
 
+                  // Revised sampling rate in ms, 0 if the group update rate is used.
+                  // The base update rate from which the sampling ticks are calculated
+                  // and the number of base update cycles until the next sample.
+   DWORD          m_dwSamplingRate;
+   DWORD          m_dwSamplingBaseRate;
+   DWORD          m_dwSamplingTicks;
+   DWORD          m_dwSamplingTickCount;
+   BOOL           m_fSampled;
+
+                  // Ring buffer with the samples collected since the last update.
+                  // Only allocated if buffering is enabled.
+   BOOL           m_fBufferEnable;
+   OPCITEMSTATE*  m_pSamples;
+   DWORD          m_dwFirstSample;
+   DWORD          m_dwNumSamples;
+   BOOL           m_fSampleOverflow;
+
    CRITICAL_SECTION m_CritSec;
 
 private:
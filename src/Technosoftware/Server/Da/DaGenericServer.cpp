@@ -24,6 +24,7 @@
 #include <process.h>
 #include <stdio.h>
 #include "DaGenericServer.h"
+#include "DaOutboundQueue.h"
 #include "UtilityFuncs.h"
 #include "DaComServer.h"
 #include "DaPublicGroup.h"
@@ -39,6 +40,7 @@ DaGenericServer::DaGenericServer()
     m_pCOpcSrv = NULL;
     m_FilterCriteria = NULL;
     m_hUpdateThread = NULL;
+    m_pOutboundQueue = NULL;
 
     InitializeCriticalSection(&m_CritSec);
     InitializeCriticalSection(&m_GroupsCritSec);
@@ -119,6 +121,18 @@ HRESULT DaGenericServer::Create(DaBaseServer* pServerClassHandler, DaComBaseServ
         goto CreateExit2;
     }
 
+    if (pServerClassHandler->GetOutboundQueueSize()) {
+        m_pOutboundQueue = new DaOutboundQueue();
+        if (m_pOutboundQueue == NULL) {
+            res = E_OUTOFMEMORY;
+            goto CreateExit3;
+        }
+        res = m_pOutboundQueue->Create(this, pServerClassHandler->GetOutboundQueueSize());
+        if (FAILED(res)) {
+            goto CreateExit3;
+        }
+    }
+
     res = CreateWaitForUpdateThread();
     if (FAILED(res)) {
         goto CreateExit3;
@@ -144,6 +158,10 @@ CreateExit4:
     KillWaitForUpdateThread();
 
 CreateExit3:
+    if (m_pOutboundQueue) {
+        delete m_pOutboundQueue;
+        m_pOutboundQueue = NULL;
+    }
     CloseHandle(m_hUpdateEvent);
     m_hUpdateEvent = NULL;
 
@@ -172,6 +190,11 @@ DaGenericServer::~DaGenericServer(void)
         SysFreeString(m_FilterCriteria);
     }
 
+    if (m_pOutboundQueue) {
+        delete m_pOutboundQueue;
+        m_pOutboundQueue = NULL;
+    }
+
     DeleteCriticalSection(&m_GroupsCritSec);
     DeleteCriticalSection(&m_CritSec);
     DeleteCriticalSection(&m_UpdateRateCritSec);
@@ -239,6 +262,10 @@ int  DaGenericServer::Kill(BOOL WithDetach)
 
     KillWaitForUpdateThread();
 
+    if (m_pOutboundQueue) {
+        m_pOutboundQueue->Destroy();           // No more callbacks after the update thread is gone
+    }
+
     EnterCriticalSection(&m_CritSec);
 
     // kill the groups of this server
@@ -915,6 +942,10 @@ unsigned __stdcall WaitForUpdateThread(void* pArg)
             if (SUCCEEDED(res)) {
 
                 if (group->GetActiveState() == TRUE) {
+                    // sample items with an own sampling rate before
+                    // the group update so that it includes the samples
+                    group->SampleItems();
+
                     // only active groups enter into account for update
                     EnterCriticalSection(&group->m_UpdateRateCritSec);
                     // recalc ticks if base update rate changed
@@ -1039,6 +1070,27 @@ HRESULT DaGenericServer::KillWaitForUpdateThread(void)
 
 
 
+//=================================================================================
+// Outbound Queue Statistics
+// -------------------------
+//=================================================================================
+LONG DaGenericServer::GetOutboundQueueDepth(void)
+{
+    return m_pOutboundQueue ? m_pOutboundQueue->Depth() : 0;
+}
+
+LONG DaGenericServer::GetCoalescedDropCount(void)
+{
+    return m_pOutboundQueue ? m_pOutboundQueue->CoalescedDrops() : 0;
+}
+
+LONG DaGenericServer::GetRejectedValueCount(void)
+{
+    return m_pOutboundQueue ? m_pOutboundQueue->RejectedValues() : 0;
+}
+
+
+
 //=================================================================================
 // Check Base Update Rate
 // ----------------------
@@ -1133,7 +1185,8 @@ void DaGenericServer::FireShutdownRequest(LPCWSTR szReason)
 
 
 //=================================================================================
-// Calls the OnRefreshOutputDevices() function in the server specific part.
+// Calls the OnRefreshOutputDevices() function in the server specific part
+// (via the write batching of DaBaseServer::RefreshOutputDevices()).
 // The current client name is provided as 'Actor ID'.
 // This function returns only S_OK or S_FALSE.
 //=================================================================================
@@ -1153,7 +1206,7 @@ HRESULT DaGenericServer::OnRefreshOutputDevices(
         szActorID = L"Unknown";                   // Must not be NULL
     }
 
-    HRESULT hrRefresh = m_pServerHandler->OnRefreshOutputDevices(
+    HRESULT hrRefresh = m_pServerHandler->RefreshOutputDevices(
         OPC_REFRESH_CLIENT, szActorID,
         dwNumOfItems,
         ppDItems,
@@ -1215,6 +1268,10 @@ HRESULT DaGenericServer::InternalReadMaxAge(
     DaDeviceItem**  pDItemsToReadFromDevice = ppTemporaryBuffer;
     HRESULT        hrRet = S_OK;
 
+    ULONGLONG ulNow = ((ULONGLONG)pftNow->dwHighDateTime << 32) | pftNow->dwLowDateTime;
+    DWORD     dwLastMaxAge = 0;              // Clients use mostly the same Max Age for all
+    ULONGLONG ulCompareTime = 0;             // items, calculate the compare time only once
+
     DWORD i;
     DWORD dwNumOfItemsToReadFromDevice = 0;
     for (i = 0; i < dwNumOfItems; i++) {         // Check each requested Item
@@ -1232,12 +1289,14 @@ HRESULT DaGenericServer::InternalReadMaxAge(
             else if (pdwMaxAges[i] != 0xFFFFFFFF) {
                 // Compare Max Age if not disabled
 
-// Subtract Max Age from the current time
-                ULONGLONG* pulNow = (ULONGLONG*)pftNow;
-                ULONGLONG* pulAge = (ULONGLONG*)&pdwMaxAges[i];
-                ULONGLONG  ulCompareTime = *pulNow - *pulAge;
+                // Subtract Max Age (ms) from the current time (100 ns)
+                if (pdwMaxAges[i] != dwLastMaxAge) {
+                    dwLastMaxAge = pdwMaxAges[i];
+                    ULONGLONG ulAge = (ULONGLONG)dwLastMaxAge * 10000;
+                    ulCompareTime = (ulNow > ulAge) ? ulNow - ulAge : 0;
+                }
 
-                if (pDItem->IsTimeStampOlderThan((FILETIME*)&ulCompareTime)) {
+                if (pDItem->IsTimeStampOlderThan(ulCompareTime)) {
                     pDItemsToReadFromDevice[i] = pDItem;
                     dwNumOfItemsToReadFromDevice++;
                 }
@@ -1250,8 +1309,7 @@ HRESULT DaGenericServer::InternalReadMaxAge(
     // Read from the Device for those Items which it's required.
     //
     if (dwNumOfItemsToReadFromDevice) {
-        HRESULT hrRefresh = m_pServerHandler->OnRefreshInputCache(
-            OPC_REFRESH_CLIENT,
+        HRESULT hrRefresh = RefreshStaleItems(
             dwNumOfItems,
             pDItemsToReadFromDevice,
             errors);
@@ -1299,6 +1357,95 @@ HRESULT DaGenericServer::InternalReadMaxAge(
 
 
 
+//=========================================================================
+// RefreshStaleItems
+// -----------------
+//    Passes only the items which must be read from the device to
+//    RefreshInputCache(). The items are ordered by the hash of their
+//    access path so items of the same device are passed one after the
+//    other; the path itself is not copied. The
+//    results are returned at the position of the items in ppStaleItems.
+//
+// return:
+//    S_OK if succeeded for all items; otherwise S_FALSE.
+//    Do not return other codes !
+//=========================================================================
+struct STALEITEM
+{
+    ULONG   ulAccessPathHash;                   // 0 if there is no access path
+    DWORD   dwIndex;                            // position in the requested items
+};
+
+static int __cdecl CompareStaleItems(const void* p1, const void* p2)
+{
+    const STALEITEM* pItem1 = (const STALEITEM*)p1;
+    const STALEITEM* pItem2 = (const STALEITEM*)p2;
+
+    if (pItem1->ulAccessPathHash != pItem2->ulAccessPathHash) {
+        return (pItem1->ulAccessPathHash < pItem2->ulAccessPathHash) ? -1 : 1;
+    }
+    return (pItem1->dwIndex < pItem2->dwIndex) ? -1 : 1;  // Keep the requested order
+}
+
+HRESULT DaGenericServer::RefreshStaleItems(
+    DWORD             dwNumOfItems,
+    DaDeviceItem   ** ppStaleItems,
+    HRESULT        *  errors)
+{
+    DWORD i;
+    DWORD dwNumStale = 0;
+    for (i = 0; i < dwNumOfItems; i++) {
+        if (ppStaleItems[i]) {
+            dwNumStale++;
+        }
+    }
+
+    STALEITEM*     pStale = new STALEITEM[dwNumStale];
+    DaDeviceItem** ppDItems = new DaDeviceItem*[dwNumStale];
+    HRESULT*       pErrors = new HRESULT[dwNumStale];
+    if (pStale == NULL || ppDItems == NULL || pErrors == NULL) {
+        if (pStale) delete[] pStale;
+        if (ppDItems) delete[] ppDItems;
+        if (pErrors) delete[] pErrors;
+        // Not enough memory to compact the list, NULL items are not read
+        return m_pServerHandler->RefreshInputCache(OPC_REFRESH_CLIENT, dwNumOfItems, ppStaleItems, errors);
+    }
+
+    BOOL  fSort = FALSE;
+    DWORD n = 0;
+    for (i = 0; i < dwNumOfItems; i++) {
+        if (ppStaleItems[i]) {
+            pStale[n].dwIndex = i;
+            pStale[n].ulAccessPathHash = ppStaleItems[i]->AccessPathHash();
+            if (n && !fSort && CompareStaleItems(&pStale[n - 1], &pStale[n]) > 0) {
+                fSort = TRUE;                   // Not yet grouped by access path
+            }
+            n++;
+        }
+    }
+    if (fSort) {
+        qsort(pStale, dwNumStale, sizeof(STALEITEM), CompareStaleItems);
+    }
+
+    for (n = 0; n < dwNumStale; n++) {
+        ppDItems[n] = ppStaleItems[pStale[n].dwIndex];
+        pErrors[n] = S_OK;
+    }
+
+    HRESULT hrRet = m_pServerHandler->RefreshInputCache(OPC_REFRESH_CLIENT, dwNumStale, ppDItems, pErrors);
+
+    for (n = 0; n < dwNumStale; n++) {
+        errors[pStale[n].dwIndex] = pErrors[n];
+    }
+
+    delete[] pErrors;
+    delete[] ppDItems;
+    delete[] pStale;
+    return hrRet;
+}
+
+
+
 //=========================================================================
 // InternalWriteVQT
 // ----------------
@@ -37,6 +37,7 @@ class DaGroup;
 class DaGenericGroup;
 class DaBaseServer;
 class DaComBaseServer;
+class DaOutboundQueue;
 
 class DaGenericServer {
     // this is the thread associated to each instance of this
@@ -260,6 +261,20 @@ public:
     // to inform to send group update to the clients
     HANDLE      m_hUpdateEvent;
 
+    //--------------------------------------------------------------
+    // returns the outbound queue used to deliver the data change
+    // callbacks or NULL if the callbacks are sent directly by the
+    // update thread
+    //--------------------------------------------------------------
+    DaOutboundQueue* GetOutboundQueue(void) { return m_pOutboundQueue; }
+
+    //--------------------------------------------------------------
+    // statistics of the outbound queue, all 0 if not used
+    //--------------------------------------------------------------
+    LONG GetOutboundQueueDepth(void);
+    LONG GetCoalescedDropCount(void);
+    LONG GetRejectedValueCount(void);
+
 private:
     // the update rate for which the ticks count limits
     // of the groups are calculated
@@ -279,6 +294,13 @@ private:
     // or go on updating
     BOOL        m_UpdateThreadToKill;
 
+    // refreshes the cache of the not NULL items in ppStaleItems,
+    // the items are passed grouped by their access path
+    HRESULT RefreshStaleItems(
+        DWORD             dwNumOfItems,
+        DaDeviceItem   ** ppStaleItems,
+        HRESULT        *  errors);
+
     // creates the thread waiting for the  m_hUpdateEvent
     // and sending update callbacks to the clients
     HRESULT CreateWaitForUpdateThread(void);
@@ -286,6 +308,10 @@ private:
     // destroys the thread waiting for the  m_hUpdateEvent
     HRESULT KillWaitForUpdateThread(void);
 
+    // queue delivering the data change callbacks to a slow client
+    // without blocking the update thread, NULL if not configured
+    DaOutboundQueue* m_pOutboundQueue;
+
     // checks if update rate of server class handler has changed
     // and sets it to the new rate
     BOOL CheckBaseUpdateRateChanged(void);
@@ -2832,6 +2832,138 @@ STDMETHODIMP DaGroup::ClearItemDeadband(
 
 
 
+///////////////////////////////////////////////////////////////////////////
+//////////////////////////// IOPCItemSamplingMgt //////////////////////////
+///////////////////////////////////////////////////////////////////////////
+
+//=========================================================================
+// IOPCItemSamplingMgt::SetItemSamplingRate                       INTERFACE
+// ----------------------------------------
+//    Sets the sampling rate for the specified items. The rate is revised
+//    to a multiple of the base update rate of the server.
+//=========================================================================
+STDMETHODIMP DaGroup::SetItemSamplingRate(
+	/* [in] */                    DWORD             dwCount,
+	/* [size_is][in] */           OPCHANDLE      *  phServer,
+	/* [size_is][in] */           DWORD          *  pdwRequestedSamplingRate,
+	/* [size_is][size_is][out] */ DWORD          ** ppdwRevisedSamplingRate,
+	/* [size_is][size_is][out] */ HRESULT        ** ppErrors)
+{
+	LOGFMTI( "IOPCItemSamplingMgt::SetItemSamplingRate" );
+
+	CFixOutArray< DWORD >   fxaRevisedSamplingRate;    // Use global COM memory
+	HRESULT                 hr = S_OK;
+	try {
+		fxaRevisedSamplingRate.Init( dwCount, ppdwRevisedSamplingRate, 0 );
+		hr = ItemSamplingRate( dwCount, phServer, ppErrors, pdwRequestedSamplingRate, *ppdwRevisedSamplingRate );
+		_OPC_CHECK_HR( hr );
+	}
+	catch (HRESULT hrEx) {
+		fxaRevisedSamplingRate.Cleanup();
+		hr = hrEx;
+	}
+	return hr;
+}
+
+
+
+//=========================================================================
+// IOPCItemSamplingMgt::GetItemSamplingRate                       INTERFACE
+// ----------------------------------------
+//    Gets the sampling rate for the specified items.
+//=========================================================================
+STDMETHODIMP DaGroup::GetItemSamplingRate(
+	/* [in] */                    DWORD             dwCount,
+	/* [size_is][in] */           OPCHANDLE      *  phServer,
+	/* [size_is][size_is][out] */ DWORD          ** ppdwSamplingRate,
+	/* [size_is][size_is][out] */ HRESULT        ** ppErrors)
+{
+	LOGFMTI( "IOPCItemSamplingMgt::GetItemSamplingRate" );
+
+	CFixOutArray< DWORD >   fxaSamplingRate;     // Use global COM memory
+	HRESULT                 hr = S_OK;
+	try {
+		fxaSamplingRate.Init( dwCount, ppdwSamplingRate, 0 );
+		hr = ItemSamplingRate( dwCount, phServer, ppErrors, NULL, *ppdwSamplingRate );
+		_OPC_CHECK_HR( hr );
+	}
+	catch (HRESULT hrEx) {
+		fxaSamplingRate.Cleanup();
+		hr = hrEx;
+	}
+	return hr;
+}
+
+
+
+//=========================================================================
+// IOPCItemSamplingMgt::ClearItemSamplingRate                     INTERFACE
+// ------------------------------------------
+//    Clears the sampling rate for the specified items. The items are
+//    sampled with the update rate of the group.
+//=========================================================================
+STDMETHODIMP DaGroup::ClearItemSamplingRate(
+	/* [in] */                    DWORD             dwCount,
+	/* [size_is][in] */           OPCHANDLE      *  phServer,
+	/* [size_is][size_is][out] */ HRESULT        ** ppErrors)
+{
+	LOGFMTI( "IOPCItemSamplingMgt::ClearItemSamplingRate" );
+
+	return ItemSamplingRate( dwCount, phServer, ppErrors );
+}
+
+
+
+//=========================================================================
+// IOPCItemSamplingMgt::SetItemBufferEnable                       INTERFACE
+// ----------------------------------------
+//    Enables or disables the buffering of the samples for the specified
+//    items.
+//=========================================================================
+STDMETHODIMP DaGroup::SetItemBufferEnable(
+	/* [in] */                    DWORD             dwCount,
+	/* [size_is][in] */           OPCHANDLE      *  phServer,
+	/* [size_is][in] */           BOOL           *  pbEnable,
+	/* [size_is][size_is][out] */ HRESULT        ** ppErrors)
+{
+	LOGFMTI( "IOPCItemSamplingMgt::SetItemBufferEnable" );
+
+	return ItemBufferEnable( dwCount, phServer, ppErrors, pbEnable );
+}
+
+
+
+//=========================================================================
+// IOPCItemSamplingMgt::GetItemBufferEnable                       INTERFACE
+// ----------------------------------------
+//    Gets the buffer enable flag for the specified items.
+//=========================================================================
+STDMETHODIMP DaGroup::GetItemBufferEnable(
+	/* [in] */                    DWORD             dwCount,
+	/* [size_is][in] */           OPCHANDLE      *  phServer,
+	/* [size_is][size_is][out] */ BOOL           ** ppbEnable,
+	/* [size_is][size_is][out] */ HRESULT        ** ppErrors)
+{
+	LOGFMTI( "IOPCItemSamplingMgt::GetItemBufferEnable" );
+
+	CFixOutArray< BOOL >    fxaEnable;           // Use global COM memory
+	HRESULT                 hr = S_OK;
+	try {
+		fxaEnable.Init( dwCount, ppbEnable, FALSE );
+		hr = ItemBufferEnable( dwCount, phServer, ppErrors, NULL, *ppbEnable );
+		_OPC_CHECK_HR( hr );
+	}
+	catch (HRESULT hrEx) {
+		fxaEnable.Cleanup();
+		hr = hrEx;
+	}
+	return hr;
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+
+
 //=========================================================================
 // WriteSync                                                       INTERNAL
 // ---------
@@ -3021,4 +3153,172 @@ HRESULT DaGroup::ItemDeadband(
 	ReleaseGenericGroup();
 	return hrRet;
 }
+
+
+
+//=========================================================================
+// ItemSamplingRate                                                 INTERNAL
+// ----------------
+//    Implementation for IOPCItemSamplingMgt::SetItemSamplingRate(),
+//    IOPCItemSamplingMgt::GetItemSamplingRate() and
+//    IOPCItemSamplingMgt::ClearItemSamplingRate().
+//
+// The parameters pdwSamplingRateIn and pdwSamplingRateOut specified
+// which functionality is performed:
+//
+// SetItemSamplingRate
+//    pdwSamplingRateIn != NULL, pdwSamplingRateOut != NULL (revised rates)
+//
+// GetItemSamplingRate
+//    pdwSamplingRateIn = NULL,  pdwSamplingRateOut != NULL
+//
+// ClearItemSamplingRate
+//    pdwSamplingRateIn = NULL,  pdwSamplingRateOut = NULL
+//
+//=========================================================================
+HRESULT DaGroup::ItemSamplingRate(
+										/* [in] */                    DWORD             dwCount,
+										/* [size_is][in] */           OPCHANDLE      *  phServer,
+										/* [size_is][size_is][out] */ HRESULT        ** ppErrors,
+										/* [size_is][in] */           DWORD          *  pdwSamplingRateIn /* = NULL */,
+										/* [size_is][out] */          DWORD          *  pdwSamplingRateOut /* = NULL */ )
+{
+	*ppErrors = NULL;                            // Note : Proxy/Stub checks if the pointers are NULL
+
+	if (dwCount == 0) {
+		LOGFMTE( "ItemSamplingRate() failed with invalid argument(s): dwCount is 0" );
+		return E_INVALIDARG;
+	}
+
+	DaGenericGroup* pGGroup;
+	HRESULT hrRet = GetGenericGroup( &pGGroup ); // Check group state and get the pointer
+	if (FAILED( hrRet )) {
+		LOGFMTE( "ItemSamplingRate() failed with error: No generic Group" );
+		return hrRet;
+	}
+
+	CFixOutArray< HRESULT > fxaErrors;           // Use global COM memory
+
+	try {
+		USES_CONVERSION;
+		LOGFMTI( "ItemSamplingRate() %ld items of group %s", dwCount, W2A( pGGroup->m_Name ) );
+
+		fxaErrors.Init( dwCount, ppErrors, S_OK );
+
+		for (DWORD i=0; i<dwCount; i++) {
+
+			DaGenericItem* pGItem;
+			HRESULT hr = pGGroup->GetGenericItem( phServer[i], &pGItem );
+			if (SUCCEEDED( hr )) {
+
+				if (pdwSamplingRateIn) {
+					DWORD dwRevised;
+					hr = pGGroup->m_pServerHandler->ReviseUpdateRate( pdwSamplingRateIn[i], &dwRevised );
+					if (SUCCEEDED( hr )) {
+						hr = pGItem->set_SamplingRate( dwRevised );
+					}
+					if (SUCCEEDED( hr )) {
+						pdwSamplingRateOut[i] = dwRevised;
+						if (dwRevised != pdwSamplingRateIn[i]) {
+							hr = OPC_S_UNSUPPORTEDRATE;
+						}
+					}
+				}
+				else if (pdwSamplingRateOut) {
+					pdwSamplingRateOut[i] = pGItem->get_SamplingRate();
+					if (pdwSamplingRateOut[i] == 0) {
+						hr = OPC_E_RATENOTSET;
+					}
+				}
+				else {
+					hr = pGItem->set_SamplingRate( 0 );
+				}
+				pGGroup->ReleaseGenericItem( phServer[i] );
+			}
+			fxaErrors[i] = hr;
+			if (FAILED( hr )) {
+				hrRet = S_FALSE;
+			}
+		}
+	}
+	catch (HRESULT hrEx) {
+		fxaErrors.Cleanup();
+		hrRet = hrEx;
+	}
+
+	ReleaseGenericGroup();
+	return hrRet;
+}
+
+
+
+//=========================================================================
+// ItemBufferEnable                                                 INTERNAL
+// ----------------
+//    Implementation for IOPCItemSamplingMgt::SetItemBufferEnable() and
+//    IOPCItemSamplingMgt::GetItemBufferEnable().
+//
+// SetItemBufferEnable
+//    pbEnableIn != NULL, pbEnableOut = NULL
+//
+// GetItemBufferEnable
+//    pbEnableIn = NULL,  pbEnableOut != NULL
+//
+//=========================================================================
+HRESULT DaGroup::ItemBufferEnable(
+										/* [in] */                    DWORD             dwCount,
+										/* [size_is][in] */           OPCHANDLE      *  phServer,
+										/* [size_is][size_is][out] */ HRESULT        ** ppErrors,
+										/* [size_is][in] */           BOOL           *  pbEnableIn /* = NULL */,
+										/* [size_is][out] */          BOOL           *  pbEnableOut /* = NULL */ )
+{
+	*ppErrors = NULL;                            // Note : Proxy/Stub checks if the pointers are NULL
+
+	if (dwCount == 0) {
+		LOGFMTE( "ItemBufferEnable() failed with invalid argument(s): dwCount is 0" );
+		return E_INVALIDARG;
+	}
+
+	DaGenericGroup* pGGroup;
+	HRESULT hrRet = GetGenericGroup( &pGGroup ); // Check group state and get the pointer
+	if (FAILED( hrRet )) {
+		LOGFMTE( "ItemBufferEnable() failed with error: No generic Group" );
+		return hrRet;
+	}
+
+	CFixOutArray< HRESULT > fxaErrors;           // Use global COM memory
+
+	try {
+		USES_CONVERSION;
+		LOGFMTI( "ItemBufferEnable() %ld items of group %s", dwCount, W2A( pGGroup->m_Name ) );
+
+		fxaErrors.Init( dwCount, ppErrors, S_OK );
+
+		for (DWORD i=0; i<dwCount; i++) {
+
+			DaGenericItem* pGItem;
+			HRESULT hr = pGGroup->GetGenericItem( phServer[i], &pGItem );
+			if (SUCCEEDED( hr )) {
+				if (pbEnableIn) {
+					hr = pGItem->set_BufferEnable( pbEnableIn[i] ? TRUE : FALSE );
+				}
+				else {
+					pbEnableOut[i] = pGItem->get_BufferEnable();
+				}
+				pGGroup->ReleaseGenericItem( phServer[i] );
+			}
+			fxaErrors[i] = hr;
+			if (FAILED( hr )) {
+				hrRet = S_FALSE;
+			}
+		}
+	}
+	catch (HRESULT hrEx) {
+		fxaErrors.Cleanup();
+		hrRet = hrEx;
+	}
+
+	ReleaseGenericGroup();
+	return hrRet;
+}
 //DOM-IGNORE-END
@@ -85,11 +85,8 @@ class ATL_NO_VTABLE DaGroup :
    public IOPCGroupStateMgt2,
    public IOPCSyncIO2,
    public IOPCAsyncIO3,
-   public IOPCItemDeadbandMgt
-/*
-
+   public IOPCItemDeadbandMgt,
    public IOPCItemSamplingMgt                   // [optional]
-*/
 {
 public:
    DaGroup();
@@ -123,7 +120,7 @@ BEGIN_COM_MAP(DaGroup)
    COM_INTERFACE_ENTRY(IOPCSyncIO2)
    COM_INTERFACE_ENTRY(IOPCAsyncIO3)
    COM_INTERFACE_ENTRY(IOPCItemDeadbandMgt)
-//   COM_INTERFACE_ENTRY(IOPCItemSamplingMgt)      // [optional]
+   COM_INTERFACE_ENTRY(IOPCItemSamplingMgt)      // [optional]
    
    COM_INTERFACE_ENTRY_AGGREGATE(IID_IMarshal, m_pUnkMarshaler.p)
 END_COM_MAP()
@@ -739,7 +736,6 @@ END_CONNECTION_POINT_MAP()
                   /* [size_is][size_is][out] */ HRESULT        ** ppErrors
                   );
 
-#ifdef NOT_YET_IMPLEMENTED
    ///////////////////////////////////////////////////////////////////////////
    //////////////////////////// IOPCItemSamplingMgt //////////////////////////
    ///////////////////////////////////////////////////////////////////////////
@@ -779,8 +775,6 @@ END_CONNECTION_POINT_MAP()
                   /* [size_is][size_is][out] */ HRESULT        ** ppErrors
                   );
 
-#endif //NOT_YET_IMPLEMENTED
-
 
    //======================================================================
 
@@ -921,6 +915,23 @@ public:
       /* [size_is][size_is][out] */ HRESULT        ** ppErrors,
       /* [size_is][in] */           FLOAT          *  pPercentDeadbandIn = NULL,
       /* [size_is][in] */           FLOAT          *  pPercentDeadbandOut = NULL );
+
+      // Called by IOPCItemSamplingMgt::SetItemSamplingRate(), IOPCItemSamplingMgt::GetItemSamplingRate()
+      // and IOPCItemSamplingMgt::ClearItemSamplingRate()
+   HRESULT ItemSamplingRate(
+      /* [in] */                    DWORD             dwCount,
+      /* [size_is][in] */           OPCHANDLE      *  phServer,
+      /* [size_is][size_is][out] */ HRESULT        ** ppErrors,
+      /* [size_is][in] */           DWORD          *  pdwSamplingRateIn = NULL,
+      /* [size_is][out] */          DWORD          *  pdwSamplingRateOut = NULL );
+
+      // Called by IOPCItemSamplingMgt::SetItemBufferEnable() and IOPCItemSamplingMgt::GetItemBufferEnable()
+   HRESULT ItemBufferEnable(
+      /* [in] */                    DWORD             dwCount,
+      /* [size_is][in] */           OPCHANDLE      *  phServer,
+      /* [size_is][size_is][out] */ HRESULT        ** ppErrors,
+      /* [size_is][in] */           BOOL           *  pbEnableIn = NULL,
+      /* [size_is][out] */          BOOL           *  pbEnableOut = NULL );
 };
 //DOM-IGNORE-END
 
@@ -817,7 +817,9 @@ HRESULT STDMETHODCALLTYPE DaItem::OPCRead(
                1, 
                &DItem, 
                &tItemValue,
-               &tError
+               &tError,
+               NULL,
+               &GItem
                );
 
    // Note : res is always S_OK or S_FALSE
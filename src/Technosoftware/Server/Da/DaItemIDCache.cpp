@@ -0,0 +1,277 @@
+/*
+ * Copyright (c) 2020 Technosoftware GmbH. All rights reserved
+ * Web: https://technosoftware.com
+ *
+ * The source code in this file is covered under a dual-license scenario:
+ *   - Owner of a purchased license: SCLA 1.0
+ *   - GPL V3: everybody else
+ *
+ * SCLA license terms accompanied with this source code.
+ * See https://technosoftware.com/license/Source_Code_License_Agreement.pdf
+ *
+ * GNU General Public License as published by the Free Software Foundation;
+ * version 3 of the License are accompanied with this source code.
+ * See https://technosoftware.com/license/GPLv3License.txt
+ *
+ * This source code is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+ //DOM-IGNORE-BEGIN
+
+#include "stdafx.h"
+#include "DaItemIDCache.h"
+#include "UtilityFuncs.h"
+
+//=========================================================================
+// Constructor
+//=========================================================================
+DaItemIDCache::DaItemIDCache( void )
+{
+   first_    = NULL;
+   last_     = NULL;
+   capacity_ = 0;
+   InitializeCriticalSection( &criticalSection_ );
+}
+
+
+
+//=========================================================================
+// Destructor
+//=========================================================================
+DaItemIDCache::~DaItemIDCache()
+{
+   RemoveAll();
+   DeleteCriticalSection( &criticalSection_ );
+}
+
+
+
+//=========================================================================
+// SetCapacity
+// -----------
+//    Removes the least recently used entries which exceed the new
+//    capacity.
+//=========================================================================
+void DaItemIDCache::SetCapacity( DWORD capacity )
+{
+   CAtlArray<DaDeviceItem*> detachItems;
+
+   EnterCriticalSection( &criticalSection_ );
+   capacity_ = capacity;
+   while (last_ && (DWORD)entries_.GetCount() > capacity_) {
+      detachItems.Add( RemoveEntryNoLock( last_ ) );
+   }
+   LeaveCriticalSection( &criticalSection_ );
+
+   for (size_t n = 0; n < detachItems.GetCount(); n++) {
+      detachItems[n]->Detach();
+   }
+}
+
+
+
+//=========================================================================
+// Lookup
+// ------
+//    The found entry becomes the most recently used one.
+//    The entry of a killed Device Item is removed.
+//=========================================================================
+BOOL DaItemIDCache::Lookup( LPCWSTR itemID, DaDeviceItem** deviceItem )
+{
+   DaDeviceItem* pDetach = NULL;
+   Entry*        pEntry;
+
+   *deviceItem = NULL;
+
+   EnterCriticalSection( &criticalSection_ );
+   if (entries_.Lookup( itemID, pEntry )) {
+      if (pEntry->deviceItem->Attach() < 0) {   // Killed
+         pDetach = RemoveEntryNoLock( pEntry );
+      }
+      else {
+         *deviceItem = pEntry->deviceItem;
+         UnlinkNoLock( pEntry );
+         LinkFirstNoLock( pEntry );
+      }
+   }
+   LeaveCriticalSection( &criticalSection_ );
+
+   // Detach outside of the critical section because
+   // Detach() may delete killed items.
+   if (pDetach) {
+      pDetach->Detach();
+   }
+   return (*deviceItem) ? TRUE : FALSE;
+}
+
+
+
+//=========================================================================
+// Add
+// ---
+//    The new entry becomes the most recently used one. The least
+//    recently used entry is removed if the cache is full.
+//=========================================================================
+void DaItemIDCache::Add( LPCWSTR itemID, DaDeviceItem* deviceItem )
+{
+   DaDeviceItem* pDetach = NULL;
+   Entry*        pEntry;
+
+   EnterCriticalSection( &criticalSection_ );
+
+   if (capacity_ == 0 ||
+       entries_.Lookup( itemID, pEntry ) ||
+       items_.Lookup( deviceItem, pEntry )) {
+      LeaveCriticalSection( &criticalSection_ );
+      return;                                   // Disabled or already cached
+   }
+
+   pEntry = new Entry;
+   if (pEntry) {
+      pEntry->itemID = WSTRClone( itemID, NULL );
+   }
+   if (pEntry == NULL || pEntry->itemID == NULL || deviceItem->Attach() < 0) {
+      if (pEntry) {
+         if (pEntry->itemID) WSTRFree( pEntry->itemID, NULL );
+         delete pEntry;
+      }
+      LeaveCriticalSection( &criticalSection_ );
+      return;
+   }
+   pEntry->deviceItem = deviceItem;
+
+   try {
+      entries_.SetAt( pEntry->itemID, pEntry );
+      items_.SetAt( deviceItem, pEntry );
+      LinkFirstNoLock( pEntry );
+      if ((DWORD)entries_.GetCount() > capacity_) {
+         pDetach = RemoveEntryNoLock( last_ );
+      }
+   }
+   catch (...) {
+      entries_.RemoveKey( pEntry->itemID );
+      items_.RemoveKey( deviceItem );
+      WSTRFree( pEntry->itemID, NULL );
+      delete pEntry;
+      pDetach = deviceItem;
+   }
+
+   LeaveCriticalSection( &criticalSection_ );
+
+   if (pDetach) {
+      pDetach->Detach();
+   }
+}
+
+
+
+//=========================================================================
+// Remove
+//=========================================================================
+void DaItemIDCache::Remove( DaDeviceItem* deviceItem )
+{
+   DaDeviceItem* pDetach = NULL;
+   Entry*        pEntry;
+
+   EnterCriticalSection( &criticalSection_ );
+   if (items_.Lookup( deviceItem, pEntry )) {
+      pDetach = RemoveEntryNoLock( pEntry );
+   }
+   LeaveCriticalSection( &criticalSection_ );
+
+   if (pDetach) {
+      pDetach->Detach();
+   }
+}
+
+
+
+//=========================================================================
+// RemoveAll
+//=========================================================================
+void DaItemIDCache::RemoveAll( void )
+{
+   CAtlArray<DaDeviceItem*> detachItems;
+
+   EnterCriticalSection( &criticalSection_ );
+   while (first_) {
+      detachItems.Add( RemoveEntryNoLock( first_ ) );
+   }
+   LeaveCriticalSection( &criticalSection_ );
+
+   for (size_t n = 0; n < detachItems.GetCount(); n++) {
+      detachItems[n]->Detach();
+   }
+}
+
+
+
+//=========================================================================
+// UnlinkNoLock
+// ------------
+//    Removes the entry from the list of used entries.
+//    criticalSection_ must be entered outside.
+//=========================================================================
+void DaItemIDCache::UnlinkNoLock( Entry* entry )
+{
+   if (entry->prev) {
+      entry->prev->next = entry->next;
+   }
+   else {
+      first_ = entry->next;
+   }
+   if (entry->next) {
+      entry->next->prev = entry->prev;
+   }
+   else {
+      last_ = entry->prev;
+   }
+   entry->prev = NULL;
+   entry->next = NULL;
+}
+
+
+
+//=========================================================================
+// LinkFirstNoLock
+// ---------------
+//    Inserts the entry as most recently used one.
+//    criticalSection_ must be entered outside.
+//=========================================================================
+void DaItemIDCache::LinkFirstNoLock( Entry* entry )
+{
+   entry->prev = NULL;
+   entry->next = first_;
+   if (first_) {
+      first_->prev = entry;
+   }
+   else {
+      last_ = entry;
+   }
+   first_ = entry;
+}
+
+
+
+//=========================================================================
+// RemoveEntryNoLock
+// -----------------
+//    Removes and deletes the entry. Returns the Device Item which must
+//    be detached by the caller outside of the critical section.
+//    criticalSection_ must be entered outside.
+//=========================================================================
+DaDeviceItem* DaItemIDCache::RemoveEntryNoLock( Entry* entry )
+{
+   DaDeviceItem* pDItem = entry->deviceItem;
+
+   UnlinkNoLock( entry );
+   entries_.RemoveKey( entry->itemID );
+   items_.RemoveKey( pDItem );
+   WSTRFree( entry->itemID, NULL );
+   delete entry;
+   return pDItem;
+}
+
+//DOM-IGNORE-END
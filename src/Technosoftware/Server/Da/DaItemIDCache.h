@@ -0,0 +1,165 @@
+/*
+ * Copyright (c) 2020 Technosoftware GmbH. All rights reserved
+ * Web: https://technosoftware.com
+ *
+ * The source code in this file is covered under a dual-license scenario:
+ *   - Owner of a purchased license: SCLA 1.0
+ *   - GPL V3: everybody else
+ *
+ * SCLA license terms accompanied with this source code.
+ * See https://technosoftware.com/license/Source_Code_License_Agreement.pdf
+ *
+ * GNU General Public License as published by the Free Software Foundation;
+ * version 3 of the License are accompanied with this source code.
+ * See https://technosoftware.com/license/GPLv3License.txt
+ *
+ * This source code is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+
+#ifndef __ITEMIDCACHE_H_
+#define __ITEMIDCACHE_H_
+
+#if _MSC_VER >= 1000
+#pragma once
+#endif // _MSC_VER >= 1000
+
+//DOM-IGNORE-BEGIN
+
+#include <atlcoll.h>
+#include "DaDeviceItem.h"
+#include "OpcMap.h"
+
+/**
+ * @class	DaItemIDCache
+ *
+ * @brief	Bounded LRU cache of resolved ItemIDs used by the stateless IOPCItemIO functions.
+ *
+ * 			Maps ItemID strings to the Device Items returned by OnValidateItems(). Each cached
+ * 			Device Item is attached by the cache. Killed Device Items are never returned and
+ * 			removed from the cache on access; the server must call Remove() before it kills a
+ * 			Device Item so the reference of the cache does not delay the deletion.
+ */
+
+class DaItemIDCache
+{
+   public:
+
+      /**
+       * @fn	DaItemIDCache::DaItemIDCache( void );
+       *
+       * @brief	Constructor. The cache is disabled until a capacity is set.
+       */
+
+      DaItemIDCache( void );
+
+      /**
+       * @fn	DaItemIDCache::~DaItemIDCache();
+       *
+       * @brief	Detaches all cached Device Items.
+       */
+
+      ~DaItemIDCache();
+
+      /**
+       * @fn	void DaItemIDCache::SetCapacity( DWORD capacity );
+       *
+       * @brief	Sets the maximum number of cached ItemIDs. The least recently used entries
+       * 			are removed if the cache is full.
+       *
+       * @param	capacity	The maximum number of entries. 0 disables the cache.
+       */
+
+      void SetCapacity( DWORD capacity );
+
+      /**
+       * @fn	BOOL DaItemIDCache::IsEnabled() const;
+       *
+       * @brief	Tells whether the cache is enabled.
+       */
+
+      inline BOOL IsEnabled() const { return (capacity_ > 0) ? TRUE : FALSE; }
+
+      /**
+       * @fn	BOOL DaItemIDCache::Lookup( LPCWSTR itemID, DaDeviceItem** deviceItem );
+       *
+       * @brief	Searches the Device Item of an ItemID.
+       *
+       * @param 		itemID	  	The ItemID.
+       * @param [out]	deviceItem	The attached Device Item if found.
+       *
+       * @return	TRUE if found; otherwise FALSE.
+       */
+
+      BOOL Lookup( LPCWSTR itemID, DaDeviceItem** deviceItem );
+
+      /**
+       * @fn	void DaItemIDCache::Add( LPCWSTR itemID, DaDeviceItem* deviceItem );
+       *
+       * @brief	Adds a resolved ItemID. Does nothing if the ItemID or the Device Item is
+       * 			already cached.
+       *
+       * @param	itemID	  	The ItemID.
+       * @param	deviceItem	The Device Item validated for the ItemID.
+       */
+
+      void Add( LPCWSTR itemID, DaDeviceItem* deviceItem );
+
+      /**
+       * @fn	void DaItemIDCache::Remove( DaDeviceItem* deviceItem );
+       *
+       * @brief	Removes the entry of a Device Item and detaches it.
+       *
+       * @param	deviceItem	The Device Item.
+       */
+
+      void Remove( DaDeviceItem* deviceItem );
+
+      /**
+       * @fn	void DaItemIDCache::RemoveAll( void );
+       *
+       * @brief	Removes all entries and detaches the Device Items.
+       */
+
+      void RemoveAll( void );
+
+   private:
+
+      /**
+       * @struct	Entry
+       *
+       * @brief	A cached ItemID, linked in the order of use.
+       */
+
+      struct Entry
+      {
+         LPWSTR         itemID;           // own copy, used as key
+         DaDeviceItem*  deviceItem;       // attached
+         Entry*         prev;             // more recently used
+         Entry*         next;             // less recently used
+      };
+
+      void UnlinkNoLock( Entry* entry );
+      void LinkFirstNoLock( Entry* entry );
+      DaDeviceItem* RemoveEntryNoLock( Entry* entry );
+
+      /** @brief	Entries by ItemID, compared by value. */
+      COpcMap<LPCWSTR, Entry*> entries_;
+
+      /** @brief	Entries by Device Item. */
+      COpcMap<DaDeviceItem*, Entry*> items_;
+
+      /** @brief	Most and least recently used entry. */
+      Entry* first_;
+      Entry* last_;
+
+      /** @brief	Protects all members. */
+      CRITICAL_SECTION criticalSection_;
+
+      DWORD capacity_;
+};
+//DOM-IGNORE-END
+
+#endif // __ITEMIDCACHE_H_
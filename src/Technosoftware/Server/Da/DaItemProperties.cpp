@@ -144,65 +144,28 @@ STDMETHODIMP DaComBaseServer::GetItemProperties(
       return E_INVALIDARG;
 
    HRESULT  hresRet = S_OK;                     // Returned result
-   LPDWORD  pdwPropIDs = NULL;
-   LPVOID   pCookie = NULL;
 
    CFixOutArray< VARIANT > aVar;
    CFixOutArray< HRESULT > aErr;
 
    try {
-      HRESULT  hres;                            // Temporary results
-      DWORD    dwNumOfProperties = 0;
-                                                // Get the Property IDs available for the specified item
-      hres = daBaseServer_->OnQueryItemProperties(
-                                          szItemID,
-                                          &dwNumOfProperties,
-                                          &pdwPropIDs,
-                                          &pCookie );
-      if (FAILED( hres )) throw hres;
+      HRESULT  hresItem;                        // Result of the item
 
       aVar.Init( dwCount, ppvData );            // Allocate and initialize the result arrays
-      aErr.Init( dwCount, ppErrors,
-                  OPC_E_INVALID_PID );          // Initialize with default error code
-
-      DWORD             dwItemCnt;              // Counts the properties of the Item
-      DWORD             dwReqCnt;               // Counts the properties requested by the user
-
-                                                // Handle all requested propreties
-      for (dwReqCnt=0; dwReqCnt<dwCount; dwReqCnt++) {
-
-         for (dwItemCnt=0; dwItemCnt<dwNumOfProperties; dwItemCnt++) {
-                                                // Checks if the item has the requested property
-            if (pdwPropIDs[dwItemCnt] == pdwPropertyIDs[ dwReqCnt ]) {
-                                                // The item has the requested property
-                                                // Get the value of the current property
-               aErr[ dwReqCnt ] = daBaseServer_->OnGetItemProperty(
-                                          szItemID,
-                                          pdwPropertyIDs[ dwReqCnt ],
-                                          &aVar[ dwReqCnt ],
-                                          pCookie );
-               break;                           // Handle next property
-            }
-         }
-         if (FAILED( aErr[ dwReqCnt ] )) {
-            hresRet = S_FALSE;                  // S_FALSE beacuse not all results in ppErrors are S_OK
-         }
-      }
-      hres = daBaseServer_->OnReleasePropertyCookie( pCookie );
-      pCookie = NULL;                           // Mark as released
-      if (FAILED( hres )) throw hres;
+      aErr.Init( dwCount, ppErrors );
+                                                // Get the values of all requested properties
+      hresRet = daBaseServer_->GetItemProperties(
+                                          1, &szItemID,
+                                          dwCount, pdwPropertyIDs,
+                                          &aVar[0], &aErr[0],
+                                          &hresItem );
+      if (FAILED( hresItem )) throw hresItem;
    }
    catch (HRESULT hresEx) {
-      if (pCookie) {                            // Release cookie if not yet done
-         daBaseServer_->OnReleasePropertyCookie( pCookie );
-      }
       aVar.Cleanup();
       aErr.Cleanup();
       hresRet = hresEx;
    }
-   if (pdwPropIDs) {
-      delete [] pdwPropIDs;                     // Release temporary ID array
-   }
    return hresRet;
 }
                                                       
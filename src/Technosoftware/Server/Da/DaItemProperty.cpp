@@ -46,4 +46,172 @@ DaItemProperty::~DaItemProperty()
 {
 }
 
+
+
+//=========================================================================
+// DaItemPropertyTable Constructor
+//=========================================================================
+DaItemPropertyTable::DaItemPropertyTable( void )
+{
+   refCount_ = 1;
+   count_    = 0;
+   propIDs_  = NULL;
+   values_   = NULL;
+}
+
+
+
+//=========================================================================
+// DaItemPropertyTable Destructor
+//=========================================================================
+DaItemPropertyTable::~DaItemPropertyTable()
+{
+   for (DWORD i = 0; i < count_; i++) {
+      VariantClear( &values_[i] );
+   }
+   if (propIDs_) delete [] propIDs_;
+   if (values_)  delete [] values_;
+}
+
+
+
+//=========================================================================
+// DaItemPropertyTable::Create
+// ---------------------------
+//    Merges the specified values into a copy of the base table.
+//    The entries are kept sorted by insertion because the number of
+//    properties of an item is small.
+//=========================================================================
+HRESULT DaItemPropertyTable::Create( DaItemPropertyTable* pBase,
+                                     DWORD dwCount,
+                                     const DWORD* pdwPropIDs,
+                                     const VARIANT* pvValues,
+                                     DaItemPropertyTable** ppTable )
+{
+   _ASSERTE( ppTable );
+   *ppTable = NULL;
+
+   DWORD dwMax = (pBase ? pBase->count_ : 0) + dwCount;
+
+   DaItemPropertyTable* pTable = new DaItemPropertyTable;
+   if (pTable == NULL) {
+      return E_OUTOFMEMORY;
+   }
+   if (dwMax) {
+      pTable->propIDs_ = new DWORD[ dwMax ];
+      pTable->values_  = new VARIANT[ dwMax ];
+      if (pTable->propIDs_ == NULL || pTable->values_ == NULL) {
+         pTable->Release();
+         return E_OUTOFMEMORY;
+      }
+   }
+
+   HRESULT hres = S_OK;
+   DWORD i;
+   if (pBase) {
+      for (i = 0; i < pBase->count_ && SUCCEEDED( hres ); i++) {
+         VariantInit( &pTable->values_[i] );
+         hres = VariantCopy( &pTable->values_[i], &pBase->values_[i] );
+         pTable->propIDs_[i] = pBase->propIDs_[i];
+         pTable->count_++;
+      }
+   }
+
+   for (i = 0; i < dwCount && SUCCEEDED( hres ); i++) {
+                                                // Find the insert position
+      DWORD dwLow = 0;
+      DWORD dwHigh = pTable->count_;
+      while (dwLow < dwHigh) {
+         DWORD dwMid = (dwLow + dwHigh) / 2;
+         if (pTable->propIDs_[dwMid] < pdwPropIDs[i]) {
+            dwLow = dwMid + 1;
+         }
+         else {
+            dwHigh = dwMid;
+         }
+      }
+      if (dwLow < pTable->count_ && pTable->propIDs_[dwLow] == pdwPropIDs[i]) {
+         continue;                              // Already in the table
+      }
+
+      for (DWORD n = pTable->count_; n > dwLow; n--) {
+         pTable->propIDs_[n] = pTable->propIDs_[n - 1];
+         pTable->values_[n]  = pTable->values_[n - 1];
+      }
+      VariantInit( &pTable->values_[dwLow] );
+      hres = VariantCopy( &pTable->values_[dwLow], const_cast<VARIANT*>( &pvValues[i] ) );
+      pTable->propIDs_[dwLow] = pdwPropIDs[i];
+      pTable->count_++;
+   }
+
+   if (FAILED( hres )) {
+      pTable->Release();
+      return hres;
+   }
+   *ppTable = pTable;
+   return S_OK;
+}
+
+
+
+//=========================================================================
+// DaItemPropertyTable::IsStaticProperty
+// -------------------------------------
+//    Value, Quality, Timestamp and Scan Rate are read from the cache or
+//    the device. The properties with IDs from 300 (alarm and condition
+//    values) and the vendor specific properties may change at any time.
+//=========================================================================
+BOOL DaItemPropertyTable::IsStaticProperty( DWORD dwPropID )
+{
+   switch (dwPropID) {
+      case OPC_PROPERTY_DATATYPE :
+      case OPC_PROPERTY_ACCESS_RIGHTS :
+      case OPC_PROPERTY_EU_TYPE :
+      case OPC_PROPERTY_EU_INFO :
+         return TRUE;
+   }
+   return (dwPropID >= OPC_PROPERTY_EU_UNITS && dwPropID < OPC_PROPERTY_CONDITION_STATUS) ? TRUE : FALSE;
+}
+
+
+
+//=========================================================================
+// DaItemPropertyTable::Lookup
+//=========================================================================
+HRESULT DaItemPropertyTable::Lookup( DWORD dwPropID, LPVARIANT pvValue ) const
+{
+   DWORD dwLow = 0;
+   DWORD dwHigh = count_;
+   while (dwLow < dwHigh) {
+      DWORD dwMid = (dwLow + dwHigh) / 2;
+      if (propIDs_[dwMid] == dwPropID) {
+         return VariantCopy( pvValue, &values_[dwMid] );
+      }
+      if (propIDs_[dwMid] < dwPropID) {
+         dwLow = dwMid + 1;
+      }
+      else {
+         dwHigh = dwMid;
+      }
+   }
+   return S_FALSE;
+}
+
+
+
+//=========================================================================
+// DaItemPropertyTable::AddRef / Release
+//=========================================================================
+void DaItemPropertyTable::AddRef( void )
+{
+   InterlockedIncrement( &refCount_ );
+}
+
+void DaItemPropertyTable::Release( void )
+{
+   if (InterlockedDecrement( &refCount_ ) == 0) {
+      delete this;
+   }
+}
+
 //DOM-IGNORE-END
@@ -51,6 +51,52 @@ public:
 	~DaItemProperty();
 };
 
+
+
+//-----------------------------------------------------------------------
+// CLASS DaItemPropertyTable
+// -------------------------
+//    Immutable table with the values of the static properties of one
+//    Device Item, sorted by the Property ID.
+//    A table is never modified after it was created. It is shared by
+//    reference counting; values are added by creating a new table from
+//    an existing one.
+//-----------------------------------------------------------------------
+class DaItemPropertyTable
+{
+public:
+            // Creates a new table with the entries of pBase (may be NULL)
+            // and the specified values. Values with IDs already in pBase
+            // are ignored. The new table is referenced by the caller.
+   static HRESULT Create( DaItemPropertyTable* pBase,
+                          DWORD dwCount,
+                          const DWORD* pdwPropIDs,
+                          const VARIANT* pvValues,
+                          DaItemPropertyTable** ppTable );
+
+            // Tells whether the value of the property does not depend on
+            // the cache of the item and may therefore be kept in a table.
+   static BOOL IsStaticProperty( DWORD dwPropID );
+
+            // Copies the value of the specified property.
+            // Returns S_FALSE if the property is not in the table.
+   HRESULT  Lookup( DWORD dwPropID, LPVARIANT pvValue ) const;
+
+   inline DWORD Count() const { return count_; }
+
+   void     AddRef( void );
+   void     Release( void );
+
+private:
+   DaItemPropertyTable( void );
+   ~DaItemPropertyTable();
+
+   LONG     refCount_;
+   DWORD    count_;
+   DWORD*   propIDs_;                           // sorted ascending
+   VARIANT* values_;
+};
+
 //DOM-IGNORE-END
 
 #endif
@@ -0,0 +1,333 @@
+/*
+ * Copyright (c) 2020 Technosoftware GmbH. All rights reserved
+ * Web: https://technosoftware.com 
+ * 
+ * The source code in this file is covered under a dual-license scenario:
+ *   - Owner of a purchased license: SCLA 1.0
+ *   - GPL V3: everybody else
+ *
+ * SCLA license terms accompanied with this source code.
+ * See https://technosoftware.com/license/Source_Code_License_Agreement.pdf
+ *
+ * GNU General Public License as published by the Free Software Foundation;
+ * version 3 of the License are accompanied with this source code.
+ * See https://technosoftware.com/license/GPLv3License.txt
+ *
+ * This source code is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+ //DOM-IGNORE-BEGIN
+
+#include "stdafx.h"
+#include <process.h>
+#include "DaOutboundQueue.h"
+#include "DaGenericServer.h"
+#include "DaGenericGroup.h"
+#include "Logger.h"
+
+//=========================================================================
+// Constructor
+//=========================================================================
+DaOutboundQueue::DaOutboundQueue( void )
+{
+   server_         = NULL;
+   hWorkEvent_     = NULL;
+   hThread_        = NULL;
+   threadToKill_   = FALSE;
+   maxItems_       = 0;
+   depth_          = 0;
+   coalescedDrops_ = 0;
+   rejectedValues_ = 0;
+   InitializeCriticalSection( &criticalSection_ );
+}
+
+
+
+//=========================================================================
+// Destructor
+//=========================================================================
+DaOutboundQueue::~DaOutboundQueue()
+{
+   Destroy();
+   DeleteCriticalSection( &criticalSection_ );
+}
+
+
+
+//=========================================================================
+// Create
+// ------
+//    Starts the delivery thread.
+//=========================================================================
+HRESULT DaOutboundQueue::Create( DaGenericServer* server, DWORD maxItems )
+{
+   _ASSERTE( server );
+   _ASSERTE( hThread_ == NULL );
+
+   server_       = server;
+   maxItems_     = maxItems;
+   threadToKill_ = FALSE;
+
+   hWorkEvent_ = CreateEvent( NULL, FALSE, FALSE, NULL );
+   if (hWorkEvent_ == NULL) {
+      return HRESULT_FROM_WIN32( GetLastError() );
+   }
+
+   unsigned uThreadID;
+   hThread_ = (HANDLE)_beginthreadex( NULL, 0, OutboundQueueThreadHandler, this, 0, &uThreadID );
+   if (hThread_ == 0) {
+      HRESULT hr = HRESULT_FROM_WIN32( GetLastError() );
+      CloseHandle( hWorkEvent_ );
+      hWorkEvent_ = NULL;
+      return hr;
+   }
+   return S_OK;
+}
+
+
+
+//=========================================================================
+// Destroy
+// -------
+//    Stops the delivery thread and discards all pending item values.
+//=========================================================================
+void DaOutboundQueue::Destroy( void )
+{
+   if (hThread_) {
+      threadToKill_ = TRUE;
+      SetEvent( hWorkEvent_ );
+
+      // Wait max 60 secs until the delivery thread has terminated.
+      if (WaitForSingleObject( hThread_, 60000 ) == WAIT_TIMEOUT) {
+         TerminateThread( hThread_, 1 );
+      }
+      CloseHandle( hThread_ );
+      hThread_ = NULL;
+   }
+   if (hWorkEvent_) {
+      CloseHandle( hWorkEvent_ );
+      hWorkEvent_ = NULL;
+   }
+
+   EnterCriticalSection( &criticalSection_ );
+   FreeAllNoLock();
+   LeaveCriticalSection( &criticalSection_ );
+}
+
+
+
+//=========================================================================
+// Enqueue
+// -------
+//    Adds the changed item values of a group. A value of an item which
+//    is already pending replaces the pending value. Buffered samples are
+//    appended as long as the number of pending values is below the limit.
+//    If the queue is full a sample replaces the latest pending value of
+//    the same item. Values of items without a pending value are rejected
+//    if the queue is full.
+//
+// return:
+//    S_OK if all values are queued; otherwise S_FALSE.
+//=========================================================================
+HRESULT DaOutboundQueue::Enqueue( long hServerGroupHandle,
+                                  BOOL custom,
+                                  BOOL withTime,
+                                  BOOL dataCallbackOnly,
+                                  DWORD numItems,
+                                  DaGenericItem** genericItems,
+                                  BOOL* samples,
+                                  OPCITEMSTATE* itemStates,
+                                  HRESULT* errors,
+                                  BOOL* queued )
+{
+   HRESULT        hrRet = S_OK;
+   GroupUpdate*   pUpdate = NULL;
+   DWORD          i;
+
+   EnterCriticalSection( &criticalSection_ );
+
+   if (!pending_.Lookup( hServerGroupHandle, pUpdate )) {
+      pUpdate = new GroupUpdate;
+      if (pUpdate) {
+         pUpdate->hServerGroupHandle = hServerGroupHandle;
+         pending_.SetAt( hServerGroupHandle, pUpdate );
+         order_.AddTail( pUpdate );
+      }
+   }
+
+   if (pUpdate == NULL) {
+      LeaveCriticalSection( &criticalSection_ );
+      for (i = 0; i < numItems; i++) {
+         queued[i] = FALSE;
+      }
+      return S_FALSE;
+   }
+
+   // The latest callback settings of the group are used for the delivery
+   pUpdate->custom           = custom;
+   pUpdate->withTime         = withTime;
+   pUpdate->dataCallbackOnly = dataCallbackOnly;
+
+   for (i = 0; i < numItems; i++) {
+
+      size_t         idx;
+      OPCITEMSTATE*  pState;
+      BOOL           fSample = samples && samples[i];
+      BOOL           fPending = pUpdate->index.Lookup( genericItems[i], idx );
+
+      queued[i] = TRUE;
+
+      if (fPending && !fSample) {
+         pState = &pUpdate->itemStates[ idx ];  // Replace the pending value
+         VariantClear( &pState->vDataValue );
+         coalescedDrops_++;
+      }
+      else if ((DWORD)depth_ < maxItems_) {
+         OPCITEMSTATE state;
+         memset( &state, 0, sizeof (OPCITEMSTATE) );
+         idx = pUpdate->itemStates.Add( state );
+         pUpdate->errors.Add( S_OK );
+         pUpdate->index.SetAt( genericItems[i], idx );   // Latest pending value of the item
+         pState = &pUpdate->itemStates[ idx ];
+         depth_++;
+      }
+      else if (fPending) {
+         pState = &pUpdate->itemStates[ idx ];  // Queue is full, collapse the sample
+         VariantClear( &pState->vDataValue );   // into the latest pending value
+         coalescedDrops_++;
+      }
+      else {
+         queued[i] = FALSE;                     // Queue is full
+         rejectedValues_++;
+         hrRet = S_FALSE;
+         continue;
+      }
+
+      pState->hClient     = itemStates[i].hClient;
+      pState->ftTimeStamp = itemStates[i].ftTimeStamp;
+      pState->wQuality    = itemStates[i].wQuality;
+      pState->wReserved   = itemStates[i].wReserved;
+      VariantInit( &pState->vDataValue );
+      VariantCopy( &pState->vDataValue, &itemStates[i].vDataValue );
+      pUpdate->errors[ idx ] = errors[i];
+   }
+
+   if (pUpdate->itemStates.GetCount() == 0) {   // Nothing queued for a new group
+      pending_.RemoveKey( hServerGroupHandle );
+      order_.RemoveAt( order_.Find( pUpdate ) );
+      delete pUpdate;
+   }
+
+   LeaveCriticalSection( &criticalSection_ );
+
+   if (hrRet == S_FALSE) {
+      LOGFMTT( "Outbound queue full, %d item values pending.", depth_ );
+   }
+
+   SetEvent( hWorkEvent_ );
+   return hrRet;
+}
+
+
+
+//=========================================================================
+// DeliverUpdate
+// -------------
+//    Sends the pending values of a group to the client.
+//=========================================================================
+void DaOutboundQueue::DeliverUpdate( GroupUpdate* update )
+{
+   DaGenericGroup* pGGroup;
+
+   // get and nail the group, fails if the group was removed
+   if (FAILED( server_->GetGenericGroup( update->hServerGroupHandle, &pGGroup ) )) {
+      return;
+   }
+
+   pGGroup->TransmitToClient( update->custom,
+                              update->withTime,
+                              update->dataCallbackOnly,
+                              (long)update->itemStates.GetCount(),
+                              update->itemStates.GetData(),
+                              update->errors.GetData() );
+
+   server_->ReleaseGenericGroup( update->hServerGroupHandle );
+}
+
+
+
+//=========================================================================
+// FreeUpdate
+//=========================================================================
+void DaOutboundQueue::FreeUpdate( GroupUpdate* update )
+{
+   for (size_t i = 0; i < update->itemStates.GetCount(); i++) {
+      VariantClear( &update->itemStates[i].vDataValue );
+   }
+   delete update;
+}
+
+
+
+//=========================================================================
+// FreeAllNoLock
+// -------------
+//    Discards all pending values.
+//    criticalSection_ must be entered outside.
+//=========================================================================
+void DaOutboundQueue::FreeAllNoLock( void )
+{
+   while (!order_.IsEmpty()) {
+      FreeUpdate( order_.RemoveHead() );
+   }
+   pending_.RemoveAll();
+   depth_ = 0;
+}
+
+
+
+//=========================================================================
+// Thread delivering the pending values to the client
+// --------------------------------------------------
+//    The groups are handled in the order of their first pending update.
+//    The values of a group are taken out of the queue before they are
+//    sent. New values arriving during the callback are queued for the
+//    next callback of the group.
+//=========================================================================
+unsigned __stdcall OutboundQueueThreadHandler( void* pArg )
+{
+   DaOutboundQueue* pQueue = static_cast<DaOutboundQueue *>(pArg);
+   _ASSERTE( pQueue != NULL );
+
+   while (pQueue->threadToKill_ == FALSE) {
+
+      WaitForSingleObject( pQueue->hWorkEvent_, INFINITE );
+
+      while (pQueue->threadToKill_ == FALSE) {
+
+         DaOutboundQueue::GroupUpdate* pUpdate = NULL;
+
+         EnterCriticalSection( &pQueue->criticalSection_ );
+         if (!pQueue->order_.IsEmpty()) {
+            pUpdate = pQueue->order_.RemoveHead();
+            pQueue->pending_.RemoveKey( pUpdate->hServerGroupHandle );
+            pQueue->depth_ -= (LONG)pUpdate->itemStates.GetCount();
+         }
+         LeaveCriticalSection( &pQueue->criticalSection_ );
+
+         if (pUpdate == NULL) {
+            break;                              // Queue is empty
+         }
+
+         pQueue->DeliverUpdate( pUpdate );
+         pQueue->FreeUpdate( pUpdate );
+      }
+   }
+
+   _endthreadex( 0 );
+   return 0;
+}
+
+//DOM-IGNORE-END
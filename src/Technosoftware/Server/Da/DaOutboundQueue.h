@@ -0,0 +1,198 @@
+/*
+ * Copyright (c) 2020 Technosoftware GmbH. All rights reserved
+ * Web: https://technosoftware.com 
+ * 
+ * The source code in this file is covered under a dual-license scenario:
+ *   - Owner of a purchased license: SCLA 1.0
+ *   - GPL V3: everybody else
+ *
+ * SCLA license terms accompanied with this source code.
+ * See https://technosoftware.com/license/Source_Code_License_Agreement.pdf
+ *
+ * GNU General Public License as published by the Free Software Foundation;
+ * version 3 of the License are accompanied with this source code.
+ * See https://technosoftware.com/license/GPLv3License.txt
+ *
+ * This source code is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+#ifndef __OUTBOUNDQUEUE_H_
+#define __OUTBOUNDQUEUE_H_
+
+#if _MSC_VER >= 1000
+#pragma once
+#endif // _MSC_VER >= 1000
+
+//DOM-IGNORE-BEGIN
+
+#include <atlcoll.h>
+
+class DaGenericServer;
+class DaGenericItem;
+
+/**
+ * @class	DaOutboundQueue
+ *
+ * @brief	Bounded outbound queue of one client (generic server instance).
+ *
+ * 			The update thread of the client puts the changed item values into the queue
+ * 			instead of invoking the client callbacks itself. A delivery thread owned by the
+ * 			queue sends the pending values of a group with a single callback. A slow client
+ * 			therefore only delays its own callbacks but no longer the update thread or
+ * 			writers waiting for the COM group list.
+ *
+ * 			If the client falls behind, a new value of an item which is still pending replaces
+ * 			the pending value (value coalescing). The number of pending item values is limited;
+ * 			if the queue is full also buffered samples replace the pending value of their item.
+ * 			Values of items without a pending value which do not fit into the queue are
+ * 			rejected and must be sent again by the caller with the next update.
+ */
+
+class DaOutboundQueue
+{
+   friend unsigned __stdcall OutboundQueueThreadHandler( void* pArg );
+
+   public:
+
+      /**
+       * @fn	DaOutboundQueue::DaOutboundQueue( void );
+       *
+       * @brief	Constructor. Call Create() to start the delivery thread.
+       */
+
+      DaOutboundQueue( void );
+
+      /**
+       * @fn	DaOutboundQueue::~DaOutboundQueue();
+       *
+       * @brief	Destructor. Stops the delivery thread if still running.
+       */
+
+      ~DaOutboundQueue();
+
+      /**
+       * @fn	HRESULT DaOutboundQueue::Create( DaGenericServer* server, DWORD maxItems );
+       *
+       * @brief	Starts the delivery thread.
+       *
+       * @param [in]	server  	The client whose callbacks are delivered.
+       * @param 		maxItems	Maximum number of pending item values.
+       *
+       * @return	S_OK if the delivery thread is running; otherwise an error code.
+       */
+
+      HRESULT Create( DaGenericServer* server, DWORD maxItems );
+
+      /**
+       * @fn	void DaOutboundQueue::Destroy( void );
+       *
+       * @brief	Stops the delivery thread and discards all pending item values.
+       */
+
+      void Destroy( void );
+
+      /**
+       * @fn	HRESULT DaOutboundQueue::Enqueue( long hServerGroupHandle, BOOL custom, BOOL withTime, BOOL dataCallbackOnly, DWORD numItems, DaGenericItem** genericItems, BOOL* samples, OPCITEMSTATE* itemStates, HRESULT* errors, BOOL* queued );
+       *
+       * @brief	Adds the changed item values of a group to the queue. The values are copied.
+       *
+       * @param 			hServerGroupHandle	The server handle of the group.
+       * @param 			custom				TRUE for IAdviseSink connections of the custom
+       * 										interface.
+       * @param 			withTime			TRUE if time stamps are sent via IAdviseSink.
+       * @param 			dataCallbackOnly	TRUE if only IOPCDataCallback must be invoked.
+       * @param 			numItems			Number of items.
+       * @param [in]		genericItems		The generic items, used to identify the values of
+       * 										the same item.
+       * @param [in]		samples				TRUE for buffered samples which are only
+       * 										coalesced if the queue is full. Can be NULL if
+       * 										there are no samples.
+       * @param [in]		itemStates			The item values.
+       * @param [in]		errors				The item errors.
+       * @param [out]		queued				Set to FALSE for each item which could not be
+       * 										queued because the queue is full.
+       *
+       * @return	S_OK if all values have been queued; otherwise S_FALSE.
+       */
+
+      HRESULT Enqueue( long hServerGroupHandle,
+                       BOOL custom,
+                       BOOL withTime,
+                       BOOL dataCallbackOnly,
+                       DWORD numItems,
+                       DaGenericItem** genericItems,
+                       BOOL* samples,
+                       OPCITEMSTATE* itemStates,
+                       HRESULT* errors,
+                       BOOL* queued );
+
+      /**
+       * @fn	LONG DaOutboundQueue::Depth() const;
+       *
+       * @brief	Number of item values currently pending.
+       */
+
+      inline LONG Depth() const { return depth_; }
+
+      /**
+       * @fn	LONG DaOutboundQueue::CoalescedDrops() const;
+       *
+       * @brief	Number of pending item values replaced by a newer value of the same item.
+       */
+
+      inline LONG CoalescedDrops() const { return coalescedDrops_; }
+
+      /**
+       * @fn	LONG DaOutboundQueue::RejectedValues() const;
+       *
+       * @brief	Number of item values rejected because the queue was full.
+       */
+
+      inline LONG RejectedValues() const { return rejectedValues_; }
+
+   private:
+
+      /**
+       * @struct	GroupUpdate
+       *
+       * @brief	The pending item values of one group.
+       */
+
+      struct GroupUpdate
+      {
+         long                             hServerGroupHandle;
+         BOOL                             custom;
+         BOOL                             withTime;
+         BOOL                             dataCallbackOnly;
+         CAtlArray<OPCITEMSTATE>          itemStates;
+         CAtlArray<HRESULT>               errors;
+         CAtlMap<DaGenericItem*, size_t>  index;      // position of the latest value of an item
+      };
+
+      void DeliverUpdate( GroupUpdate* update );
+      void FreeUpdate( GroupUpdate* update );
+      void FreeAllNoLock( void );
+
+      /** @brief	The groups with pending values, indexed by server group handle. */
+      CAtlMap<long, GroupUpdate*> pending_;
+
+      /** @brief	The groups with pending values in the order of their first update. */
+      CAtlList<GroupUpdate*> order_;
+
+      /** @brief	Protects pending_, order_ and the counters. */
+      CRITICAL_SECTION criticalSection_;
+
+      DaGenericServer*  server_;
+      HANDLE            hWorkEvent_;
+      HANDLE            hThread_;
+      BOOL              threadToKill_;
+      DWORD             maxItems_;
+      LONG              depth_;
+      LONG              coalescedDrops_;
+      LONG              rejectedValues_;
+};
+//DOM-IGNORE-END
+
+#endif // __OUTBOUNDQUEUE_H_
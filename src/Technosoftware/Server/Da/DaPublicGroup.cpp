@@ -220,7 +220,7 @@ HRESULT DaPublicGroup::Create(
 DaPublicGroup::~DaPublicGroup()
 {
    if (m_pOwner) {
-      m_pOwner->m_array.PutElem( m_Handle, NULL );
+      m_pOwner->UnregisterNoLock( this );
    }
 
    if (m_ItemDefs) {
@@ -59,6 +59,8 @@ DaPublicGroupManager::~DaPublicGroupManager()
       }
       i ++;
    }         
+   m_mapNames.RemoveAll();
+   m_Handles.RemoveAll();
 
    LeaveCriticalSection(&m_CritSec);
    DeleteCriticalSection( &m_CritSec );
@@ -83,7 +85,7 @@ HRESULT DaPublicGroupManager::AddGroup( DaPublicGroup *pGroup, long *hPGHandle )
       goto PGHAddGroupExit0;
    }
 
-   res = FindGroup( pGroup->m_Name, &sh );
+   res = FindGroupNoLock( pGroup->m_Name, &sh );
    if ( SUCCEEDED(res) ) {
          // there already is a public group with this name!
       res = OPC_E_DUPLICATENAME;
@@ -97,6 +99,17 @@ HRESULT DaPublicGroupManager::AddGroup( DaPublicGroup *pGroup, long *hPGHandle )
       pGroup->m_pOwner = NULL;
       goto PGHAddGroupExit0;
    }
+   try {
+      m_mapNames.SetAt( pGroup->m_Name, *hPGHandle );
+      m_Handles.InsertAt( UpperBoundNoLock( *hPGHandle ), *hPGHandle );
+   }
+   catch (...) {
+         // cannot index the group
+      m_mapNames.RemoveKey( pGroup->m_Name );
+      m_array.PutElem( *hPGHandle, NULL );
+      res = E_OUTOFMEMORY;
+      goto PGHAddGroupExit0;
+   }
    m_TotGroups ++;
    pGroup->m_pOwner = this;
    pGroup->m_Handle = *hPGHandle;
@@ -121,14 +134,17 @@ HRESULT DaPublicGroupManager::RemoveGroup( long hPGHandle )
    res = S_OK;
    EnterCriticalSection(&m_CritSec);
 
-   m_array.GetElem( hPGHandle, &pg );
-   if( ( FAILED(res) ) || ( pg->Killed() == TRUE ) ) {
+   res = m_array.GetElem( hPGHandle, &pg );
+   if( ( FAILED(res) ) || ( pg == NULL ) || ( pg->Killed() == TRUE ) ) {
       res = E_INVALIDARG;
       goto PGHRemoveGroupExit1;
    }
+   res = S_OK;
+         // the name can be used by a new group
+   RemoveNameNoLock( pg );
    if ( pg->m_RefCount == 0 ) {
                // no thread is accessing the group so we can delete it
-      m_array.PutElem( hPGHandle, NULL);
+               // (the destructor removes it from the array)
       delete pg;
    } else {           // kill the group as soon as possible
       pg->Kill( FALSE );
@@ -212,31 +228,69 @@ HRESULT DaPublicGroupManager::FindGroup( BSTR Name, long *hPGHandle )
 //====================================================================
 HRESULT DaPublicGroupManager::FindGroupNoLock( BSTR Name, long *hPGHandle )
 {
-      long           res;
-      DaPublicGroup   *pg;
-      long           i, ni;
+   if ( Name == NULL ) {
+      return E_FAIL;
+   }
+      // killed groups are not in the name index
+   return m_mapNames.Lookup( Name, *hPGHandle ) ? S_OK : E_FAIL;
+};
 
-      // search all the m_array
-   ni = m_array.Size();
-   i = 0;
-   while ( i < ni ) {
-      res = m_array.GetElem( i, &pg );
-      if( (SUCCEEDED(res)) 
-            &&  ( pg->Killed() == FALSE ) 
-            &&  ( wcscmp( pg->m_Name, Name) == 0 ) ) {
-         *hPGHandle = i;
-         res = S_OK;
-         goto PGHFindGroupExit0;
-      }
-      i ++;
-   }         
 
-   res = E_FAIL;
 
-PGHFindGroupExit0:
+//====================================================================
+// removes the group from the name index
+//====================================================================
+void DaPublicGroupManager::RemoveNameNoLock( DaPublicGroup *pGroup )
+{
+      long           h;
 
-   return res;
-};
+   if ( ( pGroup->m_Name != NULL )
+         &&  ( m_mapNames.Lookup( pGroup->m_Name, h ) )
+         &&  ( h == pGroup->m_Handle ) ) {
+      m_mapNames.RemoveKey( pGroup->m_Name );
+   }
+}
+
+
+
+//====================================================================
+// removes the group from the array, the name index and
+// the handle list; called by the destructor of the group
+//====================================================================
+void DaPublicGroupManager::UnregisterNoLock( DaPublicGroup *pGroup )
+{
+      size_t         pos;
+
+   RemoveNameNoLock( pGroup );
+   m_array.PutElem( pGroup->m_Handle, NULL );
+
+   pos = UpperBoundNoLock( pGroup->m_Handle );
+   if ( ( pos > 0 ) && ( m_Handles[pos - 1] == pGroup->m_Handle ) ) {
+      m_Handles.RemoveAt( pos - 1 );
+   }
+}
+
+
+
+//====================================================================
+// returns the position of the first handle greater than hPGHandle
+//====================================================================
+size_t DaPublicGroupManager::UpperBoundNoLock( long hPGHandle )
+{
+      size_t         lo, hi, mid;
+
+   lo = 0;
+   hi = m_Handles.GetCount();
+   while ( lo < hi ) {
+      mid = lo + (hi - lo) / 2;
+      if ( m_Handles[mid] <= hPGHandle ) {
+         lo = mid + 1;
+      } else {
+         hi = mid;
+      }
+   }
+   return lo;
+}
 
 
 
@@ -248,7 +302,13 @@ HRESULT DaPublicGroupManager::First( long *hPGHandle )
       long           res;
 
    EnterCriticalSection(&m_CritSec);
-   res = m_array.First( hPGHandle );
+   if ( m_Handles.GetCount() > 0 ) {
+      *hPGHandle = m_Handles[0];
+      res = S_OK;
+   } else {
+      *hPGHandle = 0;
+      res = E_FAIL;
+   }
    LeaveCriticalSection(&m_CritSec);
    return res;
 };
@@ -265,8 +325,18 @@ HRESULT DaPublicGroupManager::Next( long hStartHandle, long *hNextHandle )
       return E_INVALIDARG;
    }
 
+      size_t         pos;
+
    EnterCriticalSection(&m_CritSec);
-   res = m_array.Next( hStartHandle, hNextHandle );
+      // the start handle may already be removed
+   pos = UpperBoundNoLock( hStartHandle );
+   if ( pos < m_Handles.GetCount() ) {
+      *hNextHandle = m_Handles[pos];
+      res = S_OK;
+   } else {
+      *hNextHandle = 0;
+      res = E_FAIL;
+   }
    LeaveCriticalSection(&m_CritSec);
    return res;
 };
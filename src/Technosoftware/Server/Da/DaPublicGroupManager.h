@@ -23,8 +23,40 @@
 
 //DOM-IGNORE-BEGIN
 
+#include <atlcoll.h>
 #include "DaPublicGroup.h"
 #include "openarray.h"
+#include "StringAtom.h"
+
+
+/////////////////////////////////////////////////////////////////
+//
+// PublicGroupNameTraits:
+// ======================
+// element traits for the name index of the public groups,
+// the names are compared by value and not by pointer
+//
+/////////////////////////////////////////////////////////////////
+
+class PublicGroupNameTraits : public CElementTraitsBase< LPCWSTR >
+{
+public:
+   static ULONG Hash( LPCWSTR name )
+      {
+         DWORD dwLength;
+         return StringAtom::HashOf( name, &dwLength );
+      }
+
+   static bool CompareElements( LPCWSTR name1, LPCWSTR name2 )
+      {
+         return (wcscmp( name1, name2 ) == 0) ? true : false;
+      }
+
+   static int CompareElementsOrdered( LPCWSTR name1, LPCWSTR name2 )
+      {
+         return wcscmp( name1, name2 );
+      }
+};
 
 
 /////////////////////////////////////////////////////////////////
@@ -40,6 +72,9 @@
 // is implemented as an array
 // there is a semaphore for each group to avoid race conditions
 // so a group cannot be removed while someone is using Next
+// the groups are indexed by name (hash map) and the used
+// handles are kept in ascending order so First and Next do
+// not scan the free entries of the array
 //
 /////////////////////////////////////////////////////////////////
 
@@ -81,11 +116,28 @@ public:
 private:
    HRESULT FindGroupNoLock( BSTR Name, long *hPGHandle );
 
+      // removes the group from the name index
+   void RemoveNameNoLock( DaPublicGroup *pGroup );
+
+      // removes the group from the name index and the handle list,
+      // called when the group is deleted
+   void UnregisterNoLock( DaPublicGroup *pGroup );
+
+      // returns the position of the first handle greater than hPGHandle
+      // in m_Handles
+   size_t UpperBoundNoLock( long hPGHandle );
+
 private:
    long m_TotGroups;
 
    OpenArray<DaPublicGroup *> m_array;
 
+      // handles of the groups which are not killed by name
+   CAtlMap<LPCWSTR, long, PublicGroupNameTraits> m_mapNames;
+
+      // handles of all groups in m_array in ascending order
+   CAtlArray<long> m_Handles;
+
       // used to synchronize access to m_array
    CRITICAL_SECTION m_CritSec;
 };
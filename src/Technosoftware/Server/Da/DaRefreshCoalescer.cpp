@@ -0,0 +1,358 @@
+/*
+ * Copyright (c) 2020 Technosoftware GmbH. All rights reserved
+ * Web: https://technosoftware.com
+ *
+ * The source code in this file is covered under a dual-license scenario:
+ *   - Owner of a purchased license: SCLA 1.0
+ *   - GPL V3: everybody else
+ *
+ * SCLA license terms accompanied with this source code.
+ * See https://technosoftware.com/license/Source_Code_License_Agreement.pdf
+ *
+ * GNU General Public License as published by the Free Software Foundation;
+ * version 3 of the License are accompanied with this source code.
+ * See https://technosoftware.com/license/GPLv3License.txt
+ *
+ * This source code is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+ //DOM-IGNORE-BEGIN
+
+#include "stdafx.h"
+#include "DaRefreshCoalescer.h"
+#include "DaDeviceItem.h"
+
+//=========================================================================
+// Constructor
+//=========================================================================
+DaRefreshCoalescer::DaRefreshCoalescer( void )
+{
+   enabled_           = FALSE;
+   finishedEntries_   = 0;
+   joinWindow_        = 0;
+   lastPurgeTick_     = GetTickCount();
+   deduplicatedReads_ = 0;
+   InitializeCriticalSection( &criticalSection_ );
+}
+
+
+
+//=========================================================================
+// Destructor
+//=========================================================================
+DaRefreshCoalescer::~DaRefreshCoalescer()
+{
+   POSITION pos = inFlight_.GetStartPosition();
+   while (pos) {
+      CAtlMap<Key, Slot, KeyTraits>::CPair* pPair = inFlight_.GetNext( pos );
+      ReleaseFlight( pPair->m_value.flight );
+      pPair->m_key.item->Detach();
+   }
+   inFlight_.RemoveAll();
+   DeleteCriticalSection( &criticalSection_ );
+}
+
+
+
+//=========================================================================
+// SetEnabled
+//=========================================================================
+void DaRefreshCoalescer::SetEnabled( BOOL enabled )
+{
+   InterlockedExchange( &enabled_, enabled ? TRUE : FALSE );
+}
+
+
+
+//=========================================================================
+// SetJoinWindow
+//=========================================================================
+void DaRefreshCoalescer::SetJoinWindow( DWORD joinWindow )
+{
+   EnterCriticalSection( &criticalSection_ );
+   joinWindow_ = joinWindow;
+   LeaveCriticalSection( &criticalSection_ );
+}
+
+
+
+//=========================================================================
+// Refresh
+// -------
+//    Refreshes the cache of the specified items via OnRefreshInputCache().
+//
+//    Items which are currently refreshed by another caller for the same
+//    reason (or whose refresh finished within the join window) are not
+//    read again. Refreshes for other reasons are not joined because the
+//    server handler must get the reason of each read.
+//    The caller waits for that refresh and uses the individual item
+//    result of it.
+//
+//    The own refresh is always executed before waiting for the joined
+//    ones. Therefore two callers which join each others items cannot
+//    dead-lock.
+//
+// return:
+//    S_OK if succeeded for all items; otherwise S_FALSE.
+//    Do not return other codes !
+//=========================================================================
+HRESULT DaRefreshCoalescer::Refresh( DaBaseServer* serverHandler,
+                                     OPC_REFRESH_REASON reason,
+                                     DWORD numItems,
+                                     DaDeviceItem** deviceItems,
+                                     HRESULT* errors )
+{
+   _ASSERTE( serverHandler );
+
+   if (numItems == 0 || !InterlockedCompareExchange( &enabled_, 0, 0 )) {
+      // Refresh of all items or coalescing disabled
+      return serverHandler->OnRefreshInputCache( reason, numItems, deviceItems, errors );
+   }
+
+   Slot*          pSlots   = new Slot[ numItems ];
+   DaDeviceItem** ppOwn    = new DaDeviceItem*[ numItems ];
+   if (pSlots == NULL || ppOwn == NULL) {
+      if (pSlots) delete [] pSlots;
+      if (ppOwn)  delete [] ppOwn;
+      return serverHandler->OnRefreshInputCache( reason, numItems, deviceItems, errors );
+   }
+
+   Flight*  pOwnFlight = NULL;
+   DWORD    dwNumOwn = 0;
+   DWORD    i;
+   CAtlArray<DaDeviceItem*> detachItems;
+
+   //
+   // Join the refreshes in progress and register the own items
+   //
+   EnterCriticalSection( &criticalSection_ );
+
+   // Purge the finished refreshes before new items are added, so
+   // entries of items which are not read again do not stay in the index.
+   DWORD dwNow = GetTickCount();
+   if (finishedEntries_ && (dwNow - lastPurgeTick_) >= joinWindow_) {
+      RemoveExpiredNoLock( dwNow, detachItems );
+      lastPurgeTick_ = dwNow;
+   }
+
+   for (i = 0; i < numItems; i++) {
+
+      pSlots[i].flight = NULL;
+      DaDeviceItem* pDItem = deviceItems[i];
+      if (pDItem == NULL) {
+         continue;
+      }
+
+      Key key;
+      key.item   = pDItem;
+      key.reason = reason;
+
+      Slot slot;
+      if (inFlight_.Lookup( key, slot )) {
+         if (slot.flight == pOwnFlight) {
+            pSlots[i] = slot;                   // Item requested more than once
+            continue;
+         }
+         if (!IsExpired( slot.flight, dwNow )) {
+            InterlockedIncrement( &slot.flight->refCount );
+            pSlots[i] = slot;                   // Join the refresh of another caller
+            InterlockedIncrement( &deduplicatedReads_ );
+            continue;
+         }
+         inFlight_.RemoveKey( key );            // Finished too long ago
+         finishedEntries_--;
+         ReleaseFlight( slot.flight );
+         detachItems.Add( pDItem );
+      }
+
+      if (pOwnFlight == NULL) {
+         pOwnFlight = CreateFlight( numItems );
+         if (pOwnFlight == NULL) {
+            break;                              // Read the remaining items without coalescing
+         }
+      }
+
+      pSlots[i].flight = pOwnFlight;
+      pSlots[i].index  = dwNumOwn;
+      ppOwn[dwNumOwn++] = pDItem;
+
+      if (inFlight_.SetAt( key, pSlots[i] )) {
+         InterlockedIncrement( &pOwnFlight->refCount );
+         pDItem->Attach();                      // Keep the key valid while indexed
+      }
+   }
+
+   LeaveCriticalSection( &criticalSection_ );
+
+   // Items which could not be registered are refreshed directly
+   for (; i < numItems; i++) {
+      pSlots[i].flight = NULL;
+      if (deviceItems[i]) {
+         serverHandler->OnRefreshInputCache( reason, 1, &deviceItems[i], &errors[i] );
+      }
+   }
+
+   //
+   // Read the own items from the device
+   //
+   if (dwNumOwn) {
+      serverHandler->OnRefreshInputCache( reason, dwNumOwn, ppOwn, pOwnFlight->errors );
+
+      EnterCriticalSection( &criticalSection_ );
+
+      pOwnFlight->finished     = TRUE;
+      pOwnFlight->finishedTick = GetTickCount();
+
+      for (DWORD n = 0; n < dwNumOwn; n++) {
+         Key key;
+         key.item   = ppOwn[n];
+         key.reason = reason;
+
+         Slot slot;
+         if (inFlight_.Lookup( key, slot ) && slot.flight == pOwnFlight) {
+            if (joinWindow_ == 0) {             // Remove own items from the index
+               inFlight_.RemoveKey( key );
+               ReleaseFlight( pOwnFlight );
+               detachItems.Add( ppOwn[n] );
+            }
+            else {
+               finishedEntries_++;              // Removed when expired
+            }
+         }
+      }
+
+      LeaveCriticalSection( &criticalSection_ );
+      SetEvent( pOwnFlight->doneEvent );
+   }
+
+   //
+   // Collect the individual results
+   //
+   HRESULT hrRet = S_OK;
+   for (i = 0; i < numItems; i++) {
+
+      Flight* pFlight = pSlots[i].flight;
+      if (pFlight == NULL) {
+         if (deviceItems[i] && FAILED( errors[i] )) {
+            hrRet = S_FALSE;
+         }
+         continue;
+      }
+      if (pFlight != pOwnFlight) {
+         WaitForSingleObject( pFlight->doneEvent, INFINITE );
+      }
+      errors[i] = pFlight->errors[ pSlots[i].index ];
+      if (FAILED( errors[i] )) {
+         hrRet = S_FALSE;
+      }
+      if (pFlight != pOwnFlight) {
+         ReleaseFlight( pFlight );
+      }
+   }
+
+   if (pOwnFlight) {
+      ReleaseFlight( pOwnFlight );
+   }
+
+   // Detach outside of the critical section because
+   // Detach() may delete killed items.
+   for (size_t n = 0; n < detachItems.GetCount(); n++) {
+      detachItems[n]->Detach();
+   }
+
+   delete [] ppOwn;
+   delete [] pSlots;
+
+   _ASSERTE( SUCCEEDED( hrRet ) );              // Must return S_OK or S_FALSE
+   return hrRet;
+}
+
+
+
+//=========================================================================
+// CreateFlight
+// ------------
+//    Creates a refresh with result slots for numItems items.
+//    The refresh is referenced by the caller.
+//=========================================================================
+DaRefreshCoalescer::Flight* DaRefreshCoalescer::CreateFlight( DWORD numItems )
+{
+   Flight* pFlight = new Flight;
+   if (pFlight == NULL) {
+      return NULL;
+   }
+   pFlight->errors = new HRESULT[ numItems ];
+   pFlight->doneEvent = CreateEvent( NULL, TRUE, FALSE, NULL );
+   if (pFlight->errors == NULL || pFlight->doneEvent == NULL) {
+      if (pFlight->errors) delete [] pFlight->errors;
+      if (pFlight->doneEvent) CloseHandle( pFlight->doneEvent );
+      delete pFlight;
+      return NULL;
+   }
+   for (DWORD i = 0; i < numItems; i++) {
+      pFlight->errors[i] = S_OK;
+   }
+   pFlight->refCount     = 1;
+   pFlight->finished     = FALSE;
+   pFlight->finishedTick = 0;
+   return pFlight;
+}
+
+
+
+//=========================================================================
+// ReleaseFlight
+//=========================================================================
+void DaRefreshCoalescer::ReleaseFlight( Flight* flight )
+{
+   if (InterlockedDecrement( &flight->refCount ) == 0) {
+      CloseHandle( flight->doneEvent );
+      delete [] flight->errors;
+      delete flight;
+   }
+}
+
+
+
+//=========================================================================
+// IsExpired
+// ---------
+//    A refresh can be joined while it is in progress and within the
+//    join window after it has finished.
+//=========================================================================
+BOOL DaRefreshCoalescer::IsExpired( Flight* flight, DWORD now )
+{
+   if (!flight->finished) {
+      return FALSE;
+   }
+   return ((now - flight->finishedTick) >= joinWindow_) ? TRUE : FALSE;
+}
+
+
+
+//=========================================================================
+// RemoveExpiredNoLock
+// -------------------
+//    Removes all finished refreshes outside of the join window from the
+//    index. The removed items must be detached by the caller outside of
+//    the critical section.
+//    criticalSection_ must be entered outside.
+//=========================================================================
+void DaRefreshCoalescer::RemoveExpiredNoLock( DWORD now, CAtlArray<DaDeviceItem*>& detachItems )
+{
+   POSITION pos = inFlight_.GetStartPosition();
+   while (pos) {
+      POSITION posCurrent = pos;
+      CAtlMap<Key, Slot, KeyTraits>::CPair* pPair = inFlight_.GetNext( pos );
+      if (IsExpired( pPair->m_value.flight, now )) {
+         ReleaseFlight( pPair->m_value.flight );
+         detachItems.Add( pPair->m_key.item );
+         inFlight_.RemoveAtPos( posCurrent );
+         finishedEntries_--;
+      }
+   }
+}
+
+//DOM-IGNORE-END
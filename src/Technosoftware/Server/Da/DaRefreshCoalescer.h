@@ -0,0 +1,207 @@
+/*
+ * Copyright (c) 2020 Technosoftware GmbH. All rights reserved
+ * Web: https://technosoftware.com
+ *
+ * The source code in this file is covered under a dual-license scenario:
+ *   - Owner of a purchased license: SCLA 1.0
+ *   - GPL V3: everybody else
+ *
+ * SCLA license terms accompanied with this source code.
+ * See https://technosoftware.com/license/Source_Code_License_Agreement.pdf
+ *
+ * GNU General Public License as published by the Free Software Foundation;
+ * version 3 of the License are accompanied with this source code.
+ * See https://technosoftware.com/license/GPLv3License.txt
+ *
+ * This source code is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+#ifndef __REFRESHCOALESCER_H_
+#define __REFRESHCOALESCER_H_
+
+#if _MSC_VER >= 1000
+#pragma once
+#endif // _MSC_VER >= 1000
+
+//DOM-IGNORE-BEGIN
+
+#include <atlcoll.h>
+#include "DaBaseServer.h"
+
+/**
+ * @class	DaRefreshCoalescer
+ *
+ * @brief	Single-flight layer in front of DaBaseServer::OnRefreshInputCache().
+ *
+ * 			Device reads issued at the same time by different clients or groups for the same
+ * 			Device Items are merged: the first caller reads the items from the device, all
+ * 			other callers requesting one of these items wait for that refresh and share the
+ * 			individual item result instead of reading the device again.
+ *
+ * 			With a join window greater than 0 a finished refresh is also shared with callers
+ * 			arriving within the window after it has completed.
+ */
+
+class DaRefreshCoalescer
+{
+   public:
+
+      /**
+       * @fn	DaRefreshCoalescer::DaRefreshCoalescer( void );
+       *
+       * @brief	Constructor.
+       */
+
+      DaRefreshCoalescer( void );
+
+      /**
+       * @fn	DaRefreshCoalescer::~DaRefreshCoalescer();
+       *
+       * @brief	Releases all refreshes still referenced by the in-flight index.
+       */
+
+      ~DaRefreshCoalescer();
+
+      /**
+       * @fn	void DaRefreshCoalescer::SetEnabled( BOOL enabled );
+       *
+       * @brief	Enables or disables coalescing. If disabled all refresh requests are passed
+       * 			directly to OnRefreshInputCache(). Coalescing is disabled by default.
+       *
+       * @param	enabled	TRUE to enable coalescing.
+       */
+
+      void SetEnabled( BOOL enabled );
+
+      /**
+       * @fn	void DaRefreshCoalescer::SetJoinWindow( DWORD joinWindow );
+       *
+       * @brief	Sets the time in ms a finished device refresh can still be joined. The default
+       * 			0 shares only refreshes which are in progress.
+       *
+       * @param	joinWindow	The join window in ms.
+       */
+
+      void SetJoinWindow( DWORD joinWindow );
+
+      /**
+       * @fn	HRESULT DaRefreshCoalescer::Refresh( DaBaseServer* serverHandler, OPC_REFRESH_REASON reason, DWORD numItems, DaDeviceItem** deviceItems, HRESULT* errors );
+       *
+       * @brief	Refreshes the cache of the specified items. Items already refreshed by another
+       * 			caller for the same reason are not passed to OnRefreshInputCache() but get
+       * 			the result of that refresh.
+       *
+       * @param [in]		serverHandler	The server handler which implements OnRefreshInputCache().
+       * @param 			reason		 	The reason of the refresh.
+       * @param 			numItems	 	Number of items.
+       * @param [in]		deviceItems  	The Device Items. Entries may be NULL.
+       * @param [in,out]	errors		 	The individual item results. Entries of NULL items are
+       * 									not changed.
+       *
+       * @return	S_OK if the refresh succeeded for all items; otherwise S_FALSE.
+       */
+
+      HRESULT Refresh( DaBaseServer* serverHandler,
+                       OPC_REFRESH_REASON reason,
+                       DWORD numItems,
+                       DaDeviceItem** deviceItems,
+                       HRESULT* errors );
+
+      /**
+       * @fn	LONG DaRefreshCoalescer::DeduplicatedReads() const;
+       *
+       * @brief	Number of item reads served by a refresh of another caller.
+       *
+       * @return	The number of deduplicated item reads.
+       */
+
+      inline LONG DeduplicatedReads() const
+         {
+            return InterlockedCompareExchange( const_cast<LONG*>(&deduplicatedReads_), 0, 0 );
+         }
+
+   private:
+
+      /**
+       * @struct	Flight
+       *
+       * @brief	One device refresh with the results of all items read by it.
+       */
+
+      struct Flight
+      {
+         HANDLE   doneEvent;              // manual-reset, signaled if the refresh is finished
+         long     refCount;               // owner, index entries and joined callers
+         BOOL     finished;
+         DWORD    finishedTick;           // GetTickCount() when finished
+         HRESULT* errors;                 // individual item results
+      };
+
+      /**
+       * @struct	Key
+       *
+       * @brief	An item refreshed for a reason. Only refreshes with the same reason are joined.
+       */
+
+      struct Key
+      {
+         DaDeviceItem*        item;
+         OPC_REFRESH_REASON   reason;
+      };
+
+      /**
+       * @class	KeyTraits
+       *
+       * @brief	Hash and compare of the Key for CAtlMap.
+       */
+
+      class KeyTraits : public CElementTraitsBase<Key>
+      {
+         public:
+            static ULONG Hash( const Key& key )
+               {
+                  return CElementTraits<DaDeviceItem*>::Hash( key.item ) ^ (ULONG)key.reason;
+               }
+
+            static bool CompareElements( const Key& key1, const Key& key2 )
+               {
+                  return (key1.item == key2.item) && (key1.reason == key2.reason);
+               }
+      };
+
+      /**
+       * @struct	Slot
+       *
+       * @brief	Position of the result of an item within a refresh.
+       */
+
+      struct Slot
+      {
+         Flight*  flight;
+         DWORD    index;
+      };
+
+      Flight* CreateFlight( DWORD numItems );
+      void ReleaseFlight( Flight* flight );
+      BOOL IsExpired( Flight* flight, DWORD now );
+      void RemoveExpiredNoLock( DWORD now, CAtlArray<DaDeviceItem*>& detachItems );
+
+      /** @brief	Maps the Device Items currently refreshed and the reason to their result slot. */
+      CAtlMap<Key, Slot, KeyTraits> inFlight_;
+
+      /** @brief	Protects inFlight_ and the members of the flights. */
+      CRITICAL_SECTION criticalSection_;
+
+      /** @brief	Number of entries in inFlight_ whose refresh is finished. */
+      DWORD finishedEntries_;
+
+      LONG  enabled_;                     // Interlocked access
+      DWORD joinWindow_;
+      DWORD lastPurgeTick_;
+      LONG  deduplicatedReads_;           // Interlocked access
+};
+//DOM-IGNORE-END
+
+#endif // __REFRESHCOALESCER_H_
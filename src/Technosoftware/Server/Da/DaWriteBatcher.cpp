@@ -0,0 +1,239 @@
+/*
+ * Copyright (c) 2020 Technosoftware GmbH. All rights reserved
+ * Web: https://technosoftware.com 
+ * 
+ * The source code in this file is covered under a dual-license scenario:
+ *   - Owner of a purchased license: SCLA 1.0
+ *   - GPL V3: everybody else
+ *
+ * SCLA license terms accompanied with this source code.
+ * See https://technosoftware.com/license/Source_Code_License_Agreement.pdf
+ *
+ * GNU General Public License as published by the Free Software Foundation;
+ * version 3 of the License are accompanied with this source code.
+ * See https://technosoftware.com/license/GPLv3License.txt
+ *
+ * This source code is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+ //DOM-IGNORE-BEGIN
+
+#include "stdafx.h"
+#include "DaWriteBatcher.h"
+#include "DaDeviceItem.h"
+
+//=========================================================================
+// Constructor
+//=========================================================================
+DaWriteBatcher::DaWriteBatcher( void )
+{
+   openBatch_    = NULL;
+   window_       = 0;
+   mergedWrites_ = 0;
+   InitializeCriticalSection( &criticalSection_ );
+}
+
+
+
+//=========================================================================
+// Destructor
+//=========================================================================
+DaWriteBatcher::~DaWriteBatcher()
+{
+   _ASSERTE( openBatch_ == NULL );              // No write request must be pending
+   DeleteCriticalSection( &criticalSection_ );
+}
+
+
+
+//=========================================================================
+// SetWindow
+//=========================================================================
+void DaWriteBatcher::SetWindow( DWORD window )
+{
+   EnterCriticalSection( &criticalSection_ );
+   window_ = window;
+   LeaveCriticalSection( &criticalSection_ );
+}
+
+
+
+//=========================================================================
+// Write
+// -----
+//    Writes the values of the specified items via OnRefreshOutputDevices().
+//
+//    The first caller opens a new batch and becomes its owner. The owner
+//    waits for the batching window, closes the batch and writes all
+//    collected items. Callers arriving while the batch is open add their
+//    items to it and wait until it is written.
+//
+//    An item written more than once within the window is passed only
+//    once to the device with the value of the last write request. All
+//    callers which have written this item get the same result.
+//
+// return:
+//    S_OK if succeeded for all items; otherwise S_FALSE.
+//    Do not return other codes !
+//=========================================================================
+HRESULT DaWriteBatcher::Write( DaBaseServer* serverHandler,
+                               OPC_REFRESH_REASON reason,
+                               LPWSTR actorID,
+                               DWORD numItems,
+                               DaDeviceItem** deviceItems,
+                               OPCITEMVQT* itemVQTs,
+                               HRESULT* errors )
+{
+   _ASSERTE( serverHandler );
+
+   if (numItems == 0 || window_ == 0) {
+      // Batching disabled
+      return serverHandler->OnRefreshOutputDevices( reason, actorID, numItems, deviceItems, itemVQTs, errors );
+   }
+
+   DWORD* pdwIndex = new DWORD[ numItems ];
+   if (pdwIndex == NULL) {
+      return serverHandler->OnRefreshOutputDevices( reason, actorID, numItems, deviceItems, itemVQTs, errors );
+   }
+
+   BOOL     fOwner = FALSE;
+   Batch*   pBatch;
+   DWORD    dwWindow;
+   DWORD    i;
+
+   //
+   // Add the items to the open batch or open a new one
+   //
+   EnterCriticalSection( &criticalSection_ );
+
+   dwWindow = window_;
+   pBatch   = openBatch_;
+
+   if (pBatch && pBatch->reason != reason) {
+      pBatch = NULL;                            // Do not mix different refresh reasons
+   }
+   else if (pBatch == NULL) {
+      pBatch = CreateBatch( reason, actorID );
+      if (pBatch) {
+         openBatch_ = pBatch;
+         fOwner = TRUE;
+      }
+   }
+   else {
+      InterlockedIncrement( &pBatch->refCount );
+      if (wcscmp( pBatch->actorID, actorID ) != 0) {
+         pBatch->multipleActors = TRUE;
+      }
+   }
+
+   if (pBatch) {
+      for (i = 0; i < numItems; i++) {
+         pdwIndex[i] = 0;
+         if (deviceItems[i] == NULL) {
+            continue;
+         }
+         if (pBatch->index.Lookup( deviceItems[i], pdwIndex[i] )) {
+            pBatch->itemVQTs[ pdwIndex[i] ] = itemVQTs[i];  // Last writer wins
+            mergedWrites_++;
+            continue;
+         }
+         pdwIndex[i] = (DWORD)pBatch->items.Add( deviceItems[i] );
+         pBatch->itemVQTs.Add( itemVQTs[i] );
+         pBatch->errors.Add( S_OK );
+         pBatch->index.SetAt( deviceItems[i], pdwIndex[i] );
+      }
+   }
+
+   LeaveCriticalSection( &criticalSection_ );
+
+   if (pBatch == NULL) {
+      delete [] pdwIndex;
+      return serverHandler->OnRefreshOutputDevices( reason, actorID, numItems, deviceItems, itemVQTs, errors );
+   }
+
+   //
+   // Write the batch or wait until it is written
+   //
+   if (fOwner) {
+      Sleep( dwWindow );
+
+      EnterCriticalSection( &criticalSection_ );
+      openBatch_ = NULL;                        // No more items can be added
+      LeaveCriticalSection( &criticalSection_ );
+
+      serverHandler->OnRefreshOutputDevices(
+                        pBatch->reason,
+                        pBatch->multipleActors ? L"Multiple Clients" : pBatch->actorID,
+                        (DWORD)pBatch->items.GetCount(),
+                        pBatch->items.GetData(),
+                        pBatch->itemVQTs.GetData(),
+                        pBatch->errors.GetData() );
+
+      SetEvent( pBatch->doneEvent );
+   }
+   else {
+      WaitForSingleObject( pBatch->doneEvent, INFINITE );
+   }
+
+   //
+   // Collect the individual results
+   //
+   HRESULT hrRet = S_OK;
+   for (i = 0; i < numItems; i++) {
+      if (deviceItems[i] == NULL) {
+         continue;
+      }
+      errors[i] = pBatch->errors[ pdwIndex[i] ];
+      if (FAILED( errors[i] )) {
+         hrRet = S_FALSE;
+      }
+   }
+
+   ReleaseBatch( pBatch );
+   delete [] pdwIndex;
+
+   _ASSERTE( SUCCEEDED( hrRet ) );              // Must return S_OK or S_FALSE
+   return hrRet;
+}
+
+
+
+//=========================================================================
+// CreateBatch
+// -----------
+//    Creates a new batch referenced by the caller.
+//=========================================================================
+DaWriteBatcher::Batch* DaWriteBatcher::CreateBatch( OPC_REFRESH_REASON reason, LPWSTR actorID )
+{
+   Batch* pBatch = new Batch;
+   if (pBatch == NULL) {
+      return NULL;
+   }
+   pBatch->doneEvent = CreateEvent( NULL, TRUE, FALSE, NULL );
+   if (pBatch->doneEvent == NULL) {
+      delete pBatch;
+      return NULL;
+   }
+   pBatch->refCount       = 1;
+   pBatch->reason         = reason;
+   pBatch->actorID        = actorID;       // Valid while the owner is blocked
+   pBatch->multipleActors = FALSE;
+   return pBatch;
+}
+
+
+
+//=========================================================================
+// ReleaseBatch
+//=========================================================================
+void DaWriteBatcher::ReleaseBatch( Batch* batch )
+{
+   if (InterlockedDecrement( &batch->refCount ) == 0) {
+      CloseHandle( batch->doneEvent );
+      delete batch;
+   }
+}
+
+//DOM-IGNORE-END
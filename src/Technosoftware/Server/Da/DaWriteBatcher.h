@@ -0,0 +1,155 @@
+/*
+ * Copyright (c) 2020 Technosoftware GmbH. All rights reserved
+ * Web: https://technosoftware.com 
+ * 
+ * The source code in this file is covered under a dual-license scenario:
+ *   - Owner of a purchased license: SCLA 1.0
+ *   - GPL V3: everybody else
+ *
+ * SCLA license terms accompanied with this source code.
+ * See https://technosoftware.com/license/Source_Code_License_Agreement.pdf
+ *
+ * GNU General Public License as published by the Free Software Foundation;
+ * version 3 of the License are accompanied with this source code.
+ * See https://technosoftware.com/license/GPLv3License.txt
+ *
+ * This source code is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+#ifndef __WRITEBATCHER_H_
+#define __WRITEBATCHER_H_
+
+#if _MSC_VER >= 1000
+#pragma once
+#endif // _MSC_VER >= 1000
+
+//DOM-IGNORE-BEGIN
+
+#include <atlcoll.h>
+#include "DaBaseServer.h"
+
+/**
+ * @class	DaWriteBatcher
+ *
+ * @brief	Optional write aggregator in front of DaBaseServer::OnRefreshOutputDevices().
+ *
+ * 			The first write request opens a batch which is kept open for the configured window.
+ * 			Write requests from other clients and groups arriving within the window are added
+ * 			to the same batch. When the window expires all collected items are written with a
+ * 			single OnRefreshOutputDevices() call. If an item is written more than once within
+ * 			the window only the last written value is passed to the device (last writer wins).
+ *
+ * 			Each caller is blocked until the batch is written and gets the individual results
+ * 			of its own items.
+ */
+
+class DaWriteBatcher
+{
+   public:
+
+      /**
+       * @fn	DaWriteBatcher::DaWriteBatcher( void );
+       *
+       * @brief	Constructor. Batching is disabled by default.
+       */
+
+      DaWriteBatcher( void );
+
+      /**
+       * @fn	DaWriteBatcher::~DaWriteBatcher();
+       *
+       * @brief	Destructor.
+       */
+
+      ~DaWriteBatcher();
+
+      /**
+       * @fn	void DaWriteBatcher::SetWindow( DWORD window );
+       *
+       * @brief	Sets the time in ms a batch collects write requests before it is written to the
+       * 			device.
+       *
+       * @param	window	The batching window in ms. 0 disables batching and all write requests are
+       * 				passed directly to OnRefreshOutputDevices().
+       */
+
+      void SetWindow( DWORD window );
+
+      /**
+       * @fn	HRESULT DaWriteBatcher::Write( DaBaseServer* serverHandler, OPC_REFRESH_REASON reason, LPWSTR actorID, DWORD numItems, DaDeviceItem** deviceItems, OPCITEMVQT* itemVQTs, HRESULT* errors );
+       *
+       * @brief	Writes the specified values to the device. Returns after the batch containing
+       * 			the items has been written.
+       *
+       * @param [in]		serverHandler	The server handler which implements
+       * 									OnRefreshOutputDevices().
+       * @param 			reason		 	The reason of the write.
+       * @param [in]		actorID		 	The client name. If the batch contains requests of
+       * 									different clients 'Multiple Clients' is passed as actor
+       * 									ID to OnRefreshOutputDevices().
+       * @param 			numItems	 	Number of items.
+       * @param [in]		deviceItems  	The Device Items. Entries may be NULL.
+       * @param [in]		itemVQTs	 	The values to write.
+       * @param [in,out]	errors		 	The individual item results. Entries of NULL items are
+       * 									not changed.
+       *
+       * @return	S_OK if the write succeeded for all items; otherwise S_FALSE.
+       */
+
+      HRESULT Write( DaBaseServer* serverHandler,
+                     OPC_REFRESH_REASON reason,
+                     LPWSTR actorID,
+                     DWORD numItems,
+                     DaDeviceItem** deviceItems,
+                     OPCITEMVQT* itemVQTs,
+                     HRESULT* errors );
+
+      /**
+       * @fn	LONG DaWriteBatcher::MergedWrites() const;
+       *
+       * @brief	Number of item writes which were superseded by a later write of the same item
+       * 			within the same batch.
+       *
+       * @return	The number of merged item writes.
+       */
+
+      inline LONG MergedWrites() const { return mergedWrites_; }
+
+   private:
+
+      /**
+       * @struct	Batch
+       *
+       * @brief	The items and values collected within one batching window.
+       */
+
+      struct Batch
+      {
+         HANDLE                           doneEvent;     // manual-reset, signaled if written
+         long                             refCount;      // one reference for each caller
+         OPC_REFRESH_REASON               reason;
+         LPWSTR                           actorID;       // client name of the first caller
+         BOOL                             multipleActors;
+         CAtlArray<DaDeviceItem*>         items;
+         CAtlArray<OPCITEMVQT>            itemVQTs;      // shallow copies, callers are blocked
+         CAtlArray<HRESULT>               errors;
+         CAtlMap<DaDeviceItem*, DWORD>    index;         // position of an item in the arrays
+      };
+
+      Batch* CreateBatch( OPC_REFRESH_REASON reason, LPWSTR actorID );
+      void ReleaseBatch( Batch* batch );
+
+      /** @brief	The batch currently collecting write requests or NULL. */
+      Batch* openBatch_;
+
+      /** @brief	Protects openBatch_ and its members. */
+      CRITICAL_SECTION criticalSection_;
+
+      DWORD window_;
+      LONG  mergedWrites_;
+};
+//DOM-IGNORE-END
+
+#endif // __WRITEBATCHER_H_
@@ -24,6 +24,13 @@
 #include "UtilityFuncs.h"
 #include "VariantPack.h"
 #include "DaGenericGroup.h"
+#include "DaOutboundQueue.h"
+
+// Stream buffers up to this size are kept by the group for the next stream
+#define STREAMBUFFER_MAXPOOLED   (1024 * 1024)
+
+// Items read and sent at once by the update if only the callback size is limited
+#define UPDATE_WINDOW_ITEMS      1024
 
 //=================================================================================
 // DaGenericGroup::SendDataStream
@@ -46,15 +53,12 @@ HRESULT  DaGenericGroup::SendDataStream(
     OPCITEMSTATE  *pItemValues,
     DWORD          tid)
 {
-    DWORD             HdrSize, TotalSize;
+    DWORD             HdrSize;
     DWORD             n;
-    char             *gp;
-    HGLOBAL           gh;
     OPCGROUPHEADER   *GrpPtr;
     OPCITEMHEADER1   *ItemHdr1;   // With Time
     OPCITEMHEADER2   *ItemHdr2;   // Without Time
-    char             *DataPtr;
-    DWORD             vsize;
+    DWORD             dwOffset;
 
     HRESULT  hrStatus = S_OK;
     HRESULT  res = S_OK;
@@ -63,7 +67,17 @@ HRESULT  DaGenericGroup::SendDataStream(
         return S_OK;
     }
 
-    // Allocate the Data Stream
+    // Use the buffer of the previous stream. Another buffer is used
+    // if the stream of an other thread is currently created.
+    VariantStreamBuffer* pBuffer = (VariantStreamBuffer*)InterlockedExchangePointer((PVOID volatile*)&m_pStreamBuffer, NULL);
+    if (pBuffer == NULL) {
+        pBuffer = new VariantStreamBuffer;
+        if (pBuffer == NULL) {
+            return E_OUTOFMEMORY;
+        }
+    }
+
+    // The headers are followed by the packed values
     if (WithTime) {
         HdrSize = sizeof(OPCGROUPHEADER) + NumItems * sizeof(OPCITEMHEADER1);   // with time
     }
@@ -71,88 +85,62 @@ HRESULT  DaGenericGroup::SendDataStream(
         HdrSize = sizeof(OPCGROUPHEADER) + NumItems * sizeof(OPCITEMHEADER2);   // without time
     }
 
-    TotalSize = HdrSize;
+    if (pBuffer->Reset(HdrSize) == NULL) {
+        delete pBuffer;
+        return E_OUTOFMEMORY;                                                    // Not enough memory for group header.
+    }
+
+    // Sizes and values are determined in one pass. The headers are addressed
+    // by offset because the buffer may be moved when it grows.
     for (n = 0; n < NumItems; n++) {
-        long lsize = SizePackedVariant(&pItemValues[n].vDataValue);           // to calculate VARIANT size
-        if (lsize == -1) {                                                      // Version 1.3, AM
-            hrStatus = E_FAIL;
-            TotalSize = HdrSize;                                                 // Send only the Group Header
+        dwOffset = pBuffer->Size();
+        if (AppendPackedVariant(pBuffer, &pItemValues[n].vDataValue) == -1) {
+            hrStatus = pBuffer->OutOfMemory() ? E_OUTOFMEMORY : E_FAIL;
+            pBuffer->Truncate(HdrSize);                                          // Send only the Group Header
             NumItems = 0;
             break;
         }
-        TotalSize += lsize;
-    }
 
-    gh = GlobalAlloc(GMEM_FIXED + GMEM_SHARE, TotalSize);
-    if (gh == NULL) {                                                          // If there is not enough memory try to allocate
-        gh = GlobalAlloc(GMEM_FIXED + GMEM_SHARE, HdrSize);                   // memory only for the group header.
-        if (gh == NULL) {
-            return E_OUTOFMEMORY;                                                // Also not enough memory for group header.
+        // Get ItemHeader info and ItemValue
+        if (WithTime) {
+            ItemHdr1 = (OPCITEMHEADER1 *)(pBuffer->Data() + sizeof(OPCGROUPHEADER)) + n;
+            ItemHdr1->hClient = pItemValues[n].hClient;
+            ItemHdr1->wQuality = pItemValues[n].wQuality;
+            ItemHdr1->ftTimeStampItem = pItemValues[n].ftTimeStamp;
+            ItemHdr1->dwValueOffset = dwOffset;
+            ItemHdr1->wReserved = 0;
+        }
+        else {  // without time
+            ItemHdr2 = (OPCITEMHEADER2 *)(pBuffer->Data() + sizeof(OPCGROUPHEADER)) + n;
+            ItemHdr2->hClient = pItemValues[n].hClient;
+            ItemHdr2->wQuality = pItemValues[n].wQuality;
+            ItemHdr2->dwValueOffset = dwOffset;
+            ItemHdr2->wReserved = 0;
         }
-        hrStatus = E_OUTOFMEMORY;                                              // Send only the Group Header
-        TotalSize = HdrSize;
-        NumItems = 0;
-    }
-    gp = (char*)GlobalLock(gh);
 
-    GrpPtr = (OPCGROUPHEADER *)gp;
-    ItemHdr1 = (OPCITEMHEADER1 *)(gp + sizeof(OPCGROUPHEADER));   //With Time
-    ItemHdr2 = (OPCITEMHEADER2 *)ItemHdr1;                        //Without Time
-    DataPtr = gp + HdrSize;
+        if ((pItemValues[n].wQuality & OPC_QUALITY_MASK) != OPC_QUALITY_GOOD) {
+            hrStatus = S_FALSE;                     // One or more items has a quality status of BAD or UNCERTAIN.
+        }
+    }
+    pBuffer->Fit();
 
     // Fill in the Group header
-    GrpPtr->dwSize = TotalSize;
+    GrpPtr = (OPCGROUPHEADER *)pBuffer->Data();
+    GrpPtr->dwSize = pBuffer->Size();
     GrpPtr->dwItemCount = NumItems;
     GrpPtr->hClientGroup = m_hClientGroupHandle;
     GrpPtr->hrStatus = hrStatus;
     GrpPtr->dwTransactionID = tid;
 
-
-    if (SUCCEEDED(hrStatus)) {
-        // Fill in the Item Information
-        for (n = 0; n < NumItems; n++) {
-            // Get ItemHeader info and ItemValue
-            if (WithTime) {
-                ItemHdr1->hClient = pItemValues[n].hClient;
-                ItemHdr1->wQuality = pItemValues[n].wQuality;
-                ItemHdr1->ftTimeStampItem = pItemValues[n].ftTimeStamp;
-                ItemHdr1->dwValueOffset = (DWORD)(DataPtr - gp);
-                ItemHdr1->wReserved = 0;
-
-            }
-            else {  // without time
-                ItemHdr2->hClient = pItemValues[n].hClient;
-                ItemHdr2->wQuality = pItemValues[n].wQuality;
-                ItemHdr2->dwValueOffset = (DWORD)(DataPtr - gp);
-                ItemHdr2->wReserved = 0;
-            }
-
-            if ((pItemValues[n].wQuality & OPC_QUALITY_MASK) != OPC_QUALITY_GOOD) {
-                GrpPtr->hrStatus = S_FALSE;            // One or more items has a quality status of BAD or UNCERTAIN.
-            }
-
-            vsize = CopyPackVariant(DataPtr, &pItemValues[n].vDataValue);
-            if (vsize == -1) {                       // Version 1.3, AM
-                GrpPtr->dwSize = HdrSize;
-                GrpPtr->dwItemCount = 0;
-                GrpPtr->hrStatus = E_FAIL;
-                res = S_FALSE;     // stream sent, but with errror code
-                break;
-            }
-            DataPtr += vsize;
-            ItemHdr1++;
-            ItemHdr2++;
-        } //for
-    } // succeeded
-    else {
-        res = S_FALSE;
+    if (FAILED(hrStatus)) {
+        res = S_FALSE;     // stream sent, but with errror code
     }
 
     // Invoke the callback
     STGMEDIUM stm;
     FORMATETC fmt;
     stm.tymed = TYMED_HGLOBAL;
-    stm.hGlobal = gh;
+    stm.hGlobal = pBuffer->Handle();
     stm.pUnkForRelease = NULL;
 
     fmt.ptd = NULL;
@@ -203,8 +191,12 @@ HRESULT  DaGenericGroup::SendDataStream(
     }
     LeaveCriticalSection(&m_CallbackCritSec);
 
-    GlobalUnlock(gh);
-    GlobalFree(gh);                // free the buffer area
+    // Keep the buffer for the next stream unless it is very large
+    // or another buffer has been stored in the meantime.
+    if (pBuffer->Capacity() > STREAMBUFFER_MAXPOOLED ||
+        InterlockedCompareExchangePointer((PVOID volatile*)&m_pStreamBuffer, pBuffer, NULL) != NULL) {
+        delete pBuffer;
+    }
 
     return res;
 }
@@ -681,18 +673,22 @@ SendWriteDispExit2:
 // The return value may be used by the server to check
 // if the system is overloaded ( errors may return
 //
+//    If chunking is configured in the server the values are read,
+//    compared and sent in portions of items, so only the values of
+//    one portion are held at a time.
+//
 //    returns  E_FAIL if group ok but could not send
 //             S_OK   if group to kill or group ok and successfully sent
 //=========================================================================
 HRESULT DaGenericGroup::UpdateToClient(BOOL custom, BOOL WithTime, BOOL DataCallbackOnly)
 {
     long           i, TotGroupItems;
-    long           TotItemsToRead, TotItemsToTransmit;
+    long           TotItemsToRead;
     DaDeviceItem   **ppDItems, *pDItem;
     DaGenericItem  **ppGItems, *pGItem;
-    HRESULT        *pErr, res;
-    OPCITEMSTATE   *pItemStates;
+    HRESULT        res;
     DWORD          AccessRight;
+    long           lStart, lWindow;
 
     // while building arrays don't allow add and delete of items to group
     EnterCriticalSection(&m_ItemsCritSec);
@@ -722,7 +718,8 @@ HRESULT DaGenericGroup::UpdateToClient(BOOL custom, BOOL WithTime, BOOL DataCall
     res = m_oaItems.First(&i);
     while (SUCCEEDED(res)) {
         m_oaItems.GetElem(i, &pGItem);
-        if (pGItem && pGItem->get_Active()) {     // item must be existent and active
+        if (pGItem && pGItem->get_Active() &&     // item must be existent and active
+            pGItem->CheckSampledAndReset()) {     // and sampled since the last update
 
             if (pGItem->AttachDeviceItem(&pDItem) >= 0) {
                 // Item to be handled
@@ -752,13 +749,84 @@ HRESULT DaGenericGroup::UpdateToClient(BOOL custom, BOOL WithTime, BOOL DataCall
         goto UpdateToClient2;
     }
 
+    // Size of the portions handled at once
+    lWindow = (long)m_pServer->m_pServerHandler->GetDataChangeChunkItems();
+    if (lWindow == 0 && m_pServer->m_pServerHandler->GetDataChangeChunkBytes()) {
+        lWindow = UPDATE_WINDOW_ITEMS;            // Only the size of the callbacks is limited
+    }
+    if (lWindow == 0 || lWindow > TotItemsToRead) {
+        lWindow = TotItemsToRead;
+    }
+
+    res = E_FAIL;
+    for (lStart = 0; lStart < TotItemsToRead; lStart += lWindow) {
+        long lCount = TotItemsToRead - lStart;
+        if (lCount > lWindow) {
+            lCount = lWindow;
+        }
+        HRESULT hr = UpdateItemsToClient(custom, WithTime, DataCallbackOnly,
+            lCount, &ppGItems[lStart], &ppDItems[lStart]);
+        if (SUCCEEDED(hr) || FAILED(res)) {
+            res = hr;                             // At least one portion sent successfully
+        }
+        if (Killed() == TRUE) {
+            res = S_OK;                           // update aborted due to group being deleted
+            break;
+        }
+    }
+
+UpdateToClient2:
+    for (i = 0; i < TotItemsToRead; i++) {           // release the attached items
+        _ASSERTE(ppGItems[i]);
+        _ASSERTE(ppDItems[i]);
+        ppGItems[i]->Detach();
+        ppDItems[i]->Detach();
+    }
+    delete[] ppDItems;                          // free the device item array
+
+UpdateToClient1:
+    delete[] ppGItems;                          // free the generic item array
+
+UpdateToClient0:
+    return res;
+}
+
+
+
+//=========================================================================
+// UpdateItemsToClient
+// -------------------
+//    Reads the values of the specified items from the cache and sends
+//    the changed values to the client. The item arrays are reordered;
+//    the items remain attached.
+//
+//    returns  E_FAIL if group ok but could not send
+//             S_OK   if group to kill or group ok and successfully sent
+//=========================================================================
+HRESULT DaGenericGroup::UpdateItemsToClient(BOOL custom, BOOL WithTime, BOOL DataCallbackOnly,
+    long TotItemsToRead, DaGenericItem** ppGItems, DaDeviceItem** ppDItems)
+{
+    long           i;
+    long           TotItemsToTransmit;
+    DaDeviceItem   *pDItem;
+    DaGenericItem  *pGItem;
+    HRESULT        *pErr, res;
+    OPCITEMSTATE   *pItemStates;
+    long           TotBufferedItems, TotBufferedSamples;
+    BOOL           *pfBuffered;
+    long           NumOut;                      // The values sent to the client,
+    OPCITEMSTATE   *pOutStates;                 // differs from the changed items
+    HRESULT        *pOutErr;                    // if there are buffered samples
+    DaGenericItem  **ppOutGItems;
+    BOOL           *pfOutSamples;
+
     res = E_OUTOFMEMORY;                         // New default error code
     // Generate all required arrays with size TotItemsToRead
     pErr = (HRESULT *)pIMalloc->Alloc(TotItemsToRead * sizeof(HRESULT));
-    if (!pErr)        goto UpdateToClient2;
+    if (!pErr)        goto UpdateItemsToClient0;
 
     pItemStates = (OPCITEMSTATE *)pIMalloc->Alloc(TotItemsToRead * sizeof(OPCITEMSTATE));
-    if (!pItemStates) goto UpdateToClient3;
+    if (!pItemStates) goto UpdateItemsToClient1;
 
     for (i = 0; i < TotItemsToRead; i++) {
         pErr[i] = S_OK;
@@ -769,18 +837,29 @@ HRESULT DaGenericGroup::UpdateToClient(BOOL custom, BOOL WithTime, BOOL DataCall
 
     }
 
+    TotBufferedItems = 0;
+    TotBufferedSamples = 0;
+    pfBuffered = NULL;
+    NumOut = 0;
+    pOutStates = pItemStates;
+    pOutErr = pErr;
+    ppOutGItems = ppGItems;
+    pfOutSamples = NULL;                         // There are no samples
+
     // read current values of the items to be handled
     res = InternalRead(OPC_DS_CACHE,           // perform the read
         TotItemsToRead,
         ppDItems,
         pItemStates,
-        pErr
+        pErr,
+        NULL,
+        ppGItems                                // Use the conversions selected by the items
     );
     // Note : res is always S_OK or S_FALSE
 
     if (Killed() == TRUE) {
         res = S_OK;                               // update aborted due to group being deleted
-        goto UpdateToClient5;
+        goto UpdateItemsToClient2;
     }
 
     //
@@ -813,6 +892,36 @@ HRESULT DaGenericGroup::UpdateToClient(BOOL custom, BOOL WithTime, BOOL DataCall
             if (FAILED(res)) {
                 continue;
             }
+        }
+
+        BOOL fBuffered = ppGItems[i]->get_BufferEnable();
+        if (fBuffered) {
+            // The samples of buffered items are sent instead of the item value.
+            // The current value is the latest sample.
+            if (fItemValueChanged) {
+                ppGItems[i]->AddSample(pItemStates[i]);
+            }
+            DWORD dwSamples = ppGItems[i]->get_SampleCount();
+            if (dwSamples == 0) {
+                continue;
+            }
+            if (pfBuffered == NULL) {
+                pfBuffered = new BOOL[TotItemsToRead];
+                if (pfBuffered == NULL) {
+                    continue;                       // Samples are sent with the next update
+                }
+                for (long k = 0; k < TotItemsToRead; k++) {
+                    pfBuffered[k] = FALSE;
+                }
+            }
+            TotBufferedItems++;
+            TotBufferedSamples += dwSamples;
+        }
+        else if (!fItemValueChanged) {
+            continue;
+        }
+
+        {                                         // Item must be transmitted
             // Only items to transmit are stored in the array.
             // Move the item data in the array.
             if (TotItemsToTransmit != i) {
@@ -823,72 +932,348 @@ HRESULT DaGenericGroup::UpdateToClient(BOOL custom, BOOL WithTime, BOOL DataCall
                 VariantClear(&pItemStates[TotItemsToTransmit].vDataValue);
                 VariantCopy(&(pItemStates[TotItemsToTransmit].vDataValue), &(pItemStates[i].vDataValue));
                 pErr[TotItemsToTransmit] = pErr[i];
+
+                // Keep the item arrays aligned with the item states
+                pGItem = ppGItems[TotItemsToTransmit];
+                ppGItems[TotItemsToTransmit] = ppGItems[i];
+                ppGItems[i] = pGItem;
+                pDItem = ppDItems[TotItemsToTransmit];
+                ppDItems[TotItemsToTransmit] = ppDItems[i];
+                ppDItems[i] = pDItem;
+            }
+            if (pfBuffered) {
+                pfBuffered[TotItemsToTransmit] = fBuffered;
             }
             TotItemsToTransmit++;                  // keep this item
 
-        } // Item Value has changed
+        } // Item must be transmitted
     } // Handle all readable items
 
-    if (TotItemsToTransmit) {                   // There are items with changed values -> Transmit.
+    NumOut = TotItemsToTransmit;
+    if (TotBufferedItems) {
+        //
+        // Replace the buffered items by their samples. All samples are sent
+        // with the same callback in chronological order per item.
+        //
+        long n = TotItemsToTransmit - TotBufferedItems + TotBufferedSamples;
+        pOutStates = new OPCITEMSTATE[n];
+        pOutErr = new HRESULT[n];
+        ppOutGItems = new DaGenericItem*[n];
+        pfOutSamples = new BOOL[n];
+        if (!pOutStates || !pOutErr || !ppOutGItems || !pfOutSamples) {
+            NumOut = 0;                           // Samples are sent with the next update
+            res = E_OUTOFMEMORY;
+            goto UpdateItemsToClient2;
+        }
 
-        if (m_fCallbackEnable) {
-            CComObject<DaGroup>*  pCOMGroup;
+        n = 0;
+        for (i = 0; i < TotItemsToTransmit; i++) {
+            if (pfBuffered[i]) {
+                DWORD dwNum = ppGItems[i]->TakeSamples(&pOutStates[n], &pOutErr[n]);
+                while (dwNum--) {
+                    ppOutGItems[n] = ppGItems[i];
+                    pfOutSamples[n] = TRUE;       // Only coalesced if the queue is full
+                    n++;
+                }
+            }
+            else {
+                pOutStates[n] = pItemStates[i];    // Moves the VARIANT
+                VariantInit(&pItemStates[i].vDataValue);
+                pOutErr[n] = pErr[i];
+                ppOutGItems[n] = ppGItems[i];
+                pfOutSamples[n] = FALSE;
+                n++;
+            }
+        }
+        NumOut = n;
+    }
 
-            m_pServer->CriticalSectionCOMGroupList.BeginReading();       // lock reading
+    if (NumOut) {                               // There are items with changed values -> Transmit.
+
+        DaOutboundQueue* pQueue = m_pServer->GetOutboundQueue();
+        if (pQueue) {
+            // Delivered by the outbound queue of the client
+            BOOL* pfQueued = new BOOL[NumOut];
+            if (pfQueued) {
+                pQueue->Enqueue(m_hServerGroupHandle,
+                    custom, WithTime, DataCallbackOnly,
+                    NumOut,
+                    ppOutGItems,
+                    pfOutSamples,
+                    pOutStates,
+                    pOutErr,
+                    pfQueued);
+                for (i = 0; i < NumOut; i++) {
+                    if (!pfQueued[i]) {
+                        ppOutGItems[i]->ResetLastRead();  // Queue full, send again with next update
+                    }
+                }
+                delete[] pfQueued;
+                res = S_OK;
+                goto UpdateItemsToClient2;
+            }
+        }
+        res = TransmitToClient(custom, WithTime, DataCallbackOnly,
+            NumOut,
+            pOutStates,
+            pOutErr);
+    }
 
-            res = m_pServer->m_COMGroupList.GetElem(m_hServerGroupHandle, &pCOMGroup);
-            if (SUCCEEDED(res)) {
-                res = pCOMGroup->FireOnDataChange(TotItemsToTransmit, pItemStates, pErr);
+UpdateItemsToClient2:
+    if (pOutStates != pItemStates) {           // release the expanded arrays
+        if (pOutStates) {
+            for (i = 0; i < NumOut; i++) {
+                VariantClear(&pOutStates[i].vDataValue);
             }
+            delete[] pOutStates;
+        }
+        if (pOutErr)     delete[] pOutErr;
+        if (ppOutGItems) delete[] ppOutGItems;
+        if (pfOutSamples) delete[] pfOutSamples;
+    }
+    if (pfBuffered) {
+        delete[] pfBuffered;
+    }
 
-            m_pServer->CriticalSectionCOMGroupList.EndReading();     // unlock reading
+    for (i = 0; i < TotItemsToRead; i++) {           // release the item values
+        VariantClear(&pItemStates[i].vDataValue);
+    }
 
-        }
-        if (DataCallbackOnly == FALSE) {          // Also handle IAdviseSink callbacks.
+    pIMalloc->Free(pItemStates);
+
+UpdateItemsToClient1:
+    pIMalloc->Free(pErr);                      // release error array
 
-            if (custom) {
-                // now pack and send the read values to the requesting client
-                res = SendDataStream(WithTime,
-                    TotItemsToTransmit,
-                    pItemStates,
-                    0);          // Transaction Id
+UpdateItemsToClient0:
+    return res;
+}
+
+
+
+//=========================================================================
+// TransmitToClient
+// ----------------
+//    Sends the changed item values to the client via the registered
+//    IOPCDataCallback and the IAdviseSink connections.
+//
+//    If chunking is configured in the server the items are sent with
+//    a sequence of callbacks, each limited to the configured number of
+//    items and estimated size of the values.
+//
+//    returns  E_FAIL if group ok but could not send
+//             S_OK   if successfully sent
+//=========================================================================
+HRESULT DaGenericGroup::TransmitToClient(BOOL custom, BOOL WithTime, BOOL DataCallbackOnly,
+    long NumItems, OPCITEMSTATE* pItemStates, HRESULT* pErr)
+{
+    DWORD   dwMaxItems = m_pServer->m_pServerHandler->GetDataChangeChunkItems();
+    DWORD   dwMaxBytes = m_pServer->m_pServerHandler->GetDataChangeChunkBytes();
+
+    if ((dwMaxItems == 0 || (DWORD)NumItems <= dwMaxItems) && dwMaxBytes == 0) {
+        return TransmitChunkToClient(custom, WithTime, DataCallbackOnly, NumItems, pItemStates, pErr);
+    }
+
+    DWORD   dwHdrSize = WithTime ? sizeof(OPCITEMHEADER1) : sizeof(OPCITEMHEADER2);
+    HRESULT res = E_FAIL;
+    long    lStart = 0;
+
+    while (lStart < NumItems) {
+        long  lCount = 0;
+        DWORD dwBytes = 0;
+        while (lStart + lCount < NumItems) {
+            if (dwMaxItems && (DWORD)lCount >= dwMaxItems) {
+                break;
             }
-            else {
-                res = SendDataStreamDisp(WithTime,
-                    TotItemsToTransmit,
-                    pItemStates,
-                    0);           // Transaction Id
+            long lSize = SizePackedVariant(&pItemStates[lStart + lCount].vDataValue);
+            DWORD dwItemBytes = dwHdrSize + ((lSize > 0) ? (DWORD)lSize : 0);
+            if (dwMaxBytes && lCount && (dwBytes + dwItemBytes) > dwMaxBytes) {
+                break;                                  // At least one item per callback
             }
+            dwBytes += dwItemBytes;
+            lCount++;
+        }
+
+        HRESULT hr = TransmitChunkToClient(custom, WithTime, DataCallbackOnly,
+            lCount, &pItemStates[lStart], &pErr[lStart]);
+        if (SUCCEEDED(hr) || FAILED(res)) {
+            res = hr;                                   // At least one chunk sent successfully
         }
-        // At least sent one value successfully
+        lStart += lCount;
+    }
+    return res;
+}
+
+
+
+//=========================================================================
+// TransmitChunkToClient
+// ---------------------
+//    Sends the specified item values with a single callback to the
+//    client via the registered IOPCDataCallback and the IAdviseSink
+//    connections.
+//
+//    returns  E_FAIL if group ok but could not send
+//             S_OK   if successfully sent
+//=========================================================================
+HRESULT DaGenericGroup::TransmitChunkToClient(BOOL custom, BOOL WithTime, BOOL DataCallbackOnly,
+    long NumItems, OPCITEMSTATE* pItemStates, HRESULT* pErr)
+{
+    HRESULT res = S_OK;
+
+    if (m_fCallbackEnable) {
+        CComObject<DaGroup>*  pCOMGroup;
+
+        // The read lock is held during the callback. The final Release()
+        // of the COM group waits for it in ~DaGroup() before the group is
+        // freed.
+        m_pServer->CriticalSectionCOMGroupList.BeginReading();       // lock reading
+
+        res = m_pServer->m_COMGroupList.GetElem(m_hServerGroupHandle, &pCOMGroup);
         if (SUCCEEDED(res)) {
-            res = CoFileTimeNow(&m_pServer->m_LastUpdateTime);
+            res = pCOMGroup->FireOnDataChange(NumItems, pItemStates, pErr);
         }
+
+        m_pServer->CriticalSectionCOMGroupList.EndReading();     // unlock reading
+
+    }
+    if (DataCallbackOnly == FALSE) {          // Also handle IAdviseSink callbacks.
+
+        if (custom) {
+            // now pack and send the read values to the requesting client
+            res = SendDataStream(WithTime,
+                NumItems,
+                pItemStates,
+                0);          // Transaction Id
+        }
+        else {
+            res = SendDataStreamDisp(WithTime,
+                NumItems,
+                pItemStates,
+                0);           // Transaction Id
+        }
+    }
+    // At least sent one value successfully
+    if (SUCCEEDED(res)) {
+        res = CoFileTimeNow(&m_pServer->m_LastUpdateTime);
     }
 
-UpdateToClient5:
-    for (i = 0; i < TotItemsToRead; i++) {           // release the item values
-        VariantClear(&pItemStates[i].vDataValue);
+    return res;
+}
+
+
+
+//=========================================================================
+// SampleItems
+// -----------
+//    Called by the update thread with each base update cycle of an
+//    active group. Samples the items with an own sampling rate which are
+//    due with this cycle.
+//
+//    Only items with enabled buffering are read from the cache. Changed
+//    values are stored in the sample buffer of the item and are sent with
+//    the next update of the group. Items without buffering are only
+//    marked as sampled; the update of the group reads their value.
+//=========================================================================
+HRESULT DaGenericGroup::SampleItems(void)
+{
+    long           i, TotGroupItems, TotItemsToRead;
+    DaDeviceItem   **ppDItems, *pDItem;
+    DaGenericItem  **ppGItems, *pGItem;
+    HRESULT        *pErr, res;
+    OPCITEMSTATE   *pItemStates;
+    DWORD          AccessRight, dwBaseUpdateRate;
+
+    if (m_lNumSampledItems == 0) {
+        return S_OK;                            // All items use the group update rate
     }
 
-    pIMalloc->Free(pItemStates);
+    dwBaseUpdateRate = GetActualBaseUpdateRate();
 
-UpdateToClient3:
-    pIMalloc->Free(pErr);                      // release error array
+    EnterCriticalSection(&m_ItemsCritSec);
+
+    TotGroupItems = m_oaItems.TotElem();
+    ppGItems = new DaGenericItem*[TotGroupItems];
+    ppDItems = new DaDeviceItem*[TotGroupItems];
+    if (!ppGItems || !ppDItems) {
+        LeaveCriticalSection(&m_ItemsCritSec);
+        if (ppGItems) delete[] ppGItems;
+        if (ppDItems) delete[] ppDItems;
+        return E_OUTOFMEMORY;
+    }
+
+    TotItemsToRead = 0;
+    res = m_oaItems.First(&i);
+    while (SUCCEEDED(res)) {
+        m_oaItems.GetElem(i, &pGItem);
+        if (pGItem && pGItem->get_Active() &&
+            pGItem->SampleTick(dwBaseUpdateRate) &&
+            pGItem->get_BufferEnable()) {
+
+            if (pGItem->AttachDeviceItem(&pDItem) >= 0) {
+                res = pGItem->get_AccessRights(&AccessRight);
+                if (SUCCEEDED(res) &&
+                    ((AccessRight & OPC_READABLE) != 0)) {
+
+                    ppGItems[TotItemsToRead] = pGItem;
+                    ppDItems[TotItemsToRead] = pDItem;
+                    pGItem->Attach();
+                    TotItemsToRead++;
+                }
+                else {
+                    pDItem->Detach();
+                }
+            }
+        }
+        res = m_oaItems.Next(i, &i);
+    }
+    LeaveCriticalSection(&m_ItemsCritSec);
+
+    res = S_OK;
+    if (TotItemsToRead) {
+
+        pErr = new HRESULT[TotItemsToRead];
+        pItemStates = new OPCITEMSTATE[TotItemsToRead];
+        if (pErr && pItemStates) {
+
+            for (i = 0; i < TotItemsToRead; i++) {
+                pErr[i] = S_OK;
+                pItemStates[i].hClient = ppGItems[i]->get_ClientHandle();
+                VariantInit(&pItemStates[i].vDataValue);
+                V_VT(&pItemStates[i].vDataValue) = ppGItems[i]->get_RequestedDataType();
+            }
+
+            InternalRead(OPC_DS_CACHE, TotItemsToRead, ppDItems, pItemStates, pErr, NULL, ppGItems);
+
+            for (i = 0; i < TotItemsToRead; i++) {
+                BOOL fChanged = FALSE;
+                if (SUCCEEDED(pErr[i]) &&
+                    SUCCEEDED(ppGItems[i]->CompareLastRead(m_PercentDeadband,
+                        pItemStates[i].vDataValue,
+                        pItemStates[i].wQuality,
+                        fChanged)) &&
+                    fChanged) {
+
+                    if (SUCCEEDED(ppGItems[i]->AddSample(pItemStates[i]))) {
+                        ppGItems[i]->UpdateLastRead(pItemStates[i].vDataValue, pItemStates[i].wQuality);
+                    }
+                }
+                VariantClear(&pItemStates[i].vDataValue);
+            }
+        }
+        else {
+            res = E_OUTOFMEMORY;
+        }
+        if (pErr)        delete[] pErr;
+        if (pItemStates) delete[] pItemStates;
+    }
 
-UpdateToClient2:
     for (i = 0; i < TotItemsToRead; i++) {           // release the attached items
-        _ASSERTE(ppGItems[i]);
-        _ASSERTE(ppDItems[i]);
         ppGItems[i]->Detach();
         ppDItems[i]->Detach();
     }
-    delete[] ppDItems;                          // free the device item array
-
-UpdateToClient1:
-    delete[] ppGItems;                          // free the generic item array
+    delete[] ppDItems;
+    delete[] ppGItems;
 
-UpdateToClient0:
     return res;
 }
 
@@ -34,8 +34,51 @@ class OpenArray {
       long     size;         // highest used index          
       long     totElem;      // number of non NULL elements
       long     allOPCize;    // allocated memory (number of elements, not bytes)
+      long     freeHint;     // all elements below this index are in use
       T       *array;        // the array of elements of class T
 
+         ///////////////////////////////////////////////////////////////
+         //  Enlarges the array so that the given index can be stored.
+         //  The new elements are filled with NULLs.
+         ///////////////////////////////////////////////////////////////
+      int Grow( long idx )
+      {
+            long newallOPCize;
+            T *newarray;
+            long i;
+
+         if (allOPCize == 0) {                     // first allocation
+            newallOPCize = 4;
+         } else {
+            newallOPCize = allOPCize*2;            // standard enlargement
+         }
+
+               // Heuristic: new size = new allOPCize * 2
+         while( idx >= newallOPCize ) {
+            newallOPCize *= 2;
+         }
+
+            // Must allocate a new array filling the undefined elements with NULLs
+         newarray = new T[newallOPCize];
+         if( newarray == NULL ) {
+            return E_OUTOFMEMORY;                  // error
+         }
+
+         for( i = allOPCize ; i < newallOPCize ; i++ ) {
+            newarray[i] = NULL;                    // zero the allocated array
+         }
+         if( allOPCize > 0 ) {                     // copy old elements to new array
+                                                   // this could be done with memcpy
+            for( i = 0 ; i < allOPCize ; i++ ) {
+               newarray[i] = array[i];
+            }
+            delete [] array;                       // free old array
+         }
+         array = newarray;                         // switch to the new array
+         allOPCize = newallOPCize;
+         return S_OK;
+      }
+
    public:
       //!temp!//const static int E_OK;
       //!temp!//const static int E_NOTENOUGHMEMORY;
@@ -50,6 +93,7 @@ class OpenArray {
          allOPCize   = 0;
          size        = 0;
          totElem     = 0;
+         freeHint    = 1;
       }
 
          ///////////////////////////////////////////////////////////////
@@ -77,21 +121,44 @@ class OpenArray {
          ///////////////////////////////////////////////////////////////
          //  Returns the 1st free index.
          //  If new element is free then size+1 is returned.
+         //  The search starts at the free hint, so appending elements
+         //  is amortized O(1) instead of a scan of the whole array.
          ///////////////////////////////////////////////////////////////
       long New( void )
       {
             long i;
 
-         for( i=1 ; i < allOPCize ; ++i ) {        // search from 1 because element 0 is never used.
+                                                   // search from 1 because element 0 is never used.
+         for( i = (freeHint > 1) ? freeHint : 1 ; i < allOPCize ; ++i ) {
             if( array[i] == NULL ) {               // is free
+               freeHint = i;
                return i;
             }
          }
+         freeHint = allOPCize;
          return allOPCize;
       }
 
 
 
+         ///////////////////////////////////////////////////////////////
+         //  Preallocates the array for elements up to the given index
+         //  to avoid repeated enlargements when many elements are
+         //  added at once.
+         ///////////////////////////////////////////////////////////////
+      int Reserve( long idx )
+      {
+         if( idx < 0 ) {
+            return E_INVALIDARG;
+         }
+         if( idx < allOPCize ) {
+            return S_OK;
+         }
+         return Grow( idx );
+      }
+
+
+
 
 
          ///////////////////////////////////////////////////////////////
@@ -134,44 +201,14 @@ class OpenArray {
       int PutElem( long idx,     // element index
                    T    elem ) { // NULL deletes the entry
       
-            long newallOPCize;
-            T *newarray;
-            long i;
-      
          if( idx < 0 ) {                           // illegal index
             return E_INVALIDARG;
          }
          if( idx >= allOPCize ) {                  // above current size
-      
-            if (allOPCize == 0) {                  // first allocation
-               newallOPCize = 4;
-            } else {
-               newallOPCize = allOPCize*2;         // standard enlargement
-            }
-      
-                  // Heuristic: new size = new allOPCize * 2
-            while( idx >= newallOPCize ) {           
-               newallOPCize *= 2;
+            int res = Grow( idx );
+            if( res != S_OK ) {
+               return res;
             }
-      
-               // Must allocate a new array filling the undefined elements with NULLs
-            newarray = new T[newallOPCize];
-            if( newarray == NULL ) {
-               return E_OUTOFMEMORY;               // error
-            }
-      
-            for( i = allOPCize ; i < newallOPCize ; i++ ) {
-               newarray[i] = NULL;                 // zero the allocated array
-            }
-            if( allOPCize > 0 ) {                  // copy old elements to new array
-                                                   // this could be done with memcpy
-               for( i = 0 ; i < allOPCize ; i++ ) {
-                  newarray[i] = array[i];
-               }
-               delete [] array;                    // free old array
-            }
-            array = newarray;                      // switch to the new array
-            allOPCize = newallOPCize;
          }
                                      // now handle the element
          if( array[idx] != NULL ) {               // deleting a element
@@ -182,6 +219,12 @@ class OpenArray {
 
          if( elem != NULL ) {                     // inserting a element
             totElem ++;
+            if( idx == freeHint ) {
+               freeHint = idx+1;
+            }
+         }
+         else if( idx < freeHint ) {              // index is free again
+            freeHint = idx;
          }
          if( idx >= size ) {                      // adapt highest used index
             size = idx+1;
@@ -25,6 +25,9 @@
 //-----------------------------------------------------------------------
 #include "stdafx.h"
 #include <comdef.h>                             // for _bstr_t
+#include <float.h>                              // for FLT_MAX
+#include <math.h>
+#include <limits>
 #include "variantconversion.h"
 
 //=========================================================================
@@ -111,6 +114,26 @@ static HRESULT PutVariantArrayElementFromVariant(
 
 
 
+//=========================================================================
+// OpcErrorFromConversionError                                     INTERNAL
+// ---------------------------
+//    Converts the DISP_E_xxx error codes of a failed conversion to OPC
+//    error codes.
+//=========================================================================
+static HRESULT OpcErrorFromConversionError( HRESULT hr )
+{
+   switch (hr) {
+      // deactivated to avoid a problem in the CTT 2.00.7.1120
+      //case DISP_E_TYPEMISMATCH:         
+      case DISP_E_BADVARTYPE:    hr = OPC_E_BADTYPE;  break;
+      case DISP_E_OVERFLOW:      hr = OPC_E_RANGE;    break;
+   }
+   return hr;
+
+} // OpcErrorFromConversionError
+
+
+
 //=========================================================================
 // VariantFromVariant
 // ------------------
@@ -263,16 +286,316 @@ HRESULT VariantFromVariant(
 
    if (FAILED( hr )) {                          // Cannot get new value
       VariantClear( pvDest );                   // Initialize result value
+      hr = OpcErrorFromConversionError( hr );
+   }
+   return hr;
+
+} // VariantFromVariant
+
+
+
+//-------------------------------------------------------------------------
+// SPECIALIZED CONVERSIONS
+//-------------------------------------------------------------------------
+
+//=========================================================================
+// VarTypeTraits                                                   INTERNAL
+// -------------
+//    The C type of the numeric Variant types.
+//=========================================================================
+template <VARTYPE VT> struct VarTypeTraits;
+template <> struct VarTypeTraits<VT_I1>   { typedef CHAR     Type; };
+template <> struct VarTypeTraits<VT_UI1>  { typedef BYTE     Type; };
+template <> struct VarTypeTraits<VT_I2>   { typedef SHORT    Type; };
+template <> struct VarTypeTraits<VT_UI2>  { typedef USHORT   Type; };
+template <> struct VarTypeTraits<VT_I4>   { typedef LONG     Type; };
+template <> struct VarTypeTraits<VT_UI4>  { typedef ULONG    Type; };
+template <> struct VarTypeTraits<VT_R4>   { typedef FLOAT    Type; };
+template <> struct VarTypeTraits<VT_R8>   { typedef DOUBLE   Type; };
+
+
+
+//=========================================================================
+// NumericFromDouble                                               INTERNAL
+// -----------------
+//    Converts a double to a numeric type with the same rounding
+//    (round half to even) and range check as VariantChangeType().
+//=========================================================================
+template <class TDst>
+static inline HRESULT NumericFromDouble( double d, TDst* pDst )
+{
+   double r = floor( d + 0.5 );
+   if ((r - d) == 0.5 && fmod( r, 2.0 ) != 0.0) {
+      r -= 1.0;                                 // Round half to even
+   }
+   if (!(r >= (double)(std::numeric_limits<TDst>::min)() &&
+         r <= (double)(std::numeric_limits<TDst>::max)())) {
+      return DISP_E_OVERFLOW;                   // Also for NaN
+   }
+   *pDst = (TDst)r;
+   return S_OK;
+}
+
+template <>
+inline HRESULT NumericFromDouble<FLOAT>( double d, FLOAT* pDst )
+{
+   if (d > FLT_MAX || d < -FLT_MAX) {
+      return DISP_E_OVERFLOW;
+   }
+   *pDst = (FLOAT)d;
+   return S_OK;
+}
+
+template <>
+inline HRESULT NumericFromDouble<DOUBLE>( double d, DOUBLE* pDst )
+{
+   *pDst = d;
+   return S_OK;
+}
+
+
+
+//=========================================================================
+// ConvertNumeric                                                  INTERNAL
+// --------------
+//    Converts one numeric value. Conversions between integer types are
+//    done without floating point operations.
+//=========================================================================
+template <class TSrc, class TDst>
+static inline HRESULT ConvertNumeric( TSrc src, TDst* pDst )
+{
+   if (std::numeric_limits<TSrc>::is_integer && std::numeric_limits<TDst>::is_integer) {
+      LONGLONG ll = (LONGLONG)src;
+      if (ll < (LONGLONG)(std::numeric_limits<TDst>::min)() ||
+          ll > (LONGLONG)(std::numeric_limits<TDst>::max)()) {
+         return DISP_E_OVERFLOW;
+      }
+      *pDst = (TDst)src;
+      return S_OK;
+   }
+   return NumericFromDouble( (double)src, pDst );
+}
+
+
+
+//=========================================================================
+// NumericConverter                                                INTERNAL
+// ----------------
+//    Converts a simple numeric Variant to another numeric type.
+//    All simple types are stored at the start of the Variant data union.
+//=========================================================================
+template <VARTYPE VT_SRC, VARTYPE VT_DST>
+static HRESULT NumericConverter( LPVARIANT pvDest, VARTYPE vtRequested, const LPVARIANT pvSrc )
+{
+   typedef typename VarTypeTraits<VT_SRC>::Type TSrc;
+   typedef typename VarTypeTraits<VT_DST>::Type TDst;
+
+   if (V_VT( pvSrc ) != VT_SRC || vtRequested != VT_DST) {
+      return VariantFromVariant( pvDest, vtRequested, pvSrc );
+   }
+
+   TDst     val;
+   HRESULT  hr = ConvertNumeric( *(const TSrc*)&V_UI1( pvSrc ), &val );
+   if (FAILED( hr )) {
+      VariantClear( pvDest );
+      return OpcErrorFromConversionError( hr );
+   }
+   *(TDst*)&V_UI1( pvDest ) = val;
+   V_VT( pvDest ) = VT_DST;
+   return S_OK;
+}
+
+
+
+//=========================================================================
+// NumericArrayConverter                                           INTERNAL
+// ---------------------
+//    Converts a numeric Array-Variant to an Array-Variant with another
+//    numeric type. The elements are converted in one tight loop on the
+//    locked data of both arrays.
+//=========================================================================
+template <VARTYPE VT_SRC, VARTYPE VT_DST>
+static HRESULT NumericArrayConverter( LPVARIANT pvDest, VARTYPE vtRequested, const LPVARIANT pvSrc )
+{
+   typedef typename VarTypeTraits<VT_SRC>::Type TSrc;
+   typedef typename VarTypeTraits<VT_DST>::Type TDst;
+
+   if (V_VT( pvSrc ) != (VT_ARRAY | VT_SRC) || vtRequested != (VT_ARRAY | VT_DST)) {
+      return VariantFromVariant( pvDest, vtRequested, pvSrc );
+   }
+
+   SAFEARRAY*  psa = V_ARRAY( pvSrc );
+   TSrc HUGEP* pSrcData = NULL;
+   TDst HUGEP* pDstData = NULL;
 
-      switch (hr) {                             // Convert DISP_E_xxx error codes to OPC error codes
-         // deactivated to avoid a problem in the CTT 2.00.7.1120
-         //case DISP_E_TYPEMISMATCH:         
-         case DISP_E_BADVARTYPE:    hr = OPC_E_BADTYPE;  break;
-         case DISP_E_OVERFLOW:      hr = OPC_E_RANGE;    break;
+   HRESULT hr = SafeArrayAccessData( psa, (void HUGEP**)&pSrcData );
+   if (FAILED( hr )) {
+      return OpcErrorFromConversionError( hr );
+   }
+
+   V_VT( pvDest )    = vtRequested;          //  Create the destination Array-Variant
+   V_ARRAY( pvDest ) = SafeArrayCreate( VT_DST, 1, psa->rgsabound );
+   if (!V_ARRAY( pvDest )) {
+      hr = E_OUTOFMEMORY;
+   }
+   else {
+      hr = SafeArrayAccessData( V_ARRAY( pvDest ), (void HUGEP**)&pDstData );
+      if (SUCCEEDED( hr )) {
+         ULONG cElements = psa->rgsabound[0].cElements;
+         for (ULONG i = 0; i < cElements; i++) {
+            hr = ConvertNumeric( pSrcData[i], &pDstData[i] );
+            if (FAILED( hr )) break;
+         }
+         SafeArrayUnaccessData( V_ARRAY( pvDest ) );
       }
    }
+   SafeArrayUnaccessData( psa );
+
+   if (FAILED( hr )) {
+      VariantClear( pvDest );
+      hr = OpcErrorFromConversionError( hr );
+   }
    return hr;
+}
 
-} // VariantFromVariant
+
+
+//=========================================================================
+// IntegerToBstrConverter                                          INTERNAL
+// ----------------------
+//    Converts a simple integer Variant to VT_BSTR. The text is the same
+//    as the one returned by VariantChangeType() (decimal, no grouping).
+//=========================================================================
+template <VARTYPE VT_SRC>
+static HRESULT IntegerToBstrConverter( LPVARIANT pvDest, VARTYPE vtRequested, const LPVARIANT pvSrc )
+{
+   typedef typename VarTypeTraits<VT_SRC>::Type TSrc;
+
+   if (V_VT( pvSrc ) != VT_SRC || vtRequested != VT_BSTR) {
+      return VariantFromVariant( pvDest, vtRequested, pvSrc );
+   }
+
+   WCHAR szValue[24];
+   TSrc  val = *(const TSrc*)&V_UI1( pvSrc );
+   if (std::numeric_limits<TSrc>::is_signed) {
+      _i64tow_s( (LONGLONG)val, szValue, _countof( szValue ), 10 );
+   }
+   else {
+      _ui64tow_s( (ULONGLONG)val, szValue, _countof( szValue ), 10 );
+   }
+
+   V_BSTR( pvDest ) = SysAllocString( szValue );
+   if (V_BSTR( pvDest ) == NULL) {
+      return E_OUTOFMEMORY;
+   }
+   V_VT( pvDest ) = VT_BSTR;
+   return S_OK;
+}
+
+
+
+//=========================================================================
+// Conversion tables                                               INTERNAL
+// -----------------
+//    Indexed by NumericTypeIndex() of the source and requested types.
+//=========================================================================
+#define NUM_NUMERIC_TYPES  8
+
+#define NUMERIC_CONVERTER_ROW( CONVERTER, VT_SRC )                            \
+   { CONVERTER<VT_SRC, VT_I1>, CONVERTER<VT_SRC, VT_UI1>,                     \
+     CONVERTER<VT_SRC, VT_I2>, CONVERTER<VT_SRC, VT_UI2>,                     \
+     CONVERTER<VT_SRC, VT_I4>, CONVERTER<VT_SRC, VT_UI4>,                     \
+     CONVERTER<VT_SRC, VT_R4>, CONVERTER<VT_SRC, VT_R8> }
+
+#define NUMERIC_CONVERTER_TABLE( CONVERTER )                                  \
+   { NUMERIC_CONVERTER_ROW( CONVERTER, VT_I1 ),                               \
+     NUMERIC_CONVERTER_ROW( CONVERTER, VT_UI1 ),                              \
+     NUMERIC_CONVERTER_ROW( CONVERTER, VT_I2 ),                               \
+     NUMERIC_CONVERTER_ROW( CONVERTER, VT_UI2 ),                              \
+     NUMERIC_CONVERTER_ROW( CONVERTER, VT_I4 ),                               \
+     NUMERIC_CONVERTER_ROW( CONVERTER, VT_UI4 ),                              \
+     NUMERIC_CONVERTER_ROW( CONVERTER, VT_R4 ),                               \
+     NUMERIC_CONVERTER_ROW( CONVERTER, VT_R8 ) }
+
+static const VARIANTCONVERTER s_aNumericConverters[ NUM_NUMERIC_TYPES ][ NUM_NUMERIC_TYPES ] =
+   NUMERIC_CONVERTER_TABLE( NumericConverter );
+
+static const VARIANTCONVERTER s_aNumericArrayConverters[ NUM_NUMERIC_TYPES ][ NUM_NUMERIC_TYPES ] =
+   NUMERIC_CONVERTER_TABLE( NumericArrayConverter );
+
+static const VARIANTCONVERTER s_aBstrConverters[ NUM_NUMERIC_TYPES ] = {
+   IntegerToBstrConverter<VT_I1>, IntegerToBstrConverter<VT_UI1>,
+   IntegerToBstrConverter<VT_I2>, IntegerToBstrConverter<VT_UI2>,
+   IntegerToBstrConverter<VT_I4>, IntegerToBstrConverter<VT_UI4>,
+   NULL,                            // Floating point to text depends on the locale
+   NULL };
+
+#undef NUMERIC_CONVERTER_TABLE
+#undef NUMERIC_CONVERTER_ROW
+
+
+
+//=========================================================================
+// NumericTypeIndex                                                INTERNAL
+// ----------------
+//    Returns the index of a simple numeric type in the conversion
+//    tables or -1 if it is not a numeric type.
+//=========================================================================
+static int NumericTypeIndex( VARTYPE vt )
+{
+   switch (vt) {
+      case VT_I1:    return 0;
+      case VT_UI1:   return 1;
+      case VT_I2:    return 2;
+      case VT_UI2:   return 3;
+      case VT_I4:    return 4;
+      case VT_UI4:   return 5;
+      case VT_R4:    return 6;
+      case VT_R8:    return 7;
+      default:       return -1;
+   }
+}
+
+
+
+//=========================================================================
+// GetVariantConverter
+// -------------------
+//    For a description see the comments in the module header.
+//=========================================================================
+VARIANTCONVERTER GetVariantConverter(
+            /* [in]  */    VARTYPE vtSrc,
+            /* [in]  */    VARTYPE vtRequested )
+{
+   if (vtSrc == vtRequested || vtRequested == VT_EMPTY) {
+      return VariantFromVariant;                // Only a copy of the value
+   }
+
+   VARIANTCONVERTER pfnConverter = NULL;
+
+   if ((vtSrc & VT_ARRAY) && (vtRequested & VT_ARRAY)) {
+      int iSrc = NumericTypeIndex( vtSrc & VT_TYPEMASK );
+      int iDst = NumericTypeIndex( vtRequested & VT_TYPEMASK );
+      if (iSrc >= 0 && iDst >= 0) {
+         pfnConverter = s_aNumericArrayConverters[ iSrc ][ iDst ];
+      }
+   }
+   else if (!(vtSrc & VT_ARRAY) && !(vtRequested & VT_ARRAY)) {
+      int iSrc = NumericTypeIndex( vtSrc );
+      if (iSrc >= 0) {
+         if (vtRequested == VT_BSTR) {
+            pfnConverter = s_aBstrConverters[ iSrc ];
+         }
+         else {
+            int iDst = NumericTypeIndex( vtRequested );
+            if (iDst >= 0) {
+               pfnConverter = s_aNumericConverters[ iSrc ][ iDst ];
+            }
+         }
+      }
+   }
+   return pfnConverter ? pfnConverter : VariantFromVariant;
+
+} // GetVariantConverter
 
 //DOM-IGNORE-END
@@ -31,6 +31,26 @@ HRESULT VariantFromVariant(
             /* [out] */    LPVARIANT pvDest,
             /* [in]  */    VARTYPE vtRequested,
             /* [in]  */    const LPVARIANT pvSrc );
+
+//-----------------------------------------------------------------------
+// Converts the value of a Variant to the requested data type.
+// Has the same signature and results as VariantFromVariant().
+//-----------------------------------------------------------------------
+typedef HRESULT (*VARIANTCONVERTER)(
+            /* [out] */    LPVARIANT pvDest,
+            /* [in]  */    VARTYPE vtRequested,
+            /* [in]  */    const LPVARIANT pvSrc );
+
+//-----------------------------------------------------------------------
+// Returns the conversion function for a pair of source (canonical)
+// and requested data types. Specialized functions are returned for
+// conversions between the numeric types (also for arrays) and from
+// integer types to VT_BSTR; otherwise VariantFromVariant().
+// The returned function is never NULL.
+//-----------------------------------------------------------------------
+VARIANTCONVERTER GetVariantConverter(
+            /* [in]  */    VARTYPE vtSrc,
+            /* [in]  */    VARTYPE vtRequested );
 //DOM-IGNORE-END
 
 #endif
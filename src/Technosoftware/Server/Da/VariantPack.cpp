@@ -23,6 +23,9 @@
 #include "stdafx.h"
 #include "VariantPack.h"
 
+// Unused bytes of a stream buffer up to this size are kept by Fit()
+#define STREAMBUFFER_MINSLACK    (64 * 1024)
+
 //-----------------------------------------------------------------------
 // Returns the number of bytes needed to marshall a variant.
 // This can be used to compute the total size required for the stream.
@@ -270,5 +273,239 @@ long CopyPackVariant( char *dest, VARIANT *vp )
    return len;
 }
 
+
+
+
+
+//-----------------------------------------------------------------------
+// VariantStreamBuffer
+//-----------------------------------------------------------------------
+VariantStreamBuffer::VariantStreamBuffer( void )
+{
+   m_hGlobal      = NULL;
+   m_pData        = NULL;
+   m_dwSize       = 0;
+   m_dwCapacity   = 0;
+   m_fOutOfMemory = FALSE;
+}
+
+VariantStreamBuffer::~VariantStreamBuffer()
+{
+   if (m_hGlobal) {
+      GlobalFree( m_hGlobal );
+   }
+}
+
+char* VariantStreamBuffer::Reset( DWORD dwSize )
+{
+   m_dwSize = 0;
+   m_fOutOfMemory = FALSE;
+   return Append( dwSize );
+}
+
+char* VariantStreamBuffer::Append( DWORD dwSize )
+{
+   if (m_dwCapacity - m_dwSize < dwSize) {
+      if (!Grow( m_dwSize + dwSize )) {
+         m_fOutOfMemory = TRUE;
+         return NULL;
+      }
+   }
+   char* p = m_pData + m_dwSize;
+   m_dwSize += dwSize;
+   return p;
+}
+
+void VariantStreamBuffer::Truncate( DWORD dwSize )
+{
+   if (dwSize < m_dwSize) {
+      m_dwSize = dwSize;
+   }
+}
+
+//-----------------------------------------------------------------------
+// The used size is passed in the group header, so a small slack is
+// kept for the next stream. Only a slack larger than the used size and
+// larger than STREAMBUFFER_MINSLACK is released.
+//-----------------------------------------------------------------------
+void VariantStreamBuffer::Fit( void )
+{
+   DWORD dwSlack = m_dwCapacity - m_dwSize;
+
+   if (m_hGlobal && m_dwSize && dwSlack > m_dwSize && dwSlack > STREAMBUFFER_MINSLACK) {
+                                                            // Shrinking a fixed block is done in place
+      if (GlobalReAlloc( m_hGlobal, m_dwSize, 0 ) != NULL) {
+         m_dwCapacity = m_dwSize;
+      }
+   }
+}
+
+//-----------------------------------------------------------------------
+// Grows the buffer by at least the half of the current size so
+// appending many small values needs only a few reallocations.
+//-----------------------------------------------------------------------
+BOOL VariantStreamBuffer::Grow( DWORD dwSize )
+{
+   DWORD dwNew = m_dwCapacity + m_dwCapacity / 2;
+   if (dwNew < dwSize) {
+      dwNew = dwSize;
+   }
+   if (dwNew < 4096) {
+      dwNew = 4096;
+   }
+
+   HGLOBAL hNew;
+   if (m_hGlobal == NULL) {
+      hNew = GlobalAlloc( GMEM_FIXED + GMEM_SHARE, dwNew );
+   }
+   else {
+      hNew = GlobalReAlloc( m_hGlobal, dwNew, GMEM_MOVEABLE );
+   }
+   if (hNew == NULL) {
+      return FALSE;                                         // The current block is still valid
+   }
+   m_hGlobal    = hNew;
+   m_pData      = (char*)hNew;                              // Handle of fixed memory is the address
+   m_dwCapacity = dwNew;
+   return TRUE;
+}
+
+
+
+
+
+//-----------------------------------------------------------------------
+// Appends the VARIANT structure and the data for BSTR and Array types.
+// The length of each string and the size of each array is determined
+// only once.
+// If -1 is returned some error occured
+//-----------------------------------------------------------------------
+long AppendPackedVariant( VariantStreamBuffer* pBuffer, VARIANT* vp )
+{
+      HRESULT     hres;
+      SAFEARRAY*  pArr;
+      long        LBound, UBound;
+      long        i;
+      DWORD       nlen;
+      DWORD       dwStart;
+      VARTYPE     vtBase;
+      char*       dest;
+
+   vtBase = V_VT( vp );
+   if ((vtBase & VT_BYREF) != 0) {
+      return -1;                                            // Don't accept by ref
+   }
+
+   dwStart = pBuffer->Size();
+   dest = pBuffer->Append( sizeof (VARIANT) );
+   if (dest == NULL) {
+      return -1;
+   }
+   memcpy( dest, vp, sizeof (VARIANT) );                    // Copy the VARIANT structure
+
+   if ((vtBase & VT_ARRAY) != 0) {
+                                                            // This is a safe array!
+      vtBase = vtBase - VT_ARRAY;
+
+      pArr = V_ARRAY( vp );
+
+      if (SafeArrayGetDim( pArr ) != 1) {
+         return -1;                                         // Only one dimensional arrays supported by OPC V1.0A.
+      }
+      hres = SafeArrayGetLBound( pArr, 1, &LBound );        // Dimension always 1
+      if (FAILED( hres )) {
+         return -1;
+      }
+      hres = SafeArrayGetUBound( pArr, 1, &UBound );        // Dimension always 1
+      if (FAILED( hres )) {
+         return -1;
+      }
+      hres = SafeArrayLock( pArr );                         // Lock for direct array manipulations
+      if (FAILED( hres )) {
+         return -1;
+      }
+
+      BOOL fOk = TRUE;
+      dest = pBuffer->Append( sizeof (SAFEARRAY) );
+      if (dest == NULL) {
+         fOk = FALSE;
+      }
+      else {
+         memcpy( dest, pArr, sizeof (SAFEARRAY) );          // Copy SAFEARRAY data structure
+         ((SAFEARRAY *)dest)->pvData = NULL;
+      }
+
+      if (fOk && vtBase == VT_BSTR) {
+                                                            // It's an array of BSTRs
+         BSTR     bstr;
+
+         for (i=LBound; i<=UBound; i++) {                   // For size use <=
+
+            bstr = ((BSTR *)pArr->pvData)[i - LBound];      // Direct array memory access
+            nlen = (bstr == NULL) ? 0 : SysStringByteLen( bstr );
+
+            dest = pBuffer->Append( sizeof (DWORD) + nlen + sizeof (WCHAR) );
+            if (dest == NULL) {
+               fOk = FALSE;
+               break;
+            }
+            *((DWORD *)dest) = nlen;                        // Copy size of string
+            dest += sizeof (DWORD);
+            if (nlen > 0) {
+               memcpy( dest, bstr, nlen + sizeof (WCHAR) ); // Copy string with 00
+            }
+            else {
+               memset( dest, 0, sizeof (WCHAR) );           // Set only 00
+            }
+         }
+      }
+      else if (fOk && vtBase == VT_VARIANT) {
+                                                            // It's an array of VARIANTs
+         for (i=LBound; i<=UBound; i++) {                   // For size use <=
+                                                            // Recursive call
+            if (AppendPackedVariant( pBuffer, &((VARIANT *)pArr->pvData)[i - LBound] ) == -1) {
+               fOk = FALSE;
+               break;
+            }
+         }
+      }
+      else if (fOk) {                                       // Fixed size elements, copied at once
+                                                            // +1 for Array size
+         nlen = ((UBound - LBound)+1) * SafeArrayGetElemsize( pArr );
+         dest = pBuffer->Append( nlen );
+         if (dest == NULL) {
+            fOk = FALSE;
+         }
+         else {
+            memcpy( dest, pArr->pvData, nlen );
+         }
+      }
+
+      hres = SafeArrayUnlock( pArr );
+      if (!fOk || FAILED( hres )) {
+         return -1;
+      }
+   }
+   else if (vtBase == VT_BSTR) {
+                                                            // Simple type
+      nlen = (V_BSTR( vp ) == NULL) ? 0 : SysStringByteLen( V_BSTR( vp ) );
+
+      dest = pBuffer->Append( sizeof (DWORD) + nlen + sizeof (WCHAR) );
+      if (dest == NULL) {
+         return -1;
+      }
+      *((DWORD *)dest) = nlen;                              // Copy size of string
+      dest += sizeof (DWORD);
+      if (nlen > 0) {
+                                                            // Copy string with 00
+         memcpy( dest, V_BSTR( vp ), nlen + sizeof (WCHAR) );
+      }
+      else {
+         memset( dest, 0, sizeof (WCHAR) );                 // Set only 00
+      }
+   }
+   return (long)(pBuffer->Size() - dwStart);
+}
+
  
 //DOM-IGNORE-END
@@ -23,4 +23,58 @@ extern long SizePackedVariant( VARIANT *v);
 extern long CopyPackVariant( char *t, VARIANT *s);
 //NOTUSED extern long CopyUnpackVariant( VARIANT *vp, char * src);
 
+
+//-----------------------------------------------------------------------
+// Growable buffer for the data streams of the IDataObject callbacks.
+// The memory is allocated with GlobalAlloc( GMEM_FIXED ) so the handle
+// can be passed in a STGMEDIUM. The buffer can be reused for several
+// streams to avoid an allocation per callback.
+//-----------------------------------------------------------------------
+class VariantStreamBuffer
+{
+public:
+   VariantStreamBuffer( void );
+   ~VariantStreamBuffer();
+
+            // Discards the content and appends dwSize bytes (e.g. for the
+            // headers). Returns the address of the buffer or NULL if there
+            // is not enough memory.
+   char*    Reset( DWORD dwSize );
+
+            // Appends dwSize bytes and returns the address of the first
+            // one or NULL if there is not enough memory. Addresses
+            // returned before are no longer valid.
+   char*    Append( DWORD dwSize );
+
+            // Discards the content behind dwSize bytes.
+   void     Truncate( DWORD dwSize );
+
+            // Releases the unused memory if it is large. Must be called
+            // before the handle is passed to a client because marshaling
+            // copies the whole memory block.
+   void     Fit( void );
+
+   inline char*   Data( void ) const        { return m_pData; }
+   inline DWORD   Size( void ) const        { return m_dwSize; }
+   inline DWORD   Capacity( void ) const    { return m_dwCapacity; }
+   inline HGLOBAL Handle( void ) const      { return m_hGlobal; }
+   inline BOOL    OutOfMemory( void ) const { return m_fOutOfMemory; }
+
+private:
+   BOOL     Grow( DWORD dwSize );
+
+   HGLOBAL  m_hGlobal;
+   char*    m_pData;
+   DWORD    m_dwSize;                           // used bytes
+   DWORD    m_dwCapacity;                       // allocated bytes
+   BOOL     m_fOutOfMemory;                     // an append failed since Reset()
+};
+
+//-----------------------------------------------------------------------
+// Appends a packed variant in the same format as CopyPackVariant() but
+// with only one pass over strings and arrays.
+// If -1 is returned some error occured
+//-----------------------------------------------------------------------
+extern long AppendPackedVariant( VariantStreamBuffer* pBuffer, VARIANT* vp );
+
 //DOM-IGNORE-END
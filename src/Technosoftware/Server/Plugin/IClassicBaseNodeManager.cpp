@@ -100,6 +100,41 @@ HRESULT CreateOneItem(
     return hres;
 }
 
+/**
+ * @fn  static HRESULT CreateAnalogEUInfo(double minValue, double maxValue, LPVARIANT pvEUInfo)
+ *
+ * @brief   Creates the EU Info of an analog item. The EU Info contains exactly two doubles
+ *          corresponding to the LOW and HI EU range.
+ *
+ * @param   minValue        The LOW EU range.
+ * @param   maxValue        The HI EU range.
+ * @param [out] pvEUInfo    The created EU Info.
+ *
+ * @return  A HRESULT code with the result of the operation.
+ */
+
+static HRESULT CreateAnalogEUInfo(double minValue, double maxValue, LPVARIANT pvEUInfo)
+{
+    SAFEARRAYBOUND rgs;
+    rgs.cElements = 2;
+    rgs.lLbound = 0;
+
+    V_ARRAY(pvEUInfo) = SafeArrayCreate(VT_R8, 1, &rgs);
+    if (V_ARRAY(pvEUInfo) == nullptr) return E_OUTOFMEMORY;
+    V_VT(pvEUInfo) = VT_ARRAY | VT_R8;
+
+    long lElIndex = 0;                             // LOW EU range
+    HRESULT hres = SafeArrayPutElement(V_ARRAY(pvEUInfo), &lElIndex, &minValue);
+    if (SUCCEEDED(hres)) {
+        lElIndex++;                                 // HI  EU range
+        hres = SafeArrayPutElement(V_ARRAY(pvEUInfo), &lElIndex, &maxValue);
+    }
+    if (FAILED(hres)) {
+        VariantClear(pvEUInfo);
+    }
+    return hres;
+}
+
 HRESULT DLLCALL AddItem(LPWSTR itemId, DaAccessRights accessRights, LPVARIANT initValue, bool active, DaEuType euType, double minValue, double maxValue, void** deviceItem)
 {
     HRESULT hres = S_OK;
@@ -180,6 +215,96 @@ HRESULT DLLCALL AddAnalogItem(LPWSTR itemId, DaAccessRights accessRights, LPVARI
     return AddItem(itemId, accessRights, initValue, true, Analog, minValue, maxValue, deviceItem);
 }
 
+HRESULT DLLCALL AddItems(int numItems, DaItemDefinition* items, void** deviceItemHandles, HRESULT* errors)
+{
+    HRESULT hrRet = S_OK;
+    int i;
+
+    if (numItems <= 0) return S_OK;
+    if (items == nullptr) return E_INVALIDARG;
+
+    DeviceItem** ppItems = new DeviceItem*[numItems];
+    HRESULT* pErrors = new HRESULT[numItems];
+    int* pIndex = new int[numItems];
+    if (ppItems == nullptr || pErrors == nullptr || pIndex == nullptr) {
+        if (ppItems) delete[] ppItems;
+        if (pErrors) delete[] pErrors;
+        if (pIndex) delete[] pIndex;
+        return E_OUTOFMEMORY;
+    }
+
+    // Create the items
+    DWORD dwNumCreated = 0;
+    for (i = 0; i < numItems; i++) {
+        HRESULT hres = S_OK;
+        OPCEUTYPE eEUType = static_cast<OPCEUTYPE>(items[i].EuType);
+        VARIANT varEUInfo;
+        VariantInit(&varEUInfo);
+
+        if (deviceItemHandles != nullptr) {
+            deviceItemHandles[i] = nullptr;
+        }
+        if (eEUType == OPC_ANALOG) {
+            hres = CreateAnalogEUInfo(items[i].MinValue, items[i].MaxValue, &varEUInfo);
+        }
+        else if (eEUType != OPC_NOENUM) {
+            hres = E_INVALIDARG;                     // Enumerated EU needs the strings
+        }
+
+        DeviceItem* pItem = nullptr;
+        if (SUCCEEDED(hres)) {
+            pItem = new DeviceItem;                  // Allocate space for new server item.
+            hres = pItem ? S_OK : E_OUTOFMEMORY;
+        }
+        if (SUCCEEDED(hres)) {                     // Initialize new Item instance
+            hres = pItem->Create(items[i].ItemId, static_cast<DWORD>(items[i].AccessRights), &items[i].InitValue, items[i].Active,
+                0, nullptr, nullptr, eEUType, (eEUType == OPC_ANALOG) ? &varEUInfo : nullptr);
+        }
+        VariantClear(&varEUInfo);
+        VariantClear(&items[i].InitValue);
+
+        if (SUCCEEDED(hres)) {
+            ppItems[dwNumCreated] = pItem;
+            pIndex[dwNumCreated++] = i;
+        }
+        else {
+            if (pItem) delete pItem;
+            if (errors != nullptr) {
+                errors[i] = hres;
+            }
+            hrRet = S_FALSE;
+        }
+    }
+
+    // Add the items to the item list and the Server Address Space
+    if (dwNumCreated) {
+        HRESULT hres = gpDataServer->AddDeviceItems(dwNumCreated, ppItems, pErrors);
+        for (DWORD n = 0; n < dwNumCreated; n++) {
+            if (FAILED(hres)) {
+                pErrors[n] = hres;
+            }
+            i = pIndex[n];
+            if (errors != nullptr) {
+                errors[i] = pErrors[n];
+            }
+            if (SUCCEEDED(pErrors[n])) {
+                if (deviceItemHandles != nullptr) {
+                    deviceItemHandles[i] = ppItems[n];
+                }
+            }
+            else {
+                delete ppItems[n];                     // Not added to the server
+                hrRet = S_FALSE;
+            }
+        }
+    }
+
+    delete[] ppItems;
+    delete[] pErrors;
+    delete[] pIndex;
+    return hrRet;
+}
+
 HRESULT DLLCALL RemoveItem(void* deviceItem)
 {
     HRESULT hres;
@@ -453,6 +578,41 @@ HRESULT DLLCALL ProcessConditionStateChanges(int count, AeConditionState* condit
 #endif
 }
 
+HRESULT DLLCALL ProcessEvents(int count, AeEventDefinition* events, HRESULT* errors)
+{
+#ifdef _OPC_SRV_AE
+    if (count <= 0 || events == nullptr)
+    {
+        return E_INVALIDARG;
+    }
+
+    EVENTDATA* pEvents = new EVENTDATA[count];
+    if (pEvents == nullptr)
+    {
+        return E_OUTOFMEMORY;
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        pEvents[i].m_dwCatID = events[i].CategoryId;
+        pEvents[i].m_dwSrcID = events[i].SourceId;
+        pEvents[i].m_szMessage = events[i].Message;
+        pEvents[i].m_dwSeverity = events[i].Severity;
+        pEvents[i].m_szActorID = events[i].ActorId;
+        pEvents[i].m_dwAttrCount = events[i].AttributeCount;
+        pEvents[i].m_pvAttrValues = events[i].AttributeValues;
+        pEvents[i].m_pftTimeStamp = events[i].TimeStamp;
+    }
+
+    HRESULT hResult = gpEventServer->ProcessEvents(count, pEvents, errors);
+    delete[] pEvents;
+
+    return hResult;
+#else
+    return E_NOTIMPL;
+#endif
+}
+
 HRESULT DLLCALL AckCondition(int conditionId, LPWSTR comment)
 {
 #ifdef _OPC_SRV_AE
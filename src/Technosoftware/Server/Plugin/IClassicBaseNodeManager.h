@@ -531,6 +531,122 @@ public:
     void*   DeviceItemHandle;
 };
 
+/**
+ * @class   DaItemDefinition
+ *
+ * @brief   The definition of an item added with AddItems().
+ */
+
+class DaItemDefinition
+{
+    // Attributes
+public:
+    /**
+     * @brief   Fully qualified item name.
+     */
+
+    LPWSTR  ItemId;
+
+    /**
+     * @brief   Access rights of the item.
+     */
+
+    DaAccessRights  AccessRights;
+
+    /**
+     * @brief   Initial value and canonical data type of the item. The value is cleared by
+     *          AddItems().
+     */
+
+    VARIANT InitValue;
+
+    /**
+     * @brief   true to set the item in active state.
+     */
+
+    bool    Active;
+
+    /**
+     * @brief   Type of the Engineering Unit.
+     */
+
+    DaEuType    EuType;
+
+    /**
+     * @brief   Analog engineering unit, corresponding to the LOW EU range.
+     */
+
+    double  MinValue;
+
+    /**
+     * @brief   Analog engineering unit, corresponding to the HIGH EU range.
+     */
+
+    double  MaxValue;
+};
+
+/**
+ * @class   AeEventDefinition
+ *
+ * @brief   The definition of a Simple or Tracking Event generated with ProcessEvents().
+ */
+
+class AeEventDefinition
+{
+    // Attributes
+public:
+    /**
+     * @brief   Identifier of an existing Event Category.
+     */
+
+    int     CategoryId;
+
+    /**
+     * @brief   Identifier of an existing Event Source.
+     */
+
+    int     SourceId;
+
+    /**
+     * @brief   Message text string which describes the Event.
+     */
+
+    LPWSTR  Message;
+
+    /**
+     * @brief   The urgency of the Event in the range of 1 ... 1000.
+     */
+
+    int     Severity;
+
+    /**
+     * @brief   Text string which identifies the OPC Client which initiated the action resulting
+     *          the tracking\-related Event. A Simple Event is generated if this member is a NULL
+     *          pointer.
+     */
+
+    LPWSTR  ActorId;
+
+    /**
+     * @brief   Number of attribute values specified in AttributeValues.
+     */
+
+    int     AttributeCount;
+
+    /**
+     * @brief   Array of attribute values. The order and the types must be identical with the
+     *          attributes of the specified Event Category.
+     */
+
+    LPVARIANT   AttributeValues;
+
+    /**
+     * @brief   Occurrence time of the event. If NULL pointer then the current time is used.
+     */
+
+    LPFILETIME  TimeStamp;
+};
+
 /**
  * @}
  */
@@ -680,6 +796,33 @@ HRESULT AddItem(LPWSTR itemId, DaAccessRights accessRights, LPVARIANT initValue,
 
 HRESULT AddAnalogItem(LPWSTR itemId, DaAccessRights accessRights, LPVARIANT initValue, double minValue, double maxValue, void** deviceItemHandle = nullptr);
 
+/**
+ * @fn  HRESULT AddItems(int numItems, DaItemDefinition* items, void** deviceItemHandles, HRESULT* errors);
+ *
+ * @brief   This function is called by the customization plugin and adds several items to the
+ *          generic server cache with one call.
+ *          
+ *          The items are created and the browse hierarchy is built outside of the lock
+ *          protecting the server cache; the built hierarchy is then published with a single
+ *          locked operation. Use this method instead of calling AddItem for each item if a
+ *          large number of items is added, e.g. during the execution of
+ *          <see cref="OnCreateServerItems" text="OnCreateServerItems" />.
+ *
+ * @param           numItems            Number of items to add.
+ * @param [in,out]  items               The item definitions. The InitValue of each item is
+ *                                      cleared.
+ * @param [out]     deviceItemHandles   If non\-null, the function returns the created device
+ *                                      items. The handle is null for items which could not be
+ *                                      added.
+ * @param [out]     errors              If non\-null, the function returns the result for each
+ *                                      item. E_INVALIDARG if the item ID already exists.
+ *
+ * @return  A HRESULT code with the result of the operation. Returns S_OK if all items were
+ *          successfully added to the cache; S_FALSE if one or more items could not be added.
+ */
+
+HRESULT AddItems(int numItems, DaItemDefinition* items, void** deviceItemHandles = nullptr, HRESULT* errors = nullptr);
+
 /**
  * @brief    This function is called by the customization plugin and removes an item from the
  *             generic server cache. If
@@ -1165,6 +1308,26 @@ HRESULT ProcessSimpleEvent(int categoryId, int sourceId, LPWSTR message, int sev
 
 HRESULT ProcessTrackingEvent(int categoryId, int sourceId, LPWSTR message, int severity, LPWSTR actorId, int attributeCount, LPVARIANT attributeValues, LPFILETIME timeStamp);
 
+/**
+ * @fn  HRESULT ProcessEvents(int count, AeEventDefinition* events, HRESULT* errors);
+ *
+ * @brief   Generates several Simple and Tracking Events with one call.
+ *          
+ *          All events are validated and created with a single pass over the Event Sources and
+ *          Event Categories and are then forwarded with one notification to the subscriptions
+ *          of each connected client. Use this function instead of ProcessSimpleEvent() or
+ *          ProcessTrackingEvent() if events are generated in bursts.
+ *
+ * @param           count   Number of events in events.
+ * @param [in]      events  The event definitions.
+ * @param [out]     errors  If non\-null, the function returns the result for each event.
+ *
+ * @return  A HRESULT code with the result of the operation. Returns S_OK if all events were
+ *          successfully generated; S_FALSE if one or more events could not be generated.
+ */
+
+HRESULT ProcessEvents(int count, AeEventDefinition* events, HRESULT* errors = nullptr);
+
 /**
  * @fn  HRESULT ProcessConditionStateChanges(int count, AeConditionState* conditionStateChanges);
  *